@@ -39,6 +39,8 @@
 #include <clogs/scan.h>
 #include <clogs/reduce.h>
 #include <clogs/radixsort.h>
+#include <clogs/compact.h>
+#include <clogs/unique.h>
 
 /**
  * @mainpage
@@ -50,8 +52,8 @@
 /**
  * OpenCL primitives.
  *
- * The primary classes of interest are @ref Scan, @ref Reduce and @ref Radixsort, which
- * provide the algorithms. The other classes are utilities and helpers.
+ * The primary classes of interest are @ref Scan, @ref Reduce, @ref Radixsort,
+ * @ref Compact and @ref Unique, which provide the algorithms. The other classes are utilities and helpers.
  */
 namespace clogs
 {
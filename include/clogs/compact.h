@@ -0,0 +1,320 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Stream compaction primitive.
+ */
+
+#ifndef CLOGS_COMPACT_H
+#define CLOGS_COMPACT_H
+
+#include <clogs/visibility_push.h>
+#include <CL/cl.hpp>
+#include <cstddef>
+#include <string>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include <clogs/platform.h>
+#include <clogs/tune.h>
+
+namespace clogs
+{
+
+class CompactProblem;
+
+namespace detail
+{
+    class CompactProblem;
+    class Compact;
+
+    const CompactProblem &getDetail(const clogs::CompactProblem &);
+} // namespace detail
+
+/**
+ * Encapsulates the specifics of a stream compaction problem. After
+ * construction, use @ref setType to set the element type, and at least one of
+ * @ref setStencilType and @ref setPredicate to describe how elements are
+ * selected.
+ *
+ * An element is selected based on the value of a <em>predicate input</em>,
+ * which is the corresponding element of a separate stencil buffer if a
+ * stencil type is set, and otherwise the element itself. If a predicate is
+ * set, it is evaluated on the predicate input, otherwise the predicate input
+ * must be an integral scalar and non-zero values select the element.
+ */
+class CLOGS_API CompactProblem
+{
+private:
+    detail::CompactProblem *detail_;
+    friend const detail::CompactProblem &detail::getDetail(const clogs::CompactProblem &);
+
+public:
+    CompactProblem();
+    ~CompactProblem();
+    CompactProblem(const CompactProblem &);
+    CompactProblem &operator=(const CompactProblem &);
+
+    /**
+     * Set the type of the elements to compact.
+     *
+     * @param type      The element type
+     * @throw std::invalid_argument if @a type is void
+     */
+    void setType(const Type &type);
+
+    /**
+     * Set the type of the stencil (or flags) buffer. Use <code>Type()</code>
+     * (the default) to indicate that selection is based on the elements
+     * themselves.
+     */
+    void setStencilType(const Type &stencilType);
+
+    /**
+     * Set the predicate used to select elements. This is an OpenCL C
+     * expression in terms of a variable @c x, which holds the predicate input
+     * (see @ref CompactProblem). It must be a single line, and may not refer
+     * to any other variables. An empty string (the default) selects
+     * non-zero predicate inputs.
+     *
+     * Example: <code>problem.setPredicate("x &gt; 0.5f");</code>
+     *
+     * @throw std::invalid_argument if @a predicate contains a newline
+     */
+    void setPredicate(const std::string &predicate);
+
+    /**
+     * Set the autotuning policy.
+     */
+    void setTunePolicy(const TunePolicy &tunePolicy);
+};
+
+/**
+ * Stream compaction (select-if) primitive. It copies the selected elements of
+ * a buffer (preserving their order) to the start of an output buffer, and
+ * writes the number of selected elements to a buffer on the device. It can
+ * optionally also write the original indices of the selected elements.
+ *
+ * One instance of this class can be reused for multiple compactions, provided that
+ *  - calls to @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, ::size_t, ::size_t, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue" do not overlap; and
+ *  - their execution does not overlap.
+ *
+ * An instance of the class is specialized to a specific context, device, and
+ * problem.
+ *
+ * The implementation uses the same reduce-then-scan strategy as @ref Scan,
+ * with the final scan fused with the scatter of the selected elements.
+ */
+class CLOGS_API Compact : public Algorithm
+{
+private:
+    detail::Compact *getDetail() const;
+    detail::Compact *getDetailNonNull() const;
+    void construct(cl_context context, cl_device_id device, const CompactProblem &problem,
+                   cl_int &err, const char *&errStr);
+    void moveAssign(Compact &other);
+    friend void swap(Compact &, Compact &);
+
+protected:
+    void enqueue(cl_command_queue commandQueue,
+                 cl_mem inBuffer,
+                 cl_mem stencilBuffer,
+                 cl_mem outBuffer,
+                 cl_mem indicesBuffer,
+                 cl_mem countBuffer,
+                 ::size_t countPosition,
+                 ::size_t elements,
+                 cl_uint numEvents,
+                 const cl_event *events,
+                 cl_event *event,
+                 cl_int &err,
+                 const char *&errStr);
+
+public:
+    /**
+     * Default constructor. The object cannot be used in this state.
+     */
+    Compact();
+
+#ifdef CLOGS_HAVE_RVALUE_REFERENCES
+    Compact(Compact &&other) CLOGS_NOEXCEPT
+    {
+        moveConstruct(other);
+    }
+
+    Compact &operator=(Compact &&other) CLOGS_NOEXCEPT
+    {
+        moveAssign(other);
+        return *this;
+    }
+#endif
+
+    /**
+     * Constructor.
+     *
+     * @param context              OpenCL context to use
+     * @param device               OpenCL device to use.
+     * @param problem              Description of the specific compaction problem.
+     *
+     * @throw std::invalid_argument if @a problem is not supported on the device or is not initialized.
+     * @throw clogs::InternalError if there was a problem with initialization.
+     */
+    Compact(const cl::Context &context, const cl::Device &device, const CompactProblem &problem)
+    {
+        cl_int err;
+        const char *errStr;
+        construct(context(), device(), problem, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Constructor. This class will add new references to the @a context and @a device.
+     *
+     * @param context              OpenCL context to use
+     * @param device               OpenCL device to use.
+     * @param problem              Description of the specific compaction problem.
+     *
+     * @throw std::invalid_argument if @a problem is not supported on the device or is not initialized.
+     * @throw clogs::InternalError if there was a problem with initialization.
+     */
+    Compact(cl_context context, cl_device_id device, const CompactProblem &problem)
+    {
+        cl_int err;
+        const char *errStr;
+        construct(context, device, problem, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    ~Compact(); ///< Destructor
+
+    /**
+     * Enqueue a compaction operation on a command queue.
+     *
+     * Either or both of @a outBuffer and @a indicesBuffer may be
+     * <code>cl::Buffer()</code> if the corresponding output is not required.
+     * The indices are written as @c cl_uint.
+     *
+     * The number of selected elements is written as a @c cl_uint to
+     * @a countBuffer, so that it can be used by subsequent commands (for
+     * example, as a kernel argument or via a read) without the host having to
+     * wait for the compaction to complete.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The elements to compact.
+     * @param stencilBuffer        The stencil values (must be <code>cl::Buffer()</code> if there is no stencil type).
+     * @param outBuffer            The buffer to fill with the selected elements, or <code>cl::Buffer()</code>.
+     * @param indicesBuffer        The buffer to fill with indices of the selected elements, or <code>cl::Buffer()</code>.
+     * @param countBuffer          The buffer to which the number of selected elements is written.
+     * @param countPosition        The index (in units of @c cl_uint) at which to write the count.
+     * @param elements             The number of elements to process.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If an input buffer is not readable on the device.
+     * @throw cl::Error            If an output buffer is not writable on the device.
+     * @throw cl::Error            If the element range overruns a buffer.
+     * @throw cl::Error            If @a elements is zero.
+     * @throw cl::Error            If @a stencilBuffer is given but the problem has no stencil, or vice versa.
+     *
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * - The outputs do not overlap with each other or with the inputs.
+     * @post
+     * - After execution, the first @c n elements of @a outBuffer and
+     *   @a indicesBuffer hold the selected elements and their indices, where
+     *   @c n is the value written to @a countBuffer. The remaining elements
+     *   are unmodified.
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &inBuffer,
+                 const cl::Buffer &stencilBuffer,
+                 const cl::Buffer &outBuffer,
+                 const cl::Buffer &indicesBuffer,
+                 const cl::Buffer &countBuffer,
+                 ::size_t countPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> events_(events);
+        enqueue(commandQueue(), inBuffer(), stencilBuffer(), outBuffer(), indicesBuffer(),
+                countBuffer(), countPosition, elements,
+                events_.size(), events_.data(),
+                event != NULL ? &outEvent : NULL,
+                err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals reference
+    }
+
+    /// @overload
+    void enqueue(cl_command_queue commandQueue,
+                 cl_mem inBuffer,
+                 cl_mem stencilBuffer,
+                 cl_mem outBuffer,
+                 cl_mem indicesBuffer,
+                 cl_mem countBuffer,
+                 ::size_t countPosition,
+                 ::size_t elements,
+                 cl_uint numEvents = 0,
+                 const cl_event *events = NULL,
+                 cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueue(commandQueue, inBuffer, stencilBuffer, outBuffer, indicesBuffer,
+                countBuffer, countPosition, elements,
+                numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a compaction operation for a problem without a stencil.
+     *
+     * This is equivalent to calling
+     * @c enqueue(@a commandQueue, @a inBuffer, <code>cl::Buffer()</code>, @a outBuffer,
+     * @a indicesBuffer, @a countBuffer, @a countPosition, @a elements, @a events, @a event).
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &inBuffer,
+                 const cl::Buffer &outBuffer,
+                 const cl::Buffer &indicesBuffer,
+                 const cl::Buffer &countBuffer,
+                 ::size_t countPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL)
+    {
+        enqueue(commandQueue, inBuffer, cl::Buffer(), outBuffer, indicesBuffer,
+                countBuffer, countPosition, elements, events, event);
+    }
+};
+
+void swap(Compact &a, Compact &b);
+
+} // namespace clogs
+
+#endif /* !CLOGS_COMPACT_H */
@@ -125,6 +125,75 @@ enum CLOGS_API BaseType
     TYPE_DOUBLE
 };
 
+/**
+ * Enumeration of built-in binary operators for @ref Scan and @ref Reduce.
+ */
+enum CLOGS_API OperatorType
+{
+    OPERATOR_SUM,      ///< Addition (the default)
+    OPERATOR_MIN,      ///< Minimum (NaNs are ignored, as by @c fmin)
+    OPERATOR_MAX,      ///< Maximum (NaNs are ignored, as by @c fmax)
+    OPERATOR_AND,      ///< Bitwise and (integral types only)
+    OPERATOR_OR,       ///< Bitwise or (integral types only)
+    OPERATOR_XOR       ///< Bitwise exclusive or (integral types only)
+};
+
+/**
+ * Enumeration of ways in which @ref Scan can accumulate floating-point sums.
+ * The non-native modes reduce the rounding error of long scans, at some cost
+ * in performance. They only apply to sums of floating-point types.
+ */
+enum CLOGS_API ScanAccumulation
+{
+    SCAN_ACCUMULATE_NATIVE,       ///< Accumulate in the element type (the default)
+    SCAN_ACCUMULATE_COMPENSATED,  ///< Use Kahan compensated summation for long serial sums
+    SCAN_ACCUMULATE_WIDE          ///< Accumulate @c half in @c float and @c float in @c double
+};
+
+/**
+ * Statistics that @ref Reduce can compute together in a single pass. These
+ * are bit flags, which can be combined with bitwise or. The results are
+ * written in the order in which the flags are listed here.
+ */
+enum CLOGS_API ReduceStatistic
+{
+    REDUCE_STATISTIC_SUM = 1,           ///< Sum of the elements
+    REDUCE_STATISTIC_MIN = 2,           ///< Minimum element
+    REDUCE_STATISTIC_MAX = 4,           ///< Maximum element
+    REDUCE_STATISTIC_SUM_SQUARES = 8    ///< Sum of the squares of the elements
+};
+
+/**
+ * Selects whether @ref Reduce finds the position of an extreme element
+ * as well as its value. Ties are broken in favour of the lowest index.
+ */
+enum CLOGS_API ReduceIndex
+{
+    REDUCE_INDEX_NONE,      ///< Plain reduction (the default)
+    REDUCE_INDEX_ARGMIN,    ///< Find the minimum element and its index
+    REDUCE_INDEX_ARGMAX     ///< Find the maximum element and its index
+};
+
+/**
+ * Selects where @ref Radixsort, @ref Scan and @ref Reduce do their work.
+ * The host backend maps the buffers and runs a multi-threaded implementation
+ * on the CPU, which avoids the launch overheads of the kernels for small
+ * problems. It supports only built-in operators on scalar types, without
+ * transforms or conversions, and only the plain @c enqueue functions;
+ * anything else always runs on the device. Like the device backend, it does
+ * not block: the work runs on a worker thread once the wait list completes,
+ * and the returned event completes when the buffers have been unmapped.
+ *
+ * For @ref BACKEND_AUTO, the problem size at which the device overtakes the
+ * host is measured during autotuning, along with the other parameters.
+ */
+enum CLOGS_API Backend
+{
+    BACKEND_DEVICE,    ///< Always run on the OpenCL device (the default)
+    BACKEND_HOST,      ///< Run on the host (the problem must be supported there)
+    BACKEND_AUTO       ///< Run small problems on the host and large ones on the device
+};
+
 /**
  * Encapsulation of an OpenCL built-in type that can be stored in a buffer.
  *
@@ -88,6 +88,12 @@ public:
      * Set the autotuning policy.
      */
     void setTunePolicy(const TunePolicy &tunePolicy);
+
+    /**
+     * Set where the sort runs (see @ref Backend). The default is
+     * @ref BACKEND_DEVICE. The host backend supports all problems.
+     */
+    void setBackend(Backend backend);
 };
 
 /**
@@ -295,6 +301,23 @@ public:
 
 void swap(Radixsort &a, Radixsort &b);
 
+/**
+ * Sort keys and values in host memory, without using OpenCL. This is the
+ * implementation used by @ref BACKEND_HOST, and has the same semantics as
+ * @ref Radixsort::enqueue. The sort is stable.
+ *
+ * @param problem              Description of the sort.
+ * @param keys                 The keys to sort.
+ * @param values               The values to sort along with the keys, or @c NULL if there are none.
+ * @param elements             The number of elements to sort (may be zero).
+ * @param maxBits              Upper bound on the number of bits in any key, or 0 to use all bits.
+ *
+ * @throw std::invalid_argument if the key type is not set, or @a maxBits is too large.
+ */
+CLOGS_API void hostRadixsort(const RadixsortProblem &problem,
+                             void *keys, void *values,
+                             ::size_t elements, unsigned int maxBits = 0);
+
 } // namespace clogs
 
 #endif /* !CLOGS_RADIXSORT_H */
@@ -31,6 +31,7 @@
 #include <clogs/visibility_push.h>
 #include <CL/cl.hpp>
 #include <cstddef>
+#include <string>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -75,10 +76,126 @@ public:
      */
     void setType(const Type &type);
 
+    /**
+     * Set the type of the input elements, if it differs from the type set
+     * with @ref setType. The latter is then the type in which the reduction
+     * is computed, and each input element is converted to it as it is
+     * loaded. The two types must have the same number of components unless a
+     * transform is set with @ref setTransform. Use <code>Type()</code> (the
+     * default) to read the input as the element type.
+     */
+    void setInputType(const Type &inputType);
+
+    /**
+     * Set a transform that is applied to each input element as it is loaded,
+     * before it is reduced. It is an OpenCL C expression in terms of a
+     * variable @c x, which holds the input element (of the type set with
+     * @ref setInputType), and its value is converted to the element type. It
+     * must be a single line. An empty string (the default) reduces the input
+     * elements unchanged.
+     *
+     * Example: <code>problem.setTransform("x * x");</code> computes the sum
+     * of squares.
+     *
+     * @throw std::invalid_argument if @a transform contains a newline
+     */
+    void setTransform(const std::string &transform);
+
+    /**
+     * Set whether the reduction reads two input buffers. A binary reduction
+     * must be enqueued with @ref Reduce::enqueueBinary, and both inputs have
+     * the input type. Corresponding elements of the two inputs are combined
+     * by the transform, which is then an expression in @c x and @c y and
+     * defaults to their product, so that by default the dot product is
+     * computed.
+     *
+     * Example: <code>problem.setTransform("(x - y) * (x - y)");</code>
+     * computes the squared Euclidean distance.
+     */
+    void setBinary(bool binary);
+
+    /**
+     * Compute several statistics in one pass over the data, instead of a
+     * single reduction with the operator. @a statistics is a bitwise or of
+     * @ref ReduceStatistic flags, or 0 (the default) for a normal reduction.
+     * The selected statistics of the (transformed) elements are written to
+     * consecutive elements of the output, in the order in which
+     * @ref ReduceStatistic lists them, so the output must have room for one
+     * element per statistic. Statistics cannot be combined with a
+     * non-default operator.
+     *
+     * Example: <code>problem.setStatistics(REDUCE_STATISTIC_MIN | REDUCE_STATISTIC_MAX);</code>
+     * writes the minimum followed by the maximum.
+     *
+     * @throw std::invalid_argument if @a statistics contains unknown flags
+     */
+    void setStatistics(unsigned int statistics);
+
+    /**
+     * Compute the minimum or maximum element together with its index, instead
+     * of a reduction with the operator. A problem with an index must be
+     * enqueued with @ref Reduce::enqueueWithIndex. The index is the position
+     * of the element in the input buffer (not relative to the first element
+     * reduced), and ties are broken in favour of the lowest index. This is
+     * only supported for scalar types, and cannot be combined with
+     * statistics, two inputs or a non-default operator.
+     *
+     * @throw std::invalid_argument if @a index is not a valid @ref ReduceIndex
+     */
+    void setIndex(ReduceIndex index);
+
+    /**
+     * Set whether the result must be reproducible. Normally the order in
+     * which elements are combined depends on the autotuned parameters, so a
+     * floating-point sum may differ in the last bits between devices or
+     * after retuning. A reproducible reduction instead combines the
+     * (transformed) elements in a fixed pairwise tree: the range is padded
+     * with zeros to a power of two, adjacent elements are summed, then
+     * adjacent pairs of those sums, and so on. Since OpenCL requires
+     * correctly rounded single-precision addition, the result depends only
+     * on the input. It is tuned separately from a normal reduction, and is
+     * typically somewhat slower.
+     *
+     * This is only supported with the default operator and no statistics or
+     * index, and cannot be used with @ref Reduce::enqueueSegmented or
+     * @ref Reduce::enqueueColumns.
+     */
+    void setReproducible(bool reproducible);
+
+    /**
+     * Set the operator used to combine elements to one of the built-in
+     * operators. The default is @ref OPERATOR_SUM.
+     */
+    void setOperator(OperatorType op);
+
+    /**
+     * Set a user-defined operator used to combine elements. The operator is
+     * given as an OpenCL C expression in terms of two values @c a and @c b
+     * (of the element type). The operator must be associative and
+     * commutative, and @a identity must be an expression for its identity
+     * element. Each string must be a single line.
+     *
+     * Example: <code>problem.setCustomOperator("a * b", "1");</code> computes
+     * the product of the elements.
+     *
+     * @throw std::invalid_argument if either string is empty or contains a newline
+     */
+    void setCustomOperator(const std::string &expression, const std::string &identity);
+
     /**
      * Set the autotuning policy.
      */
     void setTunePolicy(const TunePolicy &tunePolicy);
+
+    /**
+     * Set where the reduction runs (see @ref Backend). The default is
+     * @ref BACKEND_DEVICE. The host backend supports plain unary reductions
+     * with a built-in operator on scalar types other than @c half, without
+     * an input type, transform, statistics, index or reproducibility. It is
+     * used by @ref Reduce::enqueue, but not by @ref Reduce::enqueueSegmented
+     * or @ref Reduce::enqueueColumns.
+     */
+    void setBackend(Backend backend);
 };
 
 /**
@@ -94,6 +211,11 @@ public:
  *
  * The implementation divides the data into a number of blocks, each of which
  * is reduced by a work-group. The last work-group handles the final reduction.
+ * Operators other than addition can be selected with
+ * @ref ReduceProblem::setOperator, and the elements can be transformed as they
+ * are loaded with @ref ReduceProblem::setTransform. Two inputs can be
+ * combined element-wise and reduced in one pass (for example, to compute a
+ * dot product) with @ref ReduceProblem::setBinary.
  */
 class CLOGS_API Reduce : public Algorithm
 {
@@ -131,6 +253,87 @@ protected:
                  cl_int &err,
                  const char *&errStr);
 
+    void enqueueBinary(cl_command_queue commandQueue,
+                       cl_mem inBuffer,
+                       cl_mem inBuffer2,
+                       cl_mem outBuffer,
+                       ::size_t first,
+                       ::size_t elements,
+                       ::size_t outPosition,
+                       cl_uint numEvents,
+                       const cl_event *events,
+                       cl_event *event,
+                       cl_int &err,
+                       const char *&errStr);
+
+    void enqueueBinary(cl_command_queue commandQueue,
+                       bool blocking,
+                       cl_mem inBuffer,
+                       cl_mem inBuffer2,
+                       void *out,
+                       ::size_t first,
+                       ::size_t elements,
+                       cl_uint numEvents,
+                       const cl_event *events,
+                       cl_event *event,
+                       cl_int &err,
+                       const char *&errStr);
+
+    void enqueueWithIndex(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          cl_mem indexBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          ::size_t indexPosition,
+                          cl_uint numEvents,
+                          const cl_event *events,
+                          cl_event *event,
+                          cl_int &err,
+                          const char *&errStr);
+
+    void enqueueWithIndex(cl_command_queue commandQueue,
+                          bool blocking,
+                          cl_mem inBuffer,
+                          void *out,
+                          cl_uint *index,
+                          ::size_t first,
+                          ::size_t elements,
+                          cl_uint numEvents,
+                          const cl_event *events,
+                          cl_event *event,
+                          cl_int &err,
+                          const char *&errStr);
+
+    void enqueueSegmented(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          cl_mem segmentOffsets,
+                          ::size_t numSegments,
+                          cl_uint numEvents,
+                          const cl_event *events,
+                          cl_event *event,
+                          cl_int &err,
+                          const char *&errStr);
+
+    void enqueueColumns(cl_command_queue commandQueue,
+                        cl_mem inBuffer,
+                        cl_mem outBuffer,
+                        ::size_t first,
+                        ::size_t rows,
+                        ::size_t columns,
+                        ::size_t rowStride,
+                        ::size_t outPosition,
+                        cl_uint numEvents,
+                        const cl_event *events,
+                        cl_event *event,
+                        cl_int &err,
+                        const char *&errStr);
+
 public:
     /**
      * Default constructor. The object cannot be used in this state.
@@ -196,7 +399,8 @@ public:
      * @param outBuffer            The buffer to which the result is written.
      * @param first                The index (in elements, not bytes) to begin the reduction.
      * @param elements             The number of elements to reduce.
-     * @param outPosition          The index (in elements, not bytes) at which to write the result.
+     * @param outPosition          The index (in elements, not bytes) at which to write the result
+     *                             (or the first result, if several statistics are computed).
      * @param events               Events to wait for before starting.
      * @param event                Event that will be signaled on completion.
      *
@@ -293,10 +497,391 @@ public:
                 numEvents, events, event, err, errStr);
         detail::handleError(err, errStr);
     }
+
+    /**
+     * Enqueue a reduction of two inputs on a command queue. The problem must
+     * have been set up with @ref ReduceProblem::setBinary. The arguments are
+     * the same as for @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, ::size_t, ::size_t, ::size_t, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue",
+     * except that there are two input buffers, with the same range of elements
+     * taken from each.
+     *
+     * @throw cl::Error            If the problem is not binary.
+     */
+    void enqueueBinary(const cl::CommandQueue &commandQueue,
+                       const cl::Buffer &inBuffer,
+                       const cl::Buffer &inBuffer2,
+                       const cl::Buffer &outBuffer,
+                       ::size_t first,
+                       ::size_t elements,
+                       ::size_t outPosition,
+                       const VECTOR_CLASS<cl::Event> *events = NULL,
+                       cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueBinary(commandQueue(), inBuffer(), inBuffer2(), outBuffer(), first, elements, outPosition,
+                      rawEvents.size(), rawEvents.data(),
+                      event != NULL ? &outEvent : NULL,
+                      err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueBinary(cl_command_queue commandQueue,
+                       cl_mem inBuffer,
+                       cl_mem inBuffer2,
+                       cl_mem outBuffer,
+                       ::size_t first,
+                       ::size_t elements,
+                       ::size_t outPosition,
+                       cl_uint numEvents = 0,
+                       const cl_event *events = NULL,
+                       cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueBinary(commandQueue, inBuffer, inBuffer2, outBuffer, first, elements, outPosition,
+                      numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a reduction of two inputs and read the result back to the host.
+     * This is a convenience wrapper that avoids the need to separately
+     * call @c clEnqueueReadBuffer.
+     */
+    void enqueueBinary(const cl::CommandQueue &commandQueue,
+                       bool blocking,
+                       const cl::Buffer &inBuffer,
+                       const cl::Buffer &inBuffer2,
+                       void *out,
+                       ::size_t first,
+                       ::size_t elements,
+                       const VECTOR_CLASS<cl::Event> *events = NULL,
+                       cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueBinary(commandQueue(), blocking, inBuffer(), inBuffer2(), out, first, elements,
+                      rawEvents.size(), rawEvents.data(),
+                      event != NULL ? &outEvent : NULL,
+                      err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueBinary(cl_command_queue commandQueue,
+                       bool blocking,
+                       cl_mem inBuffer,
+                       cl_mem inBuffer2,
+                       void *out,
+                       ::size_t first,
+                       ::size_t elements,
+                       cl_uint numEvents = 0,
+                       const cl_event *events = NULL,
+                       cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueBinary(commandQueue, blocking, inBuffer, inBuffer2, out, first, elements,
+                      numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue an argmin or argmax reduction on a command queue. The problem
+     * must have been set up with @ref ReduceProblem::setIndex. The arguments
+     * are the same as for @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, ::size_t, ::size_t, ::size_t, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue",
+     * except that the index of the result is additionally written as a
+     * @c cl_uint to element @a indexPosition of @a indexBuffer.
+     *
+     * @throw cl::Error            If the problem does not compute an index.
+     * @throw cl::Error            If @a indexPosition overruns @a indexBuffer.
+     * @throw cl::Error            If @a indexBuffer is not writable on the device.
+     */
+    void enqueueWithIndex(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          const cl::Buffer &indexBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          ::size_t indexPosition,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueWithIndex(commandQueue(), inBuffer(), outBuffer(), indexBuffer(),
+                         first, elements, outPosition, indexPosition,
+                         rawEvents.size(), rawEvents.data(),
+                         event != NULL ? &outEvent : NULL,
+                         err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueWithIndex(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          cl_mem indexBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          ::size_t indexPosition,
+                          cl_uint numEvents = 0,
+                          const cl_event *events = NULL,
+                          cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueWithIndex(commandQueue, inBuffer, outBuffer, indexBuffer,
+                         first, elements, outPosition, indexPosition,
+                         numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue an argmin or argmax reduction and read the value and its index
+     * back to the host. This is a convenience wrapper that avoids the need to
+     * separately call @c clEnqueueReadBuffer.
+     */
+    void enqueueWithIndex(const cl::CommandQueue &commandQueue,
+                          bool blocking,
+                          const cl::Buffer &inBuffer,
+                          void *out,
+                          cl_uint *index,
+                          ::size_t first,
+                          ::size_t elements,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueWithIndex(commandQueue(), blocking, inBuffer(), out, index, first, elements,
+                         rawEvents.size(), rawEvents.data(),
+                         event != NULL ? &outEvent : NULL,
+                         err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueWithIndex(cl_command_queue commandQueue,
+                          bool blocking,
+                          cl_mem inBuffer,
+                          void *out,
+                          cl_uint *index,
+                          ::size_t first,
+                          ::size_t elements,
+                          cl_uint numEvents = 0,
+                          const cl_event *events = NULL,
+                          cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueWithIndex(commandQueue, blocking, inBuffer, out, index, first, elements,
+                         numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a segmented reduction on a command queue. This reduces each of
+     * @a numSegments segments of the range independently, with a single
+     * kernel launch. This is much more efficient than enqueuing a separate
+     * reduction for each segment, particularly when the segments are short,
+     * and the work is balanced between work-groups however unequal the
+     * segments are.
+     *
+     * The segment offsets are stored as @c cl_uint, and each is the index
+     * (relative to @a first) of the first element of a segment, as for CSR
+     * row pointers. They must be non-decreasing. Each segment extends to the
+     * next offset, and the last to the end of the range. Elements before the
+     * first offset are ignored, and an empty segment produces the identity.
+     *
+     * The result of segment @c s is written to element
+     * <code>outPosition + s</code> of @a outBuffer, or if statistics are
+     * selected with @ref ReduceProblem::setStatistics, the results of each
+     * segment are written to consecutive groups of elements.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The buffer to reduce.
+     * @param outBuffer            The buffer to which the results are written.
+     * @param first                The index of the first element to reduce.
+     * @param elements             The number of elements in the range.
+     * @param outPosition          The position in @a outBuffer of the first result.
+     * @param segmentOffsets       The offset of the first element of each segment.
+     * @param numSegments          The number of segments.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a inBuffer or @a segmentOffsets is not readable on the device.
+     * @throw cl::Error            If @a outBuffer is not writable on the device.
+     * @throw cl::Error            If the element, segment or output range overruns a buffer.
+     * @throw cl::Error            If @a elements or @a numSegments is zero.
+     * @throw cl::Error            If the problem has two inputs or computes an index.
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * - The output range does not overlap the input range.
+     */
+    void enqueueSegmented(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          const cl::Buffer &segmentOffsets,
+                          ::size_t numSegments,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueSegmented(commandQueue(), inBuffer(), outBuffer(), first, elements, outPosition,
+                         segmentOffsets(), numSegments,
+                         rawEvents.size(), rawEvents.data(),
+                         event != NULL ? &outEvent : NULL,
+                         err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueSegmented(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          cl_mem segmentOffsets,
+                          ::size_t numSegments,
+                          cl_uint numEvents = 0,
+                          const cl_event *events = NULL,
+                          cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueSegmented(commandQueue, inBuffer, outBuffer, first, elements, outPosition,
+                         segmentOffsets, numSegments,
+                         numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a reduction of each column of a row-major matrix on a command
+     * queue. The matrix has @a rows rows of @a columns elements, with the
+     * start of each row @a rowStride elements after the start of the
+     * previous one, and the first row starting at element @a first.
+     * Elements between the end of one row and the start of the next are not
+     * accessed. Consecutive columns are read together, so no transposition
+     * is needed.
+     *
+     * The result for column @c c is written to element
+     * <code>outPosition + c</code> of @a outBuffer, or if statistics are
+     * selected with @ref ReduceProblem::setStatistics, the results of each
+     * column are written to consecutive groups of elements.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The buffer holding the matrix.
+     * @param outBuffer            The buffer to which the results are written.
+     * @param first                The index of the first element of the first row.
+     * @param rows                 The number of rows.
+     * @param columns              The number of columns.
+     * @param rowStride            The distance between the starts of consecutive rows, in elements.
+     * @param outPosition          The position in @a outBuffer of the first result.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a inBuffer is not readable on the device.
+     * @throw cl::Error            If @a outBuffer is not writable on the device.
+     * @throw cl::Error            If the matrix or output range overruns a buffer.
+     * @throw cl::Error            If @a rows or @a columns is zero.
+     * @throw cl::Error            If @a rowStride is less than @a columns.
+     * @throw cl::Error            If the problem has two inputs or computes an index.
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * - The output range does not overlap the matrix.
+     */
+    void enqueueColumns(const cl::CommandQueue &commandQueue,
+                        const cl::Buffer &inBuffer,
+                        const cl::Buffer &outBuffer,
+                        ::size_t first,
+                        ::size_t rows,
+                        ::size_t columns,
+                        ::size_t rowStride,
+                        ::size_t outPosition,
+                        const VECTOR_CLASS<cl::Event> *events = NULL,
+                        cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> rawEvents(events);
+        enqueueColumns(commandQueue(), inBuffer(), outBuffer(), first, rows, columns, rowStride, outPosition,
+                       rawEvents.size(), rawEvents.data(),
+                       event != NULL ? &outEvent : NULL,
+                       err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals the reference
+    }
+
+    /// @overload
+    void enqueueColumns(cl_command_queue commandQueue,
+                        cl_mem inBuffer,
+                        cl_mem outBuffer,
+                        ::size_t first,
+                        ::size_t rows,
+                        ::size_t columns,
+                        ::size_t rowStride,
+                        ::size_t outPosition,
+                        cl_uint numEvents = 0,
+                        const cl_event *events = NULL,
+                        cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueColumns(commandQueue, inBuffer, outBuffer, first, rows, columns, rowStride, outPosition,
+                       numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
 };
 
 void swap(Reduce &a, Reduce &b);
 
+/**
+ * Reduce an array in host memory to a single element, without using
+ * OpenCL. This is the implementation used by @ref BACKEND_HOST, and has the
+ * same semantics as @ref Reduce::enqueue.
+ *
+ * @param problem              Description of the reduction.
+ * @param in                   The elements to reduce.
+ * @param out                  The location to write the result.
+ * @param elements             The number of elements to reduce. If it is zero, the identity of the operator is written.
+ *
+ * @throw std::invalid_argument if @a problem is not supported by the host backend.
+ */
+CLOGS_API void hostReduce(const ReduceProblem &problem,
+                          const void *in, void *out, ::size_t elements);
+
 } // namespace clogs
 
 #endif /* !CLOGS_REDUCE_H */
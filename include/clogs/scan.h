@@ -32,6 +32,7 @@
 #include <clogs/visibility_push.h>
 #include <CL/cl.hpp>
 #include <cstddef>
+#include <string>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -71,29 +72,131 @@ public:
      * Set the element type for the scan.
      *
      * @param type      The element type
-     * @throw std::invalid_argument if @a type is not an integral scalar or vector type
+     * @throw std::invalid_argument if @a type is void
      */
     void setType(const Type &type);
 
+    /**
+     * Set the type of the input elements, if it differs from the type set
+     * with @ref setType. The latter is then the type of the output and of the
+     * partial sums, and each input element is converted to it as it is
+     * loaded. This allows, for example, @c cl_uchar flags to be summed into
+     * @c cl_uint without a separate conversion pass. The two types must have
+     * the same number of components (unless a transform is set with
+     * @ref setTransform), and the input and output buffers
+     * passed to @ref Scan must then be distinct. Use <code>Type()</code> (the
+     * default) to read the input as the element type.
+     */
+    void setInputType(const Type &inputType);
+
+    /**
+     * Set a transform that is applied to each input element as it is loaded,
+     * before it is scanned. It is an OpenCL C expression in terms of a
+     * variable @c x, which holds the input element (of the type set with
+     * @ref setInputType), and its value is converted to the element type. It
+     * must be a single line. An empty string (the default) scans the input
+     * elements unchanged.
+     *
+     * With a transform, the input type may have a different number of
+     * components to the element type, provided that the expression yields
+     * the right number.
+     *
+     * Example: <code>problem.setTransform("x != 0 ? 1 : 0");</code> counts
+     * the non-zero input elements before each position.
+     *
+     * @throw std::invalid_argument if @a transform contains a newline
+     */
+    void setTransform(const std::string &transform);
+
+    /**
+     * Set whether the scan is inclusive. An exclusive scan (the default)
+     * writes the sum of the elements strictly before each position, while
+     * an inclusive scan also includes the element at that position.
+     */
+    void setInclusive(bool inclusive);
+
+    /**
+     * Set whether the scan is segmented. A segmented scan restarts the
+     * running sum at the start of each segment, so that many independent
+     * sequences can be scanned with a single enqueue. The segments are given
+     * to @ref Scan::enqueueSegmented or @ref Scan::enqueueSegmentedOffsets,
+     * and the plain @ref Scan::enqueue functions may not be used. Segmented
+     * scans do not support offsets or @ref SCAN_ACCUMULATE_COMPENSATED.
+     */
+    void setSegmented(bool segmented);
+
+    /**
+     * Set the operator used to combine elements to one of the built-in
+     * operators. The default is @ref OPERATOR_SUM.
+     *
+     * When an offset is passed to @ref Scan::enqueue, it is combined with
+     * the elements using this operator rather than added to them.
+     */
+    void setOperator(OperatorType op);
+
+    /**
+     * Set a user-defined operator used to combine elements. The operator is
+     * given as an OpenCL C expression in terms of two values @c a and @c b
+     * (of the element type), where @c a precedes @c b in the sequence. The
+     * operator must be associative and commutative, and @a identity must be
+     * an expression for its identity element. Each string must be a single
+     * line.
+     *
+     * Example: <code>problem.setCustomOperator("a * b", "1");</code> computes
+     * prefix products.
+     *
+     * @throw std::invalid_argument if either string is empty or contains a newline
+     */
+    void setCustomOperator(const std::string &expression, const std::string &identity);
+
+    /**
+     * Set how floating-point sums are accumulated. The default,
+     * @ref SCAN_ACCUMULATE_NATIVE, accumulates in the element type. The other
+     * modes are only supported for sums of floating-point types, and
+     * @ref SCAN_ACCUMULATE_WIDE additionally requires the wider type to be
+     * supported by the device (e.g. @c cl_khr_fp64 for @c float elements).
+     * Each mode is autotuned separately.
+     */
+    void setAccumulation(ScanAccumulation accumulation);
+
     /**
      * Set the autotuning policy.
      */
     void setTunePolicy(const TunePolicy &tunePolicy);
+
+    /**
+     * Set where the scan runs (see @ref Backend). The default is
+     * @ref BACKEND_DEVICE. The host backend supports built-in operators on
+     * scalar types other than @c half, with native accumulation and no
+     * input type or transform. It is used by @ref Scan::enqueue,
+     * @ref Scan::enqueueSegmented and @ref Scan::enqueueSegmentedOffsets,
+     * but not by @ref Scan::enqueueBatched.
+     */
+    void setBackend(Backend backend);
 };
 
 /**
- * Exclusive scan (prefix sum) primitive.
+ * Scan (prefix sum) primitive. Both exclusive and inclusive scans are
+ * supported, as selected by @ref ScanProblem::setInclusive. Operators other
+ * than addition can be selected with @ref ScanProblem::setOperator, and
+ * segmented scans with @ref ScanProblem::setSegmented.
  *
  * One instance of this class can be reused for multiple scans, provided that
  *  - calls to @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, ::size_t, const void *, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue" do not overlap; and
  *  - their execution does not overlap.
  *
  * An instance of the class is specialized to a specific context, device, and
- * type of value to scan. Any CL integral scalar or vector type can
- * be used.
+ * type of value to scan. Any CL integral or floating-point scalar or vector
+ * type can be used, provided that the device supports it. Note that
+ * floating-point sums are not computed in sequential order, so results may
+ * differ slightly from a serial scan (see @ref ScanProblem::setAccumulation).
  *
  * The implementation is based on the reduce-then-scan strategy described at
  * https://sites.google.com/site/duanemerrill/ScanTR2.pdf?attredirects=0
+ * On CPUs and GPUs, autotuning may instead select a single-pass scan with
+ * decoupled look-back (Merrill and Garland, "Single-pass Parallel Prefix Scan
+ * with Decoupled Look-back"), which reads the input only once. This is not
+ * used for segmented scans or compensated accumulation.
  */
 class CLOGS_API Scan : public Algorithm
 {
@@ -129,6 +232,42 @@ protected:
                  cl_int &err,
                  const char *&errStr);
 
+    void enqueueBatched(cl_command_queue commandQueue,
+                        cl_mem inBuffer,
+                        cl_mem outBuffer,
+                        ::size_t rows,
+                        ::size_t rowLength,
+                        ::size_t rowStride,
+                        const void *offset,
+                        cl_uint numEvents,
+                        const cl_event *events,
+                        cl_event *event,
+                        cl_int &err,
+                        const char *&errStr);
+
+    void enqueueSegmented(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          ::size_t elements,
+                          cl_mem headFlags,
+                          cl_uint numEvents,
+                          const cl_event *events,
+                          cl_event *event,
+                          cl_int &err,
+                          const char *&errStr);
+
+    void enqueueSegmentedOffsets(cl_command_queue commandQueue,
+                                 cl_mem inBuffer,
+                                 cl_mem outBuffer,
+                                 ::size_t elements,
+                                 cl_mem segmentOffsets,
+                                 ::size_t numSegments,
+                                 cl_uint numEvents,
+                                 const cl_event *events,
+                                 cl_event *event,
+                                 cl_int &err,
+                                 const char *&errStr);
+
     void moveAssign(Scan &other);
 
 public:
@@ -217,7 +356,8 @@ public:
      * type of element specified to the constructor. If no offset is desired,
      * @c NULL may be passed instead.
      *
-     * The input and output buffers may be the same to do an in-place scan.
+     * The input and output buffers may be the same to do an in-place scan,
+     * unless a different input type was set with @ref ScanProblem::setInputType.
      *
      * @param commandQueue         The command queue to use.
      * @param inBuffer             The buffer to scan.
@@ -235,7 +375,8 @@ public:
      * - @a commandQueue was created with the context and device given to the constructor.
      * @post
      * - After execution, element @c i will be replaced by the sum of all elements strictly
-     *   before @c i, plus the @a offset (if any).
+     *   before @c i (or up to and including @c i, for an inclusive scan), plus the
+     *   @a offset (if any).
      */
     void enqueue(const cl::CommandQueue &commandQueue,
                  const cl::Buffer &inBuffer,
@@ -304,7 +445,8 @@ public:
      * scan is used with one extra element at the end to hold the grand total,
      * and the subsequent passes use this extra element as the offset.
      *
-     * The input and output buffers may be the same to do an in-place scan.
+     * The input and output buffers may be the same to do an in-place scan,
+     * unless a different input type was set with @ref ScanProblem::setInputType.
      *
      * @param commandQueue         The command queue to use.
      * @param inBuffer             The buffer to scan.
@@ -325,7 +467,8 @@ public:
      * - @a commandQueue was created with the context and device given to the constructor.
      * @post
      * - After execution, element @c i will be replaced by the sum of all elements strictly
-     *   before @c i, plus the offset.
+     *   before @c i (or up to and including @c i, for an inclusive scan), plus the
+     *   offset.
      */
     void enqueue(const cl::CommandQueue &commandQueue,
                  const cl::Buffer &inBuffer,
@@ -367,10 +510,268 @@ public:
                 numEvents, events, event, err, errStr);
         detail::handleError(err, errStr);
     }
+
+    /**
+     * Enqueue a batched scan operation on a command queue. This scans each
+     * of @a rows rows of @a rowLength elements independently, with the
+     * start of each row @a rowStride elements after the start of the
+     * previous one. Elements between the end of one row and the start of the
+     * next are not accessed. This is much more efficient than enqueuing a
+     * separate scan for each row, particularly when the rows are short.
+     *
+     * An initial offset may optionally be passed in @a offset, which will be
+     * added to all elements of every row. The pointer must point to the
+     * type of element specified to the constructor. If no offset is desired,
+     * @c NULL may be passed instead.
+     *
+     * The input and output buffers may be the same to do an in-place scan,
+     * unless a different input type was set with @ref ScanProblem::setInputType.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The buffer to scan.
+     * @param outBuffer            The buffer to fill with output.
+     * @param rows                 The number of rows to scan.
+     * @param rowLength            The number of elements to scan in each row.
+     * @param rowStride            The distance between the starts of consecutive rows, in elements.
+     * @param offset               The offset to add to all elements, or @c NULL.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a inBuffer is not readable on the device.
+     * @throw cl::Error            If @a outBuffer is not writable on the device.
+     * @throw cl::Error            If the rows overrun a buffer.
+     * @throw cl::Error            If @a rows or @a rowLength is zero.
+     * @throw cl::Error            If @a rowStride is less than @a rowLength.
+     * @throw cl::Error            If the problem is segmented.
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * @post
+     * - After execution, each element will be replaced by the sum of the
+     *   elements of its row strictly before it (or up to and including it,
+     *   for an inclusive scan), plus the @a offset (if any).
+     */
+    void enqueueBatched(const cl::CommandQueue &commandQueue,
+                        const cl::Buffer &inBuffer,
+                        const cl::Buffer &outBuffer,
+                        ::size_t rows,
+                        ::size_t rowLength,
+                        ::size_t rowStride,
+                        const void *offset = NULL,
+                        const VECTOR_CLASS<cl::Event> *events = NULL,
+                        cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> events_(events);
+        enqueueBatched(commandQueue(), inBuffer(), outBuffer(), rows, rowLength, rowStride, offset,
+                       events_.size(), events_.data(),
+                       event != NULL ? &outEvent : NULL,
+                       err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals reference
+    }
+
+    /// @overload
+    void enqueueBatched(cl_command_queue commandQueue,
+                        cl_mem inBuffer,
+                        cl_mem outBuffer,
+                        ::size_t rows,
+                        ::size_t rowLength,
+                        ::size_t rowStride,
+                        const void *offset = NULL,
+                        cl_uint numEvents = 0,
+                        const cl_event *events = NULL,
+                        cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueBatched(commandQueue, inBuffer, outBuffer, rows, rowLength, rowStride, offset,
+                       numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a segmented scan operation on a command queue, with the
+     * segments given by head flags. The problem must have been marked as
+     * segmented with @ref ScanProblem::setSegmented.
+     *
+     * The head flags are stored as one @c cl_uchar per element, and a
+     * non-zero flag indicates that the element starts a new segment. The
+     * first element always starts a segment.
+     *
+     * The input and output buffers may be the same to do an in-place scan,
+     * unless a different input type was set with @ref ScanProblem::setInputType.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The buffer to scan.
+     * @param outBuffer            The buffer to fill with output.
+     * @param elements             The number of elements to scan.
+     * @param headFlags            The head flags for the elements.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a inBuffer or @a headFlags is not readable on the device.
+     * @throw cl::Error            If @a outBuffer is not writable on the device.
+     * @throw cl::Error            If the element range overruns a buffer.
+     * @throw cl::Error            If @a elements is zero.
+     * @throw cl::Error            If the problem is not segmented.
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * @post
+     * - After execution, element @c i will be replaced by the sum of the
+     *   elements of its segment strictly before @c i (or up to and including
+     *   @c i, for an inclusive scan).
+     */
+    void enqueueSegmented(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          ::size_t elements,
+                          const cl::Buffer &headFlags,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> events_(events);
+        enqueueSegmented(commandQueue(), inBuffer(), outBuffer(), elements, headFlags(),
+                         events_.size(), events_.data(),
+                         event != NULL ? &outEvent : NULL,
+                         err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals reference
+    }
+
+    /// @overload
+    void enqueueSegmented(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          ::size_t elements,
+                          cl_mem headFlags,
+                          cl_uint numEvents = 0,
+                          const cl_event *events = NULL,
+                          cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueSegmented(commandQueue, inBuffer, outBuffer, elements, headFlags,
+                         numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a segmented scan operation on a command queue, with the
+     * segments given by their starting positions. The problem must have been
+     * marked as segmented with @ref ScanProblem::setSegmented.
+     *
+     * The segment offsets are stored as @c cl_uint, and each is the index of
+     * the first element of a segment (as for CSR row pointers). Offsets
+     * greater than or equal to @a elements are ignored, and the first element
+     * always starts a segment. The offsets are converted to head flags in an
+     * internal buffer, which is then used as for @ref enqueueSegmented.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param inBuffer             The buffer to scan.
+     * @param outBuffer            The buffer to fill with output.
+     * @param elements             The number of elements to scan.
+     * @param segmentOffsets       The index of the first element of each segment.
+     * @param numSegments          The number of offsets in @a segmentOffsets.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a inBuffer or @a segmentOffsets is not readable on the device.
+     * @throw cl::Error            If @a outBuffer is not writable on the device.
+     * @throw cl::Error            If the element or segment range overruns a buffer.
+     * @throw cl::Error            If @a elements is zero.
+     * @throw cl::Error            If the problem is not segmented.
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * @post
+     * - After execution, element @c i will be replaced by the sum of the
+     *   elements of its segment strictly before @c i (or up to and including
+     *   @c i, for an inclusive scan).
+     */
+    void enqueueSegmentedOffsets(const cl::CommandQueue &commandQueue,
+                                 const cl::Buffer &inBuffer,
+                                 const cl::Buffer &outBuffer,
+                                 ::size_t elements,
+                                 const cl::Buffer &segmentOffsets,
+                                 ::size_t numSegments,
+                                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                                 cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> events_(events);
+        enqueueSegmentedOffsets(commandQueue(), inBuffer(), outBuffer(), elements,
+                                segmentOffsets(), numSegments,
+                                events_.size(), events_.data(),
+                                event != NULL ? &outEvent : NULL,
+                                err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals reference
+    }
+
+    /// @overload
+    void enqueueSegmentedOffsets(cl_command_queue commandQueue,
+                                 cl_mem inBuffer,
+                                 cl_mem outBuffer,
+                                 ::size_t elements,
+                                 cl_mem segmentOffsets,
+                                 ::size_t numSegments,
+                                 cl_uint numEvents = 0,
+                                 const cl_event *events = NULL,
+                                 cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueueSegmentedOffsets(commandQueue, inBuffer, outBuffer, elements,
+                                segmentOffsets, numSegments,
+                                numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
 };
 
 void swap(Scan &a, Scan &b);
 
+/**
+ * Scan an array in host memory, without using OpenCL. This is the
+ * implementation used by @ref BACKEND_HOST, and has the same semantics as
+ * @ref Scan::enqueue. The input and output may be the same.
+ *
+ * @param problem              Description of the scan (which must not be segmented).
+ * @param in                   The elements to scan.
+ * @param out                  The array to fill with output.
+ * @param elements             The number of elements to scan (may be zero).
+ * @param offset               The offset to combine with all elements, or @c NULL.
+ *
+ * @throw std::invalid_argument if @a problem is not supported by the host backend.
+ */
+CLOGS_API void hostScan(const ScanProblem &problem,
+                        const void *in, void *out, ::size_t elements,
+                        const void *offset = NULL);
+
+/**
+ * Segmented scan of an array in host memory, without using OpenCL. This has
+ * the same semantics as @ref Scan::enqueueSegmented.
+ *
+ * @param problem              Description of the scan (which must be segmented).
+ * @param in                   The elements to scan.
+ * @param out                  The array to fill with output.
+ * @param elements             The number of elements to scan (may be zero).
+ * @param headFlags            The head flags for the elements.
+ *
+ * @throw std::invalid_argument if @a problem is not supported by the host backend.
+ */
+CLOGS_API void hostScanSegmented(const ScanProblem &problem,
+                                 const void *in, void *out, ::size_t elements,
+                                 const cl_uchar *headFlags);
+
 } // namespace clogs
 
 #endif /* !CLOGS_SCAN_H */
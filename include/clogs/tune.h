@@ -67,11 +67,36 @@ public:
     /**
      * Specify whether on-the-fly tuning is permitted. If it is not permitted,
      * then any attempt to construct an algorithm which isn't already tuned
-     * will throw @ref clogs::CacheError. The default is that tuning is
-     * permitted.
+     * will throw @ref clogs::CacheError, unless @ref setFallback is used.
+     * The default is that tuning is permitted.
      */
     void setEnabled(bool enabled);
 
+    /**
+     * Specify whether tuning runs in the background. If it does, then
+     * constructing an algorithm which isn't already tuned does not wait for
+     * tuning. The algorithm uses default parameters chosen from the
+     * properties of the device, and is tuned in a background thread. The
+     * results are stored in the cache and used by algorithms constructed
+     * after tuning finishes.
+     *
+     * Progress is reported in the same way as for foreground tuning, so the
+     * output stream must remain valid until tuning is complete (see @ref
+     * waitForTuning). This has no effect if tuning is not enabled. The
+     * default is to tune in the foreground.
+     */
+    void setBackground(bool background);
+
+    /**
+     * Specify what happens when tuning is disabled (see @ref setEnabled) and
+     * an algorithm which isn't already tuned is constructed. If @a fallback
+     * is true, the algorithm uses default parameters chosen from the
+     * properties of the device, as for background tuning. These are not
+     * stored in the cache. Otherwise @ref clogs::CacheError is thrown. The
+     * default is to throw.
+     */
+    void setFallback(bool fallback);
+
     /**
      * Set the verbosity level. The default is @c TUNE_VERBOSITY_NORMAL.
      */
@@ -84,6 +109,13 @@ public:
     void setOutput(std::ostream &out);
 };
 
+/**
+ * Wait for all background tuning (see @ref TunePolicy::setBackground) to
+ * complete. Background tuning that is still running when the program exits
+ * is abandoned.
+ */
+CLOGS_API void waitForTuning();
+
 } // namespace clogs
 
 #endif /* !CLOGS_TUNE_H */
@@ -0,0 +1,296 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Removal of duplicates and run-length encoding of sorted keys.
+ */
+
+#ifndef CLOGS_UNIQUE_H
+#define CLOGS_UNIQUE_H
+
+#include <clogs/visibility_push.h>
+#include <CL/cl.hpp>
+#include <cstddef>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include <clogs/platform.h>
+#include <clogs/tune.h>
+
+namespace clogs
+{
+
+class UniqueProblem;
+
+namespace detail
+{
+    class UniqueProblem;
+    class Unique;
+
+    const UniqueProblem &getDetail(const clogs::UniqueProblem &);
+} // namespace detail
+
+/**
+ * Encapsulates the specifics of a unique or run-length encoding problem.
+ * After construction, use @ref setKeyType to set the key type.
+ */
+class CLOGS_API UniqueProblem
+{
+private:
+    detail::UniqueProblem *detail_;
+    friend const detail::UniqueProblem &detail::getDetail(const clogs::UniqueProblem &);
+
+public:
+    UniqueProblem();
+    ~UniqueProblem();
+    UniqueProblem(const UniqueProblem &);
+    UniqueProblem &operator=(const UniqueProblem &);
+
+    /**
+     * Set the key type.
+     *
+     * @param keyType   The key type
+     * @throw std::invalid_argument if @a keyType is void
+     */
+    void setKeyType(const Type &keyType);
+
+    /**
+     * Set the autotuning policy. This only affects the scan used internally.
+     */
+    void setTunePolicy(const TunePolicy &tunePolicy);
+};
+
+/**
+ * Collapses runs of equal keys, such as the output of @ref Radixsort, to a
+ * single key each. It can optionally also write the length of each run,
+ * giving a run-length encoding of the input. The number of runs is written
+ * to a buffer on the device, so that no transfer to the host is required.
+ *
+ * Runs are identified by comparing adjacent keys, so the input does not
+ * need to be sorted; however, equal keys that are not adjacent are treated
+ * as separate runs.
+ *
+ * There is no separate run-length encoding class. Removing duplicates and
+ * run-length encoding find the same runs, and differ only in whether the run
+ * lengths are written, so a run-length encoding is obtained by passing a
+ * counts buffer to @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, ::size_t, ::size_t, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue".
+ * The unique keys, the counts and the number of runs together form the
+ * encoding.
+ *
+ * One instance of this class can be reused for multiple operations, provided that
+ *  - calls to @ref enqueue(const cl::CommandQueue &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, const cl::Buffer &, ::size_t, ::size_t, const VECTOR_CLASS<cl::Event> *, cl::Event *) "enqueue" do not overlap; and
+ *  - their execution does not overlap.
+ *
+ * An instance of the class is specialized to a specific context, device, and
+ * problem.
+ *
+ * The implementation marks the first key of each run, uses @ref Scan to
+ * turn the marks into output positions, and then scatters the keys. Temporary
+ * storage proportional to the number of elements is allocated on first use
+ * and retained for subsequent calls.
+ */
+class CLOGS_API Unique : public Algorithm
+{
+private:
+    detail::Unique *getDetail() const;
+    detail::Unique *getDetailNonNull() const;
+    void construct(cl_context context, cl_device_id device, const UniqueProblem &problem,
+                   cl_int &err, const char *&errStr);
+    void moveAssign(Unique &other);
+    friend void swap(Unique &, Unique &);
+
+protected:
+    void enqueue(cl_command_queue commandQueue,
+                 cl_mem keysBuffer,
+                 cl_mem uniqueBuffer,
+                 cl_mem countsBuffer,
+                 cl_mem numRunsBuffer,
+                 ::size_t numRunsPosition,
+                 ::size_t elements,
+                 cl_uint numEvents,
+                 const cl_event *events,
+                 cl_event *event,
+                 cl_int &err,
+                 const char *&errStr);
+
+public:
+    /**
+     * Default constructor. The object cannot be used in this state.
+     */
+    Unique();
+
+#ifdef CLOGS_HAVE_RVALUE_REFERENCES
+    Unique(Unique &&other) CLOGS_NOEXCEPT
+    {
+        moveConstruct(other);
+    }
+
+    Unique &operator=(Unique &&other) CLOGS_NOEXCEPT
+    {
+        moveAssign(other);
+        return *this;
+    }
+#endif
+
+    /**
+     * Constructor.
+     *
+     * @param context              OpenCL context to use
+     * @param device               OpenCL device to use.
+     * @param problem              Description of the specific problem.
+     *
+     * @throw std::invalid_argument if @a problem is not supported on the device or is not initialized.
+     * @throw clogs::InternalError if there was a problem with initialization.
+     */
+    Unique(const cl::Context &context, const cl::Device &device, const UniqueProblem &problem)
+    {
+        cl_int err;
+        const char *errStr;
+        construct(context(), device(), problem, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Constructor. This class will add new references to the @a context and @a device.
+     *
+     * @param context              OpenCL context to use
+     * @param device               OpenCL device to use.
+     * @param problem              Description of the specific problem.
+     *
+     * @throw std::invalid_argument if @a problem is not supported on the device or is not initialized.
+     * @throw clogs::InternalError if there was a problem with initialization.
+     */
+    Unique(cl_context context, cl_device_id device, const UniqueProblem &problem)
+    {
+        cl_int err;
+        const char *errStr;
+        construct(context, device, problem, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    ~Unique(); ///< Destructor
+
+    /**
+     * Enqueue a run-length encoding operation on a command queue.
+     *
+     * Either or both of @a uniqueBuffer and @a countsBuffer may be
+     * <code>cl::Buffer()</code> if the corresponding output is not required.
+     * The counts are written as @c cl_uint.
+     *
+     * The number of runs is written as a @c cl_uint to @a numRunsBuffer, so
+     * that it can be used by subsequent commands without the host having to
+     * wait for the operation to complete.
+     *
+     * @param commandQueue         The command queue to use.
+     * @param keysBuffer           The keys to process.
+     * @param uniqueBuffer         The buffer to fill with the first key of each run, or <code>cl::Buffer()</code>.
+     * @param countsBuffer         The buffer to fill with the length of each run, or <code>cl::Buffer()</code>.
+     * @param numRunsBuffer        The buffer to which the number of runs is written.
+     * @param numRunsPosition      The index (in units of @c cl_uint) at which to write the number of runs.
+     * @param elements             The number of keys to process.
+     * @param events               Events to wait for before starting.
+     * @param event                Event that will be signaled on completion.
+     *
+     * @throw cl::Error            If @a keysBuffer is not readable on the device.
+     * @throw cl::Error            If an output buffer is not writable on the device.
+     * @throw cl::Error            If the element range overruns a buffer.
+     * @throw cl::Error            If @a elements is zero.
+     *
+     * @pre
+     * - @a commandQueue was created with the context and device given to the constructor.
+     * - The outputs do not overlap with each other or with the input.
+     * @post
+     * - After execution, the first @c n elements of @a uniqueBuffer and
+     *   @a countsBuffer hold the runs, where @c n is the value written to
+     *   @a numRunsBuffer. The remaining elements are unmodified.
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &keysBuffer,
+                 const cl::Buffer &uniqueBuffer,
+                 const cl::Buffer &countsBuffer,
+                 const cl::Buffer &numRunsBuffer,
+                 ::size_t numRunsPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL)
+    {
+        cl_event outEvent;
+        cl_int err;
+        const char *errStr;
+        detail::UnwrapArray<cl::Event> events_(events);
+        enqueue(commandQueue(), keysBuffer(), uniqueBuffer(), countsBuffer(),
+                numRunsBuffer(), numRunsPosition, elements,
+                events_.size(), events_.data(),
+                event != NULL ? &outEvent : NULL,
+                err, errStr);
+        detail::handleError(err, errStr);
+        if (event != NULL)
+            *event = outEvent; // steals reference
+    }
+
+    /// @overload
+    void enqueue(cl_command_queue commandQueue,
+                 cl_mem keysBuffer,
+                 cl_mem uniqueBuffer,
+                 cl_mem countsBuffer,
+                 cl_mem numRunsBuffer,
+                 ::size_t numRunsPosition,
+                 ::size_t elements,
+                 cl_uint numEvents = 0,
+                 const cl_event *events = NULL,
+                 cl_event *event = NULL)
+    {
+        cl_int err;
+        const char *errStr;
+        enqueue(commandQueue, keysBuffer, uniqueBuffer, countsBuffer,
+                numRunsBuffer, numRunsPosition, elements,
+                numEvents, events, event, err, errStr);
+        detail::handleError(err, errStr);
+    }
+
+    /**
+     * Enqueue a unique operation, without run lengths.
+     *
+     * This is equivalent to calling
+     * @c enqueue(@a commandQueue, @a keysBuffer, @a uniqueBuffer, <code>cl::Buffer()</code>,
+     * @a numRunsBuffer, @a numRunsPosition, @a elements, @a events, @a event).
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &keysBuffer,
+                 const cl::Buffer &uniqueBuffer,
+                 const cl::Buffer &numRunsBuffer,
+                 ::size_t numRunsPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL)
+    {
+        enqueue(commandQueue, keysBuffer, uniqueBuffer, cl::Buffer(),
+                numRunsBuffer, numRunsPosition, elements, events, event);
+    }
+};
+
+void swap(Unique &a, Unique &b);
+
+} // namespace clogs
+
+#endif /* !CLOGS_UNIQUE_H */
@@ -0,0 +1,389 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Stream compaction kernels for CLOGS. The structure mirrors scan.cl: an
+ * initial kernel counts the selected elements in each block, a small scan
+ * turns the counts into output offsets, and a final kernel scans the
+ * selection flags within each block and scatters the selected elements.
+ */
+
+#if ENABLE_KHR_FP64 && __OPENCL_C_VERSION__ <= 110
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+#if ENABLE_KHR_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+
+/**
+ * Tests whether a value is a power of 2. This macro is suitable for use in
+ * preprocessor expressions.
+ * @warning Do not use with an argument that has side effects.
+ */
+#define IS_POWER2(x) ((x) > 0 && ((x) & ((x) - 1)) == 0)
+
+/**
+ * @def COMPACT_T
+ * @hideinitializer
+ * The type of the elements being compacted.
+ */
+
+/**
+ * @def PREDICATE_T
+ * @hideinitializer
+ * The type of the values on which the predicate is evaluated. This is
+ * either the stencil type or @ref COMPACT_T.
+ */
+
+/**
+ * @def PREDICATE
+ * @hideinitializer
+ * Expression that is true if the element with predicate input @a x is selected.
+ */
+
+/**
+ * @def WARP_SIZE_MEM
+ * @hideinitializer
+ * The granularity at which a barrier can be omitted for communication using
+ * local memory. This can safely be a factor of the true answer for the
+ * hardware.
+ */
+
+/**
+ * @def REDUCE_WORK_GROUP_SIZE
+ * @hideinitializer
+ * The work group size for the initial counting kernel.
+ */
+
+/**
+ * @def SCAN_BLOCKS
+ * @hideinitializer
+ * The maximum number of blocks into which the full range is subdivided.
+ */
+
+/**
+ * @def SCAN_WORK_GROUP_SIZE
+ * @hideinitializer
+ * The work group size for the final scatter kernel.
+ */
+
+/**
+ * @def SCAN_WORK_SCALE
+ * @hideinitializer
+ * The number of elements to process per thread in the final scatter kernel.
+ */
+
+#ifndef COMPACT_T
+# error "COMPACT_T must be specified"
+# define COMPACT_T int /* Keep doxygen happy */
+#endif
+
+#ifndef PREDICATE_T
+# error "PREDICATE_T must be specified"
+# define PREDICATE_T int /* Keep doxygen happy */
+#endif
+
+#ifndef PREDICATE
+# error "PREDICATE must be specified"
+# define PREDICATE(x) ((x) != 0) /* Keep doxygen happy */
+#endif
+
+#ifndef WARP_SIZE_MEM
+# error "WARP_SIZE_MEM must be specified"
+# define WARP_SIZE_MEM 1 /* Keep doxygen happy */
+#endif
+#if !IS_POWER2(WARP_SIZE_MEM)
+# error "WARP_SIZE_MEM must be a power of 2"
+#endif
+
+#ifndef REDUCE_WORK_GROUP_SIZE
+# error "REDUCE_WORK_GROUP_SIZE must be specified"
+# define REDUCE_WORK_GROUP_SIZE 1 /* Keep doxygen happy */
+#endif
+#if !IS_POWER2(REDUCE_WORK_GROUP_SIZE)
+# error "REDUCE_WORK_GROUP_SIZE must be a power of 2"
+#endif
+
+#ifndef SCAN_WORK_GROUP_SIZE
+# error "SCAN_WORK_GROUP_SIZE must be specified"
+# define SCAN_WORK_GROUP_SIZE 1 /* Keep doxygen happy */
+#endif
+#if !IS_POWER2(SCAN_WORK_GROUP_SIZE)
+# error "SCAN_WORK_GROUP_SIZE must be a power of 2"
+#endif
+
+#ifndef SCAN_BLOCKS
+# error "SCAN_BLOCKS is required"
+# define SCAN_BLOCKS 2 /* Keep doxygen happy */
+#endif
+#if SCAN_BLOCKS & 1
+# error "SCAN_BLOCKS must be even"
+#endif
+
+#ifndef SCAN_WORK_SCALE
+# error "SCAN_WORK_SCALE must be specified"
+# define SCAN_WORK_SCALE 1 /* Keep doxygen happy */
+#endif
+#if !IS_POWER2(SCAN_WORK_SCALE)
+# error "SCAN_WORK_SCALE must be a power of 2"
+#endif
+
+/**
+ * Shorthand for defining a kernel with a fixed work group size.
+ * This is needed to unconfuse Doxygen's parser.
+ */
+#define KERNEL(size) __kernel __attribute__((reqd_work_group_size(size, 1, 1)))
+
+/**
+ * Evaluates the predicate for one element.
+ *
+ * @return 1 if the element is selected, otherwise 0.
+ */
+inline uint compactSelect(__global const PREDICATE_T *pred, uint idx)
+{
+    const PREDICATE_T x = pred[idx];
+    return (PREDICATE(x)) ? 1U : 0U;
+}
+
+/**
+ * Count selected elements in contiguous ranges of elements.
+ * @param out    Counts per work-group.
+ * @param pred   Predicate inputs.
+ * @param len    Number of values to count per work-group
+ *
+ * @pre @a len is a multiple of @ref REDUCE_WORK_GROUP_SIZE
+ */
+KERNEL(REDUCE_WORK_GROUP_SIZE)
+void compactReduce(__global uint *out, __global const PREDICATE_T *pred, uint len)
+{
+    __local uint sums[REDUCE_WORK_GROUP_SIZE];
+    const uint group = get_group_id(0);
+    const uint lid = get_local_id(0);
+    const uint in_offset = group * len + lid;
+
+    uint accum = 0;
+    for (uint i = 0; i < len; i += REDUCE_WORK_GROUP_SIZE)
+        accum += compactSelect(pred, in_offset + i);
+    sums[lid] = accum;
+
+    /* Upsweep */
+    for (uint scale = REDUCE_WORK_GROUP_SIZE / 2; scale >= 1; scale >>= 1)
+    {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid < scale)
+            sums[lid] += sums[lid + scale];
+    }
+
+    /* No barrier needed here, because sums[0] is computed by thread 0 */
+    if (lid == 0)
+        out[group] = sums[0];
+}
+
+/**
+ * Does an exclusive prefix sum on @ref SCAN_BLOCKS counts.
+ *
+ * @param inout  The values to scan, replaced with result.
+ *
+ * @pre @ref SCAN_BLOCKS is even
+ */
+KERNEL(SCAN_BLOCKS / 2)
+void compactScanSmall(__global uint *inout)
+{
+    const unsigned int lid = get_local_id(0);
+    const unsigned int wgs = SCAN_BLOCKS / 2; // work group size
+    __local uint v[SCAN_BLOCKS];
+
+    /* Copy to local memory for computation, shifting by one to turn an
+     * exclusive problem into an inclusive one
+     */
+    v[lid] = (lid == 0) ? 0 : inout[lid - 1];
+    v[lid + wgs] = inout[lid + wgs - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /* Upsweep */
+    uint pos = lid + 1;
+    uint scale;
+    for (scale = 1; scale <= SCAN_BLOCKS / 2; scale <<= 1)
+    {
+        pos <<= 1;
+        if (pos <= SCAN_BLOCKS)
+            v[pos - 1] += v[pos - scale - 1];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    scale >>= 1; // undo the last scale <<= 1 at the end of the loop
+
+    /* Downsweep */
+    for (; scale >= 1; scale >>= 1)
+    {
+        if (pos <= SCAN_BLOCKS - scale)
+            v[pos + scale - 1] += v[pos - 1];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        pos >>= 1;
+    }
+
+    /* Writeback */
+    inout[lid] = v[lid];
+    inout[lid + wgs] = v[lid + wgs];
+}
+
+/**
+ * Scans the selection flags of a possibly large range, given initial output
+ * offsets per work-group, and writes the selected elements to their final
+ * positions. The last work-group also writes the total number of selected
+ * elements.
+ *
+ * @param         in         Elements to compact
+ * @param         pred       Predicate inputs
+ * @param[out]    out        Selected elements (may be @c NULL)
+ * @param[out]    indices    Indices of selected elements (may be @c NULL)
+ * @param         offsets    The starting output offset for each work-group
+ * @param[out]    count      Buffer to receive the number of selected elements
+ * @param         countPos   Index into @a count at which to write
+ * @param         len        Number of elements to process per work-group
+ * @param         total      Total number of elements
+ *
+ * @pre @a len is a multiple of @c SCAN_WORK_SCALE * @c SCAN_WORK_GROUP_SIZE
+ */
+KERNEL(SCAN_WORK_GROUP_SIZE)
+void compactScatter(
+    __global const COMPACT_T *in,
+    __global const PREDICATE_T *pred,
+    __global COMPACT_T *out,
+    __global uint *indices,
+    __global const uint *offsets,
+    __global uint *count,
+    uint countPos,
+    uint len,
+    uint total)
+{
+    /* This follows the same structure as scanExclusive in scan.cl, except
+     * that the values being scanned are the selection flags, and the
+     * writeback is replaced by a scatter of the selected elements.
+     */
+    __local uint raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local uint * const raw = raw_reduced;
+    __local uint * const reduced = raw_reduced;
+    uint priv[SCAN_WORK_SCALE];
+    uint flags[SCAN_WORK_SCALE]; // flags for the elements loaded by this workitem
+
+    const uint lid = get_local_id(0);
+    const uint first = get_group_id(0) * len;
+    const uint last = min(first + len, total);
+    uint offset = offsets[get_group_id(0)];
+
+    for (uint start = first; start < last; start += SCAN_WORK_SCALE * SCAN_WORK_GROUP_SIZE)
+    {
+        /* Evaluate the predicate using coalesced reads */
+        for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        {
+            uint addr = start + lid + i * SCAN_WORK_GROUP_SIZE;
+            flags[i] = (addr < last) ? compactSelect(pred, addr) : 0;
+            raw[lid + i * SCAN_WORK_GROUP_SIZE] = flags[i];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /* Read the relevant data into registers */
+        for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        {
+            priv[i] = raw[lid * SCAN_WORK_SCALE + i];
+        }
+
+        /* Scan the private range */
+        for (uint i = 0; i < SCAN_WORK_SCALE - 1; i++)
+            priv[i + 1] += priv[i];
+
+        /* Write the reduced private ranges for shared upsweep */
+        barrier(CLK_LOCAL_MEM_FENCE);
+        reduced[SCAN_WORK_GROUP_SIZE + lid] = priv[SCAN_WORK_SCALE - 1];
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /* Upsweep, interwarp */
+        for (uint scale = SCAN_WORK_GROUP_SIZE / 2; scale >= 1; scale >>= 1)
+        {
+            if (lid < scale)
+            {
+                const uint pos = scale + lid;
+                reduced[pos] = reduced[2 * pos] + reduced[2 * pos + 1];
+            }
+            if (scale > WARP_SIZE_MEM)
+                barrier(CLK_LOCAL_MEM_FENCE);
+            else
+                mem_fence(CLK_LOCAL_MEM_FENCE);
+        }
+
+        /* v[1] is the total of this range, but need to make it exclusive */
+        if (lid == 0)
+        {
+            uint nextOffset = offset + reduced[1];
+            reduced[1] = offset;
+            offset = nextOffset;
+        }
+        /* No barrier needed here, because only thread 0 uses reduced[1] */
+
+        /* Downsweep */
+        for (uint scale = 1; scale < SCAN_WORK_GROUP_SIZE; scale <<= 1)
+        {
+            if (lid < scale)
+            {
+                const uint pos = scale + lid;
+                const uint in = reduced[pos];
+                const uint left = reduced[2 * pos];
+                reduced[2 * pos + 1] = in + left;
+                reduced[2 * pos] = in;
+            }
+            if (scale >= WARP_SIZE_MEM)
+                barrier(CLK_LOCAL_MEM_FENCE);
+            else
+                mem_fence(CLK_LOCAL_MEM_FENCE);
+        }
+
+        /* Feed reduction back into private range, making it exclusive at the same time */
+        const uint add = reduced[SCAN_WORK_GROUP_SIZE + lid];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (uint i = SCAN_WORK_SCALE - 1; i > 0; i--)
+        {
+            raw[lid * SCAN_WORK_SCALE + i] = priv[i - 1] + add;
+        }
+        raw[lid * SCAN_WORK_SCALE] = add;
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        /* Scatter the selected elements */
+        for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        {
+            if (flags[i])
+            {
+                uint addr = start + lid + i * SCAN_WORK_GROUP_SIZE;
+                uint pos = raw[lid + i * SCAN_WORK_GROUP_SIZE];
+                if (out != 0)
+                    out[pos] = in[addr];
+                if (indices != 0)
+                    indices[pos] = addr;
+            }
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    /* Only thread 0 has the running offset */
+    if (lid == 0 && get_group_id(0) == get_num_groups(0) - 1)
+        count[countPos] = offset;
+}
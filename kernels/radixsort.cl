@@ -70,6 +70,13 @@
  * The work group size for the initial reduction kernel.
  */
 
+/**
+ * @def REDUCE_ELEMENTS_PER_LOAD
+ * @hideinitializer
+ * Number of consecutive keys that each work-item loads at once with
+ * @c vloadN in the initial reduction kernel. It must be 1, 2, 4, 8 or 16.
+ */
+
 /**
  * @def SCAN_WORK_GROUP_SIZE
  * @hideinitializer
@@ -84,6 +91,13 @@
  * partial sums per radix.
  */
 
+/**
+ * @def SCAN_WORK_GROUP_FUNCTIONS
+ * @hideinitializer
+ * If non-zero, the middle scan kernel uses the OpenCL C 2.0 work-group
+ * built-ins to prefix sum the per-chunk totals.
+ */
+
 /**
  * @def SCATTER_WORK_GROUP_SIZE
  * @hideinitializer
@@ -103,6 +117,15 @@
  * each other.
  */
 
+/**
+ * @def SCATTER_SEQUENTIAL
+ * @hideinitializer
+ * If non-zero, each work-item of the final scatter kernel scatters a whole
+ * block on its own, in order, without local memory or barriers. This suits
+ * CPU devices, for which barriers are expensive. It requires
+ * @ref SCATTER_SLICE and @ref SCATTER_WORK_SCALE to be 1.
+ */
+
 /**
  * @def RADIX_BITS
  * @hideinitializer
@@ -163,6 +186,13 @@
 # error "REDUCE_WORK_GROUP_SIZE must be at least RADIX"
 #endif
 
+#ifndef REDUCE_ELEMENTS_PER_LOAD
+# define REDUCE_ELEMENTS_PER_LOAD 1
+#endif
+#if !IS_POWER2(REDUCE_ELEMENTS_PER_LOAD) || REDUCE_ELEMENTS_PER_LOAD > 16
+# error "REDUCE_ELEMENTS_PER_LOAD must be 1, 2, 4, 8 or 16"
+#endif
+
 #ifndef SCAN_BLOCKS
 # error "SCAN_BLOCKS is required"
 # define SCAN_BLOCKS 2 /* Keep doxygen happy */
@@ -180,6 +210,12 @@
 #if SCAN_WORK_GROUP_SIZE < RADIX
 # error "SCAN_WORK_GROUP_SIZE must be at least RADIX"
 #endif
+#ifndef SCAN_WORK_GROUP_FUNCTIONS
+# define SCAN_WORK_GROUP_FUNCTIONS 0
+#endif
+#if SCAN_WORK_GROUP_FUNCTIONS && __OPENCL_C_VERSION__ >= 300 && !defined(__opencl_c_work_group_collective_functions)
+# error "Work-group collective functions are not supported by the device"
+#endif
 
 #ifndef UPSWEEP
 # error "UPSWEEP must be defined"
@@ -214,7 +250,13 @@
 #if SCATTER_WORK_GROUP_SIZE % SCATTER_SLICE != 0
 # error "SCATTER_WORK_GROUP_SIZE must be a multiple of SCATTER_SLICE"
 #endif
-#if SCATTER_SLICE < RADIX
+#ifndef SCATTER_SEQUENTIAL
+# define SCATTER_SEQUENTIAL 0
+#endif
+#if SCATTER_SEQUENTIAL && (SCATTER_SLICE != 1 || SCATTER_WORK_SCALE != 1)
+# error "SCATTER_SEQUENTIAL requires SCATTER_SLICE and SCATTER_WORK_SCALE to be 1"
+#endif
+#if !SCATTER_SEQUENTIAL && SCATTER_SLICE < RADIX
 # error "SCATTER_SLICE must be at least RADIX"
 #endif
 #if SCATTER_SLICE * SCATTER_WORK_SCALE >= 256
@@ -233,6 +275,26 @@
  */
 #define KERNEL(size) __kernel __attribute__((reqd_work_group_size(size, 1, 1)))
 
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+
+#define RADIXSORT_PASTE_(a, b) a ## b
+#define RADIXSORT_PASTE(a, b) RADIXSORT_PASTE_(a, b)
+
+/**
+ * @ref REDUCE_ELEMENTS_PER_LOAD keys, loaded as a vector and accessed as an
+ * array.
+ */
+typedef union
+{
+    RADIXSORT_PASTE(KEY_T, REDUCE_ELEMENTS_PER_LOAD) v;
+    KEY_T s[REDUCE_ELEMENTS_PER_LOAD];
+} radixsort_load;
+
+/// Loads @ref REDUCE_ELEMENTS_PER_LOAD consecutive keys starting at @a p
+#define RADIXSORT_LOAD(p) RADIXSORT_PASTE(vload, REDUCE_ELEMENTS_PER_LOAD)(0, (p))
+
+#endif
+
 /**
  * Extract keys and compute histograms for a range.
  * For each of @a len keys, extracts the @ref RADIX_BITS bits starting from
@@ -266,7 +328,23 @@ void radixsortReduce(__global uint *out, __global const KEY_T *keys,
     }
 
     /* Accumulate all chunks into the histogram */
-    for (uint i = base + lid; i < end; i += REDUCE_WORK_GROUP_SIZE)
+    uint tail = base;  // start of the keys not handled by vector loads
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+    const uint tile = REDUCE_WORK_GROUP_SIZE * REDUCE_ELEMENTS_PER_LOAD;
+    if (end > base)
+        tail += (end - base) / tile * tile;
+    for (uint i = base + lid * REDUCE_ELEMENTS_PER_LOAD; i < tail; i += tile)
+    {
+        radixsort_load loaded;
+        loaded.v = RADIXSORT_LOAD(keys + i);
+        for (uint j = 0; j < REDUCE_ELEMENTS_PER_LOAD; j++)
+        {
+            const uint bucket = (loaded.s[j] >> firstBit) & (RADIX - 1);
+            hist[bucket][lid]++;
+        }
+    }
+#endif
+    for (uint i = tail + lid; i < end; i += REDUCE_WORK_GROUP_SIZE)
     {
         const KEY_T key = keys[i];
         const uint bucket = (key >> firstBit) & (RADIX - 1);
@@ -362,6 +440,11 @@ void radixsortScan(__global uint *histogram, uint blocks)
 
     // Prefix sum the sums array
     sum = sums[SCAN_WORK_GROUP_SIZE + lid];
+#if SCAN_WORK_GROUP_FUNCTIONS
+    sum = work_group_scan_inclusive_add(sum);
+    sums[SCAN_WORK_GROUP_SIZE + lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+#else
     for (uint scale = 1; scale <= SCAN_WORK_GROUP_SIZE / 2; scale *= 2)
     {
         uint prev = sums[SCAN_WORK_GROUP_SIZE - scale + lid];
@@ -370,6 +453,7 @@ void radixsortScan(__global uint *histogram, uint blocks)
         sums[SCAN_WORK_GROUP_SIZE + lid] = sum;
         barrier(CLK_LOCAL_MEM_FENCE);
     }
+#endif
 
     /* Transfer prefix-summed sums back to individual entries, and at the
      * same time write them out.
@@ -682,6 +766,8 @@ inline void downsweep2(__local WARP_VOLATILE ushort *restrict data, __local cons
     data[lid] = out;
 }
 
+#if !SCATTER_SEQUENTIAL
+
 /**
  * Local data for a single slice of the scatter kernel.
  */
@@ -873,6 +959,8 @@ inline uint radixsortScatterTile(
     return offset;
 }
 
+#endif /* !SCATTER_SEQUENTIAL */
+
 /**
  * Scatter keys and values into output arrays.
  *
@@ -902,6 +990,27 @@ void radixsortScatter(__global KEY_T * restrict outKeys,
 #endif
                      )
 {
+#if SCATTER_SEQUENTIAL
+    const uint block = get_global_id(0);
+
+    /* Read initial offsets from global memory */
+    uint offsets[RADIX];
+    for (uint i = 0; i < RADIX; i++)
+        offsets[i] = histogram[block * RADIX + i];
+
+    const uint start = block * len;
+    const uint end = min(start + len, total);
+    for (uint i = start; i < end; i++)
+    {
+        const KEY_T key = inKeys[i];
+        const uint digit = (key >> firstBit) & (RADIX - 1);
+        const uint addr = offsets[digit]++;
+        outKeys[addr] = key;
+#ifdef VALUE_T
+        outValues[addr] = inValues[i];
+#endif
+    }
+#else
     __local WARP_VOLATILE ScatterData wd[SCATTER_SLICES];
 
     const uint local_id = get_local_id(0);
@@ -939,6 +1048,7 @@ void radixsortScatter(__global KEY_T * restrict outKeys,
             lid,
             offset);
     }
+#endif /* !SCATTER_SEQUENTIAL */
 
 #undef SCATTER_SLICES
 }
@@ -31,6 +31,15 @@
 #if ENABLE_KHR_FP16
 #pragma OPENCL EXTENSION cl_khr_fp16 : enable
 #endif
+#if ENABLE_KHR_SUBGROUPS
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+#if ENABLE_INTEL_SUBGROUPS
+#pragma OPENCL EXTENSION cl_intel_subgroups : enable
+#endif
+#if REDUCE_WORK_GROUP_FUNCTIONS && __OPENCL_C_VERSION__ >= 300 && !defined(__opencl_c_work_group_collective_functions)
+# error "Work-group collective functions are not supported by the device"
+#endif
 
 /**
  * Tests whether a value is a power of 2. This macro is suitable for use in
@@ -45,6 +54,115 @@
  * The type of data elements in the reduction.
  */
 
+/**
+ * @def REDUCE_IN_T
+ * @hideinitializer
+ * The type of the input elements. Defaults to @ref REDUCE_T. If it differs,
+ * @ref REDUCE_TRANSFORM must be defined to convert it.
+ */
+
+/**
+ * @def REDUCE_BINARY
+ * @hideinitializer
+ * If non-zero, the reduction reads corresponding elements from two input
+ * arrays, and @ref REDUCE_TRANSFORM combines them.
+ */
+
+/**
+ * @def REDUCE_TRANSFORM
+ * @hideinitializer
+ * Function-like macro mapping an input element @a x (of type
+ * @ref REDUCE_IN_T) to the @ref REDUCE_T value that is reduced. It is applied
+ * as each element is loaded. Defaults to the identity. If
+ * @ref REDUCE_BINARY is set, it instead takes two arguments @a x and @a y,
+ * one from each input, and defaults to their product.
+ */
+
+/**
+ * @def REDUCE_OP
+ * @hideinitializer
+ * Binary operator combining values @a a and @a b. It must be associative
+ * and commutative. Defaults to addition.
+ */
+
+/**
+ * @def REDUCE_IDENTITY
+ * @hideinitializer
+ * The identity element of @ref REDUCE_OP, as a @ref REDUCE_T. Defaults to zero.
+ */
+
+/**
+ * @def REDUCE_STATISTICS
+ * @hideinitializer
+ * If non-zero, a bitwise or of @c REDUCE_STATISTIC_* flags, selecting
+ * statistics that are accumulated together in a structure instead of
+ * applying @ref REDUCE_OP. @c REDUCE_MIN_IDENTITY and @c REDUCE_MAX_IDENTITY
+ * must then be defined as the identities of @c min and @c max.
+ */
+
+/**
+ * @def REDUCE_INDEX
+ * @hideinitializer
+ * If non-zero, one of the values of @c clogs::ReduceIndex other than
+ * @c REDUCE_INDEX_NONE. Each partial result is then a (value, index) pair
+ * for the smallest or largest element, with ties broken by lowest index,
+ * and the index of the result is written to a separate output.
+ * @c REDUCE_MIN_IDENTITY and @c REDUCE_MAX_IDENTITY must be defined as for
+ * @ref REDUCE_STATISTICS.
+ */
+
+/**
+ * @def REDUCE_REPRODUCIBLE
+ * @hideinitializer
+ * If non-zero, the elements are combined in a fixed pairwise tree over the
+ * range (padded with the identity to a power of two), which does not
+ * depend on the work group size, number of blocks or @ref REDUCE_LEAF_SIZE.
+ * This makes floating-point sums reproducible.
+ */
+
+/**
+ * @def REDUCE_LEAF_SIZE
+ * @hideinitializer
+ * For @ref REDUCE_REPRODUCIBLE, the number of consecutive elements that
+ * each work-item combines in registers. It must be a power of 2.
+ */
+
+/**
+ * @def REDUCE_ELEMENTS_PER_LOAD
+ * @hideinitializer
+ * Number of consecutive input elements that each work-item loads at once
+ * with @c vloadN in the main reduction loop. It must be 1, 2, 4, 8 or 16,
+ * and may only exceed 1 for scalar input types. It is not used with
+ * @ref REDUCE_REPRODUCIBLE.
+ */
+
+/**
+ * @def REDUCE_SUBGROUPS
+ * @hideinitializer
+ * If non-zero, work-group reductions use the sub-group built-ins of
+ * @c cl_khr_subgroups or @c cl_intel_subgroups (one of
+ * @c ENABLE_KHR_SUBGROUPS or @c ENABLE_INTEL_SUBGROUPS must be set), with
+ * @ref REDUCE_COLLECTIVE_OP naming the operation. It may only be used with a
+ * scalar @ref REDUCE_T, and not with @ref REDUCE_STATISTICS,
+ * @ref REDUCE_INDEX or @ref REDUCE_REPRODUCIBLE.
+ */
+
+/**
+ * @def REDUCE_WORK_GROUP_FUNCTIONS
+ * @hideinitializer
+ * If non-zero, work-group reductions use the OpenCL C 2.0 work-group
+ * built-ins, with @ref REDUCE_COLLECTIVE_OP naming the operation. The same
+ * restrictions apply as for @ref REDUCE_SUBGROUPS, with which it cannot be
+ * combined.
+ */
+
+/**
+ * @def REDUCE_COLLECTIVE_OP
+ * @hideinitializer
+ * Suffix of the sub-group or work-group built-in that implements
+ * @ref REDUCE_OP: one of @c add, @c min or @c max.
+ */
+
 /**
  * @def REDUCE_BLOCKS
  * @hideinitializer
@@ -59,11 +177,94 @@
  * The work group size for the reduction kernel.
  */
 
+/**
+ * Number of partial results combined by a work-group at each level of the
+ * final combine in @ref reduce. It is a power of 2 (at least 2), and
+ * @c wgc must be initialized with the per-level counters that it implies.
+ */
+#define REDUCE_FAN_IN (REDUCE_WORK_GROUP_SIZE > 1 ? REDUCE_WORK_GROUP_SIZE : 2)
+
 #ifndef REDUCE_T
 # error "REDUCE_T must be specified"
 # define REDUCE_T int /* Keep doxygen happy */
 #endif
 
+#ifndef REDUCE_IN_T
+# define REDUCE_IN_T REDUCE_T
+#endif
+
+#ifndef REDUCE_BINARY
+# define REDUCE_BINARY 0
+#endif
+
+#ifndef REDUCE_TRANSFORM
+# if REDUCE_BINARY
+#  define REDUCE_TRANSFORM(x, y) ((x) * (y))
+# else
+#  define REDUCE_TRANSFORM(x) (x)
+# endif
+#endif
+
+#ifndef REDUCE_OP
+# define REDUCE_OP(a, b) ((a) + (b))
+#endif
+
+#ifndef REDUCE_IDENTITY
+# define REDUCE_IDENTITY ((REDUCE_T) 0)
+#endif
+
+#ifndef REDUCE_STATISTICS
+# define REDUCE_STATISTICS 0
+#endif
+
+#ifndef REDUCE_INDEX
+# define REDUCE_INDEX 0
+#endif
+
+#ifndef REDUCE_REPRODUCIBLE
+# define REDUCE_REPRODUCIBLE 0
+#endif
+
+#ifndef REDUCE_LEAF_SIZE
+# define REDUCE_LEAF_SIZE 1
+#endif
+#if !IS_POWER2(REDUCE_LEAF_SIZE)
+# error "REDUCE_LEAF_SIZE must be a power of 2"
+#endif
+
+#ifndef REDUCE_ELEMENTS_PER_LOAD
+# define REDUCE_ELEMENTS_PER_LOAD 1
+#endif
+#if !IS_POWER2(REDUCE_ELEMENTS_PER_LOAD) || REDUCE_ELEMENTS_PER_LOAD > 16
+# error "REDUCE_ELEMENTS_PER_LOAD must be 1, 2, 4, 8 or 16"
+#endif
+
+#ifndef REDUCE_SUBGROUPS
+# define REDUCE_SUBGROUPS 0
+#endif
+#ifndef REDUCE_WORK_GROUP_FUNCTIONS
+# define REDUCE_WORK_GROUP_FUNCTIONS 0
+#endif
+#if REDUCE_SUBGROUPS && REDUCE_WORK_GROUP_FUNCTIONS
+# error "REDUCE_SUBGROUPS and REDUCE_WORK_GROUP_FUNCTIONS cannot be combined"
+#endif
+#if (REDUCE_SUBGROUPS || REDUCE_WORK_GROUP_FUNCTIONS) && (REDUCE_STATISTICS || REDUCE_INDEX || REDUCE_REPRODUCIBLE)
+# error "Built-in collectives cannot be combined with statistics, indices or reproducibility"
+#endif
+#if (REDUCE_SUBGROUPS || REDUCE_WORK_GROUP_FUNCTIONS) && !defined(REDUCE_COLLECTIVE_OP)
+# error "REDUCE_COLLECTIVE_OP must be specified with built-in collectives"
+#endif
+
+/* These must match the values of clogs::ReduceIndex */
+#define REDUCE_INDEX_ARGMIN 1
+#define REDUCE_INDEX_ARGMAX 2
+
+/* These must match the values of clogs::ReduceStatistic */
+#define REDUCE_STATISTIC_SUM 1
+#define REDUCE_STATISTIC_MIN 2
+#define REDUCE_STATISTIC_MAX 4
+#define REDUCE_STATISTIC_SUM_SQUARES 8
+
 #ifndef REDUCE_WORK_GROUP_SIZE
 # error "REDUCE_WORK_GROUP_SIZE must be specified"
 # define REDUCE_WORK_GROUP_SIZE 1 /* Keep doxygen happy */
@@ -83,24 +284,274 @@
  */
 #define KERNEL(size) __kernel __attribute__((reqd_work_group_size(size, 1, 1)))
 
+#if REDUCE_ELEMENTS_PER_LOAD > 1 || REDUCE_SUBGROUPS || REDUCE_WORK_GROUP_FUNCTIONS
+#define REDUCE_PASTE_(a, b) a ## b
+#define REDUCE_PASTE(a, b) REDUCE_PASTE_(a, b)
+#endif
+
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+
 /**
- * Work-group level reduction. The result is left in @a sums[0], which is only
- * visible to workitem 0.
+ * @ref REDUCE_ELEMENTS_PER_LOAD input elements, loaded as a vector and
+ * accessed as an array.
+ */
+typedef union
+{
+    REDUCE_PASTE(REDUCE_IN_T, REDUCE_ELEMENTS_PER_LOAD) v;
+    REDUCE_IN_T s[REDUCE_ELEMENTS_PER_LOAD];
+} reduce_load;
+
+/// Loads @ref REDUCE_ELEMENTS_PER_LOAD consecutive elements starting at @a p
+#define REDUCE_LOAD(p) REDUCE_PASTE(vload, REDUCE_ELEMENTS_PER_LOAD)(0, (p))
+
+#endif
+
+#if REDUCE_INDEX
+
+/**
+ * Accumulator holding the extreme value seen so far and its index.
+ */
+typedef struct
+{
+    REDUCE_T value;
+    uint index;
+} reduce_indexed;
+
+/// Type of the partial results
+#define REDUCE_ACC_T reduce_indexed
+
+/**
+ * Selects the better of two candidates. Ties are broken by index, which makes
+ * the result independent of the order of combination.
+ */
+inline REDUCE_ACC_T reduceOp(REDUCE_ACC_T a, REDUCE_ACC_T b)
+{
+#if REDUCE_INDEX == REDUCE_INDEX_ARGMIN
+    bool first = a.value < b.value;
+#else
+    bool first = a.value > b.value;
+#endif
+    if (a.value == b.value)
+        first = a.index < b.index;
+    return first ? a : b;
+}
+
+/// Returns a candidate that loses to any element.
+inline REDUCE_ACC_T reduceIdentity(void)
+{
+    REDUCE_ACC_T ans;
+#if REDUCE_INDEX == REDUCE_INDEX_ARGMIN
+    ans.value = REDUCE_MIN_IDENTITY;
+#else
+    ans.value = REDUCE_MAX_IDENTITY;
+#endif
+    ans.index = UINT_MAX;
+    return ans;
+}
+
+/// Returns the candidate for element @a x at position @a index.
+inline REDUCE_ACC_T reduceLift(REDUCE_T x, uint index)
+{
+    REDUCE_ACC_T ans;
+    ans.value = x;
+    ans.index = index;
+    return ans;
+}
+
+/// Writes the value of the result to @a out and its index to @a outIndex.
+inline void reduceStore(__global REDUCE_T *out, __global uint *outIndex, REDUCE_ACC_T v)
+{
+    *out = v.value;
+    *outIndex = v.index;
+}
+
+#elif REDUCE_STATISTICS
+
+/**
+ * Accumulator holding all the statistics selected by @ref REDUCE_STATISTICS.
+ */
+typedef struct
+{
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM
+    REDUCE_T sum;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MIN
+    REDUCE_T min;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MAX
+    REDUCE_T max;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES
+    REDUCE_T sumSquares;
+#endif
+} reduce_statistics;
+
+/// Type of the partial results
+#define REDUCE_ACC_T reduce_statistics
+
+/// Combines two sets of statistics.
+inline REDUCE_ACC_T reduceOp(REDUCE_ACC_T a, REDUCE_ACC_T b)
+{
+    REDUCE_ACC_T ans;
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM
+    ans.sum = a.sum + b.sum;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MIN
+    ans.min = min(a.min, b.min);
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MAX
+    ans.max = max(a.max, b.max);
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES
+    ans.sumSquares = a.sumSquares + b.sumSquares;
+#endif
+    return ans;
+}
+
+/// Returns the statistics of an empty sequence.
+inline REDUCE_ACC_T reduceIdentity(void)
+{
+    REDUCE_ACC_T ans;
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM
+    ans.sum = (REDUCE_T) 0;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MIN
+    ans.min = REDUCE_MIN_IDENTITY;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MAX
+    ans.max = REDUCE_MAX_IDENTITY;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES
+    ans.sumSquares = (REDUCE_T) 0;
+#endif
+    return ans;
+}
+
+/// Returns the statistics of a sequence containing only @a x.
+inline REDUCE_ACC_T reduceLift(REDUCE_T x, uint index)
+{
+    REDUCE_ACC_T ans;
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM
+    ans.sum = x;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MIN
+    ans.min = x;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MAX
+    ans.max = x;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES
+    ans.sumSquares = x * x;
+#endif
+    return ans;
+}
+
+/// Writes the selected statistics to consecutive elements of @a out.
+inline void reduceStore(__global REDUCE_T *out, __global uint *outIndex, REDUCE_ACC_T v)
+{
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM
+    *out++ = v.sum;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MIN
+    *out++ = v.min;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_MAX
+    *out++ = v.max;
+#endif
+#if REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES
+    *out++ = v.sumSquares;
+#endif
+}
+
+#else /* !REDUCE_INDEX && !REDUCE_STATISTICS */
+
+/// Type of the partial results
+#define REDUCE_ACC_T REDUCE_T
+
+/**
+ * Applies @ref REDUCE_OP. Using a function ensures that the arguments are
+ * evaluated once, even if a user-defined operator refers to them repeatedly.
+ */
+inline REDUCE_T reduceOp(REDUCE_T a, REDUCE_T b)
+{
+    return REDUCE_OP(a, b);
+}
+
+inline REDUCE_T reduceIdentity(void)
+{
+    return REDUCE_IDENTITY;
+}
+
+inline REDUCE_T reduceLift(REDUCE_T x, uint index)
+{
+    return x;
+}
+
+inline void reduceStore(__global REDUCE_T *out, __global uint *outIndex, REDUCE_T v)
+{
+    *out = v;
+}
+
+#endif
+
+/**
+ * Applies @ref REDUCE_TRANSFORM. Using a function ensures that the arguments
+ * are loaded once, even if the transform refers to them repeatedly.
+ */
+#if REDUCE_BINARY
+inline REDUCE_T reduceTransform(REDUCE_IN_T x, REDUCE_IN_T y)
+{
+    return REDUCE_TRANSFORM(x, y);
+}
+#else
+inline REDUCE_T reduceTransform(REDUCE_IN_T x)
+{
+    return REDUCE_TRANSFORM(x);
+}
+#endif
+
+/**
+ * Work-group level reduction of per-workitem values. The result is left in
+ * @a sums[0], which is only visible to workitem 0.
  *
- * @param in       Array containing items
- * @param first    Starting position for scan
- * @param last     End position for scan
+ * @param accum    Value contributed by the current work-item
  * @param lid      Local ID of current work-item
  * @param sums     Scratch space and output area
  */
-void reduceRange(
-    __global const REDUCE_T * restrict in, uint first, uint last, uint lid,
-    __local REDUCE_T sums[REDUCE_WORK_GROUP_SIZE])
+void reduceLocal(REDUCE_ACC_T accum, uint lid, __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE])
 {
-    REDUCE_T accum = 0;
-    for (uint i = first; i < last; i += REDUCE_WORK_GROUP_SIZE)
-        if (i + lid < last)
-            accum += in[i + lid];
+#if REDUCE_WORK_GROUP_FUNCTIONS
+    /* As for the tree, only work-item 0 uses sums[0], so no barrier is needed */
+    accum = REDUCE_PASTE(work_group_reduce_, REDUCE_COLLECTIVE_OP)(accum);
+    if (lid == 0)
+        sums[0] = accum;
+#elif REDUCE_SUBGROUPS
+    /* Each sub-group reduces its values, then the first sub-group reduces
+     * the sub-group results. The mapping of work-items to sub-groups is
+     * implementation-defined, so the barriers do not assume that work-item
+     * 0 is in sub-group 0, and the first one protects sums[0] from a
+     * previous call.
+     */
+    const uint subGroup = get_sub_group_id();
+    const uint subGroups = get_num_sub_groups();
+    const uint subSize = get_sub_group_size();
+    const uint subLid = get_sub_group_local_id();
+    accum = REDUCE_PASTE(sub_group_reduce_, REDUCE_COLLECTIVE_OP)(accum);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (subLid == 0)
+        sums[subGroup] = accum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (subGroup == 0)
+    {
+        accum = reduceIdentity();
+        for (uint i = subLid; i < subGroups; i += subSize)
+            accum = reduceOp(accum, sums[i]);
+        accum = REDUCE_PASTE(sub_group_reduce_, REDUCE_COLLECTIVE_OP)(accum);
+        if (subLid == 0)
+            sums[0] = accum;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+#else
     sums[lid] = accum;
 
     /* Local reduction */
@@ -108,32 +559,455 @@ void reduceRange(
     {
         barrier(CLK_LOCAL_MEM_FENCE);
         if (lid < scale)
-            sums[lid] += sums[lid + scale];
+            sums[lid] = reduceOp(sums[lid], sums[lid + scale]);
+    }
+#endif
+}
+
+#if REDUCE_REPRODUCIBLE
+
+/* Fusing a transform with the tree could change the rounding */
+#pragma OPENCL FP_CONTRACT OFF
+
+/**
+ * Adds the @a n th value of a sequence to a pairwise combination. The
+ * stack holds the combined values of the completed aligned subtrees, one
+ * per level, so that combining proceeds like a binary counter. When @a n + 1
+ * is a power of 2, the return value is the combination of the whole sequence.
+ */
+inline REDUCE_ACC_T reducePairwisePush(REDUCE_ACC_T *stack, uint n, REDUCE_ACC_T v)
+{
+    uint level = 0;
+    for (; n & 1; n >>= 1, level++)
+        v = reduceOp(stack[level], v);
+    stack[level] = v;
+    return v;
+}
+
+/**
+ * Variant of @ref reduceLocal that always combines adjacent subtrees, so
+ * that the per-workitem values are combined in a pairwise tree.
+ */
+void reduceLocalPairwise(REDUCE_ACC_T accum, uint lid, __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE])
+{
+    sums[lid] = accum;
+    for (uint scale = 1; scale < REDUCE_WORK_GROUP_SIZE; scale *= 2)
+    {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if ((lid & (2 * scale - 1)) == 0)
+            sums[lid] = reduceOp(sums[lid], sums[lid + scale]);
     }
 }
 
+/**
+ * Combines an aligned chunk of <code>REDUCE_WORK_GROUP_SIZE * REDUCE_LEAF_SIZE</code>
+ * elements, starting at element @a first of the range, in a pairwise tree.
+ * Each work-item combines @ref REDUCE_LEAF_SIZE consecutive elements in
+ * registers, and the work-items' results are then combined in local memory,
+ * always pairing adjacent subtrees. Elements beyond the range are taken to
+ * be the identity. The result is returned to work-item 0.
+ */
+REDUCE_ACC_T reduceChunk(
+    __global const REDUCE_IN_T * restrict in,
+#if REDUCE_BINARY
+    __global const REDUCE_IN_T * restrict in2,
+#endif
+    uint start, uint first, uint elements,
+    uint lid, __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE])
+{
+    REDUCE_ACC_T leaf[REDUCE_LEAF_SIZE];
+    const uint leafFirst = first + lid * REDUCE_LEAF_SIZE;
+    for (uint i = 0; i < REDUCE_LEAF_SIZE; i++)
+    {
+        const uint pos = leafFirst + i;
+        if (pos < elements)
+        {
+#if REDUCE_BINARY
+            leaf[i] = reduceLift(reduceTransform(in[start + pos], in2[start + pos]), start + pos);
+#else
+            leaf[i] = reduceLift(reduceTransform(in[start + pos]), start + pos);
+#endif
+        }
+        else
+            leaf[i] = reduceIdentity();
+    }
+    for (uint scale = 1; scale < REDUCE_LEAF_SIZE; scale *= 2)
+        for (uint i = 0; i < REDUCE_LEAF_SIZE; i += 2 * scale)
+            leaf[i] = reduceOp(leaf[i], leaf[i + scale]);
+
+    reduceLocalPairwise(leaf[0], lid, sums);
+    REDUCE_ACC_T ans = sums[0];
+    barrier(CLK_LOCAL_MEM_FENCE); // protects sums against the next chunk
+    return ans;
+}
+
+#endif /* REDUCE_REPRODUCIBLE */
+
+/**
+ * Combines up to @ref REDUCE_FAN_IN partial results, which are
+ * <code>partial[0], partial[stride], ...</code>. Missing results are taken
+ * to be the identity. As for @ref reduceLocal, the result is left in
+ * @a sums[0] and is only visible to work-item 0.
+ *
+ * @param partial  First partial result
+ * @param stride   Distance between partial results
+ * @param children Number of partial results
+ * @param lid      Local ID of current work-item
+ * @param sums     Scratch space and output area
+ */
+void reduceCluster(
+    __global const REDUCE_ACC_T * restrict partial, uint stride, uint children,
+    uint lid, __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE])
+{
+    /* Each work-item takes consecutive children, so that for
+     * REDUCE_REPRODUCIBLE the tree is still pairwise.
+     */
+    const uint perItem = REDUCE_FAN_IN / REDUCE_WORK_GROUP_SIZE;
+    const uint child = lid * perItem;
+    REDUCE_ACC_T accum = child < children ? partial[child * stride] : reduceIdentity();
+    for (uint i = 1; i < perItem; i++)
+        if (child + i < children)
+            accum = reduceOp(accum, partial[(child + i) * stride]);
+#if REDUCE_REPRODUCIBLE
+    reduceLocalPairwise(accum, lid, sums);
+#else
+    reduceLocal(accum, lid, sums);
+#endif
+}
+
+/**
+ * Reduces the range in @ref REDUCE_BLOCKS blocks of @a blockSize elements.
+ * Each work-group writes the result for its block to @a partial, and the
+ * block results are then combined in a tree with a fan-in of
+ * @ref REDUCE_FAN_IN: in each cluster of siblings, the last work-group to
+ * finish combines them and moves up a level, while the others exit. This
+ * keeps the combine parallel when there are many more blocks than
+ * work-items in a work-group.
+ *
+ * @param wgc            Counters of work-groups yet to finish. The first
+ *                       holds @ref REDUCE_BLOCKS and is used by the other
+ *                       kernels; it is followed by one counter per cluster,
+ *                       level by level, each holding its number of children.
+ *                       The counters are restored when the kernel completes.
+ */
 KERNEL(REDUCE_WORK_GROUP_SIZE)
 void reduce(
     __global volatile uint * restrict wgc,
     __global REDUCE_T * restrict out, uint outPos,
-    __global const REDUCE_T * restrict in, uint start, uint elements,
-    __global REDUCE_T * restrict partial,
-    uint blockSize)
+    __global const REDUCE_IN_T * restrict in, uint start, uint elements,
+    __global REDUCE_ACC_T * restrict partial,
+    uint blockSize
+#if REDUCE_BINARY
+    , __global const REDUCE_IN_T * restrict in2
+#endif
+#if REDUCE_INDEX
+    , __global uint * restrict outIndex, uint outIndexPos
+#endif
+    )
 {
-    __local REDUCE_T sums[REDUCE_WORK_GROUP_SIZE];
+    __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE];
     __local bool done;
 
     const uint group = get_group_id(0);
     const uint lid = get_local_id(0);
     const uint first = group * blockSize;
+
+#if REDUCE_REPRODUCIBLE
+    /* blockSize is a power of 2 and a multiple of the chunk size, so that
+     * each block is an aligned subtree of the pairwise tree over the range.
+     */
+    const uint chunkSize = REDUCE_WORK_GROUP_SIZE * REDUCE_LEAF_SIZE;
+    REDUCE_ACC_T stack[32];
+    REDUCE_ACC_T blockSum = reduceIdentity();
+    for (uint c = 0; c < blockSize / chunkSize; c++)
+    {
+        const uint chunkFirst = first + c * chunkSize;
+        REDUCE_ACC_T chunkSum = reduceIdentity();
+        if (chunkFirst < elements)
+        {
+#if REDUCE_BINARY
+            chunkSum = reduceChunk(in, in2, start, chunkFirst, elements, lid, sums);
+#else
+            chunkSum = reduceChunk(in, start, chunkFirst, elements, lid, sums);
+#endif
+        }
+        if (lid == 0)
+            blockSum = reducePairwisePush(stack, c, chunkSum);
+    }
+    if (lid == 0)
+        sums[0] = blockSum;
+#else
     const uint last = min(first + blockSize, elements);
 
-    reduceRange(in + start, first, last, lid, sums);
+    REDUCE_ACC_T accum = reduceIdentity();
+    uint tail = first;  // start of the elements not handled by vector loads
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+    const uint tile = REDUCE_WORK_GROUP_SIZE * REDUCE_ELEMENTS_PER_LOAD;
+    if (last > first)
+        tail += (last - first) / tile * tile;
+    for (uint i = first + lid * REDUCE_ELEMENTS_PER_LOAD; i < tail; i += tile)
+    {
+        reduce_load x;
+        x.v = REDUCE_LOAD(in + start + i);
+#if REDUCE_BINARY
+        reduce_load y;
+        y.v = REDUCE_LOAD(in2 + start + i);
+#endif
+        for (uint j = 0; j < REDUCE_ELEMENTS_PER_LOAD; j++)
+        {
+#if REDUCE_BINARY
+            accum = reduceOp(accum, reduceLift(reduceTransform(x.s[j], y.s[j]), start + i + j));
+#else
+            accum = reduceOp(accum, reduceLift(reduceTransform(x.s[j]), start + i + j));
+#endif
+        }
+    }
+#endif
+    for (uint i = tail + lid; i < last; i += REDUCE_WORK_GROUP_SIZE)
+    {
+#if REDUCE_BINARY
+        accum = reduceOp(accum, reduceLift(reduceTransform(in[start + i], in2[start + i]), start + i));
+#else
+        accum = reduceOp(accum, reduceLift(reduceTransform(in[start + i]), start + i));
+#endif
+    }
+    reduceLocal(accum, lid, sums);
+#endif
 
     /* No barrier needed here, because sums[0] is computed by thread 0 */
     if (lid == 0)
-    {
         partial[group] = sums[0];
+
+    __global volatile uint *counters = wgc + 1; // counters for the current level
+    uint count = REDUCE_BLOCKS;                 // partial results at the current level
+    uint index = group;                         // index of our result at the current level
+    uint stride = 1;                            // distance between results in partial
+    while (count > 1)
+    {
+        const uint cluster = index / REDUCE_FAN_IN;
+        const uint clusterFirst = cluster * REDUCE_FAN_IN;
+        const uint clusters = (count + REDUCE_FAN_IN - 1) / REDUCE_FAN_IN;
+        if (lid == 0)
+        {
+            mem_fence(CLK_GLOBAL_MEM_FENCE);
+            int old = atomic_dec(counters + cluster);
+            done = (old == 1);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE); // ensures all work items see done
+        if (!done)
+            return;
+
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        const uint children = min((uint) REDUCE_FAN_IN, count - clusterFirst);
+        reduceCluster(partial + clusterFirst * stride, stride, children, lid, sums);
+        if (lid == 0)
+        {
+            counters[cluster] = children;
+            partial[clusterFirst * stride] = sums[0];
+        }
+
+        counters += clusters;
+        count = clusters;
+        index = cluster;
+        stride *= REDUCE_FAN_IN;
+        barrier(CLK_LOCAL_MEM_FENCE); // protects done and sums for the next level
+    }
+
+    if (lid == 0)
+    {
+#if REDUCE_REPRODUCIBLE
+        /* The final addition of the identity turns a -0 into +0, which is
+         * what more levels of padding would have done.
+         */
+        const REDUCE_ACC_T result = reduceOp(sums[0], reduceIdentity());
+#else
+        const REDUCE_ACC_T result = sums[0];
+#endif
+#if REDUCE_INDEX
+        reduceStore(out + outPos, outIndex + outIndexPos, result);
+#else
+        reduceStore(out + outPos, NULL, result);
+#endif
+    }
+}
+
+#if !REDUCE_BINARY && !REDUCE_INDEX
+
+#if REDUCE_STATISTICS
+/// Number of elements written per result
+# define REDUCE_OUTPUTS \
+    (((REDUCE_STATISTICS & REDUCE_STATISTIC_SUM) != 0) \
+     + ((REDUCE_STATISTICS & REDUCE_STATISTIC_MIN) != 0) \
+     + ((REDUCE_STATISTICS & REDUCE_STATISTIC_MAX) != 0) \
+     + ((REDUCE_STATISTICS & REDUCE_STATISTIC_SUM_SQUARES) != 0))
+#else
+# define REDUCE_OUTPUTS 1
+#endif
+
+/**
+ * Returns the index of the first of the @a n offsets that is at least @a x,
+ * or @a n if there is none.
+ */
+inline uint reduceLowerBound(__global const uint * restrict offsets, uint n, uint x)
+{
+    uint low = 0;
+    uint high = n;
+    while (low < high)
+    {
+        uint mid = low + (high - low) / 2;
+        if (offsets[mid] < x)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/// Returns the first element of segment @a s, clamped to the range.
+inline uint reduceSegmentStart(__global const uint * restrict offsets, uint numSegments, uint elements, uint s)
+{
+    return min(offsets[s], elements);
+}
+
+/// Returns the element after the last one in segment @a s, clamped to the range.
+inline uint reduceSegmentEnd(__global const uint * restrict offsets, uint numSegments, uint elements, uint s)
+{
+    return s + 1 < numSegments ? min(offsets[s + 1], elements) : elements;
+}
+
+/**
+ * Cooperatively reduces elements @a first to @a last (exclusive) of the
+ * range, leaving the result in @a sums[0] for work-item 0.
+ */
+void reduceSpan(
+    __global const REDUCE_IN_T * restrict in, uint start, uint first, uint last,
+    uint lid, __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE])
+{
+    REDUCE_ACC_T accum = reduceIdentity();
+    for (uint i = first + lid; i < last; i += REDUCE_WORK_GROUP_SIZE)
+        accum = reduceOp(accum, reduceLift(reduceTransform(in[start + i]), start + i));
+    reduceLocal(accum, lid, sums);
+}
+
+/**
+ * Reduces each of a number of segments of the range. Segment @a s consists
+ * of the elements from <code>offsets[s]</code> up to the next offset (or
+ * the end of the range), and its result is written starting at element
+ * <code>outPos + s * @ref REDUCE_OUTPUTS</code> of @a out.
+ *
+ * The range is split into @ref REDUCE_BLOCKS blocks of @a blockSize
+ * elements, regardless of where the segments fall, so that the work is
+ * balanced however unequal the segments are. Each block writes the results
+ * of segments that lie entirely within it. A segment that is split between
+ * blocks leaves a partial result in each: the first slot of a block holds the
+ * segment continued from earlier blocks and the second slot holds the
+ * segment that continues into later blocks, with @c UINT_MAX in
+ * @a partialSegment for an unused slot. The last block to finish combines
+ * these partial results in order.
+ *
+ * @param wgc            Counter of work-groups yet to finish (the first of those for @ref reduce)
+ * @param out            Output buffer
+ * @param outPos         Position in @a out of the result for the first segment
+ * @param in             Input buffer
+ * @param start          Position in @a in of the first element of the range
+ * @param elements       Number of elements in the range
+ * @param offsets        Non-decreasing offsets (relative to @a start) of the segment starts
+ * @param numSegments    Number of segments (at least 1)
+ * @param partial        Partial results, two per block
+ * @param partialSegment Segment index of each partial result
+ * @param blockSize      Number of elements per block (a multiple of the work-group size)
+ */
+KERNEL(REDUCE_WORK_GROUP_SIZE)
+void reduceSegmented(
+    __global volatile uint * restrict wgc,
+    __global REDUCE_T * restrict out, uint outPos,
+    __global const REDUCE_IN_T * restrict in, uint start, uint elements,
+    __global const uint * restrict offsets, uint numSegments,
+    __global REDUCE_ACC_T * restrict partial,
+    __global uint * restrict partialSegment,
+    uint blockSize)
+{
+    __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE];
+    __local bool done;
+
+    const uint group = get_group_id(0);
+    const uint lid = get_local_id(0);
+    const uint first = group * blockSize;
+    const uint last = min(first + blockSize, elements);
+
+    /* Segments [firstSegment, lastSegment) lie entirely within the block.
+     * Empty segments at the end of the range belong to the last block.
+     */
+    uint firstSegment = 0, lastSegment = 0;
+    uint headSegment = UINT_MAX, tailSegment = UINT_MAX;
+    if (first < last)
+    {
+        firstSegment = reduceLowerBound(offsets, numSegments, first);
+        lastSegment = last == elements ? numSegments : reduceLowerBound(offsets, numSegments, last);
+        if (firstSegment > 0 && reduceSegmentEnd(offsets, numSegments, elements, firstSegment - 1) > first)
+            headSegment = firstSegment - 1;
+        if (lastSegment > firstSegment && reduceSegmentEnd(offsets, numSegments, elements, lastSegment - 1) > last)
+        {
+            tailSegment = lastSegment - 1;
+            lastSegment--;
+        }
+    }
+
+    if (headSegment != UINT_MAX)
+    {
+        reduceSpan(in, start, first,
+                   min(reduceSegmentEnd(offsets, numSegments, elements, headSegment), last),
+                   lid, sums);
+        if (lid == 0)
+            partial[2 * group] = sums[0];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    const uint count = lastSegment - firstSegment;
+    const uint contained =
+        count == 0 ? 0
+        : reduceSegmentEnd(offsets, numSegments, elements, lastSegment - 1)
+          - reduceSegmentStart(offsets, numSegments, elements, firstSegment);
+    if (contained < count * REDUCE_WORK_GROUP_SIZE)
+    {
+        /* Short segments: each work-item reduces whole segments on its own,
+         * rather than paying for a work-group reduction per segment.
+         */
+        for (uint s = firstSegment + lid; s < lastSegment; s += REDUCE_WORK_GROUP_SIZE)
+        {
+            const uint segEnd = reduceSegmentEnd(offsets, numSegments, elements, s);
+            REDUCE_ACC_T accum = reduceIdentity();
+            for (uint i = reduceSegmentStart(offsets, numSegments, elements, s); i < segEnd; i++)
+                accum = reduceOp(accum, reduceLift(reduceTransform(in[start + i]), start + i));
+            reduceStore(out + outPos + s * REDUCE_OUTPUTS, NULL, accum);
+        }
+    }
+    else
+    {
+        for (uint s = firstSegment; s < lastSegment; s++)
+        {
+            reduceSpan(in, start,
+                       reduceSegmentStart(offsets, numSegments, elements, s),
+                       reduceSegmentEnd(offsets, numSegments, elements, s),
+                       lid, sums);
+            if (lid == 0)
+                reduceStore(out + outPos + s * REDUCE_OUTPUTS, NULL, sums[0]);
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+    }
+
+    if (tailSegment != UINT_MAX)
+    {
+        reduceSpan(in, start, reduceSegmentStart(offsets, numSegments, elements, tailSegment), last,
+                   lid, sums);
+        if (lid == 0)
+            partial[2 * group + 1] = sums[0];
+    }
+
+    if (lid == 0)
+    {
+        partialSegment[2 * group] = headSegment;
+        partialSegment[2 * group + 1] = tailSegment;
         mem_fence(CLK_GLOBAL_MEM_FENCE);
         int old = atomic_dec(wgc);
         done = (old == 1);
@@ -143,12 +1017,132 @@ void reduce(
     if (done)
     {
         mem_fence(CLK_GLOBAL_MEM_FENCE);
-        // TODO: this could be made much more efficient if wgs is bigger than blocks
-        reduceRange(partial, 0, REDUCE_BLOCKS, lid, sums);
-        if (lid == 0)
+        /* A split segment starts in the second slot of a block, and
+         * continues in the first slots of the following blocks. Each
+         * work-item handles the segments that start in some of the blocks.
+         */
+        for (uint g = lid; g < REDUCE_BLOCKS; g += REDUCE_WORK_GROUP_SIZE)
         {
+            const uint s = partialSegment[2 * g + 1];
+            if (s == UINT_MAX)
+                continue;
+            REDUCE_ACC_T accum = partial[2 * g + 1];
+            for (uint h = g + 1; h < REDUCE_BLOCKS && partialSegment[2 * h] == s; h++)
+                accum = reduceOp(accum, partial[2 * h]);
+            reduceStore(out + outPos + s * REDUCE_OUTPUTS, NULL, accum);
+        }
+        if (lid == 0)
             *wgc = REDUCE_BLOCKS;
-            out[outPos] = sums[0];
+    }
+}
+
+/**
+ * Reduces each column of a row-major matrix. The element in row @a r and
+ * column @a c is at position <code>start + r * rowStride + c</code> of
+ * @a in, and the result for column @a c is written starting at element
+ * <code>outPos + c * @ref REDUCE_OUTPUTS</code> of @a out.
+ *
+ * The first @a blocks work-groups each reduce @a rowsPerBlock consecutive
+ * rows into a partial result per column, in
+ * <code>partial[group * columns + c]</code>, and the last work-group to
+ * finish combines them. Consecutive work-items read consecutive columns of
+ * a row, so that reads are coalesced. When there are fewer columns than
+ * work-items, each work-item handles one column of every
+ * <code>REDUCE_WORK_GROUP_SIZE / columns</code>th row and the results are
+ * combined in local memory; otherwise each work-item handles whole columns.
+ * The remaining work-groups do nothing except decrement @a wgc.
+ *
+ * @param wgc            Counter of work-groups yet to finish (the first of those for @ref reduce)
+ * @param out            Output buffer
+ * @param outPos         Position in @a out of the result for the first column
+ * @param in             Input buffer
+ * @param start          Position in @a in of the first element of the first row
+ * @param rows           Number of rows
+ * @param columns        Number of columns
+ * @param rowStride      Distance between the starts of consecutive rows, in elements
+ * @param partial        Partial results, @a columns per block
+ * @param blocks         Number of work-groups that reduce rows
+ * @param rowsPerBlock   Number of rows reduced by each work-group
+ */
+KERNEL(REDUCE_WORK_GROUP_SIZE)
+void reduceColumns(
+    __global volatile uint * restrict wgc,
+    __global REDUCE_T * restrict out, uint outPos,
+    __global const REDUCE_IN_T * restrict in, uint start,
+    uint rows, uint columns, uint rowStride,
+    __global REDUCE_ACC_T * restrict partial,
+    uint blocks, uint rowsPerBlock)
+{
+    __local REDUCE_ACC_T sums[REDUCE_WORK_GROUP_SIZE];
+    __local bool done;
+
+    const uint group = get_group_id(0);
+    const uint lid = get_local_id(0);
+    if (group < blocks)
+    {
+        const uint firstRow = group * rowsPerBlock;
+        const uint lastRow = min(firstRow + rowsPerBlock, rows);
+        __global REDUCE_ACC_T *groupPartial = partial + group * columns;
+        if (columns <= REDUCE_WORK_GROUP_SIZE)
+        {
+            const uint rowStep = REDUCE_WORK_GROUP_SIZE / columns;
+            const uint column = lid % columns;
+            REDUCE_ACC_T accum = reduceIdentity();
+            if (lid < rowStep * columns)
+            {
+                for (uint r = firstRow + lid / columns; r < lastRow; r += rowStep)
+                {
+                    const uint pos = start + r * rowStride + column;
+                    accum = reduceOp(accum, reduceLift(reduceTransform(in[pos]), pos));
+                }
+            }
+            sums[lid] = accum;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            if (lid < columns)
+            {
+                for (uint i = 1; i < rowStep; i++)
+                    accum = reduceOp(accum, sums[lid + i * columns]);
+                groupPartial[lid] = accum;
+            }
+        }
+        else
+        {
+            for (uint column = lid; column < columns; column += REDUCE_WORK_GROUP_SIZE)
+            {
+                REDUCE_ACC_T accum = reduceIdentity();
+                for (uint r = firstRow; r < lastRow; r++)
+                {
+                    const uint pos = start + r * rowStride + column;
+                    accum = reduceOp(accum, reduceLift(reduceTransform(in[pos]), pos));
+                }
+                groupPartial[column] = accum;
+            }
         }
     }
+
+    /* Every work-item may have written partial results */
+    mem_fence(CLK_GLOBAL_MEM_FENCE);
+    barrier(CLK_GLOBAL_MEM_FENCE);
+    if (lid == 0)
+    {
+        int old = atomic_dec(wgc);
+        done = (old == 1);
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE); // ensures all work items see done
+    if (done)
+    {
+        mem_fence(CLK_GLOBAL_MEM_FENCE);
+        for (uint column = lid; column < columns; column += REDUCE_WORK_GROUP_SIZE)
+        {
+            REDUCE_ACC_T accum = reduceIdentity();
+            for (uint i = 0; i < blocks; i++)
+                accum = reduceOp(accum, partial[i * columns + column]);
+            reduceStore(out + outPos + column * REDUCE_OUTPUTS, NULL, accum);
+        }
+        if (lid == 0)
+            *wgc = REDUCE_BLOCKS;
+    }
 }
+
+#endif /* !REDUCE_BINARY && !REDUCE_INDEX */
@@ -25,6 +25,22 @@
  * Scan kernels for CLOGS.
  */
 
+#if ENABLE_KHR_FP64 && __OPENCL_C_VERSION__ <= 110
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+#if ENABLE_KHR_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+#if ENABLE_KHR_SUBGROUPS
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#endif
+#if ENABLE_INTEL_SUBGROUPS
+#pragma OPENCL EXTENSION cl_intel_subgroups : enable
+#endif
+#if SCAN_WORK_GROUP_FUNCTIONS && __OPENCL_C_VERSION__ >= 300 && !defined(__opencl_c_work_group_collective_functions)
+# error "Work-group collective functions are not supported by the device"
+#endif
+
 /**
  * Tests whether a value is a power of 2. This macro is suitable for use in
  * preprocessor expressions.
@@ -38,6 +54,66 @@
  * The type of data elements in the scan.
  */
 
+/**
+ * @def SCAN_OP
+ * @hideinitializer
+ * Binary operator combining an earlier value @a a with a later value @a b.
+ * It must be associative, and also commutative since the initial reduction
+ * does not preserve the order of operands. Defaults to addition.
+ */
+
+/**
+ * @def SCAN_IDENTITY
+ * @hideinitializer
+ * The identity element of @ref SCAN_OP, as a @ref SCAN_T. Defaults to zero.
+ */
+
+/**
+ * @def SCAN_ACC_T
+ * @hideinitializer
+ * The type in which partial results are accumulated. It defaults to
+ * @ref SCAN_T, but may be a wider type (e.g. @c double for @c float data)
+ * to reduce rounding errors in long scans. If it is defined, then
+ * @c SCAN_TO_ACC(x) and @c SCAN_FROM_ACC(x) must also be defined to convert
+ * between the two types.
+ */
+
+/**
+ * @def SCAN_IN_T
+ * @hideinitializer
+ * The type of the input elements. It defaults to @ref SCAN_T, but may be a
+ * different type with the same number of components (e.g. @c uchar for
+ * @c uint sums), in which case @c SCAN_IN_TO_ACC(x) must also be defined to
+ * convert it to @ref SCAN_ACC_T. The conversion is done as the input is
+ * loaded.
+ */
+
+/**
+ * @def SCAN_TRANSFORM
+ * @hideinitializer
+ * If defined, a function-like macro mapping an input element @a x (of type
+ * @ref SCAN_IN_T) to the @ref SCAN_T value that is scanned. It is applied as
+ * each element is loaded, so that simple element-wise maps do not need a
+ * separate pass over memory. It takes the place of @c SCAN_IN_TO_ACC.
+ */
+
+/**
+ * @def SCAN_KAHAN
+ * @hideinitializer
+ * If non-zero, the long serial accumulations (within the initial reduction,
+ * and of the running offset in the final scan) use Kahan compensated
+ * summation. This is only meaningful for floating-point sums.
+ */
+
+/**
+ * @def SCAN_SEGMENTED
+ * @hideinitializer
+ * If non-zero, the scan is segmented: each element has a head flag, and the
+ * running sum restarts at each element whose flag is set. The flags are
+ * carried alongside the partial sums through every kernel, and the initial
+ * reduction combines elements in order.
+ */
+
 /**
  * @def SCAN_PAD_T
  * @hideinitializer
@@ -67,6 +143,14 @@
  * The work group size for the initial reduction kernel in a scan operation.
  */
 
+/**
+ * @def REDUCE_ELEMENTS_PER_LOAD
+ * @hideinitializer
+ * Number of consecutive input elements that each work-item loads at once
+ * with @c vloadN in the initial reduction kernel. It must be 1, 2, 4, 8 or
+ * 16, and may only exceed 1 for scalar input types and unsegmented scans.
+ */
+
 /**
  * @def SCAN_BLOCKS
  * @hideinitializer
@@ -87,11 +171,97 @@
  * The number of elements to process per thread in the final scan kernel.
  */
 
+/**
+ * @def SCAN_INCLUSIVE
+ * @hideinitializer
+ * If non-zero, the final scan kernel writes inclusive rather than exclusive
+ * prefix sums. The block offsets computed by the small scan kernels are
+ * exclusive in either case.
+ */
+
+/**
+ * @def SCAN_SUBGROUPS
+ * @hideinitializer
+ * If non-zero, the work-group reductions and scans in the reduce,
+ * @ref scanExclusive and single-pass kernels use the sub-group built-ins of
+ * @c cl_khr_subgroups or @c cl_intel_subgroups (one of
+ * @c ENABLE_KHR_SUBGROUPS or @c ENABLE_INTEL_SUBGROUPS must be set), with
+ * @ref SCAN_COLLECTIVE_OP naming the operation. It may only be used for
+ * unsegmented scans with a scalar accumulator type.
+ */
+
+/**
+ * @def SCAN_WORK_GROUP_FUNCTIONS
+ * @hideinitializer
+ * If non-zero, the work-group reductions and scans use the OpenCL C 2.0
+ * work-group built-ins instead, with the same restrictions as
+ * @ref SCAN_SUBGROUPS. It cannot be combined with @ref SCAN_SUBGROUPS.
+ */
+
+/**
+ * @def SCAN_SEQUENTIAL
+ * @hideinitializer
+ * If non-zero, each block is reduced and scanned by a single work-item in
+ * order, without local memory or barriers. This suits CPU devices, which run
+ * the work-items of a group in a loop and for which barriers are expensive.
+ * It requires @ref REDUCE_WORK_GROUP_SIZE, @ref SCAN_WORK_GROUP_SIZE and
+ * @ref SCAN_WORK_SCALE to be 1, and cannot be combined with built-in
+ * collectives.
+ */
+
+/**
+ * @def SCAN_COLLECTIVE_OP
+ * @hideinitializer
+ * Suffix of the sub-group or work-group built-ins that implement
+ * @ref SCAN_OP: one of @c add, @c min or @c max.
+ */
+
 #ifndef SCAN_T
 # error "SCAN_T must be specified"
 # define SCAN_T int /* Keep doxygen happy */
 #endif
 
+#ifndef SCAN_OP
+# define SCAN_OP(a, b) ((a) + (b))
+#endif
+
+#ifndef SCAN_IDENTITY
+# define SCAN_IDENTITY ((SCAN_T) 0)
+#endif
+
+#ifndef SCAN_ACC_T
+# define SCAN_ACC_T SCAN_T
+# define SCAN_TO_ACC(x) (x)
+# define SCAN_FROM_ACC(x) (x)
+#endif
+
+#ifndef SCAN_IN_T
+# define SCAN_IN_T SCAN_T
+#endif
+
+#ifdef SCAN_TRANSFORM
+/**
+ * Applies @ref SCAN_TRANSFORM. Using a function ensures that the argument is
+ * loaded once, even if the transform refers to it repeatedly.
+ */
+inline SCAN_T scanTransform(SCAN_IN_T x)
+{
+    return SCAN_TRANSFORM(x);
+}
+# undef SCAN_IN_TO_ACC
+# define SCAN_IN_TO_ACC(x) SCAN_TO_ACC(scanTransform(x))
+#elif !defined(SCAN_IN_TO_ACC)
+# define SCAN_IN_TO_ACC(x) SCAN_TO_ACC(x)
+#endif
+
+#ifndef SCAN_KAHAN
+# define SCAN_KAHAN 0
+#endif
+
+#ifndef SCAN_SEGMENTED
+# define SCAN_SEGMENTED 0
+#endif
+
 #ifndef SCAN_PAD_T
 # define SCAN_PAD_T SCAN_T
 # define SCAN_UNPAD(x) (x)
@@ -123,6 +293,16 @@
 # error "REDUCE_WORK_GROUP_SIZE must be a power of 2"
 #endif
 
+#ifndef REDUCE_ELEMENTS_PER_LOAD
+# define REDUCE_ELEMENTS_PER_LOAD 1
+#endif
+#if !IS_POWER2(REDUCE_ELEMENTS_PER_LOAD) || REDUCE_ELEMENTS_PER_LOAD > 16
+# error "REDUCE_ELEMENTS_PER_LOAD must be 1, 2, 4, 8 or 16"
+#endif
+#if REDUCE_ELEMENTS_PER_LOAD > 1 && SCAN_SEGMENTED
+# error "REDUCE_ELEMENTS_PER_LOAD must be 1 for segmented scans"
+#endif
+
 #ifndef SCAN_WORK_GROUP_SIZE
 # error "SCAN_WORK_GROUP_SIZE must be specified"
 # define SCAN_WORK_GROUP_SIZE 1 /* Keep doxygen happy */
@@ -147,33 +327,293 @@
 # error "SCAN_WORK_SCALE must be a power of 2"
 #endif
 
+#ifndef SCAN_INCLUSIVE
+# define SCAN_INCLUSIVE 0
+#endif
+
+#ifndef SCAN_SUBGROUPS
+# define SCAN_SUBGROUPS 0
+#endif
+#ifndef SCAN_WORK_GROUP_FUNCTIONS
+# define SCAN_WORK_GROUP_FUNCTIONS 0
+#endif
+#if SCAN_SUBGROUPS && SCAN_WORK_GROUP_FUNCTIONS
+# error "SCAN_SUBGROUPS and SCAN_WORK_GROUP_FUNCTIONS cannot be combined"
+#endif
+
+/// Non-zero if work-group reductions and scans use built-in collectives
+#define SCAN_COLLECTIVES (SCAN_SUBGROUPS || SCAN_WORK_GROUP_FUNCTIONS)
+#if SCAN_COLLECTIVES && SCAN_SEGMENTED
+# error "Built-in collectives cannot be used for segmented scans"
+#endif
+#if SCAN_COLLECTIVES && !defined(SCAN_COLLECTIVE_OP)
+# error "SCAN_COLLECTIVE_OP must be specified with built-in collectives"
+#endif
+
+#ifndef SCAN_SEQUENTIAL
+# define SCAN_SEQUENTIAL 0
+#endif
+#if SCAN_SEQUENTIAL && (REDUCE_WORK_GROUP_SIZE != 1 || SCAN_WORK_GROUP_SIZE != 1 || SCAN_WORK_SCALE != 1)
+# error "SCAN_SEQUENTIAL requires single work-item groups"
+#endif
+#if SCAN_SEQUENTIAL && SCAN_COLLECTIVES
+# error "SCAN_SEQUENTIAL cannot be combined with built-in collectives"
+#endif
+
 /**
  * Shorthand for defining a kernel with a fixed work group size.
  * This is needed to unconfuse Doxygen's parser.
  */
 #define KERNEL(size) __kernel __attribute__((reqd_work_group_size(size, 1, 1)))
 
+#if REDUCE_ELEMENTS_PER_LOAD > 1 || SCAN_COLLECTIVES
+#define SCAN_PASTE_(a, b) a ## b
+#define SCAN_PASTE(a, b) SCAN_PASTE_(a, b)
+#endif
+
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+
+/**
+ * @ref REDUCE_ELEMENTS_PER_LOAD input elements, loaded as a vector and
+ * accessed as an array.
+ */
+typedef union
+{
+    SCAN_PASTE(SCAN_IN_T, REDUCE_ELEMENTS_PER_LOAD) v;
+    SCAN_IN_T s[REDUCE_ELEMENTS_PER_LOAD];
+} scan_load;
+
+/// Loads @ref REDUCE_ELEMENTS_PER_LOAD consecutive elements starting at @a p
+#define SCAN_LOAD(p) SCAN_PASTE(vload, REDUCE_ELEMENTS_PER_LOAD)(0, (p))
+
+#endif
+
+/**
+ * Applies @ref SCAN_OP. Using a function ensures that the arguments are
+ * evaluated once, even if a user-defined operator refers to them repeatedly.
+ */
+inline SCAN_ACC_T scanOp(SCAN_ACC_T a, SCAN_ACC_T b)
+{
+    return SCAN_OP(a, b);
+}
+
+#if SCAN_SEGMENTED
+/**
+ * Replaces element @a b of a local array with the combination of elements
+ * @a a and @a b (in that order), where @a vf holds the head flags. If @a b
+ * contains a segment head, element @a a does not contribute.
+ */
+inline void combineLocal(__local SCAN_ACC_T *v, __local uint *vf, uint a, uint b)
+{
+    if (!vf[b])
+        v[b] = scanOp(v[a], v[b]);
+    vf[b] |= vf[a];
+}
+#endif
+
+#if SCAN_COLLECTIVES
+/**
+ * Work-group exclusive scan of one value per work-item, using built-in
+ * collectives. With @ref SCAN_WORK_GROUP_FUNCTIONS this is a direct call to
+ * the work-group built-ins. Otherwise, each sub-group scans its values, and
+ * the first sub-group then scans the sub-group totals, a sub-group at a
+ * time. The mapping of work-items to sub-groups is implementation-defined,
+ * and this relies on sub-groups being consecutive and work-items within them
+ * being in order. Autotuning checks the results against the local-memory
+ * variant before choosing the sub-group one, so devices that do not follow
+ * that layout never use it.
+ *
+ * The caller must ensure that @a scratch is not in use by other work-items
+ * on entry, and must place a barrier before it is next written.
+ *
+ * @param value       Value contributed by the current work-item
+ * @param scratch     Local scratch space of at least one more element than the work-group size
+ * @param[out] total  Combination of the values of the whole work-group
+ * @return The exclusive prefix of @a value within the work-group.
+ */
+inline SCAN_ACC_T scanLocalCollective(SCAN_ACC_T value, __local SCAN_ACC_T *scratch, SCAN_ACC_T *total)
+{
+#if SCAN_WORK_GROUP_FUNCTIONS
+    *total = SCAN_PASTE(work_group_reduce_, SCAN_COLLECTIVE_OP)(value);
+    return SCAN_PASTE(work_group_scan_exclusive_, SCAN_COLLECTIVE_OP)(value);
+#else
+    const uint subGroup = get_sub_group_id();
+    const uint subGroups = get_num_sub_groups();
+    const uint subSize = get_sub_group_size();
+    const uint subLid = get_sub_group_local_id();
+
+    const SCAN_ACC_T prefix = SCAN_PASTE(sub_group_scan_exclusive_, SCAN_COLLECTIVE_OP)(value);
+    const SCAN_ACC_T subTotal = SCAN_PASTE(sub_group_reduce_, SCAN_COLLECTIVE_OP)(value);
+    if (subLid == 0)
+        scratch[subGroup] = subTotal;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (subGroup == 0)
+    {
+        SCAN_ACC_T carry = SCAN_TO_ACC(SCAN_IDENTITY);
+        for (uint base = 0; base < subGroups; base += subSize)
+        {
+            const uint i = base + subLid;
+            const SCAN_ACC_T x = i < subGroups ? scratch[i] : SCAN_TO_ACC(SCAN_IDENTITY);
+            const SCAN_ACC_T p = SCAN_PASTE(sub_group_scan_exclusive_, SCAN_COLLECTIVE_OP)(x);
+            if (i < subGroups)
+                scratch[i] = scanOp(carry, p);
+            carry = scanOp(carry, SCAN_PASTE(sub_group_reduce_, SCAN_COLLECTIVE_OP)(x));
+        }
+        if (subLid == 0)
+            scratch[subGroups] = carry;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    *total = scratch[subGroups];
+    return scanOp(scratch[subGroup], prefix);
+#endif
+}
+#endif
+
+#if SCAN_KAHAN
+/**
+ * Adds @a x to @a sum using Kahan summation.
+ *
+ * @param sum          Running sum.
+ * @param x            Value to add.
+ * @param[in,out] comp Running compensation (initially zero).
+ * @return The new running sum.
+ */
+inline SCAN_ACC_T kahanAdd(SCAN_ACC_T sum, SCAN_ACC_T x, SCAN_ACC_T *comp)
+{
+    const SCAN_ACC_T y = x - *comp;
+    const SCAN_ACC_T t = sum + y;
+    *comp = (t - sum) - y;
+    return t;
+}
+#endif
+
 /**
  * Compute sums of contiguous ranges of elements.
- * @param out    Reduced output values.
- * @param in     Input values to reduce.
- * @param len    Number of values to reduce per work-group
  *
- * @pre @a len is a multiple of @ref REDUCE_WORK_GROUP_SIZE
+ * For a batched scan, the second dimension of the NDRange indexes the rows.
+ * The last block of each row is not reduced, so there are one more output
+ * values per row than there are work-groups in the first dimension.
+ *
+ * @param out       Reduced output values.
+ * @param in        Input values to reduce.
+ * @param len       Number of values to reduce per work-group
+ * @param rowStride Distance between the starts of rows (in elements)
+ *
+ * @pre @a len is a multiple of @ref REDUCE_WORK_GROUP_SIZE * @ref REDUCE_ELEMENTS_PER_LOAD
  * @todo Skip barriers and conditions below @ref WARP_SIZE_MEM.
  */
 KERNEL(REDUCE_WORK_GROUP_SIZE)
-void reduce(__global SCAN_T *out, __global const SCAN_T *in, uint len)
+void reduce(__global SCAN_ACC_T *out, __global const SCAN_IN_T *in, uint len, uint rowStride
+#if SCAN_SEGMENTED
+            , __global uint *outFlags, __global const uchar *flags
+#endif
+            )
 {
-    __local SCAN_T sums[REDUCE_WORK_GROUP_SIZE];
+#if SCAN_COLLECTIVES
+    __local SCAN_ACC_T sums[REDUCE_WORK_GROUP_SIZE + 1];
+#else
+    __local SCAN_ACC_T sums[REDUCE_WORK_GROUP_SIZE];
+#endif
     const uint group = get_group_id(0);
+    const uint row = get_group_id(1);
     const uint lid = get_local_id(0);
     const uint in_offset = group * len + lid;
 
+    in += (size_t) row * rowStride;
+    out += row * (get_num_groups(0) + 1);
+
+#if SCAN_SEGMENTED && SCAN_SEQUENTIAL
+    /* A single work-item combines the elements in order. The unsegmented
+     * code below needs no special case, since its tree is empty for a single
+     * work-item.
+     */
+    SCAN_ACC_T accum = SCAN_TO_ACC(SCAN_IDENTITY);
+    uint accumFlag = 0;
+    for (uint i = 0; i < len; i++)
+    {
+        const SCAN_ACC_T x = SCAN_IN_TO_ACC(in[in_offset + i]);
+        if (flags[in_offset + i])
+        {
+            accum = x;
+            accumFlag = 1;
+        }
+        else
+            accum = scanOp(accum, x);
+    }
+    out[group] = accum;
+    outFlags[group] = accumFlag;
+#elif SCAN_SEGMENTED
+    /* The segmented operator is not commutative, so each tile of
+     * REDUCE_WORK_GROUP_SIZE elements is reduced with an ordered tree (which
+     * leaves the total in the last element), and the tiles are then combined
+     * in order by thread 0.
+     */
+    __local uint sumFlags[REDUCE_WORK_GROUP_SIZE];
+    SCAN_ACC_T accum = SCAN_TO_ACC(SCAN_IDENTITY);
+    uint accumFlag = 0;
+    for (uint start = 0; start < len; start += REDUCE_WORK_GROUP_SIZE)
+    {
+        sums[lid] = SCAN_IN_TO_ACC(in[in_offset + start]);
+        sumFlags[lid] = flags[in_offset + start] != 0;
+        for (uint scale = 1; scale < REDUCE_WORK_GROUP_SIZE; scale <<= 1)
+        {
+            barrier(CLK_LOCAL_MEM_FENCE);
+            if (((lid + 1) & (2 * scale - 1)) == 0)
+                combineLocal(sums, sumFlags, lid - scale, lid);
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid == 0)
+        {
+            const uint last = REDUCE_WORK_GROUP_SIZE - 1;
+            accum = sumFlags[last] ? sums[last] : scanOp(accum, sums[last]);
+            accumFlag |= sumFlags[last];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if (lid == 0)
+    {
+        out[group] = accum;
+        outFlags[group] = accumFlag;
+    }
+#else
     /* Sum up corresponding elements from each chunk */
-    SCAN_T accum = 0;
+    SCAN_ACC_T accum = SCAN_TO_ACC(SCAN_IDENTITY);
+#if SCAN_KAHAN
+    SCAN_ACC_T comp = (SCAN_ACC_T) 0;
+#endif
+#if REDUCE_ELEMENTS_PER_LOAD > 1
+    const uint tile = REDUCE_WORK_GROUP_SIZE * REDUCE_ELEMENTS_PER_LOAD;
+    for (uint i = lid * REDUCE_ELEMENTS_PER_LOAD; i < len; i += tile)
+    {
+        scan_load x;
+        x.v = SCAN_LOAD(in + group * len + i);
+        for (uint j = 0; j < REDUCE_ELEMENTS_PER_LOAD; j++)
+        {
+#if SCAN_KAHAN
+            accum = kahanAdd(accum, SCAN_IN_TO_ACC(x.s[j]), &comp);
+#else
+            accum = scanOp(accum, SCAN_IN_TO_ACC(x.s[j]));
+#endif
+        }
+    }
+#elif SCAN_KAHAN
     for (uint i = 0; i < len; i += REDUCE_WORK_GROUP_SIZE)
-         accum += in[in_offset + i];
+         accum = kahanAdd(accum, SCAN_IN_TO_ACC(in[in_offset + i]), &comp);
+#else
+    for (uint i = 0; i < len; i += REDUCE_WORK_GROUP_SIZE)
+         accum = scanOp(accum, SCAN_IN_TO_ACC(in[in_offset + i]));
+#endif
+
+#if SCAN_COLLECTIVES
+    /* Only the total is needed, but the scan is cheap next to the loads */
+    SCAN_ACC_T total;
+    scanLocalCollective(accum, sums, &total);
+    if (lid == 0)
+        out[group] = total;
+#else
     sums[lid] = accum;
 
     /* Upsweep */
@@ -181,16 +621,22 @@ void reduce(__global SCAN_T *out, __global const SCAN_T *in, uint len)
     {
         barrier(CLK_LOCAL_MEM_FENCE);
         if (lid < scale)
-            sums[lid] += sums[lid + scale];
+            sums[lid] = scanOp(sums[lid], sums[lid + scale]);
     }
 
     /* No barrier needed here, because sums[0] is computed by thread 0 */
     if (lid == 0)
         out[group] = sums[0];
+#endif /* !SCAN_COLLECTIVES */
+#endif
 }
 
-// v has size SCAN_BLOCKS
-inline void scanExclusiveSmallBottom(__local SCAN_T *v, uint lid)
+// v (and vf, if segmented) has size SCAN_BLOCKS
+inline void scanExclusiveSmallBottom(__local SCAN_ACC_T *v,
+#if SCAN_SEGMENTED
+                                     __local uint *vf,
+#endif
+                                     uint lid)
 {
     /* Upsweep */
     uint pos = lid + 1;
@@ -199,7 +645,13 @@ inline void scanExclusiveSmallBottom(__local SCAN_T *v, uint lid)
     {
         pos <<= 1;
         if (pos <= SCAN_BLOCKS)
-            v[pos - 1] += v[pos - scale - 1];
+        {
+#if SCAN_SEGMENTED
+            combineLocal(v, vf, pos - scale - 1, pos - 1);
+#else
+            v[pos - 1] = scanOp(v[pos - scale - 1], v[pos - 1]);
+#endif
+        }
         barrier(CLK_LOCAL_MEM_FENCE);
     }
     scale >>= 1; // undo the last scale <<= 1 at the end of the loop
@@ -208,7 +660,13 @@ inline void scanExclusiveSmallBottom(__local SCAN_T *v, uint lid)
     for (; scale >= 1; scale >>= 1)
     {
         if (pos <= SCAN_BLOCKS - scale)
-            v[pos + scale - 1] += v[pos - 1];
+        {
+#if SCAN_SEGMENTED
+            combineLocal(v, vf, pos - 1, pos + scale - 1);
+#else
+            v[pos + scale - 1] = scanOp(v[pos - 1], v[pos + scale - 1]);
+#endif
+        }
         barrier(CLK_LOCAL_MEM_FENCE);
         pos >>= 1;
     }
@@ -216,35 +674,93 @@ inline void scanExclusiveSmallBottom(__local SCAN_T *v, uint lid)
 }
 
 /**
- * Does an exclusive prefix sum on @ref SCAN_BLOCKS elements.
+ * Does an exclusive prefix sum on @ref SCAN_BLOCKS elements, given the
+ * initial value. This is the body of the kernels below.
  *
  * @param inout  The values to scan, replaced with result.
- * @param offset Offset to add to all elements.
- *
- * @pre @ref SCAN_BLOCKS is even
- * @todo skip barriers and conditions below @ref WARP_SIZE_MEM.
+ * @param flags  Head flags for the values (segmented scans only).
+ * @param offset Initial value.
+ * @param v      Local scratch space of @ref SCAN_BLOCKS elements.
+ * @param vf     Local scratch space of @ref SCAN_BLOCKS flags (segmented scans only).
  */
-KERNEL(SCAN_BLOCKS / 2)
-void scanExclusiveSmall(__global SCAN_T *inout, SCAN_PAD_T offset)
+inline void scanExclusiveSmallGroup(__global SCAN_ACC_T *inout,
+#if SCAN_SEGMENTED
+                                    __global const uint *flags,
+#endif
+                                    SCAN_ACC_T offset, __local SCAN_ACC_T *v
+#if SCAN_SEGMENTED
+                                    , __local uint *vf
+#endif
+                                    )
 {
     const unsigned int lid = get_local_id(0);
     const unsigned int wgs = SCAN_BLOCKS / 2; // work group size
-    __local SCAN_T v[SCAN_BLOCKS];
 
     /* Copy to local memory for computation, shifting by one to turn an
      * exclusive problem into an inclusive one
      */
-    v[lid] = (lid == 0) ? SCAN_UNPAD(offset) : inout[lid - 1];
+    v[lid] = (lid == 0) ? offset : inout[lid - 1];
     v[lid + wgs] = inout[lid + wgs - 1];
+#if SCAN_SEGMENTED
+    vf[lid] = (lid == 0) ? 0 : flags[lid - 1];
+    vf[lid + wgs] = flags[lid + wgs - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    scanExclusiveSmallBottom(v, vf, lid);
+#else
     barrier(CLK_LOCAL_MEM_FENCE);
 
     scanExclusiveSmallBottom(v, lid);
+#endif
 
     /* Writeback */
     inout[lid] = v[lid];
     inout[lid + wgs] = v[lid + wgs];
 }
 
+/**
+ * Does an exclusive prefix sum on @ref SCAN_BLOCKS elements.
+ *
+ * @param inout  The values to scan, replaced with result.
+ * @param offset Offset to add to all elements.
+ *
+ * @pre @ref SCAN_BLOCKS is even
+ * @todo skip barriers and conditions below @ref WARP_SIZE_MEM.
+ */
+#if !SCAN_SEGMENTED
+KERNEL(SCAN_BLOCKS / 2)
+void scanExclusiveSmall(__global SCAN_ACC_T *inout, SCAN_PAD_T offset)
+{
+    __local SCAN_ACC_T v[SCAN_BLOCKS];
+    scanExclusiveSmallGroup(inout, SCAN_TO_ACC(SCAN_UNPAD(offset)), v);
+}
+#endif
+
+/**
+ * Does an exclusive prefix sum on @ref SCAN_BLOCKS elements, without an
+ * offset (i.e., starting from @ref SCAN_IDENTITY).
+ *
+ * @param inout  The values to scan, replaced with result.
+ * @param flags  Non-zero for blocks that contain a segment head (segmented scans only).
+ *
+ * @pre @ref SCAN_BLOCKS is even
+ */
+KERNEL(SCAN_BLOCKS / 2)
+void scanExclusiveSmallIdentity(__global SCAN_ACC_T *inout
+#if SCAN_SEGMENTED
+                                , __global const uint *flags
+#endif
+                                )
+{
+    __local SCAN_ACC_T v[SCAN_BLOCKS];
+#if SCAN_SEGMENTED
+    __local uint vf[SCAN_BLOCKS];
+    scanExclusiveSmallGroup(inout, flags, SCAN_TO_ACC(SCAN_IDENTITY), v, vf);
+#else
+    scanExclusiveSmallGroup(inout, SCAN_TO_ACC(SCAN_IDENTITY), v);
+#endif
+}
+
 /**
  * Does an exclusive prefix sum on @ref SCAN_BLOCKS elements, with an
  * offset encoded in a buffer.
@@ -256,47 +772,88 @@ void scanExclusiveSmall(__global SCAN_T *inout, SCAN_PAD_T offset)
  * @pre @ref SCAN_BLOCKS is even
  * @todo skip barriers and conditions below @ref WARP_SIZE.
  */
+#if !SCAN_SEGMENTED
 KERNEL(SCAN_BLOCKS / 2)
-void scanExclusiveSmallOffset(__global SCAN_T *inout,
+void scanExclusiveSmallOffset(__global SCAN_ACC_T *inout,
                               __global const SCAN_T *offset,
                               uint offsetIndex)
 {
-    const unsigned int lid = get_local_id(0);
-    const unsigned int wgs = SCAN_BLOCKS / 2; // work group size
-    __local SCAN_T v[SCAN_BLOCKS];
+    __local SCAN_ACC_T v[SCAN_BLOCKS];
+    scanExclusiveSmallGroup(inout, SCAN_TO_ACC(offset[offsetIndex]), v);
+}
+#endif
 
-    /* Copy to local memory for computation, shifting by one to turn an
-     * exclusive problem into an inclusive one
-     */
-    v[lid] = (lid == 0) ? offset[offsetIndex] : inout[lid - 1];
-    v[lid + wgs] = inout[lid + wgs - 1];
-    barrier(CLK_LOCAL_MEM_FENCE);
+#if !SCAN_SEGMENTED
+/**
+ * Does an exclusive prefix sum on the block sums of each row of a batched
+ * scan. Each work-item handles one row. The rows share the
+ * @ref SCAN_BLOCKS blocks, so each has only a few and a serial scan suffices.
+ *
+ * @param inout        The values to scan, replaced with result.
+ * @param blocksPerRow Number of values in each row.
+ * @param offset       Initial value for each row.
+ */
+inline void scanExclusiveSmallRowsBody(__global SCAN_ACC_T *inout, uint blocksPerRow, SCAN_ACC_T offset)
+{
+    inout += get_global_id(0) * blocksPerRow;
+    for (uint i = 0; i < blocksPerRow; i++)
+    {
+        const SCAN_ACC_T next = scanOp(offset, inout[i]);
+        inout[i] = offset;
+        offset = next;
+    }
+}
 
-    scanExclusiveSmallBottom(v, lid);
+/**
+ * Does an exclusive prefix sum on the block sums of each row of a batched
+ * scan, with the same offset for every row.
+ * @see scanExclusiveSmallRowsBody
+ */
+__kernel void scanExclusiveSmallRows(__global SCAN_ACC_T *inout, uint blocksPerRow, SCAN_PAD_T offset)
+{
+    scanExclusiveSmallRowsBody(inout, blocksPerRow, SCAN_TO_ACC(SCAN_UNPAD(offset)));
+}
 
-    /* Writeback */
-    inout[lid] = v[lid];
-    inout[lid + wgs] = v[lid + wgs];
+/**
+ * Does an exclusive prefix sum on the block sums of each row of a batched
+ * scan, starting each row from @ref SCAN_IDENTITY.
+ * @see scanExclusiveSmallRowsBody
+ */
+__kernel void scanExclusiveSmallRowsIdentity(__global SCAN_ACC_T *inout, uint blocksPerRow)
+{
+    scanExclusiveSmallRowsBody(inout, blocksPerRow, SCAN_TO_ACC(SCAN_IDENTITY));
 }
+#endif
 
 /**
  * Does an exclusive scan a possibly large range, given initial offsets per work-group.
+ * If @ref SCAN_INCLUSIVE is set, the scan is inclusive instead.
+ *
+ * For a batched scan, the second dimension of the NDRange indexes the rows,
+ * each of which is scanned independently.
  *
- * @param[in]     in      Sequence to scan
- * @param[out]    out     Prefix sums (may be the same buffer as @a in
- * @param         offsets The starting offset for each work-group
- * @param         len     Number of elements to scan per work-group
- * @param         total   Total number of elements to scan
+ * @param[in]     in        Sequence to scan
+ * @param[out]    out       Prefix sums (may be the same buffer as @a in
+ * @param         offsets   The starting offset for each work-group
+ * @param         len       Number of elements to scan per work-group
+ * @param         total     Total number of elements to scan (per row)
+ * @param         rowStride Distance between the starts of rows (in elements)
+ * @param         flags     Head flags for the elements (segmented scans only)
  *
  * @pre @a len is a multiple of @c SCAN_WORK_SCALE * @c SCAN_WORK_GROUP_SIZE
  */
 KERNEL(SCAN_WORK_GROUP_SIZE)
 void scanExclusive(
-    __global const SCAN_T *in,
+    __global const SCAN_IN_T *in,
     __global SCAN_T *out,
-    __global const SCAN_T *offsets,
+    __global const SCAN_ACC_T *offsets,
     uint len,
-    uint total)
+    uint total,
+    uint rowStride
+#if SCAN_SEGMENTED
+    , __global const uchar *flags
+#endif
+    )
 {
     /* The algorithm operates on tiles of size SCAN_WORK_GROUP_SIZE*SCAN_WORK_SCALE.
      * Each tile is scanned in a two-level hierarchy. Each workitem reads SCAN_WORK_SCALE
@@ -318,42 +875,112 @@ void scanExclusive(
      * NVIDIA drivers (as of 375.39) have a bug that leads to misaligned
      * accesses on Pascal GPUs in this case.
      */
-    __local SCAN_T raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
-    __local SCAN_T * const raw = raw_reduced;
-    __local SCAN_T * const reduced = raw_reduced;
-    SCAN_T priv[SCAN_WORK_SCALE];
+    __local SCAN_ACC_T raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local SCAN_ACC_T * const raw = raw_reduced;
+    __local SCAN_ACC_T * const reduced = raw_reduced;
+#if SCAN_SEGMENTED
+    /* Head flags corresponding to raw and reduced, aliased the same way */
+    __local uint rawFlags_reducedFlags[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local uint * const rawFlags = rawFlags_reducedFlags;
+    __local uint * const reducedFlags = rawFlags_reducedFlags;
+    uint heads; // bit i is set if private element i is a segment head
+#endif
+    SCAN_ACC_T priv[SCAN_WORK_SCALE];
 
     const uint lid = get_local_id(0);
-    SCAN_T offset;
+    SCAN_ACC_T offset;
+#if SCAN_KAHAN
+    SCAN_ACC_T offsetComp = (SCAN_ACC_T) 0;
+#endif
 
+    const uint row = get_group_id(1);
     size_t bias = get_group_id(0) * len;
-    in += bias;
-    out += bias;
+    in += bias + (size_t) row * rowStride;
+    out += bias + (size_t) row * rowStride;
+#if SCAN_SEGMENTED
+    flags += bias;
+#endif
     total -= bias;
-    offset = offsets[get_group_id(0)];
+    offset = offsets[row * get_num_groups(0) + get_group_id(0)];
+#if SCAN_SEQUENTIAL
+    /* Scan the whole block in order. The input is read before the output is
+     * written, since they may be the same buffer.
+     */
+    const uint end = min(len, total);
+    for (uint i = 0; i < end; i++)
+    {
+        const SCAN_ACC_T x = SCAN_IN_TO_ACC(in[i]);
+#if SCAN_SEGMENTED
+        if (flags[i])
+        {
+            offset = SCAN_TO_ACC(SCAN_IDENTITY);
+#if SCAN_KAHAN
+            offsetComp = (SCAN_ACC_T) 0;
+#endif
+        }
+#endif
+#if SCAN_KAHAN
+        const SCAN_ACC_T next = kahanAdd(offset, x, &offsetComp);
+#else
+        const SCAN_ACC_T next = scanOp(offset, x);
+#endif
+#if SCAN_INCLUSIVE
+        out[i] = SCAN_FROM_ACC(next);
+#else
+        out[i] = SCAN_FROM_ACC(offset);
+#endif
+        offset = next;
+    }
+#else /* !SCAN_SEQUENTIAL */
     for (uint start = 0; start < len; start += SCAN_WORK_SCALE * SCAN_WORK_GROUP_SIZE)
     {
         /* Load the raw data using coalesced reads */
         for (uint i = 0; i < SCAN_WORK_SCALE; i++)
         {
             uint addr = start + lid + i * SCAN_WORK_GROUP_SIZE;
-            raw[lid + i * SCAN_WORK_GROUP_SIZE] = (addr < total) ? in[addr] : (SCAN_T) 0;
+            raw[lid + i * SCAN_WORK_GROUP_SIZE] = (addr < total) ? SCAN_IN_TO_ACC(in[addr]) : SCAN_TO_ACC(SCAN_IDENTITY);
+#if SCAN_SEGMENTED
+            rawFlags[lid + i * SCAN_WORK_GROUP_SIZE] = (addr < total) ? (flags[addr] != 0) : 0;
+#endif
         }
         barrier(CLK_LOCAL_MEM_FENCE);
 
         /* Read the relevant data into registers */
+#if SCAN_SEGMENTED
+        heads = 0;
+#endif
         for (uint i = 0; i < SCAN_WORK_SCALE; i++)
         {
             priv[i] = raw[lid * SCAN_WORK_SCALE + i];
+#if SCAN_SEGMENTED
+            heads |= rawFlags[lid * SCAN_WORK_SCALE + i] << i;
+#endif
         }
 
         /* Scan the private range */
         for (uint i = 0; i < SCAN_WORK_SCALE - 1; i++)
-            priv[i + 1] += priv[i];
+        {
+#if SCAN_SEGMENTED
+            if ((heads >> (i + 1)) & 1)
+                continue;
+#endif
+            priv[i + 1] = scanOp(priv[i], priv[i + 1]);
+        }
 
+#if SCAN_COLLECTIVES
+        barrier(CLK_LOCAL_MEM_FENCE);
+        SCAN_ACC_T tileTotal;
+        const SCAN_ACC_T localPrefix = scanLocalCollective(priv[SCAN_WORK_SCALE - 1], reduced, &tileTotal);
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid == 0)
+            reduced[1] = tileTotal;
+#else
         /* Write the reduced private ranges for shared upsweep */
         barrier(CLK_LOCAL_MEM_FENCE);
         reduced[SCAN_WORK_GROUP_SIZE + lid] = priv[SCAN_WORK_SCALE - 1];
+#if SCAN_SEGMENTED
+        reducedFlags[SCAN_WORK_GROUP_SIZE + lid] = heads != 0;
+#endif
         barrier(CLK_LOCAL_MEM_FENCE);
 
         /* Upsweep, interwarp */
@@ -362,21 +989,39 @@ void scanExclusive(
             if (lid < scale)
             {
                 const uint pos = scale + lid;
-                reduced[pos] = reduced[2 * pos] + reduced[2 * pos + 1];
+#if SCAN_SEGMENTED
+                reduced[pos] = reducedFlags[2 * pos + 1]
+                    ? reduced[2 * pos + 1] : scanOp(reduced[2 * pos], reduced[2 * pos + 1]);
+                reducedFlags[pos] = reducedFlags[2 * pos] | reducedFlags[2 * pos + 1];
+#else
+                reduced[pos] = scanOp(reduced[2 * pos], reduced[2 * pos + 1]);
+#endif
             }
             if (scale > WARP_SIZE_MEM)
                 barrier(CLK_LOCAL_MEM_FENCE);
             else
                 mem_fence(CLK_LOCAL_MEM_FENCE); // TODO: replace all mem_fence with volatile
         }
+#endif /* !SCAN_COLLECTIVES */
 
         /* v[1] is the total of this range, but need to make it exclusive */
         if (lid == 0)
         {
-            SCAN_T nextOffset = offset + reduced[1];
+#if SCAN_SEGMENTED
+            SCAN_ACC_T nextOffset = reducedFlags[1] ? reduced[1] : scanOp(offset, reduced[1]);
+#elif SCAN_KAHAN
+            SCAN_ACC_T nextOffset = kahanAdd(offset, reduced[1], &offsetComp);
+#else
+            SCAN_ACC_T nextOffset = scanOp(offset, reduced[1]);
+#endif
             reduced[1] = offset;
             offset = nextOffset;
         }
+
+#if SCAN_COLLECTIVES
+        barrier(CLK_LOCAL_MEM_FENCE);
+        const SCAN_ACC_T add = scanOp(reduced[1], localPrefix);
+#else
         /* No barrier needed here, because only thread 0 uses reduced[1] */
 
         /* Downsweep */
@@ -385,9 +1030,14 @@ void scanExclusive(
             if (lid < scale)
             {
                 const uint pos = scale + lid;
-                const SCAN_T in = reduced[pos];
-                const SCAN_T left = reduced[2 * pos];
-                reduced[2 * pos + 1] = in + left;
+                const SCAN_ACC_T in = reduced[pos];
+                const SCAN_ACC_T left = reduced[2 * pos];
+#if SCAN_SEGMENTED
+                /* Flags are not updated, since only those of left children are needed */
+                reduced[2 * pos + 1] = reducedFlags[2 * pos] ? left : scanOp(in, left);
+#else
+                reduced[2 * pos + 1] = scanOp(in, left);
+#endif
                 reduced[2 * pos] = in;
             }
             if (scale >= WARP_SIZE_MEM)
@@ -396,14 +1046,46 @@ void scanExclusive(
                 mem_fence(CLK_LOCAL_MEM_FENCE);
         }
 
-        /* Feed reduction back into private range, making it exclusive at the same time */
-        const SCAN_T add = reduced[SCAN_WORK_GROUP_SIZE + lid];
+        const SCAN_ACC_T add = reduced[SCAN_WORK_GROUP_SIZE + lid];
+#endif /* !SCAN_COLLECTIVES */
         barrier(CLK_LOCAL_MEM_FENCE);
+#if SCAN_SEGMENTED && SCAN_INCLUSIVE
+        /* Feed reduction back into private range, up to the first head */
+        for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        {
+            raw[lid * SCAN_WORK_SCALE + i] = (heads & ((2U << i) - 1))
+                ? priv[i] : scanOp(add, priv[i]);
+        }
+#elif SCAN_SEGMENTED
+        /* Feed reduction back into private range up to the first head, making
+         * it exclusive at the same time. Heads start from the identity.
+         */
+        for (uint i = SCAN_WORK_SCALE - 1; i > 0; i--)
+        {
+            SCAN_ACC_T value;
+            if ((heads >> i) & 1)
+                value = SCAN_TO_ACC(SCAN_IDENTITY);
+            else if (heads & ((1U << i) - 1))
+                value = priv[i - 1];
+            else
+                value = scanOp(add, priv[i - 1]);
+            raw[lid * SCAN_WORK_SCALE + i] = value;
+        }
+        raw[lid * SCAN_WORK_SCALE] = (heads & 1) ? SCAN_TO_ACC(SCAN_IDENTITY) : add;
+#elif SCAN_INCLUSIVE
+        /* Feed reduction back into private range, which is already inclusive */
+        for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        {
+            raw[lid * SCAN_WORK_SCALE + i] = scanOp(add, priv[i]);
+        }
+#else
+        /* Feed reduction back into private range, making it exclusive at the same time */
         for (uint i = SCAN_WORK_SCALE - 1; i > 0; i--)
         {
-            raw[lid * SCAN_WORK_SCALE + i] = priv[i - 1] + add;
+            raw[lid * SCAN_WORK_SCALE + i] = scanOp(add, priv[i - 1]);
         }
         raw[lid * SCAN_WORK_SCALE] = add;
+#endif
         barrier(CLK_LOCAL_MEM_FENCE);
 
         /* Writeback */
@@ -411,8 +1093,311 @@ void scanExclusive(
         {
             uint addr = start + lid + i * SCAN_WORK_GROUP_SIZE;
             if (addr < total)
-                out[addr] = raw[lid + i * SCAN_WORK_GROUP_SIZE];
+                out[addr] = SCAN_FROM_ACC(raw[lid + i * SCAN_WORK_GROUP_SIZE]);
         }
         barrier(CLK_LOCAL_MEM_FENCE);
     }
+#endif /* !SCAN_SEQUENTIAL */
+}
+
+#if SCAN_SEGMENTED
+/**
+ * Clears head flags, as the first step in converting segment offsets to head
+ * flags.
+ */
+__kernel void segmentFlagsClear(__global uchar *flags)
+{
+    flags[get_global_id(0)] = 0;
+}
+
+/**
+ * Sets the head flag of the first element of each segment.
+ *
+ * @param[out] flags    Head flags, previously cleared.
+ * @param      offsets  Index of the first element of each segment.
+ * @param      elements Number of elements; offsets beyond this are ignored.
+ */
+__kernel void segmentFlagsSet(__global uchar *flags, __global const uint *offsets, uint elements)
+{
+    const uint pos = offsets[get_global_id(0)];
+    if (pos < elements)
+        flags[pos] = 1;
+}
+#endif
+
+#if !SCAN_SEGMENTED && !SCAN_KAHAN
+
+/**
+ * @name Tile states for the single-pass scan
+ * The status word of a tile holds the launch epoch in the upper bits and one
+ * of these values in the lower two bits. Words from earlier launches have a
+ * different epoch and are treated as not yet available.
+ * @{
+ */
+#define TILE_AGGREGATE 1  ///< The sum of the tile itself is available
+#define TILE_PREFIX 2     ///< The inclusive prefix sum up to the end of the tile is available
+/** @} */
+
+/**
+ * Makes a value for a tile visible to other work-groups. The value is written
+ * before the status word, so that a reader that observes the status word also
+ * observes the value.
+ *
+ * @param tileStatus  Status words for the tiles.
+ * @param tileValues  Values for the tiles, two per tile (aggregate, then inclusive prefix).
+ * @param tile        The tile being published.
+ * @param value       The value to publish.
+ * @param epoch       Epoch of the current launch.
+ * @param state       @ref TILE_AGGREGATE or @ref TILE_PREFIX.
+ */
+inline void publishTile(
+    volatile __global uint *tileStatus,
+    volatile __global SCAN_ACC_T *tileValues,
+    uint tile, SCAN_ACC_T value, uint epoch, uint state)
+{
+    tileValues[2 * tile + state - 1] = value;
+    write_mem_fence(CLK_GLOBAL_MEM_FENCE);
+    atomic_xchg(tileStatus + tile, (epoch << 2) | state);
+}
+
+/**
+ * Body of the single-pass scan kernels. Each work-group scans one tile of
+ * @c SCAN_WORK_SCALE * @c SCAN_WORK_GROUP_SIZE elements, which it holds in
+ * private memory so that the input is read only once. The offset for the tile
+ * is found with a decoupled look-back: the work-group publishes the sum of its
+ * tile, then walks backwards over the preceding tiles, accumulating their
+ * sums until it finds one that has published an inclusive prefix.
+ *
+ * Tiles are numbered in the order in which work-groups start, rather than by
+ * group ID, so that a work-group only ever waits for work-groups that are
+ * already running. This requires the device to guarantee forward progress for
+ * running work-groups.
+ *
+ * @param in             Sequence to scan
+ * @param out            Prefix sums (may be the same buffer as @a in)
+ * @param tileStatus     Status word per tile
+ * @param tileValues     Published values, two per tile
+ * @param tileCounter    Counter for assigning tiles, which must be zero on entry and is zero on exit
+ * @param total          Total number of elements to scan
+ * @param epoch          A value in [1, 2^30) that differs from the previous launch
+ * @param offset         Initial value
+ * @param raw_reduced    Local scratch space of at least 2 * @c SCAN_WORK_GROUP_SIZE elements
+ * @param tileShared     Local scratch space for broadcasting the tile index
+ */
+inline void scanSinglePassBody(
+    __global const SCAN_IN_T *in,
+    __global SCAN_T *out,
+    volatile __global uint *tileStatus,
+    volatile __global SCAN_ACC_T *tileValues,
+    volatile __global uint *tileCounter,
+    uint total,
+    uint epoch,
+    SCAN_ACC_T offset,
+    __local SCAN_ACC_T *raw_reduced,
+    __local uint *tileShared)
+{
+    __local SCAN_ACC_T * const raw = raw_reduced;
+    __local SCAN_ACC_T * const reduced = raw_reduced;
+    SCAN_ACC_T priv[SCAN_WORK_SCALE];
+    const uint lid = get_local_id(0);
+
+    if (lid == 0)
+    {
+        const uint t = atomic_inc(tileCounter);
+        /* Every other work-group has already taken its tile, so the counter
+         * can be reset for the next launch.
+         */
+        if (t == get_num_groups(0) - 1)
+            atomic_xchg(tileCounter, 0);
+        *tileShared = t;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+    const uint tile = *tileShared;
+
+    const uint bias = tile * (SCAN_WORK_SCALE * SCAN_WORK_GROUP_SIZE);
+    in += bias;
+    out += bias;
+    total -= bias;
+
+    /* Load the raw data using coalesced reads */
+    for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+    {
+        uint addr = lid + i * SCAN_WORK_GROUP_SIZE;
+        raw[addr] = (addr < total) ? SCAN_IN_TO_ACC(in[addr]) : SCAN_TO_ACC(SCAN_IDENTITY);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /* Read the relevant data into registers and scan the private range */
+    for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        priv[i] = raw[lid * SCAN_WORK_SCALE + i];
+    for (uint i = 0; i < SCAN_WORK_SCALE - 1; i++)
+        priv[i + 1] = scanOp(priv[i], priv[i + 1]);
+
+#if SCAN_COLLECTIVES
+    barrier(CLK_LOCAL_MEM_FENCE);
+    SCAN_ACC_T tileTotal;
+    const SCAN_ACC_T localPrefix = scanLocalCollective(priv[SCAN_WORK_SCALE - 1], reduced, &tileTotal);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    if (lid == 0)
+        reduced[1] = tileTotal;
+#else
+    /* Write the reduced private ranges for shared upsweep */
+    barrier(CLK_LOCAL_MEM_FENCE);
+    reduced[SCAN_WORK_GROUP_SIZE + lid] = priv[SCAN_WORK_SCALE - 1];
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /* Upsweep */
+    for (uint scale = SCAN_WORK_GROUP_SIZE / 2; scale >= 1; scale >>= 1)
+    {
+        if (lid < scale)
+        {
+            const uint pos = scale + lid;
+            reduced[pos] = scanOp(reduced[2 * pos], reduced[2 * pos + 1]);
+        }
+        if (scale > WARP_SIZE_MEM)
+            barrier(CLK_LOCAL_MEM_FENCE);
+        else
+            mem_fence(CLK_LOCAL_MEM_FENCE);
+    }
+#endif /* !SCAN_COLLECTIVES */
+
+    /* reduced[1] is the sum of the tile. Replace it with the exclusive
+     * prefix, found by looking back over earlier tiles.
+     */
+    if (lid == 0)
+    {
+        const SCAN_ACC_T aggregate = reduced[1];
+        SCAN_ACC_T prefix = offset;
+        if (tile > 0)
+        {
+            publishTile(tileStatus, tileValues, tile, aggregate, epoch, TILE_AGGREGATE);
+            prefix = SCAN_TO_ACC(SCAN_IDENTITY);
+            uint t = tile;
+            while (t > 0)
+            {
+                t--;
+                uint status;
+                do
+                {
+                    status = atomic_or(tileStatus + t, 0);
+                } while ((status >> 2) != epoch);
+                read_mem_fence(CLK_GLOBAL_MEM_FENCE);
+                const uint state = status & 3;
+                prefix = scanOp(tileValues[2 * t + state - 1], prefix);
+                if (state == TILE_PREFIX)
+                    break;
+            }
+        }
+        publishTile(tileStatus, tileValues, tile, scanOp(prefix, aggregate), epoch, TILE_PREFIX);
+        reduced[1] = prefix;
+    }
+
+#if SCAN_COLLECTIVES
+    barrier(CLK_LOCAL_MEM_FENCE);
+    const SCAN_ACC_T add = scanOp(reduced[1], localPrefix);
+#else
+    /* No barrier needed here, because only thread 0 uses reduced[1] */
+
+    /* Downsweep */
+    for (uint scale = 1; scale < SCAN_WORK_GROUP_SIZE; scale <<= 1)
+    {
+        if (lid < scale)
+        {
+            const uint pos = scale + lid;
+            const SCAN_ACC_T in = reduced[pos];
+            const SCAN_ACC_T left = reduced[2 * pos];
+            reduced[2 * pos + 1] = scanOp(in, left);
+            reduced[2 * pos] = in;
+        }
+        if (scale >= WARP_SIZE_MEM)
+            barrier(CLK_LOCAL_MEM_FENCE);
+        else
+            mem_fence(CLK_LOCAL_MEM_FENCE);
+    }
+
+    const SCAN_ACC_T add = reduced[SCAN_WORK_GROUP_SIZE + lid];
+#endif /* !SCAN_COLLECTIVES */
+    barrier(CLK_LOCAL_MEM_FENCE);
+#if SCAN_INCLUSIVE
+    for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+        raw[lid * SCAN_WORK_SCALE + i] = scanOp(add, priv[i]);
+#else
+    for (uint i = SCAN_WORK_SCALE - 1; i > 0; i--)
+        raw[lid * SCAN_WORK_SCALE + i] = scanOp(add, priv[i - 1]);
+    raw[lid * SCAN_WORK_SCALE] = add;
+#endif
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    /* Writeback */
+    for (uint i = 0; i < SCAN_WORK_SCALE; i++)
+    {
+        uint addr = lid + i * SCAN_WORK_GROUP_SIZE;
+        if (addr < total)
+            out[addr] = SCAN_FROM_ACC(raw[addr]);
+    }
+}
+
+/**
+ * Single-pass scan with an offset passed by value.
+ * @see scanSinglePassBody
+ */
+KERNEL(SCAN_WORK_GROUP_SIZE)
+void scanSinglePass(
+    __global const SCAN_IN_T *in,
+    __global SCAN_T *out,
+    volatile __global uint *tileStatus,
+    volatile __global SCAN_ACC_T *tileValues,
+    volatile __global uint *tileCounter,
+    uint total,
+    uint epoch,
+    SCAN_PAD_T offset)
+{
+    __local SCAN_ACC_T raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local uint tileShared;
+    scanSinglePassBody(in, out, tileStatus, tileValues, tileCounter, total, epoch,
+                       SCAN_TO_ACC(SCAN_UNPAD(offset)), raw_reduced, &tileShared);
+}
+
+/**
+ * Single-pass scan with an offset encoded in a buffer.
+ * @see scanSinglePassBody
+ */
+KERNEL(SCAN_WORK_GROUP_SIZE)
+void scanSinglePassOffset(
+    __global const SCAN_IN_T *in,
+    __global SCAN_T *out,
+    volatile __global uint *tileStatus,
+    volatile __global SCAN_ACC_T *tileValues,
+    volatile __global uint *tileCounter,
+    uint total,
+    uint epoch,
+    __global const SCAN_T *offset,
+    uint offsetIndex)
+{
+    __local SCAN_ACC_T raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local uint tileShared;
+    scanSinglePassBody(in, out, tileStatus, tileValues, tileCounter, total, epoch,
+                       SCAN_TO_ACC(offset[offsetIndex]), raw_reduced, &tileShared);
 }
+
+/**
+ * Single-pass scan starting from @ref SCAN_IDENTITY.
+ * @see scanSinglePassBody
+ */
+KERNEL(SCAN_WORK_GROUP_SIZE)
+void scanSinglePassIdentity(
+    __global const SCAN_IN_T *in,
+    __global SCAN_T *out,
+    volatile __global uint *tileStatus,
+    volatile __global SCAN_ACC_T *tileValues,
+    volatile __global uint *tileCounter,
+    uint total,
+    uint epoch)
+{
+    __local SCAN_ACC_T raw_reduced[(SCAN_WORK_SCALE < 2 ? 2 : SCAN_WORK_SCALE) * SCAN_WORK_GROUP_SIZE];
+    __local uint tileShared;
+    scanSinglePassBody(in, out, tileStatus, tileValues, tileCounter, total, epoch,
+                       SCAN_TO_ACC(SCAN_IDENTITY), raw_reduced, &tileShared);
+}
+
+#endif /* !SCAN_SEGMENTED && !SCAN_KAHAN */
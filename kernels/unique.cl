@@ -0,0 +1,148 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Kernels for collapsing runs of equal keys. The first key of each run is
+ * marked by @ref uniqueFlags, the marks are converted to output positions by
+ * the kernels in scan.cl, and @ref uniqueScatter then writes out the runs.
+ * If run lengths are required, @ref uniqueCounts converts the run starts
+ * written by @ref uniqueScatter into lengths.
+ */
+
+#if ENABLE_KHR_FP64 && __OPENCL_C_VERSION__ <= 110
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+#endif
+#if ENABLE_KHR_FP16
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#endif
+
+/**
+ * @def KEY_T
+ * @hideinitializer
+ * The type of the keys.
+ */
+
+/**
+ * @def KEY_DIFFERENT
+ * @hideinitializer
+ * Expression that is true if keys @a a and @a b are not equal.
+ */
+
+#ifndef KEY_T
+# error "KEY_T must be specified"
+# define KEY_T uint /* Keep doxygen happy */
+#endif
+
+#ifndef KEY_DIFFERENT
+# error "KEY_DIFFERENT must be specified"
+# define KEY_DIFFERENT(a, b) ((a) != (b)) /* Keep doxygen happy */
+#endif
+
+/**
+ * Returns true if element @a gid starts a new run.
+ */
+inline bool uniqueIsHead(__global const KEY_T * restrict keys, uint gid)
+{
+    return gid == 0 || KEY_DIFFERENT(keys[gid], keys[gid - 1]);
+}
+
+/**
+ * Writes 1 for each key that starts a run and 0 for the others.
+ *
+ * The global work size must equal the number of keys.
+ *
+ * @param[out] flags     The run marks.
+ * @param      keys      The input keys.
+ */
+__kernel void uniqueFlags(__global uint * restrict flags, __global const KEY_T * restrict keys)
+{
+    const uint gid = get_global_id(0);
+    flags[gid] = uniqueIsHead(keys, gid) ? 1 : 0;
+}
+
+/**
+ * Writes the first key of each run, and optionally the index at which each
+ * run starts. The last work-item also writes the number of runs.
+ *
+ * The global work size must equal the number of keys.
+ *
+ * @param[out] out          The first key of each run (may be NULL).
+ * @param[out] starts       The start index of each run, followed by
+ *                          @a elements, and with the number of runs at
+ *                          index <code>elements + 1</code> (may be NULL).
+ * @param[out] numRuns      Buffer to receive the number of runs.
+ * @param      numRunsPos   Index in @a numRuns at which to write.
+ * @param      keys         The input keys.
+ * @param      positions    Exclusive scan of the output of @ref uniqueFlags.
+ * @param      elements     The number of keys.
+ */
+__kernel void uniqueScatter(
+    __global KEY_T * restrict out,
+    __global uint * restrict starts,
+    __global uint * restrict numRuns,
+    uint numRunsPos,
+    __global const KEY_T * restrict keys,
+    __global const uint * restrict positions,
+    uint elements)
+{
+    const uint gid = get_global_id(0);
+    const uint pos = positions[gid];
+    const bool head = uniqueIsHead(keys, gid);
+    if (head)
+    {
+        if (out != 0)
+            out[pos] = keys[gid];
+        if (starts != 0)
+            starts[pos] = gid;
+    }
+    if (gid == elements - 1)
+    {
+        const uint runs = pos + (head ? 1 : 0);
+        numRuns[numRunsPos] = runs;
+        if (starts != 0)
+        {
+            starts[runs] = elements;
+            starts[elements + 1] = runs;
+        }
+    }
+}
+
+/**
+ * Converts run starts into run lengths.
+ *
+ * The global work size must equal the number of keys.
+ *
+ * @param[out] counts     The length of each run.
+ * @param      starts     The output of @ref uniqueScatter.
+ * @param      elements   The number of keys.
+ */
+__kernel void uniqueCounts(
+    __global uint * restrict counts,
+    __global const uint * restrict starts,
+    uint elements)
+{
+    const uint gid = get_global_id(0);
+    const uint runs = starts[elements + 1];
+    if (gid < runs)
+        counts[gid] = starts[gid + 1] - starts[gid];
+}
@@ -298,6 +298,7 @@ void Table<K, V>::prepareQuery(const char *name)
 template<typename K, typename V>
 void Table<K, V>::add(const K &key, const V &value)
 {
+    std::lock_guard<std::mutex> lock(mutex);
     sqlite3_reset(addStmt.get());
 
     int pos = 1;
@@ -312,6 +313,7 @@ void Table<K, V>::add(const K &key, const V &value)
 template<typename K, typename V>
 bool Table<K, V>::lookup(const K &key, V &value) const
 {
+    std::lock_guard<std::mutex> lock(mutex);
     sqlite3_reset(queryStmt.get());
 
     bindFields(queryStmt.get(), 1, key);
@@ -359,6 +361,7 @@ DB::DB() :
     scan(con.get(), ScanParameters::tableName()),
     reduce(con.get(), ReduceParameters::tableName()),
     radixsort(con.get(), RadixsortParameters::tableName()),
+    compact(con.get(), CompactParameters::tableName()),
     kernel(con.get(), KernelParameters::tableName())
 {
 }
@@ -372,6 +375,7 @@ CLOGS_LOCAL DB &getDB()
 template class Table<ScanParameters::Key, ScanParameters::Value>;
 template class Table<ReduceParameters::Key, ReduceParameters::Value>;
 template class Table<RadixsortParameters::Key, RadixsortParameters::Value>;
+template class Table<CompactParameters::Key, CompactParameters::Value>;
 template class Table<KernelParameters::Key, KernelParameters::Value>;
 
 } // namespace detail
@@ -30,6 +30,7 @@
 
 #include <clogs/visibility_push.h>
 #include <cstddef>
+#include <mutex>
 #include <boost/noncopyable.hpp>
 #include <clogs/visibility_pop.h>
 
@@ -86,6 +87,8 @@ class CLOGS_LOCAL Table
 private:
     sqlite3 *con;
     sqlite3_stmt_ptr addStmt, queryStmt;
+    /// Serializes use of the prepared statements, which may happen from background tuning
+    mutable std::mutex mutex;
 
     /// Create the table if it does not exist
     void createTable(const char *name);
@@ -131,6 +134,7 @@ public:
     Table<ScanParameters::Key, ScanParameters::Value> scan;
     Table<ReduceParameters::Key, ReduceParameters::Value> reduce;
     Table<RadixsortParameters::Key, RadixsortParameters::Value> radixsort;
+    Table<CompactParameters::Key, CompactParameters::Value> compact;
     Table<KernelParameters::Key, KernelParameters::Value> kernel;
 
     DB();
@@ -51,7 +51,7 @@ CLOGS_STRUCT(
 
 CLOGS_STRUCT(
     KernelParameters::Key,
-    (device)(header)(checksum)
+    (device)(header)(options)(checksum)
 )
 CLOGS_STRUCT(
     KernelParameters::Value,
@@ -62,26 +62,49 @@ CLOGS_STRUCT(
     ScanParameters::Key,
     (device)
     (elementType)
+    (inputType)
+    (transform)
+    (operation)
+    (accumulation)
+    (segmented)
 )
 CLOGS_STRUCT(
     ScanParameters::Value,
     (warpSizeMem)
     (warpSizeSchedule)
     (reduceWorkGroupSize)
+    (reduceElementsPerLoad)
     (scanWorkGroupSize)
     (scanWorkScale)
     (scanBlocks)
+    (singlePass)
+    (subgroups)
+    (workGroupFunctions)
+    (sequential)
+    (hostCrossover)
 )
 
 CLOGS_STRUCT(
     ReduceParameters::Key,
     (device)
     (elementType)
+    (inputType)
+    (transform)
+    (binary)
+    (statistics)
+    (indexMode)
+    (reproducible)
+    (operation)
 )
 CLOGS_STRUCT(
     ReduceParameters::Value,
     (reduceWorkGroupSize)
     (reduceBlocks)
+    (reduceLeafSize)
+    (reduceElementsPerLoad)
+    (subgroups)
+    (workGroupFunctions)
+    (hostCrossover)
 )
 
 CLOGS_STRUCT(
@@ -95,11 +118,30 @@ CLOGS_STRUCT(
     (warpSizeMem)
     (warpSizeSchedule)
     (reduceWorkGroupSize)
+    (reduceElementsPerLoad)
     (scanWorkGroupSize)
     (scatterWorkGroupSize)
     (scatterWorkScale)
     (scanBlocks)
     (radixBits)
+    (workGroupFunctions)
+    (scatterSequential)
+    (hostCrossover)
+)
+
+CLOGS_STRUCT(
+    CompactParameters::Key,
+    (device)
+    (elementType)
+    (stencilType)
+)
+CLOGS_STRUCT(
+    CompactParameters::Value,
+    (warpSizeMem)
+    (reduceWorkGroupSize)
+    (scanWorkGroupSize)
+    (scanWorkScale)
+    (scanBlocks)
 )
 
 CLOGS_LOCAL DeviceKey deviceKey(const cl::Device &device)
@@ -60,6 +60,7 @@ public:
     {
         DeviceKey device;
         std::string header;
+        std::string options;       ///< Options passed to the OpenCL compiler
         std::string checksum;
     };
 
@@ -68,7 +69,7 @@ public:
         std::vector<unsigned char> binary;
     };
 
-    static const char *tableName() { return "kernel_v1"; }
+    static const char *tableName() { return "kernel_v2"; }
 };
 
 CLOGS_STRUCT_FORWARD(KernelParameters::Key)
@@ -81,6 +82,11 @@ public:
     {
         DeviceKey device;
         std::string elementType;
+        std::string inputType;     ///< Empty if the input has the element type
+        std::string transform;     ///< Transform applied to input elements, or empty
+        std::string operation;     ///< Key of the binary operator
+        std::string accumulation;  ///< Accumulation mode (native, compensated or wide)
+        ::size_t segmented;        ///< Non-zero for segmented scans
     };
 
     struct CLOGS_LOCAL Value
@@ -88,12 +94,23 @@ public:
         ::size_t warpSizeMem;
         ::size_t warpSizeSchedule;
         ::size_t reduceWorkGroupSize;
+        ::size_t reduceElementsPerLoad; ///< Elements per vector load in the reduce kernel
         ::size_t scanWorkGroupSize;
         ::size_t scanWorkScale;
         ::size_t scanBlocks;
+        /**
+         * Non-zero to use the single-pass (decoupled look-back) kernel. It is
+         * only considered where @ref workGroupForwardProgress holds, since
+         * work-groups wait for earlier ones to publish their sums.
+         */
+        ::size_t singlePass;
+        ::size_t subgroups;        ///< Non-zero to use sub-group built-ins for work-group scans
+        ::size_t workGroupFunctions; ///< Non-zero to use the OpenCL 2.0 work-group built-ins
+        ::size_t sequential;       ///< Non-zero to reduce and scan each block with a single work-item
+        ::size_t hostCrossover;    ///< Largest problem size that @ref BACKEND_AUTO runs on the host
     };
 
-    static const char *tableName() { return "scan_v6"; }
+    static const char *tableName() { return "scan_v18"; }
 };
 
 CLOGS_STRUCT_FORWARD(ScanParameters::Key)
@@ -106,15 +123,27 @@ public:
     {
         DeviceKey device;
         std::string elementType;
+        std::string inputType;     ///< Empty if the input has the element type
+        std::string transform;     ///< Transform applied to input elements, or empty
+        ::size_t binary;           ///< Non-zero if there are two input buffers
+        ::size_t statistics;       ///< Bitwise or of the statistics computed, or 0
+        ::size_t indexMode;        ///< Argmin/argmax mode (a @ref ReduceIndex)
+        ::size_t reproducible;     ///< Non-zero if a fixed pairwise tree is used
+        std::string operation;     ///< Key of the binary operator
     };
 
     struct CLOGS_LOCAL Value
     {
         ::size_t reduceWorkGroupSize;
         ::size_t reduceBlocks;
+        ::size_t reduceLeafSize;   ///< Elements per work-item per chunk (1 unless reproducible)
+        ::size_t reduceElementsPerLoad; ///< Elements per vector load (1 if reproducible)
+        ::size_t subgroups;        ///< Non-zero to use sub-group built-ins for work-group reductions
+        ::size_t workGroupFunctions; ///< Non-zero to use the OpenCL 2.0 work-group built-ins
+        ::size_t hostCrossover;    ///< Largest problem size that @ref BACKEND_AUTO runs on the host
     };
 
-    static const char *tableName() { return "reduce_v1"; }
+    static const char *tableName() { return "reduce_v12"; }
 };
 
 CLOGS_STRUCT_FORWARD(ReduceParameters::Key)
@@ -135,19 +164,48 @@ public:
         ::size_t warpSizeMem;
         ::size_t warpSizeSchedule;
         ::size_t reduceWorkGroupSize;
+        ::size_t reduceElementsPerLoad; ///< Keys per vector load in the reduce kernel
         ::size_t scanWorkGroupSize;
         ::size_t scatterWorkGroupSize;
         ::size_t scatterWorkScale;
         ::size_t scanBlocks;
         unsigned int radixBits;
+        ::size_t workGroupFunctions; ///< Non-zero to use the OpenCL 2.0 work-group built-ins in the scan kernel
+        ::size_t scatterSequential; ///< Non-zero to scatter each block with a single work-item
+        ::size_t hostCrossover;    ///< Largest problem size that @ref BACKEND_AUTO runs on the host
     };
 
-    static const char *tableName() { return "radixsort_v5"; }
+    static const char *tableName() { return "radixsort_v9"; }
 };
 
 CLOGS_STRUCT_FORWARD(RadixsortParameters::Key)
 CLOGS_STRUCT_FORWARD(RadixsortParameters::Value)
 
+class CLOGS_LOCAL CompactParameters
+{
+public:
+    struct CLOGS_LOCAL Key
+    {
+        DeviceKey device;
+        std::string elementType;
+        std::string stencilType;   ///< Empty if there is no stencil
+    };
+
+    struct CLOGS_LOCAL Value
+    {
+        ::size_t warpSizeMem;
+        ::size_t reduceWorkGroupSize;
+        ::size_t scanWorkGroupSize;
+        ::size_t scanWorkScale;
+        ::size_t scanBlocks;
+    };
+
+    static const char *tableName() { return "compact_v1"; }
+};
+
+CLOGS_STRUCT_FORWARD(CompactParameters::Key)
+CLOGS_STRUCT_FORWARD(CompactParameters::Value)
+
 /**
  * Create a key with fields uniquely describing @a device.
  */
@@ -0,0 +1,706 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Stream compaction implementation.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include <clogs/compact.h>
+#include "compact.h"
+#include "utils.h"
+#include "parameters.h"
+#include "tune.h"
+#include "cache.h"
+
+namespace clogs
+{
+
+namespace detail
+{
+
+void CompactProblem::setType(const Type &type)
+{
+    if (type.getBaseType() == TYPE_VOID)
+        throw std::invalid_argument("type must not be void");
+    this->type = type;
+}
+
+void CompactProblem::setStencilType(const Type &stencilType)
+{
+    this->stencilType = stencilType;
+}
+
+void CompactProblem::setPredicate(const std::string &predicate)
+{
+    if (predicate.find_first_of("\r\n") != std::string::npos)
+        throw std::invalid_argument("predicate must not contain newlines");
+    this->predicate = predicate;
+}
+
+void CompactProblem::setTunePolicy(const TunePolicy &tunePolicy)
+{
+    this->tunePolicy = tunePolicy;
+}
+
+void Compact::initialize(
+    const cl::Context &context, const cl::Device &device, const CompactProblem &problem,
+    const CompactParameters::Value &params)
+{
+    reduceWorkGroupSize = params.reduceWorkGroupSize;
+    scanWorkGroupSize = params.scanWorkGroupSize;
+    scanWorkScale = params.scanWorkScale;
+    maxBlocks = params.scanBlocks;
+    elementSize = problem.type.getSize();
+    stencilSize = problem.stencilType.getSize();
+
+    const Type &predicateType =
+        problem.stencilType.getBaseType() == TYPE_VOID ? problem.type : problem.stencilType;
+
+    std::map<std::string, int> defines;
+    std::map<std::string, std::string> stringDefines;
+    if (problem.type.getBaseType() == TYPE_HALF || problem.stencilType.getBaseType() == TYPE_HALF)
+        defines["ENABLE_KHR_FP16"] = 1;
+    if (problem.type.getBaseType() == TYPE_DOUBLE || problem.stencilType.getBaseType() == TYPE_DOUBLE)
+        defines["ENABLE_KHR_FP64"] = 1;
+    defines["WARP_SIZE_MEM"] = params.warpSizeMem;
+    defines["REDUCE_WORK_GROUP_SIZE"] = params.reduceWorkGroupSize;
+    defines["SCAN_WORK_GROUP_SIZE"] = params.scanWorkGroupSize;
+    defines["SCAN_WORK_SCALE"] = params.scanWorkScale;
+    defines["SCAN_BLOCKS"] = params.scanBlocks;
+    stringDefines["COMPACT_T"] = problem.type.getName();
+    stringDefines["PREDICATE_T"] = predicateType.getName();
+    if (problem.predicate.empty())
+        stringDefines["PREDICATE(x)"] = "((x) != 0)";
+    else
+        stringDefines["PREDICATE(x)"] = "(" + problem.predicate + ")";
+
+    try
+    {
+        sums = cl::Buffer(context, CL_MEM_READ_WRITE, params.scanBlocks * sizeof(cl_uint));
+
+        program = build(context, device, "compact.cl", defines, stringDefines);
+
+        reduceKernel = cl::Kernel(program, "compactReduce");
+        reduceKernel.setArg(0, sums);
+
+        scanSmallKernel = cl::Kernel(program, "compactScanSmall");
+        scanSmallKernel.setArg(0, sums);
+
+        scatterKernel = cl::Kernel(program, "compactScatter");
+        scatterKernel.setArg(4, sums);
+    }
+    catch (cl::Error &e)
+    {
+        throw InternalError(std::string("Error preparing kernels for compact: ") + e.what());
+    }
+}
+
+std::pair<double, double> Compact::tuneReduceCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const boost::any &paramsAny,
+    const CompactProblem &problem)
+{
+    const CompactParameters::Value &params = boost::any_cast<const CompactParameters::Value &>(paramsAny);
+    const ::size_t reduceWorkGroupSize = params.reduceWorkGroupSize;
+    const ::size_t maxBlocks = params.scanBlocks;
+    const ::size_t predicateSize = std::max(problem.type.getSize(), problem.stencilType.getSize());
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * predicateSize);
+    cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+    ::size_t blockSize = roundUp(elements, reduceWorkGroupSize * maxBlocks) / maxBlocks;
+    ::size_t nBlocks = (elements + blockSize - 1) / blockSize;
+    if (nBlocks <= 1)
+        throw InternalError("No blocks to operate on");
+
+    Compact compact(context, device, problem, params);
+    compact.reduceKernel.setArg(1, buffer);
+    compact.reduceKernel.setArg(2, (cl_uint) blockSize);
+    cl::Event event;
+    // Warmup pass
+    queue.enqueueNDRangeKernel(
+        compact.reduceKernel,
+        cl::NullRange,
+        cl::NDRange(reduceWorkGroupSize * (nBlocks - 1)),
+        cl::NDRange(reduceWorkGroupSize),
+        NULL, NULL);
+    queue.finish();
+    // Timing pass
+    queue.enqueueNDRangeKernel(
+        compact.reduceKernel,
+        cl::NullRange,
+        cl::NDRange(reduceWorkGroupSize * (nBlocks - 1)),
+        cl::NDRange(reduceWorkGroupSize),
+        NULL, &event);
+    queue.finish();
+
+    event.wait();
+    cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    double elapsed = end - start;
+    double rate = (nBlocks - 1) * blockSize / elapsed;
+    return std::make_pair(rate, rate);
+}
+
+std::pair<double, double> Compact::tuneScatterCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const boost::any &paramsAny,
+    const CompactProblem &problem)
+{
+    const CompactParameters::Value &params = boost::any_cast<const CompactParameters::Value &>(paramsAny);
+    const ::size_t elementSize = problem.type.getSize();
+    const ::size_t stencilSize = problem.stencilType.getSize();
+    cl::Buffer input(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::Buffer stencil;
+    if (stencilSize > 0)
+        stencil = cl::Buffer(context, CL_MEM_READ_WRITE, elements * stencilSize);
+    cl::Buffer output(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::Buffer count(context, CL_MEM_READ_WRITE, sizeof(cl_uint));
+    cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+    const ::size_t scanWorkGroupSize = params.scanWorkGroupSize;
+    const ::size_t scanWorkScale = params.scanWorkScale;
+    const ::size_t maxBlocks = params.scanBlocks;
+    ::size_t tileSize = scanWorkGroupSize * scanWorkScale;
+    ::size_t blockSize = roundUp(elements, tileSize * maxBlocks) / maxBlocks;
+    ::size_t nBlocks = (elements + blockSize - 1) / blockSize;
+    Compact compact(context, device, problem, params);
+
+    /* The block offsets are all zero, which keeps the writes in bounds */
+    std::vector<cl_uint> zeros(maxBlocks);
+    queue.enqueueWriteBuffer(compact.sums, CL_TRUE, 0, maxBlocks * sizeof(cl_uint), &zeros[0]);
+
+    cl::Event event;
+    compact.scatterKernel.setArg(0, input);
+    compact.scatterKernel.setArg(1, stencilSize > 0 ? stencil : input);
+    compact.scatterKernel.setArg(2, output);
+    compact.scatterKernel.setArg(3, cl::Buffer());
+    compact.scatterKernel.setArg(5, count);
+    compact.scatterKernel.setArg(6, (cl_uint) 0);
+    compact.scatterKernel.setArg(7, (cl_uint) blockSize);
+    compact.scatterKernel.setArg(8, (cl_uint) elements);
+    // Warmup pass
+    queue.enqueueNDRangeKernel(
+        compact.scatterKernel,
+        cl::NullRange,
+        cl::NDRange(scanWorkGroupSize * nBlocks),
+        cl::NDRange(scanWorkGroupSize),
+        NULL, NULL);
+    queue.finish();
+    // Timing pass
+    queue.enqueueNDRangeKernel(
+        compact.scatterKernel,
+        cl::NullRange,
+        cl::NDRange(scanWorkGroupSize * nBlocks),
+        cl::NDRange(scanWorkGroupSize),
+        NULL, &event);
+    queue.finish();
+
+    event.wait();
+    cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    double elapsed = end - start;
+    double rate = elements / elapsed;
+    return std::make_pair(rate, rate);
+}
+
+std::pair<double, double> Compact::tuneBlocksCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const boost::any &paramsAny,
+    const CompactProblem &problem)
+{
+    const CompactParameters::Value &params = boost::any_cast<const CompactParameters::Value &>(paramsAny);
+    const ::size_t elementSize = problem.type.getSize();
+    const ::size_t stencilSize = problem.stencilType.getSize();
+    cl::Buffer input(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::Buffer stencil;
+    if (stencilSize > 0)
+        stencil = cl::Buffer(context, CL_MEM_READ_WRITE, elements * stencilSize);
+    cl::Buffer output(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::Buffer count(context, CL_MEM_READ_WRITE, sizeof(cl_uint));
+    cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+    Compact compact(context, device, problem, params);
+    cl::Event event;
+    // Warmup pass
+    compact.enqueue(queue, input, stencil, output, cl::Buffer(), count, 0, elements, NULL, NULL);
+    queue.finish();
+    // Timing pass
+    compact.enqueue(queue, input, stencil, output, cl::Buffer(), count, 0, elements, NULL, &event);
+    queue.finish();
+
+    event.wait();
+    cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    double elapsed = end - start;
+    double rate = elements / elapsed;
+    /* As for scan, require a 5% improvement to increase the number of blocks */
+    return std::make_pair(rate, rate * 1.05);
+}
+
+CompactParameters::Value Compact::defaultParameters(
+    const cl::Device &device, const CompactProblem &)
+{
+    // Limits are as for tune, with the same model as the scan
+    const size_t maxWorkGroupSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / sizeof(cl_uint);
+    const size_t maxBlocks = std::min(2 * maxWorkGroupSize, localMemElements) & ~1;
+    const size_t computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    const size_t workGroupSize = getDefaultWorkGroupSize(
+        device, std::min(maxWorkGroupSize, localMemElements));
+    const bool isCPU = device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU;
+
+    CompactParameters::Value params;
+    params.warpSizeMem = getWarpSizeMem(device);
+    params.reduceWorkGroupSize = workGroupSize;
+    params.scanWorkGroupSize = workGroupSize;
+    params.scanWorkScale = roundDownPower2(std::min(localMemElements / workGroupSize, size_t(4)));
+    params.scanBlocks = std::max(size_t(2), std::min(maxBlocks, (isCPU ? 4 : 8) * computeUnits)) & ~1;
+    return params;
+}
+
+CompactParameters::Value Compact::tune(
+    const cl::Device &device, const CompactProblem &problem)
+{
+    const TunePolicy &policy = problem.tunePolicy;
+    policy.assertEnabled();
+    std::ostringstream description;
+    description << "compact for " << problem.type.getName() << " elements";
+    if (problem.stencilType.getBaseType() != TYPE_VOID)
+        description << " with " << problem.stencilType.getName() << " stencil";
+    policy.logStartAlgorithm(description.str(), device);
+
+    const size_t elementSize = problem.type.getSize();
+    const size_t maxWorkGroupSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / sizeof(cl_uint);
+    const size_t maxBlocks = std::min(2 * maxWorkGroupSize, localMemElements) & ~1;
+    const size_t startBlocks = std::max(size_t(2), maxBlocks / 2) & ~1;
+
+    std::vector<std::size_t> problemSizes;
+    problemSizes.push_back(65536);
+    problemSizes.push_back(32 * 1024 * 1024 / elementSize);
+
+    CompactParameters::Value cand;
+    cand.warpSizeMem = getWarpSizeMem(device);
+    cand.reduceWorkGroupSize = 1;
+    cand.scanWorkGroupSize = 1;
+    cand.scanWorkScale = 1;
+    cand.scanBlocks = startBlocks;
+
+    {
+        // Tune counting kernel
+        std::vector<boost::any> sets;
+        for (::size_t reduceWorkGroupSize = 1; reduceWorkGroupSize <= maxWorkGroupSize; reduceWorkGroupSize *= 2)
+        {
+            CompactParameters::Value params = cand;
+            params.reduceWorkGroupSize = reduceWorkGroupSize;
+            sets.push_back(params);
+        }
+
+        using namespace std::placeholders;
+        cand = boost::any_cast<CompactParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Compact::tuneReduceCallback, _1, _2, _3, _4, problem)));
+    }
+
+    {
+        // Tune scatter kernel, jointly over work group size and work scale
+        std::vector<boost::any> sets;
+        for (size_t scanWorkGroupSize = 1; scanWorkGroupSize <= maxWorkGroupSize; scanWorkGroupSize *= 2)
+        {
+            const size_t maxWorkScale = std::min(localMemElements / scanWorkGroupSize, std::size_t(16));
+            for (size_t scanWorkScale = 1; scanWorkScale <= maxWorkScale; scanWorkScale *= 2)
+            {
+                CompactParameters::Value params = cand;
+                params.scanWorkGroupSize = scanWorkGroupSize;
+                params.scanWorkScale = scanWorkScale;
+                sets.push_back(params);
+            }
+        }
+
+        using namespace std::placeholders;
+        cand = boost::any_cast<CompactParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Compact::tuneScatterCallback, _1, _2, _3, _4, problem)));
+    }
+
+    {
+        // Tune number of blocks
+        std::vector<boost::any> sets;
+        for (size_t blocks = 2; blocks <= maxBlocks; blocks *= 2)
+        {
+            CompactParameters::Value params = cand;
+            params.scanBlocks = blocks;
+            sets.push_back(params);
+        }
+
+        using namespace std::placeholders;
+        cand = boost::any_cast<CompactParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Compact::tuneBlocksCallback, _1, _2, _3, _4, problem)));
+    }
+
+    policy.logEndAlgorithm();
+    return cand;
+}
+
+bool Compact::problemSupported(const cl::Device &device, const CompactProblem &problem)
+{
+    if (!problem.type.isStorable(device))
+        return false;
+    const bool hasStencil = problem.stencilType.getBaseType() != TYPE_VOID;
+    if (hasStencil && !problem.stencilType.isStorable(device))
+        return false;
+    const Type &predicateType = hasStencil ? problem.stencilType : problem.type;
+    if (!predicateType.isComputable(device))
+        return false;
+    // The default predicate must yield a scalar truth value
+    if (problem.predicate.empty()
+        && (!predicateType.isIntegral() || predicateType.getLength() != 1))
+        return false;
+    return true;
+}
+
+Compact::Compact(const cl::Context &context, const cl::Device &device, const CompactProblem &problem)
+{
+    if (!problemSupported(device, problem))
+        throw std::invalid_argument("problem is not supported on this device");
+
+    CompactParameters::Key key = makeKey(device, problem);
+    CompactParameters::Value params;
+    if (!getDB().compact.lookup(key, params))
+    {
+        if (problem.tunePolicy.isBackground() || problem.tunePolicy.isFallback())
+        {
+            params = defaultParameters(device, problem);
+            if (problem.tunePolicy.isBackground())
+                BackgroundTuner::get().start<CompactParameters::Key, CompactParameters::Value>(
+                    getDB().compact, key, problem.tunePolicy,
+                    std::bind(&Compact::tune, device, problem));
+        }
+        else
+        {
+            params = tune(device, problem);
+            getDB().compact.add(key, params);
+        }
+    }
+    initialize(context, device, problem, params);
+}
+
+Compact::Compact(const cl::Context &context, const cl::Device &device, const CompactProblem &problem,
+                 const CompactParameters::Value &params)
+{
+    initialize(context, device, problem, params);
+}
+
+/**
+ * To reduce the amount of time for tuning, we assume that signed
+ * and unsigned variants are equivalent, and canonicalise to signed.
+ */
+static Type canonicalType(const Type &type)
+{
+    switch (type.getBaseType())
+    {
+    case TYPE_UCHAR:
+        return Type(TYPE_CHAR, type.getLength());
+    case TYPE_USHORT:
+        return Type(TYPE_SHORT, type.getLength());
+    case TYPE_UINT:
+        return Type(TYPE_INT, type.getLength());
+    case TYPE_ULONG:
+        return Type(TYPE_LONG, type.getLength());
+    default:
+        return type;
+    }
+}
+
+CompactParameters::Key Compact::makeKey(const cl::Device &device, const CompactProblem &problem)
+{
+    CompactParameters::Key key;
+    key.device = deviceKey(device);
+    key.elementType = canonicalType(problem.type).getName();
+    if (problem.stencilType.getBaseType() != TYPE_VOID)
+        key.stencilType = canonicalType(problem.stencilType).getName();
+    return key;
+}
+
+void Compact::enqueue(const cl::CommandQueue &commandQueue,
+                      const cl::Buffer &inBuffer,
+                      const cl::Buffer &stencilBuffer,
+                      const cl::Buffer &outBuffer,
+                      const cl::Buffer &indicesBuffer,
+                      const cl::Buffer &countBuffer,
+                      ::size_t countPosition,
+                      ::size_t elements,
+                      const VECTOR_CLASS<cl::Event> *events,
+                      cl::Event *event)
+{
+    /* Validate parameters */
+    if (elements == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Compact::enqueue: elements is zero");
+    if ((stencilSize > 0) != (stencilBuffer() != NULL))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: stencil buffer does not match problem");
+    if (stencilSize > 0)
+    {
+        if (stencilBuffer.getInfo<CL_MEM_SIZE>() / stencilSize < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: range out of stencil buffer bounds");
+        if (!(stencilBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: stencil buffer is not readable");
+    }
+    if (outBuffer() != NULL || stencilSize == 0)
+    {
+        if (inBuffer.getInfo<CL_MEM_SIZE>() / elementSize < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: range out of input buffer bounds");
+        if (!(inBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: input buffer is not readable");
+    }
+    if (outBuffer() != NULL)
+    {
+        if (outBuffer.getInfo<CL_MEM_SIZE>() / elementSize < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: range out of output buffer bounds");
+        if (!(outBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: output buffer is not writable");
+    }
+    if (indicesBuffer() != NULL)
+    {
+        if (indicesBuffer.getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: range out of indices buffer bounds");
+        if (!(indicesBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: indices buffer is not writable");
+    }
+    if (countBuffer.getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) <= countPosition)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: count position out of buffer bounds");
+    if (!(countBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Compact::enqueue: count buffer is not writable");
+
+    const cl::Buffer &predicateBuffer = stencilSize > 0 ? stencilBuffer : inBuffer;
+
+    // block size must be a multiple of this
+    const ::size_t tileSize = std::max(reduceWorkGroupSize, scanWorkScale * scanWorkGroupSize);
+
+    /* Ensure that blockSize * blocks >= elements while blockSize is a multiply of tileSize */
+    const ::size_t blockSize = roundUp(elements, tileSize * maxBlocks) / maxBlocks;
+    const ::size_t allBlocks = (elements + blockSize - 1) / blockSize;
+    assert(allBlocks > 0 && allBlocks <= maxBlocks);
+    assert((allBlocks - 1) * blockSize <= elements);
+    assert(allBlocks * blockSize >= elements);
+
+    reduceKernel.setArg(1, predicateBuffer);
+    reduceKernel.setArg(2, (cl_uint) blockSize);
+
+    scatterKernel.setArg(0, inBuffer);
+    scatterKernel.setArg(1, predicateBuffer);
+    scatterKernel.setArg(2, outBuffer);
+    scatterKernel.setArg(3, indicesBuffer);
+    scatterKernel.setArg(5, countBuffer);
+    scatterKernel.setArg(6, (cl_uint) countPosition);
+    scatterKernel.setArg(7, (cl_uint) blockSize);
+    scatterKernel.setArg(8, (cl_uint) elements);
+
+    std::vector<cl::Event> reduceEvents(1);
+    std::vector<cl::Event> scanSmallEvents(1);
+    cl::Event scatterEvent;
+    const std::vector<cl::Event> *waitFor = events;
+    if (allBlocks > 1)
+    {
+        commandQueue.enqueueNDRangeKernel(reduceKernel,
+                                          cl::NullRange,
+                                          cl::NDRange(reduceWorkGroupSize * (allBlocks - 1)),
+                                          cl::NDRange(reduceWorkGroupSize),
+                                          events, &reduceEvents[0]);
+        waitFor = &reduceEvents;
+        doEventCallback(reduceEvents[0]);
+    }
+    commandQueue.enqueueNDRangeKernel(scanSmallKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(maxBlocks / 2),
+                                      cl::NDRange(maxBlocks / 2),
+                                      waitFor, &scanSmallEvents[0]);
+    doEventCallback(scanSmallEvents[0]);
+    commandQueue.enqueueNDRangeKernel(scatterKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(scanWorkGroupSize * allBlocks),
+                                      cl::NDRange(scanWorkGroupSize),
+                                      &scanSmallEvents, &scatterEvent);
+    doEventCallback(scatterEvent);
+    if (event != NULL)
+        *event = scatterEvent;
+}
+
+const CompactProblem &getDetail(const clogs::CompactProblem &problem)
+{
+    return *problem.detail_;
+}
+
+} // namespace detail
+
+CompactProblem::CompactProblem() : detail_(new detail::CompactProblem())
+{
+}
+
+CompactProblem::~CompactProblem()
+{
+    delete detail_;
+}
+
+CompactProblem::CompactProblem(const CompactProblem &other)
+    : detail_(new detail::CompactProblem(*other.detail_))
+{
+}
+
+CompactProblem &CompactProblem::operator=(const CompactProblem &other)
+{
+    if (detail_ != other.detail_)
+    {
+        detail::CompactProblem *tmp = new detail::CompactProblem(*other.detail_);
+        delete detail_;
+        detail_ = tmp;
+    }
+    return *this;
+}
+
+void CompactProblem::setType(const Type &type)
+{
+    assert(detail_ != NULL);
+    detail_->setType(type);
+}
+
+void CompactProblem::setStencilType(const Type &stencilType)
+{
+    assert(detail_ != NULL);
+    detail_->setStencilType(stencilType);
+}
+
+void CompactProblem::setPredicate(const std::string &predicate)
+{
+    assert(detail_ != NULL);
+    detail_->setPredicate(predicate);
+}
+
+void CompactProblem::setTunePolicy(const TunePolicy &tunePolicy)
+{
+    assert(detail_ != NULL);
+    detail_->setTunePolicy(detail::getDetail(tunePolicy));
+}
+
+
+Compact::Compact()
+{
+}
+
+detail::Compact *Compact::getDetail() const
+{
+    return static_cast<detail::Compact *>(Algorithm::getDetail());
+}
+
+detail::Compact *Compact::getDetailNonNull() const
+{
+    return static_cast<detail::Compact *>(Algorithm::getDetailNonNull());
+}
+
+void Compact::construct(cl_context context, cl_device_id device, const CompactProblem &problem,
+                        cl_int &err, const char *&errStr)
+{
+    try
+    {
+        setDetail(new detail::Compact(
+            detail::retainWrap<cl::Context>(context),
+            detail::retainWrap<cl::Device>(device),
+            detail::getDetail(problem)));
+        detail::clearError(err, errStr);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Compact::moveAssign(Compact &other)
+{
+    delete static_cast<detail::Compact *>(Algorithm::moveAssign(other));
+}
+
+Compact::~Compact()
+{
+    delete getDetail();
+}
+
+void Compact::enqueue(cl_command_queue commandQueue,
+                      cl_mem inBuffer,
+                      cl_mem stencilBuffer,
+                      cl_mem outBuffer,
+                      cl_mem indicesBuffer,
+                      cl_mem countBuffer,
+                      ::size_t countPosition,
+                      ::size_t elements,
+                      cl_uint numEvents,
+                      const cl_event *events,
+                      cl_event *event,
+                      cl_int &err,
+                      const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueue(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(stencilBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            detail::retainWrap<cl::Buffer>(indicesBuffer),
+            detail::retainWrap<cl::Buffer>(countBuffer),
+            countPosition, elements,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void swap(Compact &a, Compact &b)
+{
+    a.swap(b);
+}
+
+} // namespace clogs
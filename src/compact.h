@@ -0,0 +1,181 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Stream compaction implementation.
+ */
+
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <boost/any.hpp>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include "parameters.h"
+#include "cache_types.h"
+#include "utils.h"
+#include "tune.h"
+
+namespace clogs
+{
+namespace detail
+{
+
+class Compact;
+
+/**
+ * Internal implementation of @ref clogs::CompactProblem.
+ */
+class CLOGS_LOCAL CompactProblem
+{
+private:
+    friend class Compact;
+    Type type;
+    Type stencilType;
+    std::string predicate;
+    TunePolicy tunePolicy;
+
+public:
+    void setType(const Type &type);
+    void setStencilType(const Type &stencilType);
+    void setPredicate(const std::string &predicate);
+    void setTunePolicy(const TunePolicy &tunePolicy);
+};
+
+/**
+ * Internal implementation of @ref clogs::Compact.
+ */
+class CLOGS_LOCAL Compact : public Algorithm
+{
+private:
+    ::size_t reduceWorkGroupSize;    ///< Work group size for the counting phase
+    ::size_t scanWorkGroupSize;      ///< Work group size for the scatter phase
+    ::size_t scanWorkScale;          ///< Elements per work item for the scatter phase
+    ::size_t maxBlocks;              ///< Maximum number of items in the middle phase
+    ::size_t elementSize;            ///< Size of the element type
+    ::size_t stencilSize;            ///< Size of the stencil type (0 if none)
+    cl::Program program;             ///< Program containing the kernels
+    cl::Kernel reduceKernel;         ///< Initial counting kernel
+    cl::Kernel scanSmallKernel;      ///< Middle-phase scan kernel
+    cl::Kernel scatterKernel;        ///< Final scan-and-scatter kernel
+    cl::Buffer sums;                 ///< Counts of the blocks for the middle phase
+
+    /**
+     * Second construction phase. This is called either by the normal constructor
+     * or during autotuning.
+     *
+     * @param context, device, problem Constructor arguments
+     * @param params                   Autotuned parameters
+     */
+    void initialize(
+        const cl::Context &context, const cl::Device &device, const CompactProblem &problem,
+        const CompactParameters::Value &params);
+
+    /**
+     * Constructor for autotuning
+     */
+    Compact(const cl::Context &context, const cl::Device &device, const CompactProblem &problem,
+            const CompactParameters::Value &params);
+
+    static std::pair<double, double> tuneReduceCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const boost::any &parameters,
+        const CompactProblem &problem);
+
+    static std::pair<double, double> tuneScatterCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const boost::any &parameters,
+        const CompactProblem &problem);
+
+    static std::pair<double, double> tuneBlocksCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const boost::any &parameters,
+        const CompactProblem &problem);
+
+    /**
+     * Returns key for looking up autotuning parameters.
+     *
+     * @param device, problem  Constructor parameters.
+     */
+    static CompactParameters::Key makeKey(const cl::Device &device, const CompactProblem &problem);
+
+    /**
+     * Returns parameters estimated from the properties of @a device, for
+     * use while tuning runs in the background or in place of tuning when it
+     * is disabled (see @ref TunePolicy::isFallback).
+     *
+     * @param device      Device to tune for
+     * @param problem     Compaction parameters
+     */
+    static CompactParameters::Value defaultParameters(
+        const cl::Device &device, const CompactProblem &problem);
+
+    /**
+     * Perform autotuning.
+     *
+     * @param device      Device to tune for
+     * @param problem     Compaction parameters
+     */
+    static CompactParameters::Value tune(
+        const cl::Device &device, const CompactProblem &problem);
+
+public:
+    /**
+     * Constructor.
+     * @see @ref clogs::Compact::Compact(const cl::Context &, const cl::Device &, const CompactProblem &)
+     */
+    Compact(const cl::Context &context, const cl::Device &device, const CompactProblem &problem);
+
+    /**
+     * Enqueue a compaction on a command queue.
+     * @see @ref clogs::Compact::enqueue.
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &inBuffer,
+                 const cl::Buffer &stencilBuffer,
+                 const cl::Buffer &outBuffer,
+                 const cl::Buffer &indicesBuffer,
+                 const cl::Buffer &countBuffer,
+                 ::size_t countPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL);
+
+    /**
+     * Return whether a problem is supported on a device.
+     */
+    static bool problemSupported(const cl::Device &device, const CompactProblem &problem);
+};
+
+} // namespace detail
+} // namespace clogs
+
+#endif /* COMPACT_H */
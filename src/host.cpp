@@ -0,0 +1,830 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Host implementations of sorting, scan and reduction.
+ */
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include "host.h"
+
+namespace clogs
+{
+namespace detail
+{
+
+/**
+ * Minimum number of elements given to each thread. Smaller problems run
+ * entirely on the calling thread, since waking a pool thread and waiting for
+ * it costs about as much as processing this many elements.
+ */
+static const ::size_t minChunkElements = 16384;
+
+namespace
+{
+
+/**
+ * Persistent worker threads for the host backend, so that small problems do
+ * not pay for starting threads on every call. Threads that call @ref run
+ * also execute queued tasks while they wait, so work always makes progress,
+ * even if no worker threads could be started.
+ */
+class ThreadPool
+{
+private:
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()> > tasks;
+    ::size_t workers;   ///< Number of threads that were started
+
+    /// Body of each worker thread
+    void worker()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return !tasks.empty(); });
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    /// Runs one queued task on the calling thread, returning false if there are none
+    bool runOne()
+    {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (tasks.empty())
+                return false;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        return true;
+    }
+
+    explicit ThreadPool(::size_t threads) : workers(0)
+    {
+        for (::size_t i = 0; i < threads; i++)
+        {
+            try
+            {
+                std::thread(&ThreadPool::worker, this).detach();
+                workers++;
+            }
+            catch (std::system_error &)
+            {
+                break; // callers run the tasks themselves
+            }
+        }
+    }
+
+public:
+    /**
+     * Returns the pool, starting it on first use with one thread fewer than
+     * the hardware concurrency (the calling thread does the remaining share),
+     * but at least one so that @ref post has somewhere to run. It is never
+     * destroyed, so that it remains usable by other static objects (such as
+     * background tuning) during program exit.
+     */
+    static ThreadPool &get()
+    {
+        static ThreadPool *pool = new ThreadPool(
+            std::max(2U, std::thread::hardware_concurrency()) - 1);
+        return *pool;
+    }
+
+    /**
+     * Queues @a task to run on a worker thread without waiting for it.
+     * Returns false (without queuing it) if there are no worker threads.
+     */
+    bool post(std::function<void()> task)
+    {
+        if (workers == 0)
+            return false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    /**
+     * Calls @a f(i) for i in [1, @a count) on the pool and @a f(0) on the
+     * calling thread, returning once all the calls have completed.
+     */
+    void run(::size_t count, const std::function<void(::size_t)> &f)
+    {
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+        ::size_t remaining = count - 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (::size_t i = 1; i < count; i++)
+            {
+                tasks.push_back([&, i]
+                {
+                    f(i);
+                    std::lock_guard<std::mutex> doneLock(doneMutex);
+                    if (--remaining == 0)
+                        doneCondition.notify_all();
+                });
+            }
+        }
+        wake.notify_all();
+        f(0);
+        while (runOne())
+        {
+        }
+        std::unique_lock<std::mutex> doneLock(doneMutex);
+        doneCondition.wait(doneLock, [&] { return remaining == 0; });
+    }
+};
+
+} // anonymous namespace
+
+::size_t hostElements(Backend backend, bool supported, ::size_t crossover)
+{
+    switch (backend)
+    {
+    case BACKEND_DEVICE:
+        return 0;
+    case BACKEND_HOST:
+        if (!supported)
+            throw std::invalid_argument("problem is not supported by the host backend");
+        return std::numeric_limits< ::size_t>::max();
+    case BACKEND_AUTO:
+        return supported ? crossover : 0;
+    }
+    throw std::invalid_argument("unknown backend");
+}
+
+::size_t defaultHostCrossover(const cl::Device &device, ::size_t discrete)
+{
+    if ((device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
+        || device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>())
+        return 4 * discrete;
+    else
+        return discrete;
+}
+
+bool hostTypeSupported(const Type &type)
+{
+    if (type.getLength() != 1)
+        return false;
+    switch (type.getBaseType())
+    {
+    case TYPE_VOID:
+    case TYPE_HALF:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/**
+ * Returns the number of chunks into which to split @a elements elements.
+ */
+static ::size_t chunkCount(::size_t elements)
+{
+    ::size_t threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    return std::max(::size_t(1), std::min(threads, elements / minChunkElements));
+}
+
+/**
+ * Splits the range [0, @a elements) into @a chunks contiguous, nearly equal
+ * pieces, and calls <code>f(chunk, begin, end)</code> for each of them in
+ * parallel on the @ref ThreadPool. The first chunk is processed on the
+ * calling thread, so a single chunk does not involve the pool.
+ */
+template<typename F>
+static void parallelChunks(::size_t chunks, ::size_t elements, const F &f)
+{
+    const ::size_t base = elements / chunks;
+    const ::size_t extra = elements % chunks;
+    auto chunk = [&](::size_t c)
+    {
+        const ::size_t begin = c * base + std::min(c, extra);
+        const ::size_t end = begin + base + (c < extra ? 1 : 0);
+        f(c, begin, end);
+    };
+    if (chunks == 1)
+        chunk(0);
+    else
+        ThreadPool::get().run(chunks, chunk);
+}
+
+/**
+ * Least-significant digit radix sort on 8-bit digits. Each pass counts the
+ * digits of each chunk, computes the output positions with a digit-major
+ * scan over the chunks (which keeps the sort stable), and then scatters the
+ * chunks in parallel. Passes in which all keys have the same digit are
+ * skipped.
+ */
+template<typename K>
+static void radixsortKeys(
+    K *keys, cl_uchar *values, ::size_t valueSize, ::size_t elements, unsigned int maxBits)
+{
+    const unsigned int radixBits = 8;
+    const ::size_t radix = ::size_t(1) << radixBits;
+
+    std::vector<K> tmpKeys(elements);
+    std::vector<cl_uchar> tmpValues(elements * valueSize);
+    K *curKeys = keys;
+    K *nextKeys = tmpKeys.data();
+    cl_uchar *curValues = values;
+    cl_uchar *nextValues = tmpValues.data();
+
+    const ::size_t chunks = chunkCount(elements);
+    std::vector< ::size_t> offsets(chunks * radix);
+    for (unsigned int firstBit = 0; firstBit < maxBits; firstBit += radixBits)
+    {
+        const unsigned int bits = std::min(radixBits, maxBits - firstBit);
+        const K mask = K((::size_t(1) << bits) - 1);
+        std::fill(offsets.begin(), offsets.end(), ::size_t(0));
+
+        parallelChunks(chunks, elements, [&](::size_t c, ::size_t begin, ::size_t end)
+        {
+            ::size_t *count = &offsets[c * radix];
+            for (::size_t i = begin; i < end; i++)
+                count[(curKeys[i] >> firstBit) & mask]++;
+        });
+
+        ::size_t sum = 0;
+        bool trivial = false;
+        for (::size_t d = 0; d < radix; d++)
+        {
+            const ::size_t start = sum;
+            for (::size_t c = 0; c < chunks; c++)
+            {
+                const ::size_t count = offsets[c * radix + d];
+                offsets[c * radix + d] = sum;
+                sum += count;
+            }
+            if (sum - start == elements)
+                trivial = true;
+        }
+        if (trivial)
+            continue;
+
+        parallelChunks(chunks, elements, [&](::size_t c, ::size_t begin, ::size_t end)
+        {
+            ::size_t *offset = &offsets[c * radix];
+            for (::size_t i = begin; i < end; i++)
+            {
+                const ::size_t pos = offset[(curKeys[i] >> firstBit) & mask]++;
+                nextKeys[pos] = curKeys[i];
+                if (valueSize != 0)
+                    std::memcpy(nextValues + pos * valueSize, curValues + i * valueSize, valueSize);
+            }
+        });
+        std::swap(curKeys, nextKeys);
+        std::swap(curValues, nextValues);
+    }
+
+    if (curKeys != keys)
+    {
+        std::copy(curKeys, curKeys + elements, keys);
+        if (valueSize != 0)
+            std::memcpy(values, curValues, elements * valueSize);
+    }
+}
+
+void hostRadixsort(
+    const Type &keyType, ::size_t valueSize,
+    void *keys, void *values, ::size_t elements, unsigned int maxBits)
+{
+    cl_uchar *valueBytes = static_cast<cl_uchar *>(values);
+    switch (keyType.getBaseType())
+    {
+    case TYPE_UCHAR:
+        radixsortKeys(static_cast<cl_uchar *>(keys), valueBytes, valueSize, elements, maxBits);
+        break;
+    case TYPE_USHORT:
+        radixsortKeys(static_cast<cl_ushort *>(keys), valueBytes, valueSize, elements, maxBits);
+        break;
+    case TYPE_UINT:
+        radixsortKeys(static_cast<cl_uint *>(keys), valueBytes, valueSize, elements, maxBits);
+        break;
+    case TYPE_ULONG:
+        radixsortKeys(static_cast<cl_ulong *>(keys), valueBytes, valueSize, elements, maxBits);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+/**
+ * Adds integers with wrap-around on overflow, like OpenCL C.
+ */
+template<typename T>
+static T hostAdd(T a, T b, std::true_type)
+{
+    typedef typename std::make_unsigned<T>::type U;
+    return T(U(a) + U(b));
+}
+
+/// Floating-point version of @ref hostAdd
+template<typename T>
+static T hostAdd(T a, T b, std::false_type)
+{
+    return a + b;
+}
+
+/**
+ * Returns the largest (if @a max) or smallest value of an integral type.
+ */
+template<typename T>
+static T hostLimit(bool max, std::true_type)
+{
+    return max ? std::numeric_limits<T>::max() : std::numeric_limits<T>::min();
+}
+
+/// Floating-point version of @ref hostLimit, which uses infinities
+template<typename T>
+static T hostLimit(bool max, std::false_type)
+{
+    return max ? std::numeric_limits<T>::infinity() : -std::numeric_limits<T>::infinity();
+}
+
+/// @ref OPERATOR_SUM
+template<typename T>
+struct HostSum
+{
+    T identity() const { return T(0); }
+    T operator()(T a, T b) const { return hostAdd(a, b, std::is_integral<T>()); }
+};
+
+/**
+ * Returns the smaller (if @a max is false) or larger of two integers.
+ */
+template<typename T>
+static T hostMinMax(bool max, T a, T b, std::true_type)
+{
+    return max ? std::max(a, b) : std::min(a, b);
+}
+
+/**
+ * Floating-point version of @ref hostMinMax. This uses @c fmin and @c fmax,
+ * which ignore a NaN operand, as the device compilers implement @c min and
+ * @c max for floating-point types.
+ */
+template<typename T>
+static T hostMinMax(bool max, T a, T b, std::false_type)
+{
+    return max ? std::fmax(a, b) : std::fmin(a, b);
+}
+
+/// @ref OPERATOR_MIN
+template<typename T>
+struct HostMin
+{
+    T identity() const { return hostLimit<T>(true, std::is_integral<T>()); }
+    T operator()(T a, T b) const { return hostMinMax(false, a, b, std::is_integral<T>()); }
+};
+
+/// @ref OPERATOR_MAX
+template<typename T>
+struct HostMax
+{
+    T identity() const { return hostLimit<T>(false, std::is_integral<T>()); }
+    T operator()(T a, T b) const { return hostMinMax(true, a, b, std::is_integral<T>()); }
+};
+
+/// @ref OPERATOR_AND
+template<typename T>
+struct HostAnd
+{
+    T identity() const { return T(~T(0)); }
+    T operator()(T a, T b) const { return T(a & b); }
+};
+
+/// @ref OPERATOR_OR
+template<typename T>
+struct HostOr
+{
+    T identity() const { return T(0); }
+    T operator()(T a, T b) const { return T(a | b); }
+};
+
+/// @ref OPERATOR_XOR
+template<typename T>
+struct HostXor
+{
+    T identity() const { return T(0); }
+    T operator()(T a, T b) const { return T(a ^ b); }
+};
+
+/**
+ * Calls @a visitor with the function object for @a op, for an integral
+ * element type @a T.
+ */
+template<typename T, typename Visitor>
+static void visitOperator(OperatorType op, const Visitor &visitor, std::true_type)
+{
+    switch (op)
+    {
+    case OPERATOR_SUM: visitor(HostSum<T>()); break;
+    case OPERATOR_MIN: visitor(HostMin<T>()); break;
+    case OPERATOR_MAX: visitor(HostMax<T>()); break;
+    case OPERATOR_AND: visitor(HostAnd<T>()); break;
+    case OPERATOR_OR:  visitor(HostOr<T>()); break;
+    case OPERATOR_XOR: visitor(HostXor<T>()); break;
+    }
+}
+
+/**
+ * Floating-point version of @ref visitOperator, which excludes the bitwise
+ * operators.
+ */
+template<typename T, typename Visitor>
+static void visitOperator(OperatorType op, const Visitor &visitor, std::false_type)
+{
+    switch (op)
+    {
+    case OPERATOR_SUM: visitor(HostSum<T>()); break;
+    case OPERATOR_MIN: visitor(HostMin<T>()); break;
+    case OPERATOR_MAX: visitor(HostMax<T>()); break;
+    default:
+        assert(false);
+    }
+}
+
+/**
+ * Reduce-then-scan over chunks: each chunk is reduced in parallel, the
+ * chunk totals are scanned serially, and then each chunk is scanned in
+ * parallel starting from its carry-in. For a segmented scan, the reduction
+ * of a chunk only covers the elements after its last head, and a chunk that
+ * contains a head does not propagate the carry-in.
+ */
+template<typename T>
+struct HostScanVisitor
+{
+    const T *in;
+    T *out;
+    ::size_t elements;
+    bool inclusive;
+    const T *offset;
+    const cl_uchar *flags;
+
+    template<typename Op>
+    void operator()(const Op &op) const
+    {
+        const ::size_t chunks = chunkCount(elements);
+        std::vector<T> carry(chunks, offset != NULL ? *offset : op.identity());
+        if (chunks > 1)
+        {
+            std::vector<T> sums(chunks);
+            std::vector<cl_uchar> heads(chunks);
+            parallelChunks(chunks, elements, [&](::size_t c, ::size_t begin, ::size_t end)
+            {
+                T sum = op.identity();
+                bool head = false;
+                for (::size_t i = begin; i < end; i++)
+                {
+                    if (flags != NULL && flags[i])
+                    {
+                        sum = op.identity();
+                        head = true;
+                    }
+                    sum = op(sum, in[i]);
+                }
+                sums[c] = sum;
+                heads[c] = head;
+            });
+            for (::size_t c = 1; c < chunks; c++)
+                carry[c] = heads[c - 1] ? sums[c - 1] : op(carry[c - 1], sums[c - 1]);
+        }
+
+        parallelChunks(chunks, elements, [&](::size_t c, ::size_t begin, ::size_t end)
+        {
+            T sum = carry[c];
+            if (flags != NULL)
+            {
+                for (::size_t i = begin; i < end; i++)
+                {
+                    const T x = in[i];
+                    if (flags[i])
+                        sum = op.identity();
+                    if (inclusive)
+                        sum = op(sum, x);
+                    out[i] = sum;
+                    if (!inclusive)
+                        sum = op(sum, x);
+                }
+            }
+            else if (inclusive)
+            {
+                for (::size_t i = begin; i < end; i++)
+                {
+                    sum = op(sum, in[i]);
+                    out[i] = sum;
+                }
+            }
+            else
+            {
+                for (::size_t i = begin; i < end; i++)
+                {
+                    const T x = in[i];
+                    out[i] = sum;
+                    sum = op(sum, x);
+                }
+            }
+        });
+    }
+};
+
+/**
+ * Reduces each chunk in parallel, then combines the results in order.
+ */
+template<typename T>
+struct HostReduceVisitor
+{
+    const T *in;
+    T *out;
+    ::size_t elements;
+
+    template<typename Op>
+    void operator()(const Op &op) const
+    {
+        const ::size_t chunks = chunkCount(elements);
+        std::vector<T> sums(chunks);
+        parallelChunks(chunks, elements, [&](::size_t c, ::size_t begin, ::size_t end)
+        {
+            T sum = op.identity();
+            for (::size_t i = begin; i < end; i++)
+                sum = op(sum, in[i]);
+            sums[c] = sum;
+        });
+        T sum = sums[0];
+        for (::size_t c = 1; c < chunks; c++)
+            sum = op(sum, sums[c]);
+        *out = sum;
+    }
+};
+
+template<typename T>
+static void scanTyped(
+    OperatorType op, bool inclusive,
+    const void *in, void *out, ::size_t elements,
+    const void *offset, const cl_uchar *flags)
+{
+    const HostScanVisitor<T> visitor =
+    {
+        static_cast<const T *>(in), static_cast<T *>(out), elements,
+        inclusive, static_cast<const T *>(offset), flags
+    };
+    visitOperator<T>(op, visitor, std::is_integral<T>());
+}
+
+template<typename T>
+static void reduceTyped(OperatorType op, const void *in, void *out, ::size_t elements)
+{
+    const HostReduceVisitor<T> visitor =
+    {
+        static_cast<const T *>(in), static_cast<T *>(out), elements
+    };
+    visitOperator<T>(op, visitor, std::is_integral<T>());
+}
+
+void hostScan(
+    const Type &type, OperatorType op, bool inclusive,
+    const void *in, void *out, ::size_t elements,
+    const void *offset, const cl_uchar *flags)
+{
+    assert(hostTypeSupported(type));
+    switch (type.getBaseType())
+    {
+    case TYPE_UCHAR:  scanTyped<cl_uchar>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_CHAR:   scanTyped<cl_char>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_USHORT: scanTyped<cl_ushort>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_SHORT:  scanTyped<cl_short>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_UINT:   scanTyped<cl_uint>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_INT:    scanTyped<cl_int>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_ULONG:  scanTyped<cl_ulong>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_LONG:   scanTyped<cl_long>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_FLOAT:  scanTyped<cl_float>(op, inclusive, in, out, elements, offset, flags); break;
+    case TYPE_DOUBLE: scanTyped<cl_double>(op, inclusive, in, out, elements, offset, flags); break;
+    default:
+        assert(false);
+    }
+}
+
+void hostReduce(
+    const Type &type, OperatorType op,
+    const void *in, void *out, ::size_t elements)
+{
+    assert(hostTypeSupported(type));
+    switch (type.getBaseType())
+    {
+    case TYPE_UCHAR:  reduceTyped<cl_uchar>(op, in, out, elements); break;
+    case TYPE_CHAR:   reduceTyped<cl_char>(op, in, out, elements); break;
+    case TYPE_USHORT: reduceTyped<cl_ushort>(op, in, out, elements); break;
+    case TYPE_SHORT:  reduceTyped<cl_short>(op, in, out, elements); break;
+    case TYPE_UINT:   reduceTyped<cl_uint>(op, in, out, elements); break;
+    case TYPE_INT:    reduceTyped<cl_int>(op, in, out, elements); break;
+    case TYPE_ULONG:  reduceTyped<cl_ulong>(op, in, out, elements); break;
+    case TYPE_LONG:   reduceTyped<cl_long>(op, in, out, elements); break;
+    case TYPE_FLOAT:  reduceTyped<cl_float>(op, in, out, elements); break;
+    case TYPE_DOUBLE: reduceTyped<cl_double>(op, in, out, elements); break;
+    default:
+        assert(false);
+    }
+}
+
+HostMapping::HostMapping(const cl::CommandQueue &queue, const VECTOR_CLASS<cl::Event> *events)
+    : queue(queue), events(events)
+{
+}
+
+HostMapping::~HostMapping()
+{
+    for (std::size_t i = 0; i < mapped.size(); i++)
+    {
+        try
+        {
+            std::vector<cl::Event> wait(1, ready);
+            queue.enqueueUnmapMemObject(mapped[i].first, mapped[i].second, &wait);
+        }
+        catch (cl::Error &)
+        {
+            // Nothing more can be done while unwinding
+        }
+    }
+}
+
+void *HostMapping::map(const cl::Buffer &buffer, cl_map_flags flags, ::size_t offset, ::size_t size)
+{
+    // Chain the maps, so that the last one completing implies that all have
+    std::vector<cl::Event> wait;
+    if (ready())
+        wait.assign(1, ready);
+    cl::Event event;
+    void *ptr = queue.enqueueMapBuffer(buffer, CL_FALSE, flags, offset, size,
+                                       ready() ? &wait : events, &event);
+    mapped.push_back(std::make_pair(buffer, ptr));
+    ready = event;
+    return ptr;
+}
+
+namespace
+{
+
+/// Host work waiting for the maps of a @ref HostMapping
+struct HostTask
+{
+    std::function<void()> work;
+    cl::UserEvent done;     ///< Signalled once @a work has run
+};
+
+} // anonymous namespace
+
+/**
+ * Runs the work of a @ref HostTask and signals its user event with the
+ * result, taking ownership of @a task.
+ */
+static void runHostTask(HostTask *task)
+{
+    cl_int status = CL_COMPLETE;
+    try
+    {
+        task->work();
+    }
+    catch (...)
+    {
+        status = CL_OUT_OF_HOST_MEMORY;
+    }
+    try
+    {
+        task->done.setStatus(status);
+    }
+    catch (cl::Error &)
+    {
+        // There is nobody to report this to
+    }
+    delete task;
+}
+
+/**
+ * Callback for the last map of a @ref HostMapping. Runtimes expect
+ * callbacks to return promptly, so the work is handed to the thread pool
+ * unless that is impossible.
+ */
+static void CL_CALLBACK hostTaskCallback(cl_event, cl_int status, void *data)
+{
+    HostTask *task = static_cast<HostTask *>(data);
+    if (status < 0)
+    {
+        // The maps failed, so the work cannot run
+        try
+        {
+            task->done.setStatus(status);
+        }
+        catch (cl::Error &)
+        {
+            // There is nobody to report this to
+        }
+        delete task;
+    }
+    else
+    {
+        bool posted = false;
+        try
+        {
+            posted = ThreadPool::get().post(std::bind(&runHostTask, task));
+        }
+        catch (std::exception &)
+        {
+            // Fall through to running it here
+        }
+        if (!posted)
+            runHostTask(task);
+    }
+}
+
+std::vector<cl::Event> HostMapping::enqueue(const std::function<void()> &work)
+{
+    assert(!mapped.empty());
+    const cl::UserEvent done(queue.getInfo<CL_QUEUE_CONTEXT>());
+    HostTask *task = new HostTask;
+    try
+    {
+        task->work = work;
+        task->done = done;
+        ready.setCallback(CL_COMPLETE, &hostTaskCallback, task);
+    }
+    catch (...)
+    {
+        delete task;
+        throw;
+    }
+    // The task now owns the mapped memory until it signals completion
+    ready = done;
+    queue.flush();   // so that the maps, and hence the work, start promptly
+
+    std::vector<cl::Event> unmapEvents;
+    std::vector<cl::Event> wait(1, ready);
+    while (!mapped.empty())
+    {
+        cl::Event unmapEvent;
+        queue.enqueueUnmapMemObject(mapped.front().first, mapped.front().second,
+                                    &wait, &unmapEvent);
+        mapped.erase(mapped.begin());
+        wait.assign(1, unmapEvent);
+        unmapEvents.push_back(unmapEvent);
+    }
+    return unmapEvents;
+}
+
+} // namespace detail
+} // namespace clogs
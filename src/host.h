@@ -0,0 +1,161 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Host implementations of sorting, scan and reduction, used by
+ * @ref clogs::BACKEND_HOST and @ref clogs::BACKEND_AUTO.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <utility>
+#include <boost/noncopyable.hpp>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+
+namespace clogs
+{
+namespace detail
+{
+
+/**
+ * Returns the largest problem size (in elements) that is run on the host
+ * for @a backend. This is zero for @ref BACKEND_DEVICE, or if the problem is
+ * not @a supported by the host implementation. For @ref BACKEND_AUTO it is
+ * @a crossover, the size measured during autotuning.
+ *
+ * @throw std::invalid_argument if @a backend is @ref BACKEND_HOST and the problem is not supported
+ */
+CLOGS_LOCAL ::size_t hostElements(Backend backend, bool supported, ::size_t crossover);
+
+/**
+ * Returns an estimate of the largest problem size (in elements) that is
+ * faster on the host than on @a device, for @ref BACKEND_AUTO before the
+ * crossover has been measured. @a discrete is the estimate for a GPU with its
+ * own memory, where the buffers have to be copied to map them. CPU devices
+ * and GPUs that share memory with the host avoid the copies, so the host
+ * remains faster up to larger sizes.
+ */
+CLOGS_LOCAL ::size_t defaultHostCrossover(const cl::Device &device, ::size_t discrete);
+
+/**
+ * Returns whether the host implementations of scan and reduction support
+ * elements of type @a type. Only scalar types other than @c half are
+ * supported.
+ */
+CLOGS_LOCAL bool hostTypeSupported(const Type &type);
+
+/**
+ * Sorts keys, and optionally values, in host memory. The sort is stable.
+ *
+ * @param keyType      Type of the keys (an unsigned integral scalar type)
+ * @param valueSize    Size of each value, or 0 if there are no values
+ * @param keys         Keys to sort in place
+ * @param values       Values to permute along with the keys, or @c NULL
+ * @param elements     Number of keys
+ * @param maxBits      Number of low-order bits of the keys to sort on
+ */
+CLOGS_LOCAL void hostRadixsort(
+    const Type &keyType, ::size_t valueSize,
+    void *keys, void *values, ::size_t elements, unsigned int maxBits);
+
+/**
+ * Scans an array in host memory. The input and output may be the same.
+ *
+ * @param type         Element type (see @ref hostTypeSupported)
+ * @param op           Operator to combine elements with
+ * @param inclusive    Whether the scan is inclusive
+ * @param in, out      Input and output arrays
+ * @param elements     Number of elements
+ * @param offset       Initial value to combine with all the results, or @c NULL
+ * @param flags        Head flags for a segmented scan, or @c NULL
+ */
+CLOGS_LOCAL void hostScan(
+    const Type &type, OperatorType op, bool inclusive,
+    const void *in, void *out, ::size_t elements,
+    const void *offset, const cl_uchar *flags);
+
+/**
+ * Reduces an array in host memory to a single element.
+ *
+ * @param type         Element type (see @ref hostTypeSupported)
+ * @param op           Operator to combine elements with
+ * @param in           Input array
+ * @param out          Output element
+ * @param elements     Number of elements (if zero, the identity is written)
+ */
+CLOGS_LOCAL void hostReduce(
+    const Type &type, OperatorType op,
+    const void *in, void *out, ::size_t elements);
+
+/**
+ * Maps buffers so that a host implementation can be run in place of the
+ * kernels, and unmaps them again afterwards. Nothing blocks: the maps wait
+ * for the events given to the constructor, the host work runs on a worker
+ * thread once they complete, and the unmaps wait for a user event that the
+ * worker signals. The caller may thus wait for the events after enqueuing.
+ */
+class CLOGS_LOCAL HostMapping : public boost::noncopyable
+{
+private:
+    cl::CommandQueue queue;
+    const VECTOR_CLASS<cl::Event> *events;
+    std::vector<std::pair<cl::Buffer, void *> > mapped;
+    cl::Event ready;        ///< Event that the next map or unmap must wait for
+
+public:
+    HostMapping(const cl::CommandQueue &queue, const VECTOR_CLASS<cl::Event> *events);
+
+    /// Unmaps any buffers that are still mapped (if an exception was thrown).
+    ~HostMapping();
+
+    /**
+     * Enqueues a map of a range of @a buffer. The returned pointer may only
+     * be dereferenced by the work passed to @ref enqueue. A buffer that is
+     * both read and written must be mapped once, with both flags.
+     */
+    void *map(const cl::Buffer &buffer, cl_map_flags flags, ::size_t offset, ::size_t size);
+
+    /**
+     * Arranges for @a work to run once all the maps have completed, and
+     * enqueues the unmapping of all the mapped buffers after it. Each unmap
+     * waits for the previous one, so the last of the returned events signals
+     * that all of them have completed. @a work must not refer to anything
+     * owned by the caller, since it may run after the caller has returned.
+     * If the maps fail or @a work throws, the unmaps fail as well.
+     */
+    std::vector<cl::Event> enqueue(const std::function<void()> &work);
+};
+
+} // namespace detail
+} // namespace clogs
+
+#endif /* HOST_H */
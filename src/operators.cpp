@@ -0,0 +1,211 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Binary operators for scan and reduction.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <string>
+#include <stdexcept>
+#include <cassert>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include "operators.h"
+
+namespace clogs
+{
+namespace detail
+{
+
+Operator::Operator() : custom(false), type(OPERATOR_SUM)
+{
+}
+
+Operator::Operator(OperatorType type) : custom(false), type(type)
+{
+    switch (type)
+    {
+    case OPERATOR_SUM:
+    case OPERATOR_MIN:
+    case OPERATOR_MAX:
+    case OPERATOR_AND:
+    case OPERATOR_OR:
+    case OPERATOR_XOR:
+        break;
+    default:
+        throw std::invalid_argument("unknown operator");
+    }
+}
+
+Operator::Operator(const std::string &expression, const std::string &identity)
+    : custom(true), type(OPERATOR_SUM), expression(expression), identity(identity)
+{
+    if (expression.empty() || identity.empty())
+        throw std::invalid_argument("operator expression and identity must not be empty");
+    if (expression.find_first_of("\r\n") != std::string::npos
+        || identity.find_first_of("\r\n") != std::string::npos)
+        throw std::invalid_argument("operator expression and identity must not contain newlines");
+}
+
+std::string Operator::getExpression(const Type &type) const
+{
+    if (custom)
+        return "(" + expression + ")";
+    // min and max are undefined for NaN, while fmin and fmax ignore it
+    const std::string prefix = type.isIntegral() ? "" : "f";
+    switch (this->type)
+    {
+    case OPERATOR_SUM: return "((a) + (b))";
+    case OPERATOR_MIN: return prefix + "min((a), (b))";
+    case OPERATOR_MAX: return prefix + "max((a), (b))";
+    case OPERATOR_AND: return "((a) & (b))";
+    case OPERATOR_OR:  return "((a) | (b))";
+    case OPERATOR_XOR: return "((a) ^ (b))";
+    }
+    assert(false);
+    return "";
+}
+
+/**
+ * Returns the OpenCL C name of the largest (if @a max) or smallest value of
+ * the scalar type @a baseType.
+ */
+static std::string limitValue(BaseType baseType, bool max)
+{
+    switch (baseType)
+    {
+    case TYPE_UCHAR:  return max ? "UCHAR_MAX" : "0";
+    case TYPE_CHAR:   return max ? "CHAR_MAX" : "CHAR_MIN";
+    case TYPE_USHORT: return max ? "USHRT_MAX" : "0";
+    case TYPE_SHORT:  return max ? "SHRT_MAX" : "SHRT_MIN";
+    case TYPE_UINT:   return max ? "UINT_MAX" : "0";
+    case TYPE_INT:    return max ? "INT_MAX" : "INT_MIN";
+    case TYPE_ULONG:  return max ? "ULONG_MAX" : "0";
+    case TYPE_LONG:   return max ? "LONG_MAX" : "LONG_MIN";
+    case TYPE_HALF:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+        return max ? "INFINITY" : "-INFINITY";
+    case TYPE_VOID:
+        break;
+    }
+    assert(false);
+    return "0";
+}
+
+std::string Operator::getIdentity(const Type &type) const
+{
+    std::string value;
+    if (custom)
+        value = identity;
+    else
+    {
+        switch (this->type)
+        {
+        case OPERATOR_SUM:
+        case OPERATOR_OR:
+        case OPERATOR_XOR:
+            value = "0";
+            break;
+        case OPERATOR_MIN:
+            value = limitValue(type.getBaseType(), true);
+            break;
+        case OPERATOR_MAX:
+            value = limitValue(type.getBaseType(), false);
+            break;
+        case OPERATOR_AND:
+            value = "-1";
+            break;
+        }
+    }
+    return "((" + type.getName() + ") (" + value + "))";
+}
+
+std::string Operator::getKey() const
+{
+    if (custom)
+        return "custom:" + expression + ":" + identity;
+    switch (type)
+    {
+    case OPERATOR_SUM: return "sum";
+    case OPERATOR_MIN: return "min";
+    case OPERATOR_MAX: return "max";
+    case OPERATOR_AND: return "and";
+    case OPERATOR_OR:  return "or";
+    case OPERATOR_XOR: return "xor";
+    }
+    assert(false);
+    return "";
+}
+
+bool Operator::typeSupported(const Type &type) const
+{
+    if (custom)
+        return true;
+    switch (this->type)
+    {
+    case OPERATOR_AND:
+    case OPERATOR_OR:
+    case OPERATOR_XOR:
+        return type.isIntegral();
+    default:
+        return true;
+    }
+}
+
+std::string Operator::getCollectiveName(const Type &type) const
+{
+    if (custom || type.getLength() != 1)
+        return "";
+    switch (type.getBaseType())
+    {
+    case TYPE_INT:
+    case TYPE_UINT:
+    case TYPE_LONG:
+    case TYPE_ULONG:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+        break;
+    default:
+        return "";
+    }
+    switch (this->type)
+    {
+    case OPERATOR_SUM: return "add";
+    // The built-ins follow min and max rather than fmin and fmax
+    case OPERATOR_MIN: return type.isIntegral() ? "min" : "";
+    case OPERATOR_MAX: return type.isIntegral() ? "max" : "";
+    default:           return "";
+    }
+}
+
+} // namespace detail
+} // namespace clogs
@@ -0,0 +1,118 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Binary operators for scan and reduction.
+ */
+
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <string>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+
+namespace clogs
+{
+namespace detail
+{
+
+/**
+ * Associative binary operator, either built-in or user-defined, that is
+ * injected into the scan and reduce kernels as an OpenCL C expression.
+ */
+class CLOGS_LOCAL Operator
+{
+private:
+    bool custom;                ///< True for a user-defined operator
+    OperatorType type;          ///< Built-in operator (if not custom)
+    std::string expression;     ///< User-defined expression in @c a and @c b
+    std::string identity;       ///< User-defined identity value
+
+public:
+    /// Default constructor, creating @ref OPERATOR_SUM.
+    Operator();
+
+    /// Construct a built-in operator.
+    explicit Operator(OperatorType type);
+
+    /**
+     * Construct a user-defined operator.
+     *
+     * @param expression   OpenCL C expression combining @c a and @c b
+     * @param identity     OpenCL C expression for the identity value
+     * @throw std::invalid_argument if either string is empty or contains a newline
+     */
+    Operator(const std::string &expression, const std::string &identity);
+
+    /// Whether this is the default (summation) operator
+    bool isSum() const { return !custom && type == OPERATOR_SUM; }
+
+    /// Whether this is a user-defined operator
+    bool isCustom() const { return custom; }
+
+    /// The built-in operator (only meaningful if not @ref isCustom)
+    OperatorType getType() const { return type; }
+
+    /**
+     * Returns an OpenCL C expression that combines @c a (the earlier value)
+     * with @c b (the later value), both of type @a type. Minimum and maximum
+     * of floating-point types use @c fmin and @c fmax, so that a NaN is
+     * ignored as it is by the host backend.
+     */
+    std::string getExpression(const Type &type) const;
+
+    /**
+     * Returns an OpenCL C expression for the identity element, converted
+     * to @a type.
+     */
+    std::string getIdentity(const Type &type) const;
+
+    /**
+     * Returns a string that uniquely describes the operator, for use in
+     * autotuning keys.
+     */
+    std::string getKey() const;
+
+    /**
+     * Returns whether the operator can be applied to @a type. User-defined
+     * operators are assumed to be valid for any type.
+     */
+    bool typeSupported(const Type &type) const;
+
+    /**
+     * Returns the suffix of the sub-group and work-group built-ins (such as
+     * @c sub_group_reduce_add or @c work_group_scan_exclusive_add) that apply
+     * the operator to @a type, or an empty string if there are none.
+     */
+    std::string getCollectiveName(const Type &type) const;
+};
+
+} // namespace detail
+} // namespace clogs
+
+#endif /* OPERATORS_H */
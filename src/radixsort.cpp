@@ -40,6 +40,8 @@
 #include <utility>
 #include <random>
 #include <functional>
+#include <chrono>
+#include <limits>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -49,6 +51,7 @@
 #include "parameters.h"
 #include "tune.h"
 #include "cache.h"
+#include "host.h"
 
 namespace clogs
 {
@@ -74,10 +77,15 @@ void RadixsortProblem::setTunePolicy(const TunePolicy &tunePolicy)
     this->tunePolicy = tunePolicy;
 }
 
+void RadixsortProblem::setBackend(Backend backend)
+{
+    this->backend = backend;
+}
+
 
 ::size_t Radixsort::getTileSize() const
 {
-    return std::max(reduceWorkGroupSize, scatterWorkScale * scatterWorkGroupSize);
+    return std::max(reduceWorkGroupSize * reduceElementsPerLoad, scatterWorkScale * scatterWorkGroupSize);
 }
 
 ::size_t Radixsort::getBlockSize(::size_t elements) const
@@ -198,6 +206,12 @@ void Radixsort::enqueue(
     else if (maxBits > CHAR_BIT * keySize)
         throw cl::Error(CL_INVALID_VALUE, "clogs::Radixsort::enqueue: maxBits is too large");
 
+    if (elements <= hostMaxElements)
+    {
+        enqueueHost(queue, keys, values, elements, maxBits, events, event);
+        return;
+    }
+
     const cl::Context &context = queue.getInfo<CL_QUEUE_CONTEXT>();
 
     // If necessary, allocate temporary buffers for ping-pong
@@ -270,28 +284,37 @@ void Radixsort::initialize(
     const RadixsortParameters::Value &params)
 {
     reduceWorkGroupSize = params.reduceWorkGroupSize;
+    reduceElementsPerLoad = params.reduceElementsPerLoad;
     scanWorkGroupSize = params.scanWorkGroupSize;
     scatterWorkGroupSize = params.scatterWorkGroupSize;
     scatterWorkScale = params.scatterWorkScale;
     scanBlocks = params.scanBlocks;
     keySize = problem.keyType.getSize();
     valueSize = problem.valueType.getSize();
+    keyType = problem.keyType;
+    hostMaxElements = 0;
     radixBits = params.radixBits;
 
     radix = 1U << radixBits;
-    scatterSlice = std::max(params.warpSizeSchedule, ::size_t(radix));
+    if (params.scatterSequential)
+        scatterSlice = 1;
+    else
+        scatterSlice = std::max(params.warpSizeSchedule, ::size_t(radix));
 
     std::map<std::string, int> defines;
     std::map<std::string, std::string> stringDefines;
     defines["WARP_SIZE_MEM"] = params.warpSizeMem;
     defines["WARP_SIZE_SCHEDULE"] = params.warpSizeSchedule;
     defines["REDUCE_WORK_GROUP_SIZE"] = reduceWorkGroupSize;
+    defines["REDUCE_ELEMENTS_PER_LOAD"] = reduceElementsPerLoad;
     defines["SCAN_WORK_GROUP_SIZE"] = scanWorkGroupSize;
     defines["SCATTER_WORK_GROUP_SIZE"] = scatterWorkGroupSize;
     defines["SCATTER_WORK_SCALE"] = scatterWorkScale;
     defines["SCATTER_SLICE"] = scatterSlice;
     defines["SCAN_BLOCKS"] = scanBlocks;
     defines["RADIX_BITS"] = radixBits;
+    defines["SCAN_WORK_GROUP_FUNCTIONS"] = params.workGroupFunctions ? 1 : 0;
+    defines["SCATTER_SEQUENTIAL"] = params.scatterSequential ? 1 : 0;
     stringDefines["KEY_T"] = problem.keyType.getName();
     if (problem.valueType.getBaseType() != TYPE_VOID)
     {
@@ -379,13 +402,23 @@ void Radixsort::initialize(
     for (int i = int(downsweepStmts.size()) - 1; i >= 0; i--)
         downsweep << downsweepStmts[i];
     downsweep << "} while (0)";
-    stringDefines["UPSWEEP()"] = upsweep.str();
-    stringDefines["DOWNSWEEP()"] = downsweep.str();
+    if (params.scatterSequential)
+    {
+        // The sequential scatter kernel does not use the slice-wide scans
+        stringDefines["UPSWEEP()"] = "do {} while (0)";
+        stringDefines["DOWNSWEEP()"] = "do {} while (0)";
+    }
+    else
+    {
+        stringDefines["UPSWEEP()"] = upsweep.str();
+        stringDefines["DOWNSWEEP()"] = downsweep.str();
+    }
 
     try
     {
         histogram = cl::Buffer(context, CL_MEM_READ_WRITE, params.scanBlocks * radix * sizeof(cl_uint));
-        program = build(context, device, "radixsort.cl", defines, stringDefines);
+        const std::string options = params.workGroupFunctions ? getLanguageBuildOptions(device) : "";
+        program = build(context, device, "radixsort.cl", defines, stringDefines, options);
 
         reduceKernel = cl::Kernel(program, "radixsortReduce");
 
@@ -417,15 +450,30 @@ Radixsort::Radixsort(
         throw std::invalid_argument("keyType is not valid");
     if (!valueTypeSupported(device, problem.valueType))
         throw std::invalid_argument("valueType is not valid");
+    // Check the backend before spending time on tuning
+    const bool host = hostSupported(problem);
+    hostElements(problem.backend, host, 0);
 
     RadixsortParameters::Key key = makeKey(device, problem);
     RadixsortParameters::Value params;
     if (!getDB().radixsort.lookup(key, params))
     {
-        params = tune(device, problem);
-        getDB().radixsort.add(key, params);
+        if (problem.tunePolicy.isBackground() || problem.tunePolicy.isFallback())
+        {
+            params = defaultParameters(device, problem);
+            if (problem.tunePolicy.isBackground())
+                BackgroundTuner::get().start<RadixsortParameters::Key, RadixsortParameters::Value>(
+                    getDB().radixsort, key, problem.tunePolicy,
+                    std::bind(&Radixsort::tune, device, problem));
+        }
+        else
+        {
+            params = tune(device, problem);
+            getDB().radixsort.add(key, params);
+        }
     }
     initialize(context, device, problem, params);
+    hostMaxElements = hostElements(problem.backend, host, params.hostCrossover);
 }
 
 RadixsortParameters::Key Radixsort::makeKey(
@@ -454,6 +502,51 @@ bool Radixsort::valueTypeSupported(const cl::Device &device, const Type &valueTy
         || valueType.isStorable(device);
 }
 
+bool Radixsort::hostSupported(const RadixsortProblem &problem)
+{
+    return problem.keyType.isIntegral()
+        && !problem.keyType.isSigned()
+        && problem.keyType.getLength() == 1;
+}
+
+void Radixsort::sortHost(
+    const RadixsortProblem &problem,
+    void *keys, void *values,
+    ::size_t elements, unsigned int maxBits)
+{
+    if (!hostSupported(problem))
+        throw std::invalid_argument("problem is not supported by the host backend");
+    const unsigned int keyBits = CHAR_BIT * problem.keyType.getSize();
+    if (maxBits == 0)
+        maxBits = keyBits;
+    else if (maxBits > keyBits)
+        throw std::invalid_argument("maxBits is too large");
+    hostRadixsort(problem.keyType, problem.valueType.getSize(), keys, values, elements, maxBits);
+}
+
+void Radixsort::enqueueHost(
+    const cl::CommandQueue &queue,
+    const cl::Buffer &keys, const cl::Buffer &values,
+    ::size_t elements, unsigned int maxBits,
+    const VECTOR_CLASS<cl::Event> *events, cl::Event *event)
+{
+    HostMapping mapping(queue, events);
+    void *keysPtr = mapping.map(keys, CL_MAP_READ | CL_MAP_WRITE, 0, elements * keySize);
+    void *valuesPtr = NULL;
+    if (valueSize != 0)
+        valuesPtr = mapping.map(values, CL_MAP_READ | CL_MAP_WRITE, 0, elements * valueSize);
+
+    // The work runs later, so it must not use *this
+    const Type type = keyType;
+    const ::size_t valueBytes = valueSize;
+    const std::vector<cl::Event> unmapEvents = mapping.enqueue(
+        [=] { hostRadixsort(type, valueBytes, keysPtr, valuesPtr, elements, maxBits); });
+    for (const cl::Event &unmapEvent : unmapEvents)
+        doEventCallback(unmapEvent);
+    if (event != NULL)
+        *event = unmapEvents.back();
+}
+
 static cl::Buffer makeRandomBuffer(const cl::CommandQueue &queue, ::size_t size)
 {
     cl::Buffer buffer(queue.getInfo<CL_QUEUE_CONTEXT>(), CL_MEM_READ_WRITE, size);
@@ -599,6 +692,94 @@ std::pair<double, double> Radixsort::tuneBlocksCallback(
     return std::make_pair(rate, rate * 1.05);
 }
 
+std::pair<double, double> Radixsort::tuneHostCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const RadixsortParameters::Value &params,
+    const RadixsortProblem &problem)
+{
+    cl::CommandQueue queue(context, device);
+    const cl::Buffer keyBuffer = makeRandomBuffer(queue, elements * problem.keyType.getSize());
+    cl::Buffer valueBuffer;
+    if (problem.valueType.getBaseType() != TYPE_VOID)
+        valueBuffer = makeRandomBuffer(queue, elements * problem.valueType.getSize());
+
+    Radixsort sort(context, device, problem, params);
+    double elapsed[2];
+    for (int host = 0; host < 2; host++)
+    {
+        sort.hostMaxElements = host ? std::numeric_limits< ::size_t>::max() : 0;
+        /* Warmup and timing passes. The time is measured on the host, since
+         * the overheads of launching kernels and of mapping buffers are what
+         * is being compared.
+         */
+        for (int pass = 0; pass < 2; pass++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            sort.enqueue(queue, keyBuffer, valueBuffer, elements);
+            queue.finish();
+            elapsed[host] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    return std::make_pair(elapsed[0], elapsed[1]);
+}
+
+RadixsortParameters::Value Radixsort::defaultParameters(
+    const cl::Device &device,
+    const RadixsortProblem &problem)
+{
+    // Limits are as for tune
+    const unsigned int radixBits = 4;
+    const ::size_t radix = ::size_t(1) << radixBits;
+    const ::size_t localMemSize = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+    const ::size_t maxWorkGroupSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const ::size_t computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    const ::size_t scanWorkGroupSize = 4 * radix;
+    const ::size_t startBlocks = roundDown(
+        (localMemSize / sizeof(cl_uint) - 2 * scanWorkGroupSize) / radix / 2,
+        scanWorkGroupSize / radix);
+    const ::size_t warpSizeSchedule = getWarpSizeSchedule(device);
+
+    RadixsortParameters::Value params;
+    params.radixBits = radixBits;
+    params.warpSizeMem = getWarpSizeMem(device);
+    params.warpSizeSchedule = warpSizeSchedule;
+    // The reduce kernel keeps a histogram per work-item, so leave room for it
+    params.reduceWorkGroupSize = std::max(radix, getDefaultWorkGroupSize(
+        device, std::min(maxWorkGroupSize, localMemSize / (2 * radix * sizeof(cl_uint)))));
+    // Load 16 bytes at a time, which is a full vector on most devices
+    params.reduceElementsPerLoad = std::max(::size_t(1), 16 / problem.keyType.getSize());
+    params.scanWorkGroupSize = scanWorkGroupSize;
+    params.workGroupFunctions = 0;
+    if (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
+    {
+        // Scatter each block with one work-item, with a few blocks per core
+        params.scatterWorkGroupSize = 1;
+        params.scatterWorkScale = 1;
+        params.scatterSequential = 1;
+        params.scanBlocks = std::min(startBlocks, 4 * computeUnits);
+    }
+    else
+    {
+        /* A few slices per scatter work group, and enough blocks to keep
+         * every compute unit busy.
+         */
+        const ::size_t scatterSlice = std::max(warpSizeSchedule, radix);
+        params.scatterWorkGroupSize = std::max(scatterSlice, roundDownPower2(
+            std::min(maxWorkGroupSize, 4 * scatterSlice)));
+        params.scatterWorkScale = 1;
+        params.scatterSequential = 0;
+        params.scanBlocks = std::min(startBlocks, 16 * computeUnits);
+    }
+    // Both the scan and the scatter work groups have to divide the blocks evenly
+    const ::size_t slicesPerWorkGroup = params.scatterSequential
+        ? params.scatterWorkGroupSize
+        : params.scatterWorkGroupSize / std::max(warpSizeSchedule, radix);
+    const ::size_t blockMultiple = std::max(slicesPerWorkGroup, scanWorkGroupSize / radix);
+    params.scanBlocks = std::max(blockMultiple, roundDown(params.scanBlocks, blockMultiple));
+    params.hostCrossover = hostSupported(problem) ? defaultHostCrossover(device, 65536) : 0;
+    return params;
+}
+
 RadixsortParameters::Value Radixsort::tune(
     const cl::Device &device,
     const RadixsortProblem &problem)
@@ -655,6 +836,10 @@ RadixsortParameters::Value Radixsort::tune(
         cand.scanWorkGroupSize = scanWorkGroupSize;
         cand.scatterWorkGroupSize = scatterSlice;
         cand.scatterWorkScale = 1;
+        cand.reduceElementsPerLoad = 1;
+        cand.workGroupFunctions = 0;
+        cand.scatterSequential = 0;
+        cand.hostCrossover = 0;
 
         // Tune the reduction kernel, assuming a large scanBlocks
         {
@@ -671,6 +856,22 @@ RadixsortParameters::Value Radixsort::tune(
                 std::bind(&Radixsort::tuneReduceCallback, _1, _2, _3, _4, problem)));
         }
 
+        // Tune the number of keys per vector load in the reduction kernel
+        {
+            std::vector<boost::any> sets;
+            const ::size_t keySize = problem.keyType.getSize();
+            for (::size_t perLoad = 1; perLoad <= 16 && perLoad * keySize <= 64; perLoad *= 2)
+            {
+                RadixsortParameters::Value params = cand;
+                params.reduceElementsPerLoad = perLoad;
+                sets.push_back(params);
+            }
+            using namespace std::placeholders;
+            cand = boost::any_cast<RadixsortParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Radixsort::tuneReduceCallback, _1, _2, _3, _4, problem)));
+        }
+
         // Tune the scatter kernel
         {
             std::vector<boost::any> sets;
@@ -693,16 +894,42 @@ RadixsortParameters::Value Radixsort::tune(
                 std::bind(&Radixsort::tuneScatterCallback, _1, _2, _3, _4, problem)));
         }
 
+        /* CPU runtimes run the work-items of a group as a loop, which every
+         * barrier in the scatter kernel has to split. Try scattering each
+         * block with a single work-item, which is only used if it is faster.
+         */
+        if (isCPU)
+        {
+            std::vector<boost::any> sets;
+            sets.push_back(cand);
+            for (::size_t scatterWorkGroupSize = 1;
+                 scatterWorkGroupSize <= std::min(maxWorkGroupSize, startBlocks);
+                 scatterWorkGroupSize *= 2)
+            {
+                RadixsortParameters::Value params = cand;
+                params.scanBlocks = roundDown(startBlocks, scatterWorkGroupSize);
+                params.scatterWorkGroupSize = scatterWorkGroupSize;
+                params.scatterWorkScale = 1;
+                params.scatterSequential = 1;
+                sets.push_back(params);
+            }
+            using namespace std::placeholders;
+            cand = boost::any_cast<RadixsortParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Radixsort::tuneScatterCallback, _1, _2, _3, _4, problem)));
+        }
+
         // Tune the block count
         {
             std::vector<boost::any> sets;
 
             ::size_t scanWorkGroupSize = cand.scanWorkGroupSize;
             ::size_t scatterWorkGroupSize = cand.scatterWorkGroupSize;
-            const ::size_t slicesPerWorkGroup = scatterWorkGroupSize / scatterSlice;
+            const ::size_t slicesPerWorkGroup = cand.scatterSequential
+                ? scatterWorkGroupSize : scatterWorkGroupSize / scatterSlice;
             // Have to reduce the maximum to align with slicesPerWorkGroup, which was 1 earlier
             maxBlocks = roundDown(maxBlocks, slicesPerWorkGroup);
-            maxBlocks = roundDown(maxBlocks, scatterWorkGroupSize / radix);
+            maxBlocks = roundDown(maxBlocks, std::max(scatterWorkGroupSize / radix, ::size_t(1)));
             std::set< ::size_t> scanBlockCands;
             for (::size_t scanBlocks = std::max(scanWorkGroupSize / radix, slicesPerWorkGroup); scanBlocks <= maxBlocks; scanBlocks *= 2)
             {
@@ -735,10 +962,38 @@ RadixsortParameters::Value Radixsort::tune(
                 std::bind(&Radixsort::tuneBlocksCallback, _1, _2, _3, _4, problem)));
         }
 
+        // Choose whether to use the OpenCL 2.0 work-group built-ins in the scan kernel
+        if (workGroupFunctionsSupported(device))
+        {
+            std::vector<boost::any> sets;
+            for (::size_t workGroupFunctions = 0; workGroupFunctions <= 1; workGroupFunctions++)
+            {
+                RadixsortParameters::Value params = cand;
+                params.workGroupFunctions = workGroupFunctions;
+                sets.push_back(params);
+            }
+            using namespace std::placeholders;
+            cand = boost::any_cast<RadixsortParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Radixsort::tuneBlocksCallback, _1, _2, _3, _4, problem)));
+        }
+
         // TODO: benchmark the whole combination
         out = cand;
     }
 
+    /* Find the problem size below which BACKEND_AUTO sorts on the host. The
+     * host is only expected to win for small problems, so there is no point
+     * measuring large ones.
+     */
+    if (hostSupported(problem))
+    {
+        using namespace std::placeholders;
+        out.hostCrossover = tuneHostCrossover(
+            policy, device, hostCrossoverSizes(std::min(elements, ::size_t(4 * 1024 * 1024))),
+            std::bind(&Radixsort::tuneHostCallback, _1, _2, _3, out, problem));
+    }
+
     policy.logEndAlgorithm();
     return out;
 }
@@ -793,6 +1048,12 @@ void RadixsortProblem::setTunePolicy(const TunePolicy &tunePolicy)
     detail_->setTunePolicy(detail::getDetail(tunePolicy));
 }
 
+void RadixsortProblem::setBackend(Backend backend)
+{
+    assert(detail_ != NULL);
+    detail_->setBackend(backend);
+}
+
 
 Radixsort::Radixsort()
 {
@@ -888,4 +1149,11 @@ void swap(Radixsort &a, Radixsort &b)
     a.swap(b);
 }
 
+void hostRadixsort(const RadixsortProblem &problem,
+                   void *keys, void *values,
+                   ::size_t elements, unsigned int maxBits)
+{
+    detail::Radixsort::sortHost(detail::getDetail(problem), keys, values, elements, maxBits);
+}
+
 } // namespace clogs
@@ -60,11 +60,15 @@ private:
     Type keyType;
     Type valueType;
     TunePolicy tunePolicy;
+    Backend backend;
 
 public:
+    RadixsortProblem() : backend(BACKEND_DEVICE) {}
+
     void setKeyType(const Type &keyType);
     void setValueType(const Type &valueType);
     void setTunePolicy(const TunePolicy &tunePolicy);
+    void setBackend(Backend backend);
 };
 
 /**
@@ -76,6 +80,7 @@ class CLOGS_LOCAL Radixsort : public Algorithm
     friend class ::TestRadixsort;
 private:
     ::size_t reduceWorkGroupSize;    ///< Work group size for the initial reduce phase
+    ::size_t reduceElementsPerLoad;  ///< Keys per vector load in the initial reduce phase
     ::size_t scanWorkGroupSize;      ///< Work group size for the middle scan phase
     ::size_t scatterWorkGroupSize;   ///< Work group size for the final scatter phase
     ::size_t scatterWorkScale;       ///< Elements per work item for the final scan/scatter phase
@@ -85,6 +90,8 @@ private:
     ::size_t valueSize;              ///< Size of the value type
     unsigned int radix;              ///< Sort radix
     unsigned int radixBits;          ///< Number of bits forming radix
+    Type keyType;                    ///< Type of the keys (for the host backend)
+    ::size_t hostMaxElements;        ///< Sorts of at most this many elements run on the host
     cl::Program program;             ///< Program containing the kernels
     cl::Kernel reduceKernel;         ///< Initial reduction kernel
     cl::Kernel scanKernel;           ///< Middle-phase scan kernel
@@ -94,6 +101,16 @@ private:
     cl::Buffer tmpValues;            ///< User-provided buffer to hold temporary values
 
     ::size_t getTileSize() const;
+
+    /**
+     * Sort on the host instead of the device, by mapping the buffers.
+     * @see @ref enqueue
+     */
+    void enqueueHost(
+        const cl::CommandQueue &queue,
+        const cl::Buffer &keys, const cl::Buffer &values,
+        ::size_t elements, unsigned int maxBits,
+        const VECTOR_CLASS<cl::Event> *events, cl::Event *event);
     ::size_t getBlockSize(::size_t elements) const;
     ::size_t getBlocks(::size_t elements, ::size_t len) const;
 
@@ -181,6 +198,16 @@ private:
         std::size_t elements, const boost::any &params,
         const RadixsortProblem &problem);
 
+    /**
+     * Times a sort on the device and with the host backend, returning the
+     * two times in that order.
+     * @see @ref tuneHostCrossover
+     */
+    static std::pair<double, double> tuneHostCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const RadixsortParameters::Value &params,
+        const RadixsortProblem &problem);
+
     /**
      * Returns key for looking up autotuning parameters.
      *
@@ -188,6 +215,17 @@ private:
      */
     static RadixsortParameters::Key makeKey(const cl::Device &device, const RadixsortProblem &problem);
 
+    /**
+     * Returns parameters estimated from the properties of @a device, for
+     * use while tuning runs in the background or in place of tuning when it
+     * is disabled (see @ref TunePolicy::isFallback).
+     *
+     * @param device, problem Constructor parameters
+     */
+    static RadixsortParameters::Value defaultParameters(
+        const cl::Device &device,
+        const RadixsortProblem &problem);
+
     /**
      * Perform autotuning.
      *
@@ -229,6 +267,19 @@ public:
      * Return whether a type is supported as a value type on a device.
      */
     static bool valueTypeSupported(const cl::Device &device, const Type &valueType);
+
+    /**
+     * Return whether a problem is supported by the host backend.
+     */
+    static bool hostSupported(const RadixsortProblem &problem);
+
+    /**
+     * Sort keys and values in host memory.
+     * @see @ref clogs::hostRadixsort.
+     */
+    static void sortHost(const RadixsortProblem &problem,
+                         void *keys, void *values,
+                         ::size_t elements, unsigned int maxBits);
 };
 
 } // namespace detail
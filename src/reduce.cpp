@@ -45,6 +45,8 @@
 #include <vector>
 #include <algorithm>
 #include <utility>
+#include <limits>
+#include <chrono>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -54,6 +56,7 @@
 #include "parameters.h"
 #include "tune.h"
 #include "cache.h"
+#include "host.h"
 
 namespace clogs
 {
@@ -68,11 +71,71 @@ void ReduceProblem::setType(const Type &type)
     this->type = type;
 }
 
+void ReduceProblem::setInputType(const Type &inputType)
+{
+    this->inputType = inputType;
+}
+
+void ReduceProblem::setTransform(const std::string &transform)
+{
+    if (transform.find_first_of("\r\n") != std::string::npos)
+        throw std::invalid_argument("transform must not contain newlines");
+    this->transform = transform;
+}
+
+void ReduceProblem::setBinary(bool binary)
+{
+    this->binary = binary;
+}
+
+void ReduceProblem::setStatistics(unsigned int statistics)
+{
+    const unsigned int all = REDUCE_STATISTIC_SUM | REDUCE_STATISTIC_MIN
+        | REDUCE_STATISTIC_MAX | REDUCE_STATISTIC_SUM_SQUARES;
+    if (statistics & ~all)
+        throw std::invalid_argument("unknown statistic");
+    this->statistics = statistics;
+}
+
+void ReduceProblem::setReproducible(bool reproducible)
+{
+    this->reproducible = reproducible;
+}
+
+void ReduceProblem::setIndex(ReduceIndex index)
+{
+    switch (index)
+    {
+    case REDUCE_INDEX_NONE:
+    case REDUCE_INDEX_ARGMIN:
+    case REDUCE_INDEX_ARGMAX:
+        break;
+    default:
+        throw std::invalid_argument("unknown index mode");
+    }
+    this->index = index;
+}
+
+void ReduceProblem::setOperator(OperatorType op)
+{
+    this->op = Operator(op);
+}
+
+void ReduceProblem::setCustomOperator(const std::string &expression, const std::string &identity)
+{
+    this->op = Operator(expression, identity);
+}
+
 void ReduceProblem::setTunePolicy(const TunePolicy &tunePolicy)
 {
     this->tunePolicy = tunePolicy;
 }
 
+void ReduceProblem::setBackend(Backend backend)
+{
+    this->backend = backend;
+}
+
 
 void Reduce::initialize(
     const cl::Context &context, const cl::Device &device,
@@ -81,30 +144,111 @@ void Reduce::initialize(
 {
     reduceWorkGroupSize = params.reduceWorkGroupSize;
     reduceBlocks = params.reduceBlocks;
+    reduceLeafSize = params.reduceLeafSize;
+    reduceElementsPerLoad = params.reduceElementsPerLoad;
     elementSize = problem.type.getSize();
+    const Type inType = inputType(problem);
+    inputElementSize = inType.getSize();
+    binary = problem.binary;
+    indexed = problem.index != REDUCE_INDEX_NONE;
+    reproducible = problem.reproducible;
+    elementType = problem.type;
+    hostOperator = problem.op.getType();
+    hostMaxElements = 0;
+    outputs = numOutputs(problem);
+    accumulatorSize = getAccumulatorSize(problem);
 
     std::map<std::string, int> defines;
     std::map<std::string, std::string> stringDefines;
-    if (problem.type.getBaseType() == TYPE_HALF)
+    if (problem.type.getBaseType() == TYPE_HALF || inType.getBaseType() == TYPE_HALF)
         defines["ENABLE_KHR_FP16"] = 1;
-    if (problem.type.getBaseType() == TYPE_DOUBLE)
+    if (problem.type.getBaseType() == TYPE_DOUBLE || inType.getBaseType() == TYPE_DOUBLE)
         defines["ENABLE_KHR_FP64"] = 1;
     defines["REDUCE_WORK_GROUP_SIZE"] = reduceWorkGroupSize;
     defines["REDUCE_BLOCKS"] = reduceBlocks;
+    defines["REDUCE_BINARY"] = problem.binary ? 1 : 0;
+    defines["REDUCE_STATISTICS"] = problem.statistics;
+    defines["REDUCE_INDEX"] = problem.index;
+    defines["REDUCE_REPRODUCIBLE"] = problem.reproducible ? 1 : 0;
+    defines["REDUCE_LEAF_SIZE"] = reduceLeafSize;
+    defines["REDUCE_ELEMENTS_PER_LOAD"] = reduceElementsPerLoad;
+    if (problem.statistics || indexed)
+    {
+        stringDefines["REDUCE_MIN_IDENTITY"] = Operator(OPERATOR_MIN).getIdentity(problem.type);
+        stringDefines["REDUCE_MAX_IDENTITY"] = Operator(OPERATOR_MAX).getIdentity(problem.type);
+    }
     stringDefines["REDUCE_T"] = problem.type.getName();
+    const std::string convert = "convert_" + problem.type.getName();
+    std::string transform = problem.transform;
+    if (inType.getName() != problem.type.getName())
+    {
+        stringDefines["REDUCE_IN_T"] = inType.getName();
+        if (transform.empty())
+            transform = problem.binary ? convert + "(x) * " + convert + "(y)" : "x";
+    }
+    if (!transform.empty())
+    {
+        const std::string macro = problem.binary ? "REDUCE_TRANSFORM(x, y)" : "REDUCE_TRANSFORM(x)";
+        stringDefines[macro] = convert + "(" + transform + ")";
+    }
+    if (!problem.op.isSum())
+    {
+        stringDefines["REDUCE_OP(a, b)"] = problem.op.getExpression(problem.type);
+        stringDefines["REDUCE_IDENTITY"] = problem.op.getIdentity(problem.type);
+    }
+    std::string options;
+    if (params.subgroups)
+    {
+        if (getSubgroupExtension(device) == "cl_intel_subgroups")
+            defines["ENABLE_INTEL_SUBGROUPS"] = 1;
+        else
+            defines["ENABLE_KHR_SUBGROUPS"] = 1;
+        defines["REDUCE_SUBGROUPS"] = 1;
+        stringDefines["REDUCE_COLLECTIVE_OP"] = problem.op.getCollectiveName(problem.type);
+        options = getSubgroupBuildOptions(device);
+    }
+    else if (params.workGroupFunctions)
+    {
+        defines["REDUCE_WORK_GROUP_FUNCTIONS"] = 1;
+        stringDefines["REDUCE_COLLECTIVE_OP"] = problem.op.getCollectiveName(problem.type);
+        options = getLanguageBuildOptions(device);
+    }
 
     try
     {
-        cl_uint wgcInit = reduceBlocks;
+        /* The first counter is for the whole kernel, followed by one per
+         * cluster of the final combine tree (see REDUCE_FAN_IN in reduce.cl).
+         */
+        const ::size_t fanIn = std::max(reduceWorkGroupSize, ::size_t(2));
+        std::vector<cl_uint> wgcInit(1, reduceBlocks);
+        for (::size_t count = reduceBlocks; count > 1; count = (count + fanIn - 1) / fanIn)
+            for (::size_t first = 0; first < count; first += fanIn)
+                wgcInit.push_back(std::min(fanIn, count - first));
         // The extra element is used for storing the final reduction to be read back
-        sums = cl::Buffer(context, CL_MEM_READ_WRITE, (reduceBlocks + 1) * elementSize);
-        wgc = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &wgcInit);
+        sums = cl::Buffer(context, CL_MEM_READ_WRITE, (reduceBlocks + 1) * accumulatorSize);
+        wgc = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                         wgcInit.size() * sizeof(cl_uint), &wgcInit[0]);
+        if (indexed)
+            indexSum = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint));
 
-        program = build(context, device, "reduce.cl", defines, stringDefines);
+        program = build(context, device, "reduce.cl", defines, stringDefines, options);
 
         reduceKernel = cl::Kernel(program, "reduce");
         reduceKernel.setArg(0, wgc);
         reduceKernel.setArg(6, sums);
+
+        if (!binary && !indexed)
+        {
+            // Two partial results per block, for the segments shared with neighbours
+            segmentSums = cl::Buffer(context, CL_MEM_READ_WRITE, 2 * reduceBlocks * accumulatorSize);
+            segmentIds = cl::Buffer(context, CL_MEM_READ_WRITE, 2 * reduceBlocks * sizeof(cl_uint));
+            segmentedKernel = cl::Kernel(program, "reduceSegmented");
+            segmentedKernel.setArg(0, wgc);
+            segmentedKernel.setArg(8, segmentSums);
+            segmentedKernel.setArg(9, segmentIds);
+            columnsKernel = cl::Kernel(program, "reduceColumns");
+            columnsKernel.setArg(0, wgc);
+        }
     }
     catch (cl::Error &e)
     {
@@ -118,33 +262,90 @@ std::pair<double, double> Reduce::tuneReduceCallback(
     const ReduceProblem &problem)
 {
     const ReduceParameters::Value &params = boost::any_cast<const ReduceParameters::Value &>(paramsAny);
-    const ::size_t reduceWorkGroupSize = params.reduceWorkGroupSize;
-    const ::size_t reduceBlocks = params.reduceBlocks;
     const ::size_t elementSize = problem.type.getSize();
-    const ::size_t allocSize = elements * elementSize;
+    const ::size_t allocSize = elements * inputType(problem).getSize();
     cl::Buffer buffer(context, CL_MEM_READ_ONLY, allocSize);
-    cl::Buffer output(context, CL_MEM_WRITE_ONLY, elementSize);
+    cl::Buffer buffer2;
+    if (problem.binary)
+        buffer2 = cl::Buffer(context, CL_MEM_READ_ONLY, allocSize);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, numOutputs(problem) * elementSize);
+    cl::Buffer indexOutput;
+    if (problem.index != REDUCE_INDEX_NONE)
+        indexOutput = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(cl_uint));
     cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
     cl::Event event;
 
-    ::size_t blockSize = roundUp(elements, reduceWorkGroupSize * reduceBlocks) / reduceBlocks;
-
     Reduce reduce(context, device, problem, params);
+    const cl::Buffer *in2 = problem.binary ? &buffer2 : NULL;
+    const cl::Buffer *index = problem.index != REDUCE_INDEX_NONE ? &indexOutput : NULL;
     // Warmup pass
-    reduce.enqueue(queue, buffer, output, 0, elements, 0);
+    reduce.enqueueInternal(queue, buffer, in2, output, index, 0, elements, 0, 0, NULL, NULL);
     queue.finish();
     // Timing pass
-    reduce.enqueue(queue, buffer, output, 0, elements, 0, NULL, &event);
+    reduce.enqueueInternal(queue, buffer, in2, output, index, 0, elements, 0, 0, NULL, &event);
     queue.finish();
 
     event.wait();
     cl_ulong start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
     cl_ulong end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
     double elapsed = end - start;
-    double rate = reduceBlocks * blockSize / elapsed;
+    double rate = elements / elapsed;
     return std::make_pair(rate, rate * 1.05);
 }
 
+std::pair<double, double> Reduce::tuneHostCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const ReduceParameters::Value &params,
+    const ReduceProblem &problem)
+{
+    const ::size_t elementSize = problem.type.getSize();
+    cl::Buffer buffer(context, CL_MEM_READ_ONLY, elements * elementSize);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, elementSize);
+    cl::CommandQueue queue(context, device);
+
+    Reduce reduce(context, device, problem, params);
+    double elapsed[2];
+    for (int host = 0; host < 2; host++)
+    {
+        reduce.hostMaxElements = host ? std::numeric_limits< ::size_t>::max() : 0;
+        // Warmup and timing passes, timed on the host to include all overheads
+        for (int pass = 0; pass < 2; pass++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            reduce.enqueueInternal(queue, buffer, NULL, output, NULL, 0, elements, 0, 0, NULL, NULL);
+            queue.finish();
+            elapsed[host] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    return std::make_pair(elapsed[0], elapsed[1]);
+}
+
+ReduceParameters::Value Reduce::defaultParameters(
+    const cl::Device &device, const ReduceProblem &problem)
+{
+    // Limits are as for tune
+    const ::size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / getAccumulatorSize(problem);
+    const ::size_t maxWorkGroupSize = std::min(device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(), localMemElements);
+    const ::size_t computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    const bool isCPU = device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU;
+
+    ReduceParameters::Value params;
+    params.reduceWorkGroupSize = getDefaultWorkGroupSize(device, maxWorkGroupSize);
+    // GPUs need several groups per compute unit to hide memory latency
+    params.reduceBlocks = (isCPU ? 4 : 16) * computeUnits;
+    params.reduceLeafSize = 1;
+    params.reduceElementsPerLoad = 1;
+    if (!problem.reproducible && inputType(problem).getLength() == 1)
+    {
+        // Load 16 bytes at a time, which is a full vector on most devices
+        params.reduceElementsPerLoad = std::max(::size_t(1), 16 / inputType(problem).getSize());
+    }
+    params.subgroups = 0;
+    params.workGroupFunctions = 0;
+    params.hostCrossover = hostSupported(problem) ? defaultHostCrossover(device, 16384) : 0;
+    return params;
+}
+
 ReduceParameters::Value Reduce::tune(
     const cl::Device &device, const ReduceProblem &problem)
 {
@@ -152,20 +353,43 @@ ReduceParameters::Value Reduce::tune(
     policy.assertEnabled();
     std::ostringstream description;
     description << "reduce for " << problem.type.getName() << " elements";
+    if (inputType(problem).getName() != problem.type.getName())
+        description << " from " << inputType(problem).getName() << " input";
+    if (problem.binary)
+        description << " of two inputs";
+    if (!problem.transform.empty())
+        description << " with transform " << problem.transform;
+    if (!problem.op.isSum())
+        description << " with operator " << problem.op.getKey();
+    if (problem.statistics)
+        description << " with statistics " << problem.statistics;
+    if (problem.index == REDUCE_INDEX_ARGMIN)
+        description << " with argmin";
+    else if (problem.index == REDUCE_INDEX_ARGMAX)
+        description << " with argmax";
+    if (problem.reproducible)
+        description << " (reproducible)";
     policy.logStartAlgorithm(description.str(), device);
 
     const ::size_t elementSize = problem.type.getSize();
-    const ::size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / elementSize;
+    const ::size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / getAccumulatorSize(problem);
     const ::size_t maxWorkGroupSize = std::min(device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(), localMemElements);
     const ::size_t computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
     const ::size_t startBlocks = 16 * computeUnits;
 
     std::vector<std::size_t> problemSizes;
     problemSizes.push_back(65536);
-    problemSizes.push_back(32 * 1024 * 1024 / elementSize);
+    // Keep the total input the same size whether there are one or two streams
+    const ::size_t streams = problem.binary ? 2 : 1;
+    problemSizes.push_back(32 * 1024 * 1024 / std::max(elementSize, streams * inputType(problem).getSize()));
 
     ReduceParameters::Value cand;
     cand.reduceBlocks = startBlocks;
+    cand.reduceLeafSize = 1;
+    cand.reduceElementsPerLoad = 1;
+    cand.subgroups = 0;
+    cand.workGroupFunctions = 0;
+    cand.hostCrossover = 0;
     {
         // Tune work group size
         std::vector<boost::any> sets;
@@ -182,13 +406,91 @@ ReduceParameters::Value Reduce::tune(
                 std::bind(&Reduce::tuneReduceCallback, _1, _2, _3, _4, problem)));
     }
 
+    if (problem.reproducible)
+    {
+        /* Tune number of elements combined in registers. This trades
+         * coalescing against fewer local-memory tree levels, and does not
+         * affect the result.
+         */
+        std::vector<boost::any> sets;
+        for (::size_t leafSize = 1; leafSize <= 16; leafSize *= 2)
+        {
+            ReduceParameters::Value params = cand;
+            params.reduceLeafSize = leafSize;
+            sets.push_back(params);
+        }
+
+        using namespace std::placeholders;
+        cand = boost::any_cast<ReduceParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Reduce::tuneReduceCallback, _1, _2, _3, _4, problem)));
+    }
+    else if (inputType(problem).getLength() == 1)
+    {
+        /* Tune number of elements per vector load. Wider loads make better
+         * use of memory transactions for narrow types, and help CPU devices
+         * to vectorize.
+         */
+        const ::size_t inputSize = inputType(problem).getSize();
+        std::vector<boost::any> sets;
+        for (::size_t perLoad = 1; perLoad <= 16 && perLoad * inputSize <= 64; perLoad *= 2)
+        {
+            ReduceParameters::Value params = cand;
+            params.reduceElementsPerLoad = perLoad;
+            sets.push_back(params);
+        }
+
+        using namespace std::placeholders;
+        cand = boost::any_cast<ReduceParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Reduce::tuneReduceCallback, _1, _2, _3, _4, problem)));
+    }
+
+    if (collectivesSupported(problem))
     {
-        // Tune number of blocks
+        /* Choose how to do the work-group reductions: with the local memory
+         * tree, sub-group built-ins or the OpenCL 2.0 work-group built-ins.
+         * Which is fastest depends on the device and driver.
+         */
         std::vector<boost::any> sets;
+        sets.push_back(cand);
+        if (getSubgroupExtension(device) != "")
+        {
+            ReduceParameters::Value params = cand;
+            params.subgroups = 1;
+            sets.push_back(params);
+        }
+        if (workGroupFunctionsSupported(device))
+        {
+            ReduceParameters::Value params = cand;
+            params.workGroupFunctions = 1;
+            sets.push_back(params);
+        }
+
+        if (sets.size() > 1)
+        {
+            using namespace std::placeholders;
+            cand = boost::any_cast<ReduceParameters::Value>(tuneOne(
+                    policy, device, sets, problemSizes,
+                    std::bind(&Reduce::tuneReduceCallback, _1, _2, _3, _4, problem)));
+        }
+    }
+
+    {
+        /* Tune number of blocks. The final combine is a tree, so large
+         * numbers of blocks are also worth trying.
+         */
+        std::vector< ::size_t> blockCounts;
         for (::size_t blocks = 4 * computeUnits; blocks <= 64 * computeUnits; blocks += 4 * computeUnits)
+            blockCounts.push_back(blocks);
+        for (::size_t blocks = 128 * computeUnits; blocks <= 512 * computeUnits; blocks *= 2)
+            blockCounts.push_back(blocks);
+
+        std::vector<boost::any> sets;
+        for (::size_t i = 0; i < blockCounts.size(); i++)
         {
             ReduceParameters::Value params = cand;
-            params.reduceBlocks = blocks;
+            params.reduceBlocks = blockCounts[i];
             sets.push_back(params);
         }
 
@@ -198,28 +500,108 @@ ReduceParameters::Value Reduce::tune(
                 std::bind(&Reduce::tuneReduceCallback, _1, _2, _3, _4, problem)));
     }
 
+    // Find the problem size below which BACKEND_AUTO reduces on the host
+    if (hostSupported(problem))
+    {
+        using namespace std::placeholders;
+        cand.hostCrossover = tuneHostCrossover(
+            policy, device, hostCrossoverSizes(std::min(problemSizes.back(), ::size_t(4 * 1024 * 1024))),
+            std::bind(&Reduce::tuneHostCallback, _1, _2, _3, cand, problem));
+    }
+
     policy.logEndAlgorithm();
     return cand;
 }
 
+bool Reduce::collectivesSupported(const ReduceProblem &problem)
+{
+    if (problem.statistics || problem.index != REDUCE_INDEX_NONE || problem.reproducible)
+        return false;
+    return problem.op.getCollectiveName(problem.type) != "";
+}
+
 bool Reduce::typeSupported(const cl::Device &device, const Type &type)
 {
     return type.isComputable(device) && type.isStorable(device);
 }
 
+bool Reduce::problemSupported(const cl::Device &device, const ReduceProblem &problem)
+{
+    if (!typeSupported(device, problem.type) || !problem.op.typeSupported(problem.type))
+        return false;
+    const Type inType = inputType(problem);
+    if (!typeSupported(device, inType))
+        return false;
+    // Without a transform, the input is converted component-wise
+    if (problem.transform.empty() && inType.getLength() != problem.type.getLength())
+        return false;
+    // Statistics replace the operator
+    if (problem.statistics && !problem.op.isSum())
+        return false;
+    // The fixed tree is only defined for sums of single values
+    if (problem.reproducible && (!problem.op.isSum() || problem.statistics || problem.index != REDUCE_INDEX_NONE))
+        return false;
+    if (problem.index != REDUCE_INDEX_NONE)
+    {
+        // Indices are only meaningful for a scalar, unary reduction
+        if (problem.statistics || problem.binary || !problem.op.isSum()
+            || problem.type.getLength() != 1)
+            return false;
+    }
+    return true;
+}
+
+bool Reduce::hostSupported(const ReduceProblem &problem)
+{
+    const Type inType = inputType(problem);
+    return hostTypeSupported(problem.type)
+        && inType.getBaseType() == problem.type.getBaseType()
+        && inType.getLength() == problem.type.getLength()
+        && problem.transform.empty()
+        && !problem.binary
+        && problem.statistics == 0
+        && problem.index == REDUCE_INDEX_NONE
+        && !problem.reproducible
+        && !problem.op.isCustom()
+        && problem.op.typeSupported(problem.type);
+}
+
+void Reduce::reduceHost(const ReduceProblem &problem,
+                        const void *in, void *out, ::size_t elements)
+{
+    if (!hostSupported(problem))
+        throw std::invalid_argument("problem is not supported by the host backend");
+    hostReduce(problem.type, problem.op.getType(), in, out, elements);
+}
+
 Reduce::Reduce(const cl::Context &context, const cl::Device &device, const ReduceProblem &problem)
 {
-    if (!typeSupported(device, problem.type))
-        throw std::invalid_argument("type is not a supported format on this device");
+    if (!problemSupported(device, problem))
+        throw std::invalid_argument("problem is not supported on this device");
+    // Check the backend before spending time on tuning
+    const bool host = hostSupported(problem);
+    hostElements(problem.backend, host, 0);
 
     ReduceParameters::Key key = makeKey(device, problem);
     ReduceParameters::Value params;
     if (!getDB().reduce.lookup(key, params))
     {
-        params = tune(device, problem);
-        getDB().reduce.add(key, params);
+        if (problem.tunePolicy.isBackground() || problem.tunePolicy.isFallback())
+        {
+            params = defaultParameters(device, problem);
+            if (problem.tunePolicy.isBackground())
+                BackgroundTuner::get().start<ReduceParameters::Key, ReduceParameters::Value>(
+                    getDB().reduce, key, problem.tunePolicy,
+                    std::bind(&Reduce::tune, device, problem));
+        }
+        else
+        {
+            params = tune(device, problem);
+            getDB().reduce.add(key, params);
+        }
     }
     initialize(context, device, problem, params);
+    hostMaxElements = hostElements(problem.backend, host, params.hostCrossover);
 }
 
 Reduce::Reduce(const cl::Context &context, const cl::Device &device, const ReduceProblem &problem,
@@ -255,42 +637,131 @@ ReduceParameters::Key Reduce::makeKey(const cl::Device &device, const ReduceProb
     ReduceParameters::Key key;
     key.device = deviceKey(device);
     key.elementType = canon.getName();
+    if (inputType(problem).getName() != problem.type.getName())
+        key.inputType = inputType(problem).getName();
+    key.transform = problem.transform;
+    key.binary = problem.binary ? 1 : 0;
+    key.statistics = problem.statistics;
+    key.indexMode = problem.index;
+    key.reproducible = problem.reproducible ? 1 : 0;
+    key.operation = problem.op.getKey();
     return key;
 }
 
-void Reduce::enqueue(
+::size_t Reduce::getBlockSize(::size_t elements) const
+{
+    if (reproducible)
+    {
+        /* Each block must be an aligned subtree of the pairwise tree, and
+         * hold a whole number of chunks.
+         */
+        const ::size_t perBlock = (elements + reduceBlocks - 1) / reduceBlocks;
+        ::size_t blockSize = reduceWorkGroupSize * reduceLeafSize;
+        while (blockSize < perBlock)
+            blockSize *= 2;
+        return blockSize;
+    }
+    else
+    {
+        // Keep all but the last block a whole number of vector-load tiles
+        const ::size_t tileSize = reduceWorkGroupSize * reduceElementsPerLoad;
+        return roundUp(elements, tileSize * reduceBlocks) / reduceBlocks;
+    }
+}
+
+::size_t Reduce::numOutputs(const ReduceProblem &problem)
+{
+    ::size_t ans = 0;
+    for (unsigned int s = problem.statistics; s != 0; s &= s - 1)
+        ans++;
+    return std::max(ans, ::size_t(1));
+}
+
+::size_t Reduce::getAccumulatorSize(const ReduceProblem &problem)
+{
+    const ::size_t elementSize = problem.type.getSize();
+    if (problem.index != REDUCE_INDEX_NONE)
+    {
+        // (value, index) structure, padded to the alignment of the larger member
+        const ::size_t align = std::max(elementSize, sizeof(cl_uint));
+        return roundUp(elementSize + sizeof(cl_uint), align);
+    }
+    else
+        return numOutputs(problem) * elementSize;
+}
+
+Type Reduce::inputType(const ReduceProblem &problem)
+{
+    if (problem.inputType.getBaseType() == TYPE_VOID)
+        return problem.type;
+    else
+        return problem.inputType;
+}
+
+void Reduce::enqueueInternal(
     const cl::CommandQueue &commandQueue,
     const cl::Buffer &inBuffer,
+    const cl::Buffer *inBuffer2,
     const cl::Buffer &outBuffer,
+    const cl::Buffer *indexBuffer,
     ::size_t first,
     ::size_t elements,
     ::size_t outPosition,
+    ::size_t indexPosition,
     const VECTOR_CLASS<cl::Event> *events,
     cl::Event *event)
 {
     /* Validate parameters */
+    if (binary && inBuffer2 == NULL)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: binary reductions require two inputs");
+    if (!binary && inBuffer2 != NULL)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueBinary: reduction is not binary");
+    if (indexed && indexBuffer == NULL)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: argmin/argmax reductions require an index output");
+    if (!indexed && indexBuffer != NULL)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueWithIndex: reduction does not compute an index");
     if (first + elements < first)
     {
         // Only happens if first + elements overflows. size_t is unsigned so behaviour
         // is well-defined.
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: range out of input buffer bounds");
     }
-    if (inBuffer.getInfo<CL_MEM_SIZE>() / elementSize < first + elements)
+    if (inBuffer.getInfo<CL_MEM_SIZE>() / inputElementSize < first + elements)
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: range out of input buffer bounds");
-    if (outBuffer.getInfo<CL_MEM_SIZE>() / elementSize <= outPosition)
+    if (outBuffer.getInfo<CL_MEM_SIZE>() / elementSize < outPosition + outputs)
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: output position out of buffer bounds");
     if (!(inBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
     {
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: input buffer is not readable");
     }
+    if (inBuffer2 != NULL)
+    {
+        if (inBuffer2->getInfo<CL_MEM_SIZE>() / inputElementSize < first + elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: range out of input buffer bounds");
+        if (!(inBuffer2->getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: input buffer is not readable");
+    }
     if (!(outBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
     {
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: output buffer is not writable");
     }
+    if (indexBuffer != NULL)
+    {
+        if (indexBuffer->getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) <= indexPosition)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueWithIndex: index position out of buffer bounds");
+        if (!(indexBuffer->getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueWithIndex: index buffer is not writable");
+    }
     if (elements == 0)
         throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Reduce::enqueue: elements is zero");
 
-    const ::size_t blockSize = roundUp(elements, reduceWorkGroupSize * reduceBlocks) / reduceBlocks;
+    if (elements <= hostMaxElements)
+    {
+        enqueueHost(commandQueue, inBuffer, outBuffer, first, elements, outPosition, events, event);
+        return;
+    }
+
+    const ::size_t blockSize = getBlockSize(elements);
 
     reduceKernel.setArg(1, outBuffer);
     reduceKernel.setArg(2, (cl_uint) outPosition);
@@ -298,6 +769,14 @@ void Reduce::enqueue(
     reduceKernel.setArg(4, (cl_uint) first);
     reduceKernel.setArg(5, (cl_uint) elements);
     reduceKernel.setArg(7, (cl_uint) blockSize);
+    cl_uint arg = 8;
+    if (inBuffer2 != NULL)
+        reduceKernel.setArg(arg++, *inBuffer2);
+    if (indexBuffer != NULL)
+    {
+        reduceKernel.setArg(arg++, *indexBuffer);
+        reduceKernel.setArg(arg++, (cl_uint) indexPosition);
+    }
 
     cl::Event reduceEvent;
     commandQueue.enqueueNDRangeKernel(
@@ -312,11 +791,177 @@ void Reduce::enqueue(
         *event = reduceEvent;
 }
 
-void Reduce::enqueue(
+void Reduce::enqueueHost(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &outBuffer,
+    ::size_t first,
+    ::size_t elements,
+    ::size_t outPosition,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    HostMapping mapping(commandQueue, events);
+    const void *inPtr = mapping.map(inBuffer, CL_MAP_READ, first * elementSize, elements * elementSize);
+    void *outPtr = mapping.map(outBuffer, CL_MAP_WRITE, outPosition * elementSize, elementSize);
+
+    // The work runs later, so it must not use *this
+    const Type type = elementType;
+    const OperatorType op = hostOperator;
+    const std::vector<cl::Event> unmapEvents = mapping.enqueue(
+        [=] { hostReduce(type, op, inPtr, outPtr, elements); });
+    for (const cl::Event &unmapEvent : unmapEvents)
+        doEventCallback(unmapEvent);
+    if (event != NULL)
+        *event = unmapEvents.back();
+}
+
+void Reduce::enqueueSegmented(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &outBuffer,
+    ::size_t first,
+    ::size_t elements,
+    ::size_t outPosition,
+    const cl::Buffer &segmentOffsets,
+    ::size_t numSegments,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    /* Validate parameters */
+    if (binary)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: binary reductions cannot be segmented");
+    if (indexed)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: argmin/argmax reductions cannot be segmented");
+    if (reproducible)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: reproducible reductions cannot be segmented");
+    if (first + elements < first)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: range out of input buffer bounds");
+    if (inBuffer.getInfo<CL_MEM_SIZE>() / inputElementSize < first + elements)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: range out of input buffer bounds");
+    if (outBuffer.getInfo<CL_MEM_SIZE>() / elementSize < outPosition + numSegments * outputs)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: range out of output buffer bounds");
+    if (segmentOffsets.getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) < numSegments)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: range out of offsets buffer bounds");
+    if (!(inBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: input buffer is not readable");
+    if (!(segmentOffsets.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: offsets buffer is not readable");
+    if (!(outBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueSegmented: output buffer is not writable");
+    if (elements == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Reduce::enqueueSegmented: elements is zero");
+    if (numSegments == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Reduce::enqueueSegmented: numSegments is zero");
+
+    /* The blocks are fixed-size pieces of the range, independent of the
+     * segment boundaries, so that the work is balanced across work-groups
+     * however unequal the segments are.
+     */
+    const ::size_t blockSize = roundUp(elements, reduceWorkGroupSize * reduceBlocks) / reduceBlocks;
+
+    segmentedKernel.setArg(1, outBuffer);
+    segmentedKernel.setArg(2, (cl_uint) outPosition);
+    segmentedKernel.setArg(3, inBuffer);
+    segmentedKernel.setArg(4, (cl_uint) first);
+    segmentedKernel.setArg(5, (cl_uint) elements);
+    segmentedKernel.setArg(6, segmentOffsets);
+    segmentedKernel.setArg(7, (cl_uint) numSegments);
+    segmentedKernel.setArg(10, (cl_uint) blockSize);
+
+    cl::Event reduceEvent;
+    commandQueue.enqueueNDRangeKernel(
+        segmentedKernel,
+        cl::NullRange,
+        cl::NDRange(reduceWorkGroupSize * reduceBlocks),
+        cl::NDRange(reduceWorkGroupSize),
+        events, &reduceEvent);
+    doEventCallback(reduceEvent);
+
+    if (event != NULL)
+        *event = reduceEvent;
+}
+
+void Reduce::enqueueColumns(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &outBuffer,
+    ::size_t first,
+    ::size_t rows,
+    ::size_t columns,
+    ::size_t rowStride,
+    ::size_t outPosition,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    /* Validate parameters */
+    if (binary)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: binary reductions cannot be done by column");
+    if (indexed)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: argmin/argmax reductions cannot be done by column");
+    if (reproducible)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: reproducible reductions cannot be done by column");
+    if (rowStride < columns)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: rowStride is less than columns");
+    if (rows == 0 || columns == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Reduce::enqueueColumns: no elements");
+    const ::size_t span = (rows - 1) * rowStride + columns;
+    if (inBuffer.getInfo<CL_MEM_SIZE>() / inputElementSize < first + span)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: range out of input buffer bounds");
+    if (outBuffer.getInfo<CL_MEM_SIZE>() / elementSize < outPosition + columns * outputs)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: range out of output buffer bounds");
+    if (!(inBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: input buffer is not readable");
+    if (!(outBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueColumns: output buffer is not writable");
+
+    /* Each block produces a partial result per column, which the last
+     * work-group combines serially. Using about sqrt(rows) blocks balances
+     * the two phases.
+     */
+    ::size_t blocks = 1;
+    while (blocks < reduceBlocks && blocks * blocks < rows)
+        blocks++;
+    const ::size_t rowsPerBlock = (rows + blocks - 1) / blocks;
+
+    if (!columnSums() || columnSums.getInfo<CL_MEM_SIZE>() < blocks * columns * accumulatorSize)
+    {
+        const cl::Context &context = commandQueue.getInfo<CL_QUEUE_CONTEXT>();
+        columnSums = cl::Buffer(context, CL_MEM_READ_WRITE, blocks * columns * accumulatorSize);
+    }
+
+    columnsKernel.setArg(1, outBuffer);
+    columnsKernel.setArg(2, (cl_uint) outPosition);
+    columnsKernel.setArg(3, inBuffer);
+    columnsKernel.setArg(4, (cl_uint) first);
+    columnsKernel.setArg(5, (cl_uint) rows);
+    columnsKernel.setArg(6, (cl_uint) columns);
+    columnsKernel.setArg(7, (cl_uint) rowStride);
+    columnsKernel.setArg(8, columnSums);
+    columnsKernel.setArg(9, (cl_uint) blocks);
+    columnsKernel.setArg(10, (cl_uint) rowsPerBlock);
+
+    // All REDUCE_BLOCKS work-groups are launched, since they count down wgc
+    cl::Event reduceEvent;
+    commandQueue.enqueueNDRangeKernel(
+        columnsKernel,
+        cl::NullRange,
+        cl::NDRange(reduceWorkGroupSize * reduceBlocks),
+        cl::NDRange(reduceWorkGroupSize),
+        events, &reduceEvent);
+    doEventCallback(reduceEvent);
+
+    if (event != NULL)
+        *event = reduceEvent;
+}
+
+void Reduce::enqueueInternal(
     const cl::CommandQueue &commandQueue,
     bool blocking,
     const cl::Buffer &inBuffer,
+    const cl::Buffer *inBuffer2,
     void *out,
+    cl_uint *index,
     ::size_t first,
     ::size_t elements,
     const VECTOR_CLASS<cl::Event> *events,
@@ -327,12 +972,29 @@ void Reduce::enqueue(
 
     if (out == NULL)
         throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueue: out is NULL");
+    if (indexed && index == NULL)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Reduce::enqueueWithIndex: index is NULL");
 
-    enqueue(commandQueue, inBuffer, sums, first, elements, reduceBlocks, events, &reduceEvent[0]);
+    // The result is placed after the partial results in sums
+    enqueueInternal(commandQueue, inBuffer, inBuffer2, sums, indexed ? &indexSum : NULL,
+                    first, elements, reduceBlocks * accumulatorSize / elementSize, 0,
+                    events, &reduceEvent[0]);
+    if (indexed)
+    {
+        /* Read the index first, so that the final read event marks
+         * completion of both reads.
+         */
+        cl::Event indexEvent;
+        commandQueue.enqueueReadBuffer(
+            indexSum, blocking, 0, sizeof(cl_uint), index,
+            &reduceEvent, &indexEvent);
+        doEventCallback(indexEvent);
+        reduceEvent[0] = indexEvent;
+    }
     commandQueue.enqueueReadBuffer(
         sums, blocking,
-        reduceBlocks * elementSize,
-        elementSize,
+        reduceBlocks * accumulatorSize,
+        outputs * elementSize,
         out,
         &reduceEvent,
         &readEvent);
@@ -341,6 +1003,92 @@ void Reduce::enqueue(
         *event = readEvent;
 }
 
+void Reduce::enqueue(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &outBuffer,
+    ::size_t first,
+    ::size_t elements,
+    ::size_t outPosition,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, inBuffer, NULL, outBuffer, NULL, first, elements, outPosition, 0,
+                    events, event);
+}
+
+void Reduce::enqueue(
+    const cl::CommandQueue &commandQueue,
+    bool blocking,
+    const cl::Buffer &inBuffer,
+    void *out,
+    ::size_t first,
+    ::size_t elements,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, blocking, inBuffer, NULL, out, NULL, first, elements, events, event);
+}
+
+void Reduce::enqueueBinary(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &inBuffer2,
+    const cl::Buffer &outBuffer,
+    ::size_t first,
+    ::size_t elements,
+    ::size_t outPosition,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, inBuffer, &inBuffer2, outBuffer, NULL, first, elements, outPosition, 0,
+                    events, event);
+}
+
+void Reduce::enqueueBinary(
+    const cl::CommandQueue &commandQueue,
+    bool blocking,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &inBuffer2,
+    void *out,
+    ::size_t first,
+    ::size_t elements,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, blocking, inBuffer, &inBuffer2, out, NULL, first, elements, events, event);
+}
+
+void Reduce::enqueueWithIndex(
+    const cl::CommandQueue &commandQueue,
+    const cl::Buffer &inBuffer,
+    const cl::Buffer &outBuffer,
+    const cl::Buffer &indexBuffer,
+    ::size_t first,
+    ::size_t elements,
+    ::size_t outPosition,
+    ::size_t indexPosition,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, inBuffer, NULL, outBuffer, &indexBuffer, first, elements,
+                    outPosition, indexPosition, events, event);
+}
+
+void Reduce::enqueueWithIndex(
+    const cl::CommandQueue &commandQueue,
+    bool blocking,
+    const cl::Buffer &inBuffer,
+    void *out,
+    cl_uint *index,
+    ::size_t first,
+    ::size_t elements,
+    const VECTOR_CLASS<cl::Event> *events,
+    cl::Event *event)
+{
+    enqueueInternal(commandQueue, blocking, inBuffer, NULL, out, index, first, elements, events, event);
+}
+
 const ReduceProblem &getDetail(const clogs::ReduceProblem &problem)
 {
     return *problem.detail_;
@@ -379,12 +1127,66 @@ void ReduceProblem::setType(const Type &type)
     detail_->setType(type);
 }
 
+void ReduceProblem::setInputType(const Type &inputType)
+{
+    assert(detail_ != NULL);
+    detail_->setInputType(inputType);
+}
+
+void ReduceProblem::setTransform(const std::string &transform)
+{
+    assert(detail_ != NULL);
+    detail_->setTransform(transform);
+}
+
+void ReduceProblem::setBinary(bool binary)
+{
+    assert(detail_ != NULL);
+    detail_->setBinary(binary);
+}
+
+void ReduceProblem::setStatistics(unsigned int statistics)
+{
+    assert(detail_ != NULL);
+    detail_->setStatistics(statistics);
+}
+
+void ReduceProblem::setIndex(ReduceIndex index)
+{
+    assert(detail_ != NULL);
+    detail_->setIndex(index);
+}
+
+void ReduceProblem::setReproducible(bool reproducible)
+{
+    assert(detail_ != NULL);
+    detail_->setReproducible(reproducible);
+}
+
+void ReduceProblem::setOperator(OperatorType op)
+{
+    assert(detail_ != NULL);
+    detail_->setOperator(op);
+}
+
+void ReduceProblem::setCustomOperator(const std::string &expression, const std::string &identity)
+{
+    assert(detail_ != NULL);
+    detail_->setCustomOperator(expression, identity);
+}
+
 void ReduceProblem::setTunePolicy(const TunePolicy &tunePolicy)
 {
     assert(detail_ != NULL);
     detail_->setTunePolicy(detail::getDetail(tunePolicy));
 }
 
+void ReduceProblem::setBackend(Backend backend)
+{
+    assert(detail_ != NULL);
+    detail_->setBackend(backend);
+}
+
 
 Reduce::Reduce()
 {
@@ -491,9 +1293,221 @@ void Reduce::enqueue(cl_command_queue commandQueue,
     }
 }
 
+void Reduce::enqueueBinary(cl_command_queue commandQueue,
+                           cl_mem inBuffer,
+                           cl_mem inBuffer2,
+                           cl_mem outBuffer,
+                           ::size_t first,
+                           ::size_t elements,
+                           ::size_t outPosition,
+                           cl_uint numEvents,
+                           const cl_event *events,
+                           cl_event *event,
+                           cl_int &err,
+                           const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueBinary(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(inBuffer2),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            first, elements, outPosition,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Reduce::enqueueBinary(cl_command_queue commandQueue,
+                           bool blocking,
+                           cl_mem inBuffer,
+                           cl_mem inBuffer2,
+                           void *out,
+                           ::size_t first,
+                           ::size_t elements,
+                           cl_uint numEvents,
+                           const cl_event *events,
+                           cl_event *event,
+                           cl_int &err,
+                           const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueBinary(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            blocking,
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(inBuffer2),
+            out, first, elements,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Reduce::enqueueWithIndex(cl_command_queue commandQueue,
+                              cl_mem inBuffer,
+                              cl_mem outBuffer,
+                              cl_mem indexBuffer,
+                              ::size_t first,
+                              ::size_t elements,
+                              ::size_t outPosition,
+                              ::size_t indexPosition,
+                              cl_uint numEvents,
+                              const cl_event *events,
+                              cl_event *event,
+                              cl_int &err,
+                              const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueWithIndex(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            detail::retainWrap<cl::Buffer>(indexBuffer),
+            first, elements, outPosition, indexPosition,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Reduce::enqueueWithIndex(cl_command_queue commandQueue,
+                              bool blocking,
+                              cl_mem inBuffer,
+                              void *out,
+                              cl_uint *index,
+                              ::size_t first,
+                              ::size_t elements,
+                              cl_uint numEvents,
+                              const cl_event *events,
+                              cl_event *event,
+                              cl_int &err,
+                              const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueWithIndex(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            blocking,
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            out, index, first, elements,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Reduce::enqueueSegmented(cl_command_queue commandQueue,
+                              cl_mem inBuffer,
+                              cl_mem outBuffer,
+                              ::size_t first,
+                              ::size_t elements,
+                              ::size_t outPosition,
+                              cl_mem segmentOffsets,
+                              ::size_t numSegments,
+                              cl_uint numEvents,
+                              const cl_event *events,
+                              cl_event *event,
+                              cl_int &err,
+                              const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueSegmented(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            first, elements, outPosition,
+            detail::retainWrap<cl::Buffer>(segmentOffsets),
+            numSegments,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Reduce::enqueueColumns(cl_command_queue commandQueue,
+                            cl_mem inBuffer,
+                            cl_mem outBuffer,
+                            ::size_t first,
+                            ::size_t rows,
+                            ::size_t columns,
+                            ::size_t rowStride,
+                            ::size_t outPosition,
+                            cl_uint numEvents,
+                            const cl_event *events,
+                            cl_event *event,
+                            cl_int &err,
+                            const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueColumns(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            first, rows, columns, rowStride, outPosition,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
 void swap(Reduce &a, Reduce &b)
 {
     a.swap(b);
 }
 
+void hostReduce(const ReduceProblem &problem,
+                const void *in, void *out, ::size_t elements)
+{
+    detail::Reduce::reduceHost(detail::getDetail(problem), in, out, elements);
+}
+
 } // namespace clogs
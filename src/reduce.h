@@ -43,6 +43,7 @@
 #include "cache_types.h"
 #include "utils.h"
 #include "tune.h"
+#include "operators.h"
 
 namespace clogs
 {
@@ -59,11 +60,32 @@ class CLOGS_LOCAL ReduceProblem
 private:
     friend class Reduce;
     Type type;
+    Type inputType;                  ///< Type of input elements, or void if the same as @ref type
+    std::string transform;           ///< Expression applied to each input element, or empty
+    bool binary;                     ///< Whether there are two input buffers
+    unsigned int statistics;         ///< Bitwise or of @ref ReduceStatistic flags, or 0
+    ReduceIndex index;
+    bool reproducible;               ///< Whether the result must not depend on the parameters
+    Operator op;
     TunePolicy tunePolicy;
+    Backend backend;
 
 public:
+    ReduceProblem()
+        : binary(false), statistics(0), index(REDUCE_INDEX_NONE), reproducible(false),
+        backend(BACKEND_DEVICE) {}
+
     void setType(const Type &type);
+    void setInputType(const Type &inputType);
+    void setTransform(const std::string &transform);
+    void setBinary(bool binary);
+    void setStatistics(unsigned int statistics);
+    void setIndex(ReduceIndex index);
+    void setReproducible(bool reproducible);
+    void setOperator(OperatorType op);
+    void setCustomOperator(const std::string &expression, const std::string &identity);
     void setTunePolicy(const TunePolicy &tunePolicy);
+    void setBackend(Backend backend);
 };
 
 /**
@@ -74,13 +96,50 @@ class CLOGS_LOCAL Reduce : public Algorithm
 private:
     ::size_t reduceWorkGroupSize;
     ::size_t reduceBlocks;
+    ::size_t reduceLeafSize;         ///< Elements per work-item per chunk, for reproducible reductions
+    ::size_t reduceElementsPerLoad;  ///< Elements per vector load in the main loop
     ::size_t elementSize;
+    ::size_t inputElementSize;
+    ::size_t accumulatorSize;        ///< Size of a partial result (all statistics together)
+    ::size_t outputs;                ///< Number of elements written per reduction
+    bool binary;                     ///< Whether there are two input buffers
+    bool indexed;                    ///< Whether the index of the result is computed
+    bool reproducible;               ///< Whether a fixed pairwise tree is used
+    Type elementType;                ///< Type of the elements (for the host backend)
+    OperatorType hostOperator;       ///< Built-in operator (for the host backend)
+    ::size_t hostMaxElements;        ///< Reductions of at most this many elements run on the host
+
+    /**
+     * Returns the number of elements handled by each work-group when
+     * reducing @a elements elements.
+     */
+    ::size_t getBlockSize(::size_t elements) const;
+
+    /**
+     * Reduce on the host instead of the device, by mapping the buffers. The
+     * parameters must already have been validated.
+     */
+    void enqueueHost(
+        const cl::CommandQueue &commandQueue,
+        const cl::Buffer &inBuffer,
+        const cl::Buffer &outBuffer,
+        ::size_t first,
+        ::size_t elements,
+        ::size_t outPosition,
+        const VECTOR_CLASS<cl::Event> *events,
+        cl::Event *event);
 
     cl::Program program;
     cl::Kernel reduceKernel;
+    cl::Kernel segmentedKernel;      ///< Kernel for segmented reductions (unless binary or indexed)
+    cl::Kernel columnsKernel;        ///< Kernel for column reductions (unless binary or indexed)
 
     cl::Buffer sums;
     cl::Buffer wgc;
+    cl::Buffer indexSum;             ///< Index of the result, for reading back to the host
+    cl::Buffer segmentSums;          ///< Partial results of segments split between blocks
+    cl::Buffer segmentIds;           ///< Segment indices corresponding to @ref segmentSums
+    cl::Buffer columnSums;           ///< Partial results of column reductions (grown as needed)
 
     /**
      * Second construction phase. This is called either by the normal constructor
@@ -99,16 +158,95 @@ private:
     Reduce(const cl::Context &context, const cl::Device &device, const ReduceProblem &problem,
            const ReduceParameters::Value &params);
 
+    /**
+     * Implementation of the enqueue functions, where @a inBuffer2 is
+     * @c NULL for reductions of a single input, and @a indexBuffer is
+     * @c NULL unless the index of the result is computed.
+     */
+    void enqueueInternal(const cl::CommandQueue &commandQueue,
+                         const cl::Buffer &inBuffer,
+                         const cl::Buffer *inBuffer2,
+                         const cl::Buffer &outBuffer,
+                         const cl::Buffer *indexBuffer,
+                         ::size_t first,
+                         ::size_t elements,
+                         ::size_t outPosition,
+                         ::size_t indexPosition,
+                         const VECTOR_CLASS<cl::Event> *events,
+                         cl::Event *event);
+
+    /**
+     * Implementation of the enqueue functions that read the result back to
+     * the host, where @a inBuffer2 is @c NULL for reductions of a single
+     * input, and @a index is @c NULL unless the index of the result is computed.
+     */
+    void enqueueInternal(const cl::CommandQueue &commandQueue,
+                         bool blocking,
+                         const cl::Buffer &inBuffer,
+                         const cl::Buffer *inBuffer2,
+                         void *out,
+                         cl_uint *index,
+                         ::size_t first,
+                         ::size_t elements,
+                         const VECTOR_CLASS<cl::Event> *events,
+                         cl::Event *event);
+
     static std::pair<double, double> tuneReduceCallback(
         const cl::Context &context, const cl::Device &device,
         std::size_t elements, const boost::any &parameters,
         const ReduceProblem &problem);
 
+    /**
+     * Times a reduction on the device and with the host backend, returning
+     * the two times in that order.
+     * @see @ref tuneHostCrossover
+     */
+    static std::pair<double, double> tuneHostCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const ReduceParameters::Value &parameters,
+        const ReduceProblem &problem);
+
     /**
      * Returns key for looking up autotuning parameters.
      */
     static ReduceParameters::Key makeKey(const cl::Device &device, const ReduceProblem &problem);
 
+    /**
+     * Returns the type of the input elements.
+     */
+    static Type inputType(const ReduceProblem &problem);
+
+    /**
+     * Returns the number of results produced by the reduction (the number
+     * of statistics selected, or 1 if none are).
+     */
+    static ::size_t numOutputs(const ReduceProblem &problem);
+
+    /**
+     * Returns the size in bytes of a partial result, which holds all the
+     * statistics, or the value and its index.
+     */
+    static ::size_t getAccumulatorSize(const ReduceProblem &problem);
+
+    /**
+     * Returns whether the work-group reductions of a problem may use
+     * sub-group or work-group built-ins, if the device provides them. This
+     * requires an operator and type that they implement, and is not done for
+     * statistics, indices or reproducible reductions.
+     */
+    static bool collectivesSupported(const ReduceProblem &problem);
+
+    /**
+     * Returns parameters estimated from the properties of @a device, for
+     * use while tuning runs in the background or in place of tuning when it
+     * is disabled (see @ref TunePolicy::isFallback).
+     *
+     * @param device      Device to tune for
+     * @param problem     Problem parameters
+     */
+    static ReduceParameters::Value defaultParameters(
+        const cl::Device &device, const ReduceProblem &problem);
+
     /**
      * Perform autotuning.
      *
@@ -151,10 +289,116 @@ public:
                  const VECTOR_CLASS<cl::Event> *events = NULL,
                  cl::Event *event = NULL);
 
+    /**
+     * Enqueue a reduction of two inputs on a command queue.
+     * @see @ref clogs::Reduce::enqueueBinary.
+     */
+    void enqueueBinary(const cl::CommandQueue &commandQueue,
+                       const cl::Buffer &inBuffer,
+                       const cl::Buffer &inBuffer2,
+                       const cl::Buffer &outBuffer,
+                       ::size_t first,
+                       ::size_t elements,
+                       ::size_t outPosition,
+                       const VECTOR_CLASS<cl::Event> *events = NULL,
+                       cl::Event *event = NULL);
+
+    /**
+     * Enqueue a reduction of two inputs on a command queue and read the
+     * result back to the host.
+     * @see @ref clogs::Reduce::enqueueBinary.
+     */
+    void enqueueBinary(const cl::CommandQueue &commandQueue,
+                       bool blocking,
+                       const cl::Buffer &inBuffer,
+                       const cl::Buffer &inBuffer2,
+                       void *out,
+                       ::size_t first,
+                       ::size_t elements,
+                       const VECTOR_CLASS<cl::Event> *events = NULL,
+                       cl::Event *event = NULL);
+
+    /**
+     * Enqueue a reduction that also computes the index of the result.
+     * @see @ref clogs::Reduce::enqueueWithIndex.
+     */
+    void enqueueWithIndex(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          const cl::Buffer &indexBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          ::size_t indexPosition,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL);
+
+    /**
+     * Enqueue a reduction that also computes the index of the result, and
+     * read both back to the host.
+     * @see @ref clogs::Reduce::enqueueWithIndex.
+     */
+    void enqueueWithIndex(const cl::CommandQueue &commandQueue,
+                          bool blocking,
+                          const cl::Buffer &inBuffer,
+                          void *out,
+                          cl_uint *index,
+                          ::size_t first,
+                          ::size_t elements,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL);
+
+    /**
+     * Enqueue a segmented reduction.
+     * @see @ref clogs::Reduce::enqueueSegmented.
+     */
+    void enqueueSegmented(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          ::size_t first,
+                          ::size_t elements,
+                          ::size_t outPosition,
+                          const cl::Buffer &segmentOffsets,
+                          ::size_t numSegments,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL);
+
+    /**
+     * Enqueue a reduction of each column of a matrix.
+     * @see @ref clogs::Reduce::enqueueColumns.
+     */
+    void enqueueColumns(const cl::CommandQueue &commandQueue,
+                        const cl::Buffer &inBuffer,
+                        const cl::Buffer &outBuffer,
+                        ::size_t first,
+                        ::size_t rows,
+                        ::size_t columns,
+                        ::size_t rowStride,
+                        ::size_t outPosition,
+                        const VECTOR_CLASS<cl::Event> *events = NULL,
+                        cl::Event *event = NULL);
+
     /**
      * Return whether a type is supported on a device.
      */
     static bool typeSupported(const cl::Device &device, const Type &type);
+
+    /**
+     * Return whether a problem is supported on a device.
+     */
+    static bool problemSupported(const cl::Device &device, const ReduceProblem &problem);
+
+    /**
+     * Return whether a problem is supported by the host backend.
+     */
+    static bool hostSupported(const ReduceProblem &problem);
+
+    /**
+     * Reduce in host memory.
+     * @see @ref clogs::hostReduce.
+     */
+    static void reduceHost(const ReduceProblem &problem,
+                           const void *in, void *out, ::size_t elements);
 };
 
 } // namespace detail
@@ -40,6 +40,8 @@
 #include <vector>
 #include <algorithm>
 #include <utility>
+#include <limits>
+#include <chrono>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -49,6 +51,7 @@
 #include "parameters.h"
 #include "tune.h"
 #include "cache.h"
+#include "host.h"
 
 namespace clogs
 {
@@ -58,58 +61,206 @@ namespace detail
 
 void ScanProblem::setType(const Type &type)
 {
-    if (!type.isIntegral())
-        throw std::invalid_argument("type is not a supported integral format");
+    if (type.getBaseType() == TYPE_VOID)
+        throw std::invalid_argument("type must not be void");
     this->type = type;
 }
 
+void ScanProblem::setInputType(const Type &inputType)
+{
+    this->inputType = inputType;
+}
+
+void ScanProblem::setTransform(const std::string &transform)
+{
+    if (transform.find_first_of("\r\n") != std::string::npos)
+        throw std::invalid_argument("transform must not contain newlines");
+    this->transform = transform;
+}
+
+void ScanProblem::setInclusive(bool inclusive)
+{
+    this->inclusive = inclusive;
+}
+
+void ScanProblem::setSegmented(bool segmented)
+{
+    this->segmented = segmented;
+}
+
+void ScanProblem::setOperator(OperatorType op)
+{
+    this->op = Operator(op);
+}
+
+void ScanProblem::setCustomOperator(const std::string &expression, const std::string &identity)
+{
+    this->op = Operator(expression, identity);
+}
+
+void ScanProblem::setAccumulation(ScanAccumulation accumulation)
+{
+    this->accumulation = accumulation;
+}
+
 void ScanProblem::setTunePolicy(const TunePolicy &tunePolicy)
 {
     this->tunePolicy = tunePolicy;
 }
 
+void ScanProblem::setBackend(Backend backend)
+{
+    this->backend = backend;
+}
+
+/// Name of an accumulation mode, for use in keys and log messages
+static const char *accumulationName(ScanAccumulation accumulation)
+{
+    switch (accumulation)
+    {
+    case SCAN_ACCUMULATE_NATIVE: return "native";
+    case SCAN_ACCUMULATE_COMPENSATED: return "compensated";
+    case SCAN_ACCUMULATE_WIDE: return "wide";
+    }
+    assert(false);
+    return "";
+}
+
 void Scan::initialize(
     const cl::Context &context, const cl::Device &device, const ScanProblem &problem,
     const ScanParameters::Value &params)
 {
     reduceWorkGroupSize = params.reduceWorkGroupSize;
+    reduceElementsPerLoad = params.reduceElementsPerLoad;
     scanWorkGroupSize = params.scanWorkGroupSize;
     scanWorkScale = params.scanWorkScale;
     maxBlocks = params.scanBlocks;
     elementSize = problem.type.getSize();
+    inputElementSize = inputType(problem).getSize();
+    segmented = problem.segmented;
+    inclusive = problem.inclusive;
+    elementType = problem.type;
+    hostOperator = problem.op.getType();
+    hostMaxElements = 0;
+    // Guards against parameters cached before the device was excluded
+    singlePass = params.singlePass != 0 && singlePassSupported(device, problem);
+    epoch = 0;
+    const Type accType = accumulatorType(problem);
+    const Type inType = inputType(problem);
+    accumulatorSize = accType.getSize();
 
     std::map<std::string, int> defines;
     std::map<std::string, std::string> stringDefines;
+    if (problem.type.getBaseType() == TYPE_HALF || accType.getBaseType() == TYPE_HALF
+        || inType.getBaseType() == TYPE_HALF)
+        defines["ENABLE_KHR_FP16"] = 1;
+    if (problem.type.getBaseType() == TYPE_DOUBLE || accType.getBaseType() == TYPE_DOUBLE
+        || inType.getBaseType() == TYPE_DOUBLE)
+        defines["ENABLE_KHR_FP64"] = 1;
     defines["WARP_SIZE_MEM"] = params.warpSizeMem;
     defines["WARP_SIZE_SCHEDULE"] = params.warpSizeSchedule;
     defines["REDUCE_WORK_GROUP_SIZE"] = params.reduceWorkGroupSize;
+    defines["REDUCE_ELEMENTS_PER_LOAD"] = params.reduceElementsPerLoad;
     defines["SCAN_WORK_GROUP_SIZE"] = params.scanWorkGroupSize;
     defines["SCAN_WORK_SCALE"] = params.scanWorkScale;
     defines["SCAN_BLOCKS"] = params.scanBlocks;
+    defines["SCAN_INCLUSIVE"] = problem.inclusive ? 1 : 0;
+    defines["SCAN_KAHAN"] = problem.accumulation == SCAN_ACCUMULATE_COMPENSATED ? 1 : 0;
+    defines["SCAN_SEGMENTED"] = problem.segmented ? 1 : 0;
+    defines["SCAN_SEQUENTIAL"] = params.sequential ? 1 : 0;
     stringDefines["SCAN_T"] = problem.type.getName();
+    if (problem.accumulation == SCAN_ACCUMULATE_WIDE)
+    {
+        stringDefines["SCAN_ACC_T"] = accType.getName();
+        stringDefines["SCAN_TO_ACC(x)"] = "convert_" + accType.getName() + "(x)";
+        stringDefines["SCAN_FROM_ACC(x)"] = "convert_" + problem.type.getName() + "(x)";
+    }
+    if (inType.getName() != problem.type.getName())
+    {
+        stringDefines["SCAN_IN_T"] = inType.getName();
+        if (problem.transform.empty())
+            stringDefines["SCAN_IN_TO_ACC(x)"] = "convert_" + accType.getName() + "(x)";
+    }
+    if (!problem.transform.empty())
+        stringDefines["SCAN_TRANSFORM(x)"] = "convert_" + problem.type.getName() + "(" + problem.transform + ")";
+    if (!problem.op.isSum())
+    {
+        stringDefines["SCAN_OP(a, b)"] = problem.op.getExpression(accType);
+        stringDefines["SCAN_IDENTITY"] = problem.op.getIdentity(problem.type);
+    }
     if (problem.type.getLength() == 3)
     {
         Type padded(problem.type.getBaseType(), 4);
         stringDefines["SCAN_PAD_T"] = padded.getName();
     }
+    std::string options;
+    if (params.subgroups)
+    {
+        if (getSubgroupExtension(device) == "cl_intel_subgroups")
+            defines["ENABLE_INTEL_SUBGROUPS"] = 1;
+        else
+            defines["ENABLE_KHR_SUBGROUPS"] = 1;
+        defines["SCAN_SUBGROUPS"] = 1;
+        stringDefines["SCAN_COLLECTIVE_OP"] = problem.op.getCollectiveName(accType);
+        options = getSubgroupBuildOptions(device);
+    }
+    else if (params.workGroupFunctions)
+    {
+        defines["SCAN_WORK_GROUP_FUNCTIONS"] = 1;
+        stringDefines["SCAN_COLLECTIVE_OP"] = problem.op.getCollectiveName(accType);
+        options = getLanguageBuildOptions(device);
+    }
 
     try
     {
-        sums = cl::Buffer(context, CL_MEM_READ_WRITE, params.scanBlocks * elementSize);
+        sums = cl::Buffer(context, CL_MEM_READ_WRITE, params.scanBlocks * accType.getSize());
 
-        program = build(context, device, "scan.cl", defines, stringDefines);
+        program = build(context, device, "scan.cl", defines, stringDefines, options);
 
         reduceKernel = cl::Kernel(program, "reduce");
         reduceKernel.setArg(0, sums);
+        reduceKernel.setArg(3, cl_uint(0)); // row stride, only used for batched scans
 
-        scanSmallKernel = cl::Kernel(program, "scanExclusiveSmall");
-        scanSmallKernel.setArg(0, sums);
+        scanSmallKernelIdentity = cl::Kernel(program, "scanExclusiveSmallIdentity");
+        scanSmallKernelIdentity.setArg(0, sums);
 
-        scanSmallKernelOffset = cl::Kernel(program, "scanExclusiveSmallOffset");
-        scanSmallKernelOffset.setArg(0, sums);
+        if (segmented)
+        {
+            // Segmented scans do not take an offset, so only the identity kernel exists
+            blockFlags = cl::Buffer(context, CL_MEM_READ_WRITE, params.scanBlocks * sizeof(cl_uint));
+            reduceKernel.setArg(4, blockFlags);
+            scanSmallKernelIdentity.setArg(1, blockFlags);
+            segmentFlagsClearKernel = cl::Kernel(program, "segmentFlagsClear");
+            segmentFlagsSetKernel = cl::Kernel(program, "segmentFlagsSet");
+        }
+        else
+        {
+            scanSmallKernel = cl::Kernel(program, "scanExclusiveSmall");
+            scanSmallKernel.setArg(0, sums);
+
+            scanSmallKernelOffset = cl::Kernel(program, "scanExclusiveSmallOffset");
+            scanSmallKernelOffset.setArg(0, sums);
+
+            scanSmallRowsKernel = cl::Kernel(program, "scanExclusiveSmallRows");
+            scanSmallRowsKernelIdentity = cl::Kernel(program, "scanExclusiveSmallRowsIdentity");
+        }
 
         scanKernel = cl::Kernel(program, "scanExclusive");
         scanKernel.setArg(2, sums);
+        scanKernel.setArg(5, cl_uint(0)); // row stride, only used for batched scans
+
+        if (singlePass)
+        {
+            // The kernel leaves the counter at zero, so it only needs to be initialized once
+            cl_uint zero = 0;
+            tileCounter = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(cl_uint), &zero);
+            singlePassKernel = cl::Kernel(program, "scanSinglePass");
+            singlePassKernel.setArg(4, tileCounter);
+            singlePassKernelOffset = cl::Kernel(program, "scanSinglePassOffset");
+            singlePassKernelOffset.setArg(4, tileCounter);
+            singlePassKernelIdentity = cl::Kernel(program, "scanSinglePassIdentity");
+            singlePassKernelIdentity.setArg(4, tileCounter);
+        }
     }
     catch (cl::Error &e)
     {
@@ -125,12 +276,13 @@ std::pair<double, double> Scan::tuneReduceCallback(
     const ScanParameters::Value &params = boost::any_cast<const ScanParameters::Value &>(paramsAny);
     const ::size_t reduceWorkGroupSize = params.reduceWorkGroupSize;
     const ::size_t maxBlocks = params.scanBlocks;
-    const ::size_t elementSize = problem.type.getSize();
+    const ::size_t elementSize = inputType(problem).getSize();
     const ::size_t allocSize = elements * elementSize;
     cl::Buffer buffer(context, CL_MEM_READ_WRITE, allocSize);
     cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
 
-    ::size_t blockSize = roundUp(elements, reduceWorkGroupSize * maxBlocks) / maxBlocks;
+    const ::size_t tileSize = reduceWorkGroupSize * params.reduceElementsPerLoad;
+    ::size_t blockSize = roundUp(elements, tileSize * maxBlocks) / maxBlocks;
     ::size_t nBlocks = (elements + blockSize - 1) / blockSize;
     if (nBlocks <= 0)
         throw InternalError("No blocks to operate on");
@@ -138,6 +290,15 @@ std::pair<double, double> Scan::tuneReduceCallback(
     Scan scan(context, device, problem, params);
     scan.reduceKernel.setArg(1, buffer);
     scan.reduceKernel.setArg(2, (cl_uint) blockSize);
+    /* Flag contents are irrelevant for timing. The buffer must outlive the
+     * launches, since setting a kernel argument does not retain it.
+     */
+    cl::Buffer flags;
+    if (problem.segmented)
+    {
+        flags = cl::Buffer(context, CL_MEM_READ_WRITE, elements);
+        scan.reduceKernel.setArg(5, flags);
+    }
     cl::Event event;
     // Warmup pass
     queue.enqueueNDRangeKernel(
@@ -171,7 +332,9 @@ std::pair<double, double> Scan::tuneScanCallback(
     const ScanProblem &problem)
 {
     const ScanParameters::Value &params = boost::any_cast<const ScanParameters::Value &>(paramsAny);
-    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * problem.type.getSize());
+    // The same buffer is used for input and output
+    const ::size_t elementSize = std::max(problem.type.getSize(), inputType(problem).getSize());
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * elementSize);
     cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
 
     const ::size_t scanWorkGroupSize = params.scanWorkGroupSize;
@@ -186,6 +349,15 @@ std::pair<double, double> Scan::tuneScanCallback(
     scan.scanKernel.setArg(1, buffer);
     scan.scanKernel.setArg(3, (cl_uint) blockSize);
     scan.scanKernel.setArg(4, (cl_uint) elements);
+    /* Flag contents are irrelevant for timing. The buffer must outlive the
+     * launches, since setting a kernel argument does not retain it.
+     */
+    cl::Buffer flags;
+    if (problem.segmented)
+    {
+        flags = cl::Buffer(context, CL_MEM_READ_WRITE, elements);
+        scan.scanKernel.setArg(6, flags);
+    }
     // Warmup pass
     queue.enqueueNDRangeKernel(
         scan.scanKernel,
@@ -217,16 +389,25 @@ std::pair<double, double> Scan::tuneBlocksCallback(
     const ScanProblem &problem)
 {
     const ScanParameters::Value &params = boost::any_cast<const ScanParameters::Value &>(paramsAny);
-    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * problem.type.getSize());
+    // The same buffer is used for input and output
+    const ::size_t elementSize = std::max(problem.type.getSize(), inputType(problem).getSize());
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * elementSize);
     cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
 
+    // Flag contents are irrelevant for timing
+    cl::Buffer flags;
+    if (problem.segmented)
+        flags = cl::Buffer(context, CL_MEM_READ_WRITE, elements);
+
     Scan scan(context, device, problem, params);
     cl::Event event;
     // Warmup pass
-    scan.enqueue(queue, buffer, buffer, elements, NULL, NULL, NULL);
+    scan.enqueueInternal(queue, buffer, buffer, elements, NULL, NULL, 0,
+                         problem.segmented ? &flags : NULL, NULL, NULL);
     queue.finish();
     // Timing pass
-    scan.enqueue(queue, buffer, buffer, elements, NULL, NULL, &event);
+    scan.enqueueInternal(queue, buffer, buffer, elements, NULL, NULL, 0,
+                         problem.segmented ? &flags : NULL, NULL, &event);
     queue.finish();
 
     event.wait();
@@ -241,6 +422,214 @@ std::pair<double, double> Scan::tuneBlocksCallback(
     return std::make_pair(rate, rate * 1.05);
 }
 
+/**
+ * Writes @a elements values of the scalar type @a type to @a buffer. The
+ * values are small integers, so that combining them in any order with the
+ * built-in operators gives the same result, even for floating-point types.
+ */
+static void writeSmallValues(
+    const cl::CommandQueue &queue, const cl::Buffer &buffer,
+    const Type &type, ::size_t elements)
+{
+    const ::size_t size = type.getSize();
+    std::vector<unsigned char> data(elements * size);
+    for (::size_t i = 0; i < elements; i++)
+    {
+        const int value = int((i * 7 + i / 5) % 4);
+        void *ptr = &data[i * size];
+        switch (type.getBaseType())
+        {
+        case TYPE_UCHAR:  *static_cast<cl_uchar *>(ptr) = value; break;
+        case TYPE_CHAR:   *static_cast<cl_char *>(ptr) = value; break;
+        case TYPE_USHORT: *static_cast<cl_ushort *>(ptr) = value; break;
+        case TYPE_SHORT:  *static_cast<cl_short *>(ptr) = value; break;
+        case TYPE_UINT:   *static_cast<cl_uint *>(ptr) = value; break;
+        case TYPE_INT:    *static_cast<cl_int *>(ptr) = value; break;
+        case TYPE_ULONG:  *static_cast<cl_ulong *>(ptr) = value; break;
+        case TYPE_LONG:   *static_cast<cl_long *>(ptr) = value; break;
+        case TYPE_FLOAT:  *static_cast<cl_float *>(ptr) = value; break;
+        case TYPE_DOUBLE: *static_cast<cl_double *>(ptr) = value; break;
+        case TYPE_HALF:
+            {
+                // 0, 1, 2 and 3 as IEEE half-precision bit patterns
+                static const cl_ushort halfBits[4] = {0x0000, 0x3C00, 0x4000, 0x4200};
+                *static_cast<cl_ushort *>(ptr) = halfBits[value];
+                break;
+            }
+        case TYPE_VOID:
+            throw InternalError("cannot write values of type void");
+        }
+    }
+    queue.enqueueWriteBuffer(buffer, CL_TRUE, 0, data.size(), &data[0]);
+}
+
+void Scan::checkSubgroups(
+    const cl::Context &context, const cl::Device &device,
+    const ScanParameters::Value &params, const ScanProblem &problem)
+{
+    /* Several work-groups and a partial tile, while keeping sums below 2^24
+     * so that they are exact in single precision.
+     */
+    const ::size_t elements = 65537;
+    const Type inType = inputType(problem);
+    cl::CommandQueue queue(context, device);
+    cl::Buffer inBuffer(context, CL_MEM_READ_WRITE, elements * inType.getSize());
+    writeSmallValues(queue, inBuffer, inType, elements);
+
+    ScanParameters::Value referenceParams = params;
+    referenceParams.subgroups = 0;
+    const ::size_t outSize = elements * problem.type.getSize();
+    std::vector<unsigned char> out[2];
+    for (int i = 0; i < 2; i++)
+    {
+        Scan scan(context, device, problem, i ? params : referenceParams);
+        cl::Buffer outBuffer(context, CL_MEM_READ_WRITE, outSize);
+        scan.enqueueInternal(queue, inBuffer, outBuffer, elements, NULL, NULL, 0, NULL, NULL, NULL);
+        out[i].resize(outSize);
+        queue.enqueueReadBuffer(outBuffer, CL_TRUE, 0, outSize, &out[i][0]);
+    }
+    if (out[0] != out[1])
+        throw InternalError("sub-group scan does not match the reference");
+}
+
+std::pair<double, double> Scan::tuneCollectivesCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const boost::any &paramsAny,
+    const ScanProblem &problem)
+{
+    const ScanParameters::Value &params = boost::any_cast<const ScanParameters::Value &>(paramsAny);
+    if (params.subgroups)
+        checkSubgroups(context, device, params, problem);
+    return tuneBlocksCallback(context, device, elements, paramsAny, problem);
+}
+
+/// Event callback used while tuning, to record every command that is enqueued
+static void CL_CALLBACK collectEvent(cl_event event, void *events)
+{
+    clRetainEvent(event);
+    static_cast<std::vector<cl::Event> *>(events)->push_back(cl::Event(event)); // steals reference
+}
+
+std::pair<double, double> Scan::tuneSinglePassCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const boost::any &paramsAny,
+    const ScanProblem &problem)
+{
+    const ScanParameters::Value &params = boost::any_cast<const ScanParameters::Value &>(paramsAny);
+    // The single-pass kernel has its own use of the sub-group scans
+    if (params.singlePass && params.subgroups)
+        checkSubgroups(context, device, params, problem);
+    // The same buffer is used for input and output
+    const ::size_t elementSize = std::max(problem.type.getSize(), inputType(problem).getSize());
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::CommandQueue queue(context, device, CL_QUEUE_PROFILING_ENABLE);
+
+    Scan scan(context, device, problem, params);
+    std::vector<cl::Event> events;
+    scan.setEventCallback(collectEvent, &events, NULL);
+    // Warmup pass
+    scan.enqueueInternal(queue, buffer, buffer, elements, NULL, NULL, 0, NULL, NULL, NULL);
+    queue.finish();
+    events.clear();
+    // Timing pass
+    scan.enqueueInternal(queue, buffer, buffer, elements, NULL, NULL, 0, NULL, NULL, NULL);
+    queue.finish();
+
+    /* The two variants enqueue different numbers of kernels, so the time is
+     * measured from the start of the first to the end of the last.
+     */
+    cl_ulong start = events.front().getProfilingInfo<CL_PROFILING_COMMAND_START>();
+    cl_ulong end = events.back().getProfilingInfo<CL_PROFILING_COMMAND_END>();
+    double elapsed = end - start;
+    double rate = elements / elapsed;
+    /* The multi-pass variant is listed first, and is kept unless the
+     * single-pass variant is clearly faster.
+     */
+    return std::make_pair(rate, rate * 1.05);
+}
+
+std::pair<double, double> Scan::tuneHostCallback(
+    const cl::Context &context, const cl::Device &device,
+    std::size_t elements, const ScanParameters::Value &params,
+    const ScanProblem &problem)
+{
+    // The same buffer is used for input and output
+    const ::size_t elementSize = problem.type.getSize();
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, elements * elementSize);
+    cl::CommandQueue queue(context, device);
+
+    // Flag contents are irrelevant for timing
+    cl::Buffer flags;
+    if (problem.segmented)
+        flags = cl::Buffer(context, CL_MEM_READ_WRITE, elements);
+
+    Scan scan(context, device, problem, params);
+    double elapsed[2];
+    for (int host = 0; host < 2; host++)
+    {
+        scan.hostMaxElements = host ? std::numeric_limits< ::size_t>::max() : 0;
+        // Warmup and timing passes, timed on the host to include all overheads
+        for (int pass = 0; pass < 2; pass++)
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            scan.enqueueInternal(queue, buffer, buffer, elements, NULL, NULL, 0,
+                                 problem.segmented ? &flags : NULL, NULL, NULL);
+            queue.finish();
+            elapsed[host] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    return std::make_pair(elapsed[0], elapsed[1]);
+}
+
+ScanParameters::Value Scan::defaultParameters(
+    const cl::Device &device, const ScanProblem &problem)
+{
+    // Local memory limits are as for tune
+    const size_t localElementSize = accumulatorType(problem).getSize()
+        + (problem.segmented ? sizeof(cl_uint) : 0);
+    const size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / localElementSize;
+    const size_t maxWorkGroupSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+    const size_t maxBlocks = std::min(2 * maxWorkGroupSize, localMemElements) & ~1;
+    const size_t computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+
+    ScanParameters::Value params;
+    params.warpSizeMem = getWarpSizeMem(device);
+    params.warpSizeSchedule = getWarpSizeSchedule(device);
+    params.reduceElementsPerLoad = 1;
+    if (!problem.segmented && inputType(problem).getLength() == 1)
+    {
+        // Load 16 bytes at a time, which is a full vector on most devices
+        params.reduceElementsPerLoad = std::max(size_t(1), 16 / inputType(problem).getSize());
+    }
+    params.singlePass = 0;
+    params.subgroups = 0;
+    params.workGroupFunctions = 0;
+    if (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
+    {
+        // Sequential kernels, with a few blocks per core for load balancing
+        params.reduceWorkGroupSize = 1;
+        params.scanWorkGroupSize = 1;
+        params.scanWorkScale = 1;
+        params.scanBlocks = std::max(size_t(2), std::min(maxBlocks, 4 * computeUnits)) & ~1;
+        params.sequential = 1;
+    }
+    else
+    {
+        /* Enough blocks to keep every compute unit busy, but not so many that
+         * small problems are dominated by the per-block overheads.
+         */
+        const size_t workGroupSize = getDefaultWorkGroupSize(
+            device, std::min(maxWorkGroupSize, localMemElements));
+        params.reduceWorkGroupSize = workGroupSize;
+        params.scanWorkGroupSize = workGroupSize;
+        params.scanWorkScale = roundDownPower2(std::min(localMemElements / workGroupSize, size_t(4)));
+        params.scanBlocks = std::max(size_t(2), std::min(maxBlocks, 8 * computeUnits)) & ~1;
+        params.sequential = 0;
+    }
+    params.hostCrossover = hostSupported(problem) ? defaultHostCrossover(device, 16384) : 0;
+    return params;
+}
+
 ScanParameters::Value Scan::tune(
     const cl::Device &device, const ScanProblem &problem)
 {
@@ -248,11 +637,24 @@ ScanParameters::Value Scan::tune(
     policy.assertEnabled();
     std::ostringstream description;
     description << "scan for " << problem.type.getName() << " elements";
+    if (inputType(problem).getName() != problem.type.getName())
+        description << " from " << inputType(problem).getName() << " input";
+    if (!problem.transform.empty())
+        description << " with transform " << problem.transform;
+    if (!problem.op.isSum())
+        description << " with operator " << problem.op.getKey();
+    if (problem.accumulation != SCAN_ACCUMULATE_NATIVE)
+        description << " with " << accumulationName(problem.accumulation) << " accumulation";
+    if (problem.segmented)
+        description << " (segmented)";
     policy.logStartAlgorithm(description.str(), device);
 
     const size_t elementSize = problem.type.getSize();
     const size_t maxWorkGroupSize = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
-    const size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / elementSize;
+    // Segmented scans hold a cl_uint head flag in local memory alongside each value
+    const size_t localElementSize = accumulatorType(problem).getSize()
+        + (problem.segmented ? sizeof(cl_uint) : 0);
+    const size_t localMemElements = device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / localElementSize;
     const size_t maxBlocks = std::min(2 * maxWorkGroupSize, localMemElements) & ~1;
     /* Some devices (e.g. G80) can't actually provide all the local memory they
      * claim they have, so start with a smaller block count and tune it later.
@@ -270,6 +672,9 @@ ScanParameters::Value Scan::tune(
     size_t bestScanWorkGroupSize = 0;
     size_t bestScanWorkScale = 0;
     size_t bestBlocks = 0;
+    size_t bestSubgroups = 0;
+    size_t bestWorkGroupFunctions = 0;
+    size_t bestSequential = 0;
 
     {
         // Tune reduce kernel
@@ -280,9 +685,15 @@ ScanParameters::Value Scan::tune(
             params.warpSizeMem = warpSizeMem;
             params.warpSizeSchedule = warpSizeSchedule;
             params.reduceWorkGroupSize = reduceWorkGroupSize;
+            params.reduceElementsPerLoad = 1;
             params.scanWorkGroupSize = 1;
             params.scanWorkScale = 1;
             params.scanBlocks = startBlocks;
+            params.singlePass = 0;
+            params.subgroups = bestSubgroups;
+            params.workGroupFunctions = bestWorkGroupFunctions;
+            params.sequential = bestSequential;
+            params.hostCrossover = 0;
             sets.push_back(params);
         }
 
@@ -293,6 +704,40 @@ ScanParameters::Value Scan::tune(
         bestReduceWorkGroupSize = params.reduceWorkGroupSize;
     }
 
+    size_t bestReduceElementsPerLoad = 1;
+    if (!problem.segmented && inputType(problem).getLength() == 1)
+    {
+        /* Tune number of elements per vector load in the reduce kernel.
+         * Wider loads make better use of memory transactions for narrow
+         * types, and help CPU devices to vectorize.
+         */
+        const size_t inputSize = inputType(problem).getSize();
+        std::vector<boost::any> sets;
+        for (size_t perLoad = 1; perLoad <= 16 && perLoad * inputSize <= 64; perLoad *= 2)
+        {
+            ScanParameters::Value params;
+            params.warpSizeMem = warpSizeMem;
+            params.warpSizeSchedule = warpSizeSchedule;
+            params.reduceWorkGroupSize = bestReduceWorkGroupSize;
+            params.reduceElementsPerLoad = perLoad;
+            params.scanWorkGroupSize = 1;
+            params.scanWorkScale = 1;
+            params.scanBlocks = startBlocks;
+            params.singlePass = 0;
+            params.subgroups = bestSubgroups;
+            params.workGroupFunctions = bestWorkGroupFunctions;
+            params.sequential = bestSequential;
+            params.hostCrossover = 0;
+            sets.push_back(params);
+        }
+
+        using namespace std::placeholders;
+        ScanParameters::Value params = boost::any_cast<ScanParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Scan::tuneReduceCallback, _1, _2, _3, _4, problem)));
+        bestReduceElementsPerLoad = params.reduceElementsPerLoad;
+    }
+
     {
         /* Tune scan kernel. The work group size and the work scale interact in
          * affecting register allocations, so they need to be tuned jointly.
@@ -307,9 +752,15 @@ ScanParameters::Value Scan::tune(
                 params.warpSizeMem = warpSizeMem;
                 params.warpSizeSchedule = warpSizeSchedule;
                 params.reduceWorkGroupSize = bestReduceWorkGroupSize;
+                params.reduceElementsPerLoad = bestReduceElementsPerLoad;
                 params.scanWorkGroupSize = scanWorkGroupSize;
                 params.scanWorkScale = scanWorkScale;
                 params.scanBlocks = startBlocks;
+                params.singlePass = 0;
+                params.subgroups = bestSubgroups;
+                params.workGroupFunctions = bestWorkGroupFunctions;
+                params.sequential = bestSequential;
+                params.hostCrossover = 0;
                 sets.push_back(params);
             }
         }
@@ -332,16 +783,148 @@ ScanParameters::Value Scan::tune(
             params.warpSizeMem = warpSizeMem;
             params.warpSizeSchedule = warpSizeSchedule;
             params.reduceWorkGroupSize = bestReduceWorkGroupSize;
+            params.reduceElementsPerLoad = bestReduceElementsPerLoad;
             params.scanWorkGroupSize = bestScanWorkGroupSize;
             params.scanWorkScale = bestScanWorkScale;
             params.scanBlocks = blocks;
+            params.singlePass = 0;
+            params.subgroups = bestSubgroups;
+            params.workGroupFunctions = bestWorkGroupFunctions;
+            params.sequential = bestSequential;
+            params.hostCrossover = 0;
+            sets.push_back(params);
+        }
+        using namespace std::placeholders;
+        ScanParameters::Value params = boost::any_cast<ScanParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Scan::tuneBlocksCallback, _1, _2, _3, _4, problem)));
+        bestBlocks = params.scanBlocks;
+    }
+
+    if (collectivesSupported(problem))
+    {
+        /* Choose how to do the work-group reductions and scans: with the
+         * local memory trees, sub-group built-ins or the OpenCL 2.0
+         * work-group built-ins. Which is fastest depends on the device and
+         * driver.
+         */
+        ScanParameters::Value base;
+        base.warpSizeMem = warpSizeMem;
+        base.warpSizeSchedule = warpSizeSchedule;
+        base.reduceWorkGroupSize = bestReduceWorkGroupSize;
+        base.reduceElementsPerLoad = bestReduceElementsPerLoad;
+        base.scanWorkGroupSize = bestScanWorkGroupSize;
+        base.scanWorkScale = bestScanWorkScale;
+        base.scanBlocks = bestBlocks;
+        base.singlePass = 0;
+        base.subgroups = 0;
+        base.workGroupFunctions = 0;
+        base.sequential = 0;
+        base.hostCrossover = 0;
+
+        std::vector<boost::any> sets;
+        sets.push_back(base);
+        if (getSubgroupExtension(device) != "")
+        {
+            ScanParameters::Value params = base;
+            params.subgroups = 1;
+            sets.push_back(params);
+        }
+        if (workGroupFunctionsSupported(device))
+        {
+            ScanParameters::Value params = base;
+            params.workGroupFunctions = 1;
+            sets.push_back(params);
+        }
+
+        if (sets.size() > 1)
+        {
+            using namespace std::placeholders;
+            ScanParameters::Value params = boost::any_cast<ScanParameters::Value>(tuneOne(
+                policy, device, sets, problemSizes,
+                std::bind(&Scan::tuneCollectivesCallback, _1, _2, _3, _4, problem)));
+            bestSubgroups = params.subgroups;
+            bestWorkGroupFunctions = params.workGroupFunctions;
+        }
+    }
+
+    if (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
+    {
+        /* CPU runtimes run the work-items of a group as a loop, which each
+         * barrier has to split. Try the sequential kernels, which give each
+         * block to a single work-item, with a range of block counts. They
+         * only displace the kernels tuned above if they are faster.
+         */
+        std::vector<boost::any> sets;
+        ScanParameters::Value best;
+        best.warpSizeMem = warpSizeMem;
+        best.warpSizeSchedule = warpSizeSchedule;
+        best.reduceWorkGroupSize = bestReduceWorkGroupSize;
+        best.reduceElementsPerLoad = bestReduceElementsPerLoad;
+        best.scanWorkGroupSize = bestScanWorkGroupSize;
+        best.scanWorkScale = bestScanWorkScale;
+        best.scanBlocks = bestBlocks;
+        best.singlePass = 0;
+        best.subgroups = bestSubgroups;
+        best.workGroupFunctions = bestWorkGroupFunctions;
+        best.sequential = 0;
+        best.hostCrossover = 0;
+        sets.push_back(best);
+        for (size_t blocks = 2; blocks <= maxBlocks; blocks *= 2)
+        {
+            ScanParameters::Value params = best;
+            params.reduceWorkGroupSize = 1;
+            params.scanWorkGroupSize = 1;
+            params.scanWorkScale = 1;
+            params.scanBlocks = blocks;
+            params.subgroups = 0;
+            params.workGroupFunctions = 0;
+            params.sequential = 1;
             sets.push_back(params);
         }
         using namespace std::placeholders;
         ScanParameters::Value params = boost::any_cast<ScanParameters::Value>(tuneOne(
             policy, device, sets, problemSizes,
             std::bind(&Scan::tuneBlocksCallback, _1, _2, _3, _4, problem)));
+        bestReduceWorkGroupSize = params.reduceWorkGroupSize;
+        bestScanWorkGroupSize = params.scanWorkGroupSize;
+        bestScanWorkScale = params.scanWorkScale;
         bestBlocks = params.scanBlocks;
+        bestSubgroups = params.subgroups;
+        bestWorkGroupFunctions = params.workGroupFunctions;
+        bestSequential = params.sequential;
+    }
+
+    size_t bestSinglePass = 0;
+    if (!bestSequential && singlePassSupported(device, problem))
+    {
+        /* Choose between the multi-pass kernels and the single-pass kernel.
+         * The latter reuses the work group size and work scale of the final
+         * scan kernel.
+         */
+        std::vector<boost::any> sets;
+        for (size_t singlePass = 0; singlePass <= 1; singlePass++)
+        {
+            ScanParameters::Value params;
+            params.warpSizeMem = warpSizeMem;
+            params.warpSizeSchedule = warpSizeSchedule;
+            params.reduceWorkGroupSize = bestReduceWorkGroupSize;
+            params.reduceElementsPerLoad = bestReduceElementsPerLoad;
+            params.scanWorkGroupSize = bestScanWorkGroupSize;
+            params.scanWorkScale = bestScanWorkScale;
+            params.scanBlocks = bestBlocks;
+            params.singlePass = singlePass;
+            params.subgroups = bestSubgroups;
+            params.workGroupFunctions = bestWorkGroupFunctions;
+            params.sequential = bestSequential;
+            params.hostCrossover = 0;
+            sets.push_back(params);
+        }
+        using namespace std::placeholders;
+        ScanParameters::Value params = boost::any_cast<ScanParameters::Value>(tuneOne(
+            policy, device, sets, problemSizes,
+            std::bind(&Scan::tuneSinglePassCallback, _1, _2, _3, _4, problem)));
+        bestSinglePass = params.singlePass;
     }
 
     // TODO: use a new exception type
@@ -355,32 +938,131 @@ ScanParameters::Value Scan::tune(
     params.warpSizeMem = warpSizeMem;
     params.warpSizeSchedule = warpSizeSchedule;
     params.reduceWorkGroupSize = bestReduceWorkGroupSize;
+    params.reduceElementsPerLoad = bestReduceElementsPerLoad;
     params.scanWorkGroupSize = bestScanWorkGroupSize;
     params.scanWorkScale = bestScanWorkScale;
     params.scanBlocks = bestBlocks;
+    params.singlePass = bestSinglePass;
+    params.subgroups = bestSubgroups;
+    params.workGroupFunctions = bestWorkGroupFunctions;
+    params.sequential = bestSequential;
+    params.hostCrossover = 0;
+
+    // Find the problem size below which BACKEND_AUTO scans on the host
+    if (hostSupported(problem))
+    {
+        using namespace std::placeholders;
+        params.hostCrossover = tuneHostCrossover(
+            policy, device, hostCrossoverSizes(std::min(problemSizes.back(), size_t(4 * 1024 * 1024))),
+            std::bind(&Scan::tuneHostCallback, _1, _2, _3, params, problem));
+    }
 
     policy.logEndAlgorithm();
     return params;
 }
 
+bool Scan::singlePassSupported(const cl::Device &device, const ScanProblem &problem)
+{
+    if (problem.segmented || problem.accumulation == SCAN_ACCUMULATE_COMPENSATED)
+        return false;
+    return workGroupForwardProgress(device);
+}
+
+bool Scan::collectivesSupported(const ScanProblem &problem)
+{
+    if (problem.segmented)
+        return false;
+    return problem.op.getCollectiveName(accumulatorType(problem)) != "";
+}
+
 bool Scan::typeSupported(const cl::Device &device, const Type &type)
 {
-    return type.isIntegral() && type.isComputable(device) && type.isStorable(device);
+    return type.isComputable(device) && type.isStorable(device);
+}
+
+bool Scan::problemSupported(const cl::Device &device, const ScanProblem &problem)
+{
+    if (!typeSupported(device, problem.type) || !problem.op.typeSupported(problem.type))
+        return false;
+    const Type inType = inputType(problem);
+    if (!typeSupported(device, inType))
+        return false;
+    // Without a transform, the input is converted component-wise
+    if (problem.transform.empty() && inType.getLength() != problem.type.getLength())
+        return false;
+    if (problem.accumulation != SCAN_ACCUMULATE_NATIVE)
+    {
+        if (problem.type.isIntegral() || !problem.op.isSum())
+            return false;
+        const Type accType = accumulatorType(problem);
+        if (accType.getBaseType() == TYPE_VOID || !typeSupported(device, accType))
+            return false;
+    }
+    // Compensation is not implemented for the segmented kernels
+    if (problem.segmented && problem.accumulation == SCAN_ACCUMULATE_COMPENSATED)
+        return false;
+    return true;
+}
+
+bool Scan::hostSupported(const ScanProblem &problem)
+{
+    const Type inType = inputType(problem);
+    return hostTypeSupported(problem.type)
+        && inType.getBaseType() == problem.type.getBaseType()
+        && inType.getLength() == problem.type.getLength()
+        && problem.transform.empty()
+        && !problem.op.isCustom()
+        && problem.op.typeSupported(problem.type)
+        && problem.accumulation == SCAN_ACCUMULATE_NATIVE;
+}
+
+void Scan::scanHost(const ScanProblem &problem,
+                    const void *in, void *out, ::size_t elements,
+                    const void *offset, const cl_uchar *headFlags)
+{
+    if (!hostSupported(problem))
+        throw std::invalid_argument("problem is not supported by the host backend");
+    if (problem.segmented)
+    {
+        if (headFlags == NULL)
+            throw std::invalid_argument("segmented scans require head flags");
+        if (offset != NULL)
+            throw std::invalid_argument("segmented scans do not support offsets");
+    }
+    else if (headFlags != NULL)
+        throw std::invalid_argument("scan is not segmented");
+    hostScan(problem.type, problem.op.getType(), problem.inclusive,
+             in, out, elements, offset, headFlags);
 }
 
 Scan::Scan(const cl::Context &context, const cl::Device &device, const ScanProblem &problem)
 {
-    if (!typeSupported(device, problem.type))
-        throw std::invalid_argument("type is not a supported integral format on this device");
+    if (!problemSupported(device, problem))
+        throw std::invalid_argument("problem is not supported on this device");
+    // Check the backend before spending time on tuning
+    const bool host = hostSupported(problem);
+    hostElements(problem.backend, host, 0);
 
     ScanParameters::Key key = makeKey(device, problem);
     ScanParameters::Value params;
     if (!getDB().scan.lookup(key, params))
     {
-        params = tune(device, problem);
-        getDB().scan.add(key, params);
+        if (problem.tunePolicy.isBackground() || problem.tunePolicy.isFallback())
+        {
+            params = defaultParameters(device, problem);
+            if (problem.tunePolicy.isBackground())
+                BackgroundTuner::get().start<ScanParameters::Key, ScanParameters::Value>(
+                    getDB().scan, key, problem.tunePolicy,
+                    std::bind(&Scan::tune, device, problem));
+        }
+        else
+        {
+            params = tune(device, problem);
+            getDB().scan.add(key, params);
+        }
     }
     initialize(context, device, problem, params);
+    hostMaxElements = hostElements(problem.backend, host, params.hostCrossover);
 }
 
 Scan::Scan(const cl::Context &context, const cl::Device &device, const ScanProblem &problem,
@@ -416,9 +1098,38 @@ ScanParameters::Key Scan::makeKey(const cl::Device &device, const ScanProblem &p
     ScanParameters::Key key;
     key.device = deviceKey(device);
     key.elementType = canon.getName();
+    if (inputType(problem).getName() != problem.type.getName())
+        key.inputType = inputType(problem).getName();
+    key.transform = problem.transform;
+    key.operation = problem.op.getKey();
+    key.accumulation = accumulationName(problem.accumulation);
+    key.segmented = problem.segmented ? 1 : 0;
     return key;
 }
 
+Type Scan::inputType(const ScanProblem &problem)
+{
+    if (problem.inputType.getBaseType() == TYPE_VOID)
+        return problem.type;
+    else
+        return problem.inputType;
+}
+
+Type Scan::accumulatorType(const ScanProblem &problem)
+{
+    if (problem.accumulation != SCAN_ACCUMULATE_WIDE)
+        return problem.type;
+    switch (problem.type.getBaseType())
+    {
+    case TYPE_HALF:
+        return Type(TYPE_FLOAT, problem.type.getLength());
+    case TYPE_FLOAT:
+        return Type(TYPE_DOUBLE, problem.type.getLength());
+    default:
+        return Type();
+    }
+}
+
 void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
                            const cl::Buffer &inBuffer,
                            const cl::Buffer &outBuffer,
@@ -426,11 +1137,27 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
                            const void *offsetHost,
                            const cl::Buffer *offsetBuffer,
                            cl_uint offsetIndex,
+                           const cl::Buffer *flagsBuffer,
                            const VECTOR_CLASS<cl::Event> *events,
                            cl::Event *event)
 {
     /* Validate parameters */
-    if (inBuffer.getInfo<CL_MEM_SIZE>() < elements * elementSize)
+    if (segmented)
+    {
+        if (flagsBuffer == NULL)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: segmented scans require head flags");
+        if (offsetHost != NULL || offsetBuffer != NULL)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: segmented scans do not support offsets");
+        if (flagsBuffer->getInfo<CL_MEM_SIZE>() < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: range out of flags buffer bounds");
+        if (!(flagsBuffer->getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: flags buffer is not readable");
+    }
+    else if (flagsBuffer != NULL)
+    {
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: scan is not segmented");
+    }
+    if (inBuffer.getInfo<CL_MEM_SIZE>() < elements * inputElementSize)
     {
         throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueue: range out of buffer bounds");
     }
@@ -461,8 +1188,23 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
     if (elements == 0)
         throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Scan::enqueue: elements is zero");
 
+    if (elements <= hostMaxElements)
+    {
+        enqueueHost(commandQueue, inBuffer, outBuffer, elements,
+                    offsetHost, offsetBuffer, offsetIndex, flagsBuffer, events, event);
+        return;
+    }
+
+    if (singlePass)
+    {
+        enqueueSinglePass(commandQueue, inBuffer, outBuffer, elements,
+                          offsetHost, offsetBuffer, offsetIndex, events, event);
+        return;
+    }
+
     // block size must be a multiple of this
-    const ::size_t tileSize = std::max(reduceWorkGroupSize, scanWorkScale * scanWorkGroupSize);
+    const ::size_t tileSize = std::max(reduceWorkGroupSize * reduceElementsPerLoad,
+                                       scanWorkScale * scanWorkGroupSize);
 
     /* Ensure that blockSize * blocks >= elements while blockSize is a multiply of tileSize */
     const ::size_t blockSize = roundUp(elements, tileSize * maxBlocks) / maxBlocks;
@@ -471,6 +1213,12 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
     assert((allBlocks - 1) * blockSize <= elements);
     assert(allBlocks * blockSize >= elements);
 
+    // enqueueBatched may have changed these
+    reduceKernel.setArg(0, sums);
+    reduceKernel.setArg(3, cl_uint(0));
+    scanKernel.setArg(2, sums);
+    scanKernel.setArg(5, cl_uint(0));
+
     reduceKernel.setArg(1, inBuffer);
     reduceKernel.setArg(2, (cl_uint) blockSize);
 
@@ -479,21 +1227,29 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
     scanKernel.setArg(3, (cl_uint) blockSize);
     scanKernel.setArg(4, (cl_uint) elements);
 
-    const cl::Kernel &smallKernel = offsetBuffer ? scanSmallKernelOffset : scanSmallKernel;
+    if (segmented)
+    {
+        reduceKernel.setArg(5, *flagsBuffer);
+        scanKernel.setArg(6, *flagsBuffer);
+    }
+
+    const cl::Kernel *smallKernel;
     if (offsetBuffer != NULL)
     {
         scanSmallKernelOffset.setArg(1, *offsetBuffer);
         scanSmallKernelOffset.setArg(2, offsetIndex);
+        smallKernel = &scanSmallKernelOffset;
     }
     else if (offsetHost != NULL)
     {
         // setArg is missing a const qualifier, hence the cast
         scanSmallKernel.setArg(1, elementSize, const_cast<void *>(offsetHost));
+        smallKernel = &scanSmallKernel;
     }
     else
     {
-        std::vector<cl_uchar> zero(elementSize);
-        scanSmallKernel.setArg(1, elementSize, &zero[0]);
+        // The identity may not be zero, so it is supplied by the kernel
+        smallKernel = &scanSmallKernelIdentity;
     }
 
     std::vector<cl::Event> reduceEvents(1);
@@ -510,7 +1266,7 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
         waitFor = &reduceEvents;
         doEventCallback(reduceEvents[0]);
     }
-    commandQueue.enqueueNDRangeKernel(smallKernel,
+    commandQueue.enqueueNDRangeKernel(*smallKernel,
                                       cl::NullRange,
                                       cl::NDRange(maxBlocks / 2),
                                       cl::NDRange(maxBlocks / 2),
@@ -526,6 +1282,125 @@ void Scan::enqueueInternal(const cl::CommandQueue &commandQueue,
         *event = scanEvent;
 }
 
+void Scan::enqueueHost(const cl::CommandQueue &commandQueue,
+                       const cl::Buffer &inBuffer,
+                       const cl::Buffer &outBuffer,
+                       ::size_t elements,
+                       const void *offsetHost,
+                       const cl::Buffer *offsetBuffer,
+                       cl_uint offsetIndex,
+                       const cl::Buffer *flagsBuffer,
+                       const VECTOR_CLASS<cl::Event> *events,
+                       cl::Event *event)
+{
+    HostMapping mapping(commandQueue, events);
+    const void *inPtr;
+    void *outPtr;
+    if (inBuffer() == outBuffer())
+    {
+        outPtr = mapping.map(outBuffer, CL_MAP_READ | CL_MAP_WRITE, 0, elements * elementSize);
+        inPtr = outPtr;
+    }
+    else
+    {
+        inPtr = mapping.map(inBuffer, CL_MAP_READ, 0, elements * elementSize);
+        outPtr = mapping.map(outBuffer, CL_MAP_WRITE, 0, elements * elementSize);
+    }
+    const void *offsetPtr = NULL;
+    if (offsetBuffer != NULL)
+        offsetPtr = mapping.map(*offsetBuffer, CL_MAP_READ, offsetIndex * elementSize, elementSize);
+    const cl_uchar *flags = NULL;
+    if (flagsBuffer != NULL)
+        flags = static_cast<const cl_uchar *>(mapping.map(*flagsBuffer, CL_MAP_READ, 0, elements));
+
+    // The work runs later, so it takes copies rather than using *this or offsetHost
+    std::vector<unsigned char> offsetCopy;
+    if (offsetHost != NULL)
+    {
+        const unsigned char *offsetBytes = static_cast<const unsigned char *>(offsetHost);
+        offsetCopy.assign(offsetBytes, offsetBytes + elementSize);
+    }
+    const Type type = elementType;
+    const OperatorType op = hostOperator;
+    const bool isInclusive = inclusive;
+    const std::vector<cl::Event> unmapEvents = mapping.enqueue(
+        [=]
+        {
+            hostScan(type, op, isInclusive, inPtr, outPtr, elements,
+                     offsetCopy.empty() ? offsetPtr : offsetCopy.data(), flags);
+        });
+    for (const cl::Event &unmapEvent : unmapEvents)
+        doEventCallback(unmapEvent);
+    if (event != NULL)
+        *event = unmapEvents.back();
+}
+
+void Scan::enqueueSinglePass(const cl::CommandQueue &commandQueue,
+                             const cl::Buffer &inBuffer,
+                             const cl::Buffer &outBuffer,
+                             ::size_t elements,
+                             const void *offsetHost,
+                             const cl::Buffer *offsetBuffer,
+                             cl_uint offsetIndex,
+                             const VECTOR_CLASS<cl::Event> *events,
+                             cl::Event *event)
+{
+    const ::size_t tileSize = scanWorkGroupSize * scanWorkScale;
+    const ::size_t tiles = (elements + tileSize - 1) / tileSize;
+
+    /* Status words hold the epoch shifted left by two. When it wraps, the
+     * status buffer is discarded so that stale words cannot be mistaken for
+     * current ones.
+     */
+    epoch++;
+    if (epoch >= (cl_uint(1) << 30))
+    {
+        tileStatus = cl::Buffer();
+        epoch = 1;
+    }
+    if (!tileStatus() || tileStatus.getInfo<CL_MEM_SIZE>() < tiles * sizeof(cl_uint))
+    {
+        const cl::Context &context = commandQueue.getInfo<CL_QUEUE_CONTEXT>();
+        std::vector<cl_uint> zeros(tiles);
+        tileStatus = cl::Buffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
+                                tiles * sizeof(cl_uint), &zeros[0]);
+        tileValues = cl::Buffer(context, CL_MEM_READ_WRITE, 2 * tiles * accumulatorSize);
+    }
+
+    cl::Kernel *kernel;
+    if (offsetBuffer != NULL)
+    {
+        singlePassKernelOffset.setArg(7, *offsetBuffer);
+        singlePassKernelOffset.setArg(8, offsetIndex);
+        kernel = &singlePassKernelOffset;
+    }
+    else if (offsetHost != NULL)
+    {
+        // setArg is missing a const qualifier, hence the cast
+        singlePassKernel.setArg(7, elementSize, const_cast<void *>(offsetHost));
+        kernel = &singlePassKernel;
+    }
+    else
+        kernel = &singlePassKernelIdentity;
+
+    kernel->setArg(0, inBuffer);
+    kernel->setArg(1, outBuffer);
+    kernel->setArg(2, tileStatus);
+    kernel->setArg(3, tileValues);
+    kernel->setArg(5, (cl_uint) elements);
+    kernel->setArg(6, epoch);
+
+    cl::Event scanEvent;
+    commandQueue.enqueueNDRangeKernel(*kernel,
+                                      cl::NullRange,
+                                      cl::NDRange(scanWorkGroupSize * tiles),
+                                      cl::NDRange(scanWorkGroupSize),
+                                      events, &scanEvent);
+    doEventCallback(scanEvent);
+    if (event != NULL)
+        *event = scanEvent;
+}
+
 void Scan::enqueue(const cl::CommandQueue &commandQueue,
                    const cl::Buffer &inBuffer,
                    const cl::Buffer &outBuffer,
@@ -534,7 +1409,7 @@ void Scan::enqueue(const cl::CommandQueue &commandQueue,
                    const VECTOR_CLASS<cl::Event> *events,
                    cl::Event *event)
 {
-    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, offset, NULL, 0, events, event);
+    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, offset, NULL, 0, NULL, events, event);
 }
 
 void Scan::enqueue(const cl::CommandQueue &commandQueue,
@@ -546,7 +1421,173 @@ void Scan::enqueue(const cl::CommandQueue &commandQueue,
                    const VECTOR_CLASS<cl::Event> *events,
                    cl::Event *event)
 {
-    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, NULL, &offsetBuffer, offsetIndex, events, event);
+    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, NULL, &offsetBuffer, offsetIndex, NULL, events, event);
+}
+
+void Scan::enqueueSegmented(const cl::CommandQueue &commandQueue,
+                            const cl::Buffer &inBuffer,
+                            const cl::Buffer &outBuffer,
+                            ::size_t elements,
+                            const cl::Buffer &headFlags,
+                            const VECTOR_CLASS<cl::Event> *events,
+                            cl::Event *event)
+{
+    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, NULL, NULL, 0, &headFlags, events, event);
+}
+
+void Scan::enqueueBatched(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          ::size_t rows,
+                          ::size_t rowLength,
+                          ::size_t rowStride,
+                          const void *offset,
+                          const VECTOR_CLASS<cl::Event> *events,
+                          cl::Event *event)
+{
+    /* Validate parameters */
+    if (segmented)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: segmented scans cannot be batched");
+    if (rowStride < rowLength)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: rowStride is less than rowLength");
+    if (rows == 0 || rowLength == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Scan::enqueueBatched: no elements");
+    const ::size_t span = (rows - 1) * rowStride + rowLength;
+    if (inBuffer.getInfo<CL_MEM_SIZE>() < span * inputElementSize)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: range out of buffer bounds");
+    if (outBuffer.getInfo<CL_MEM_SIZE>() < span * elementSize)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: range out of buffer bounds");
+    if (!(inBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: input buffer is not readable");
+    if (!(outBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueBatched: output buffer is not writable");
+
+    /* The blocks are shared between the rows, so that short rows still give
+     * enough work-groups to fill the device. Each row gets at least one.
+     */
+    const ::size_t tileSize = std::max(reduceWorkGroupSize * reduceElementsPerLoad,
+                                       scanWorkScale * scanWorkGroupSize);
+    const ::size_t rowBlocks = std::max(::size_t(1), maxBlocks / rows);
+    const ::size_t blockSize = roundUp(rowLength, tileSize * rowBlocks) / rowBlocks;
+    const ::size_t blocksPerRow = (rowLength + blockSize - 1) / blockSize;
+    assert(blocksPerRow > 0 && blocksPerRow <= rowBlocks);
+
+    // With more rows than blocks, the block sums do not fit in sums
+    const ::size_t allBlocks = rows * blocksPerRow;
+    const cl::Buffer *blockSums = &sums;
+    if (allBlocks > maxBlocks)
+    {
+        if (!rowSums() || rowSums.getInfo<CL_MEM_SIZE>() < allBlocks * accumulatorSize)
+        {
+            const cl::Context &context = commandQueue.getInfo<CL_QUEUE_CONTEXT>();
+            rowSums = cl::Buffer(context, CL_MEM_READ_WRITE, allBlocks * accumulatorSize);
+        }
+        blockSums = &rowSums;
+    }
+
+    reduceKernel.setArg(0, *blockSums);
+    reduceKernel.setArg(1, inBuffer);
+    reduceKernel.setArg(2, (cl_uint) blockSize);
+    reduceKernel.setArg(3, (cl_uint) rowStride);
+
+    scanKernel.setArg(0, inBuffer);
+    scanKernel.setArg(1, outBuffer);
+    scanKernel.setArg(2, *blockSums);
+    scanKernel.setArg(3, (cl_uint) blockSize);
+    scanKernel.setArg(4, (cl_uint) rowLength);
+    scanKernel.setArg(5, (cl_uint) rowStride);
+
+    cl::Kernel *smallKernel;
+    if (offset != NULL)
+    {
+        // setArg is missing a const qualifier, hence the cast
+        scanSmallRowsKernel.setArg(2, elementSize, const_cast<void *>(offset));
+        smallKernel = &scanSmallRowsKernel;
+    }
+    else
+        smallKernel = &scanSmallRowsKernelIdentity;
+    smallKernel->setArg(0, *blockSums);
+    smallKernel->setArg(1, (cl_uint) blocksPerRow);
+
+    std::vector<cl::Event> reduceEvents(1);
+    std::vector<cl::Event> scanSmallEvents(1);
+    cl::Event scanEvent;
+    const std::vector<cl::Event> *waitFor = events;
+    if (blocksPerRow > 1)
+    {
+        commandQueue.enqueueNDRangeKernel(reduceKernel,
+                                          cl::NullRange,
+                                          cl::NDRange(reduceWorkGroupSize * (blocksPerRow - 1), rows),
+                                          cl::NDRange(reduceWorkGroupSize, 1),
+                                          events, &reduceEvents[0]);
+        waitFor = &reduceEvents;
+        doEventCallback(reduceEvents[0]);
+    }
+    commandQueue.enqueueNDRangeKernel(*smallKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(rows),
+                                      cl::NullRange,
+                                      waitFor, &scanSmallEvents[0]);
+    doEventCallback(scanSmallEvents[0]);
+    commandQueue.enqueueNDRangeKernel(scanKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(scanWorkGroupSize * blocksPerRow, rows),
+                                      cl::NDRange(scanWorkGroupSize, 1),
+                                      &scanSmallEvents, &scanEvent);
+    doEventCallback(scanEvent);
+    if (event != NULL)
+        *event = scanEvent;
+}
+
+void Scan::enqueueSegmentedOffsets(const cl::CommandQueue &commandQueue,
+                                   const cl::Buffer &inBuffer,
+                                   const cl::Buffer &outBuffer,
+                                   ::size_t elements,
+                                   const cl::Buffer &segmentOffsets,
+                                   ::size_t numSegments,
+                                   const VECTOR_CLASS<cl::Event> *events,
+                                   cl::Event *event)
+{
+    if (!segmented)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueSegmentedOffsets: scan is not segmented");
+    if (numSegments > 0)
+    {
+        if (segmentOffsets.getInfo<CL_MEM_SIZE>() < numSegments * sizeof(cl_uint))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueSegmentedOffsets: range out of offsets buffer bounds");
+        if (!(segmentOffsets.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Scan::enqueueSegmentedOffsets: offsets buffer is not readable");
+    }
+    if (elements == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Scan::enqueueSegmentedOffsets: elements is zero");
+
+    const cl::Context &context = commandQueue.getInfo<CL_QUEUE_CONTEXT>();
+    if (!segmentFlags() || segmentFlags.getInfo<CL_MEM_SIZE>() < elements)
+        segmentFlags = cl::Buffer(context, CL_MEM_READ_WRITE, elements);
+
+    std::vector<cl::Event> flagsEvents(1);
+    segmentFlagsClearKernel.setArg(0, segmentFlags);
+    commandQueue.enqueueNDRangeKernel(segmentFlagsClearKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(elements),
+                                      cl::NullRange,
+                                      events, &flagsEvents[0]);
+    doEventCallback(flagsEvents[0]);
+    if (numSegments > 0)
+    {
+        cl::Event setEvent;
+        segmentFlagsSetKernel.setArg(0, segmentFlags);
+        segmentFlagsSetKernel.setArg(1, segmentOffsets);
+        segmentFlagsSetKernel.setArg(2, (cl_uint) elements);
+        commandQueue.enqueueNDRangeKernel(segmentFlagsSetKernel,
+                                          cl::NullRange,
+                                          cl::NDRange(numSegments),
+                                          cl::NullRange,
+                                          &flagsEvents, &setEvent);
+        doEventCallback(setEvent);
+        flagsEvents[0] = setEvent;
+    }
+    enqueueInternal(commandQueue, inBuffer, outBuffer, elements, NULL, NULL, 0, &segmentFlags,
+                    &flagsEvents, event);
 }
 
 const ScanProblem &getDetail(const clogs::ScanProblem &problem)
@@ -587,12 +1628,60 @@ void ScanProblem::setType(const Type &type)
     detail_->setType(type);
 }
 
+void ScanProblem::setInputType(const Type &inputType)
+{
+    assert(detail_ != NULL);
+    detail_->setInputType(inputType);
+}
+
+void ScanProblem::setTransform(const std::string &transform)
+{
+    assert(detail_ != NULL);
+    detail_->setTransform(transform);
+}
+
+void ScanProblem::setInclusive(bool inclusive)
+{
+    assert(detail_ != NULL);
+    detail_->setInclusive(inclusive);
+}
+
+void ScanProblem::setSegmented(bool segmented)
+{
+    assert(detail_ != NULL);
+    detail_->setSegmented(segmented);
+}
+
+void ScanProblem::setOperator(OperatorType op)
+{
+    assert(detail_ != NULL);
+    detail_->setOperator(op);
+}
+
+void ScanProblem::setCustomOperator(const std::string &expression, const std::string &identity)
+{
+    assert(detail_ != NULL);
+    detail_->setCustomOperator(expression, identity);
+}
+
+void ScanProblem::setAccumulation(ScanAccumulation accumulation)
+{
+    assert(detail_ != NULL);
+    detail_->setAccumulation(accumulation);
+}
+
 void ScanProblem::setTunePolicy(const TunePolicy &tunePolicy)
 {
     assert(detail_ != NULL);
     detail_->setTunePolicy(detail::getDetail(tunePolicy));
 }
 
+void ScanProblem::setBackend(Backend backend)
+{
+    assert(detail_ != NULL);
+    detail_->setBackend(backend);
+}
+
 
 Scan::Scan()
 {
@@ -699,9 +1788,121 @@ void Scan::enqueue(cl_command_queue commandQueue,
     }
 }
 
+void Scan::enqueueSegmented(cl_command_queue commandQueue,
+                            cl_mem inBuffer,
+                            cl_mem outBuffer,
+                            ::size_t elements,
+                            cl_mem headFlags,
+                            cl_uint numEvents,
+                            const cl_event *events,
+                            cl_event *event,
+                            cl_int &err,
+                            const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueSegmented(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            elements,
+            detail::retainWrap<cl::Buffer>(headFlags),
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Scan::enqueueBatched(cl_command_queue commandQueue,
+                          cl_mem inBuffer,
+                          cl_mem outBuffer,
+                          ::size_t rows,
+                          ::size_t rowLength,
+                          ::size_t rowStride,
+                          const void *offset,
+                          cl_uint numEvents,
+                          const cl_event *events,
+                          cl_event *event,
+                          cl_int &err,
+                          const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueBatched(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            rows, rowLength, rowStride, offset,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Scan::enqueueSegmentedOffsets(cl_command_queue commandQueue,
+                                   cl_mem inBuffer,
+                                   cl_mem outBuffer,
+                                   ::size_t elements,
+                                   cl_mem segmentOffsets,
+                                   ::size_t numSegments,
+                                   cl_uint numEvents,
+                                   const cl_event *events,
+                                   cl_event *event,
+                                   cl_int &err,
+                                   const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueueSegmentedOffsets(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(inBuffer),
+            detail::retainWrap<cl::Buffer>(outBuffer),
+            elements,
+            detail::retainWrap<cl::Buffer>(segmentOffsets), numSegments,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
 void swap(Scan &a, Scan &b)
 {
     a.swap(b);
 }
 
+void hostScan(const ScanProblem &problem,
+              const void *in, void *out, ::size_t elements,
+              const void *offset)
+{
+    detail::Scan::scanHost(detail::getDetail(problem), in, out, elements, offset, NULL);
+}
+
+void hostScanSegmented(const ScanProblem &problem,
+                       const void *in, void *out, ::size_t elements,
+                       const cl_uchar *headFlags)
+{
+    detail::Scan::scanHost(detail::getDetail(problem), in, out, elements, NULL, headFlags);
+}
+
 } // namespace clogs
@@ -44,6 +44,7 @@
 #include "cache_types.h"
 #include "utils.h"
 #include "tune.h"
+#include "operators.h"
 
 namespace clogs
 {
@@ -60,11 +61,30 @@ class CLOGS_LOCAL ScanProblem
 private:
     friend class Scan;
     Type type;
+    Type inputType;                  ///< Type of input elements, or void if the same as @ref type
+    std::string transform;           ///< Expression applied to each input element, or empty
+    bool inclusive;
+    bool segmented;
+    Operator op;
+    ScanAccumulation accumulation;
     TunePolicy tunePolicy;
+    Backend backend;
 
 public:
+    ScanProblem()
+        : inclusive(false), segmented(false), accumulation(SCAN_ACCUMULATE_NATIVE),
+        backend(BACKEND_DEVICE) {}
+
     void setType(const Type &type);
+    void setInputType(const Type &inputType);
+    void setTransform(const std::string &transform);
+    void setInclusive(bool inclusive);
+    void setSegmented(bool segmented);
+    void setOperator(OperatorType op);
+    void setCustomOperator(const std::string &expression, const std::string &identity);
+    void setAccumulation(ScanAccumulation accumulation);
     void setTunePolicy(const TunePolicy &tunePolicy);
+    void setBackend(Backend backend);
 };
 
 /**
@@ -74,22 +94,79 @@ class CLOGS_LOCAL Scan : public Algorithm
 {
 private:
     ::size_t reduceWorkGroupSize;    ///< Work group size for the initial reduce phase
+    ::size_t reduceElementsPerLoad;  ///< Elements per vector load in the initial reduce phase
     ::size_t scanWorkGroupSize;      ///< Work group size for the final scan phase
     ::size_t scanWorkScale;          ///< Elements for work item for the final scan phase
     ::size_t maxBlocks;              ///< Maximum number of items in the middle phase
     ::size_t elementSize;            ///< Size of the element type
+    ::size_t inputElementSize;       ///< Size of the input element type
+    ::size_t accumulatorSize;        ///< Size of the type used for partial sums
+    bool segmented;                  ///< Whether the scan is segmented
+    bool inclusive;                  ///< Whether the scan is inclusive (for the host backend)
+    Type elementType;                ///< Type of the elements (for the host backend)
+    OperatorType hostOperator;       ///< Built-in operator (for the host backend)
+    ::size_t hostMaxElements;        ///< Scans of at most this many elements run on the host
+    bool singlePass;                 ///< Whether to use the single-pass kernels
     cl::Program program;             ///< Program containing the kernels
     cl::Kernel reduceKernel;         ///< Initial reduction kernel
     cl::Kernel scanSmallKernel;      ///< Middle-phase scan kernel
     cl::Kernel scanSmallKernelOffset; ///< Middle-phase scan kernel with offset support
+    cl::Kernel scanSmallKernelIdentity; ///< Middle-phase scan kernel without an offset
+    cl::Kernel scanSmallRowsKernel;  ///< Middle-phase scan kernel for batched scans
+    cl::Kernel scanSmallRowsKernelIdentity; ///< Middle-phase scan kernel for batched scans without an offset
     cl::Kernel scanKernel;           ///< Final scan kernel
+    cl::Kernel segmentFlagsClearKernel; ///< Clears head flags (segmented only)
+    cl::Kernel segmentFlagsSetKernel; ///< Converts segment offsets to head flags (segmented only)
+    cl::Kernel singlePassKernel;     ///< Single-pass scan kernel
+    cl::Kernel singlePassKernelOffset; ///< Single-pass scan kernel with offset support
+    cl::Kernel singlePassKernelIdentity; ///< Single-pass scan kernel without an offset
     cl::Buffer sums;                 ///< Reductions of the blocks for middle phase
+    cl::Buffer blockFlags;           ///< Whether each block contains a head (segmented only)
+    cl::Buffer segmentFlags;         ///< Head flags computed from segment offsets (grown as needed)
+    cl::Buffer rowSums;              ///< Block sums for batched scans with many rows (grown as needed)
+    cl::Buffer tileCounter;          ///< Counter for assigning tiles in the single-pass kernel
+    cl::Buffer tileStatus;           ///< Status word per tile for the single-pass kernel (grown as needed)
+    cl::Buffer tileValues;           ///< Published sums per tile for the single-pass kernel (grown as needed)
+    cl_uint epoch;                   ///< Epoch of the most recent single-pass launch
 
     /**
      * Implementation of @ref enqueue, supporting both offsetting and
      * non-offsetting. If @a offsetBuffer is not @c NULL, we are doing offseting.
+     * For segmented scans, @a flagsBuffer holds the head flags.
      */
     void enqueueInternal(
+        const cl::CommandQueue &commandQueue,
+        const cl::Buffer &inBuffer,
+        const cl::Buffer &outBuffer,
+        ::size_t elements,
+        const void *offsetCPU,
+        const cl::Buffer *offsetBuffer,
+        cl_uint offsetIndex,
+        const cl::Buffer *flagsBuffer,
+        const VECTOR_CLASS<cl::Event> *events,
+        cl::Event *event);
+
+    /**
+     * Implementation of @ref enqueueInternal that runs on the host, by
+     * mapping the buffers. The parameters must already have been validated.
+     */
+    void enqueueHost(
+        const cl::CommandQueue &commandQueue,
+        const cl::Buffer &inBuffer,
+        const cl::Buffer &outBuffer,
+        ::size_t elements,
+        const void *offsetCPU,
+        const cl::Buffer *offsetBuffer,
+        cl_uint offsetIndex,
+        const cl::Buffer *flagsBuffer,
+        const VECTOR_CLASS<cl::Event> *events,
+        cl::Event *event);
+
+    /**
+     * Implementation of @ref enqueueInternal for the single-pass kernels. The
+     * parameters must already have been validated.
+     */
+    void enqueueSinglePass(
         const cl::CommandQueue &commandQueue,
         const cl::Buffer &inBuffer,
         const cl::Buffer &outBuffer,
@@ -132,6 +209,59 @@ private:
         std::size_t elements, const boost::any &parameters,
         const ScanProblem &problem);
 
+    /**
+     * Checks that the sub-group variant of the kernels computes the same
+     * scan as the local-memory variant, throwing @ref InternalError if not.
+     * The sub-group scans assume that sub-groups are consecutive ranges of
+     * local IDs, which OpenCL leaves to the implementation, so each
+     * candidate that uses them must pass this before it can be chosen.
+     */
+    static void checkSubgroups(
+        const cl::Context &context, const cl::Device &device,
+        const ScanParameters::Value &params, const ScanProblem &problem);
+
+    /**
+     * As for @ref tuneBlocksCallback, but first calls @ref checkSubgroups if
+     * the parameters use sub-groups.
+     */
+    static std::pair<double, double> tuneCollectivesCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const boost::any &parameters,
+        const ScanProblem &problem);
+
+    static std::pair<double, double> tuneSinglePassCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const boost::any &parameters,
+        const ScanProblem &problem);
+
+    /**
+     * Times a scan on the device and with the host backend, returning the
+     * two times in that order.
+     * @see @ref tuneHostCrossover
+     */
+    static std::pair<double, double> tuneHostCallback(
+        const cl::Context &context, const cl::Device &device,
+        std::size_t elements, const ScanParameters::Value &parameters,
+        const ScanProblem &problem);
+
+    /**
+     * Returns whether the single-pass kernels may be used for a problem on a
+     * device. They are not implemented for segmented scans or compensated
+     * summation, and they rely on concurrently running work-groups making
+     * progress, so they are limited to the devices accepted by
+     * @ref workGroupForwardProgress. Otherwise the look-back (and the tuning
+     * run that would measure it) could spin forever.
+     */
+    static bool singlePassSupported(const cl::Device &device, const ScanProblem &problem);
+
+    /**
+     * Returns whether the work-group reductions and scans of a problem may
+     * use sub-group or work-group built-ins, if the device provides them.
+     * This requires an operator and accumulator type that they implement,
+     * and an unsegmented scan.
+     */
+    static bool collectivesSupported(const ScanProblem &problem);
+
     /**
      * Returns key for looking up autotuning parameters.
      *
@@ -139,6 +269,30 @@ private:
      */
     static ScanParameters::Key makeKey(const cl::Device &device, const ScanProblem &problem);
 
+    /**
+     * Returns the type in which partial sums are accumulated, which is the
+     * element type unless wide accumulation is requested. If there is no
+     * suitable wider type, returns void.
+     */
+    static Type accumulatorType(const ScanProblem &problem);
+
+    /**
+     * Returns the type of the input elements, which is the element type
+     * unless a different input type is requested.
+     */
+    static Type inputType(const ScanProblem &problem);
+
+    /**
+     * Returns parameters estimated from the properties of @a device, for
+     * use while tuning runs in the background or in place of tuning when it
+     * is disabled (see @ref TunePolicy::isFallback).
+     *
+     * @param device      Device to tune for
+     * @param problem     Scan parameters
+     */
+    static ScanParameters::Value defaultParameters(
+        const cl::Device &device, const ScanProblem &problem);
+
     /**
      * Perform autotuning.
      *
@@ -180,10 +334,67 @@ public:
                  const VECTOR_CLASS<cl::Event> *events = NULL,
                  cl::Event *event = NULL);
 
+    /**
+     * Enqueue a batched scan operation on a command queue.
+     * @see @ref clogs::Scan::enqueueBatched.
+     */
+    void enqueueBatched(const cl::CommandQueue &commandQueue,
+                        const cl::Buffer &inBuffer,
+                        const cl::Buffer &outBuffer,
+                        ::size_t rows,
+                        ::size_t rowLength,
+                        ::size_t rowStride,
+                        const void *offset = NULL,
+                        const VECTOR_CLASS<cl::Event> *events = NULL,
+                        cl::Event *event = NULL);
+
+    /**
+     * Enqueue a segmented scan operation on a command queue, with head flags.
+     * @see @ref clogs::Scan::enqueueSegmented.
+     */
+    void enqueueSegmented(const cl::CommandQueue &commandQueue,
+                          const cl::Buffer &inBuffer,
+                          const cl::Buffer &outBuffer,
+                          ::size_t elements,
+                          const cl::Buffer &headFlags,
+                          const VECTOR_CLASS<cl::Event> *events = NULL,
+                          cl::Event *event = NULL);
+
+    /**
+     * Enqueue a segmented scan operation on a command queue, with segment offsets.
+     * @see @ref clogs::Scan::enqueueSegmentedOffsets.
+     */
+    void enqueueSegmentedOffsets(const cl::CommandQueue &commandQueue,
+                                 const cl::Buffer &inBuffer,
+                                 const cl::Buffer &outBuffer,
+                                 ::size_t elements,
+                                 const cl::Buffer &segmentOffsets,
+                                 ::size_t numSegments,
+                                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                                 cl::Event *event = NULL);
+
     /**
      * Return whether a type is supported for scanning on a device.
      */
     static bool typeSupported(const cl::Device &device, const Type &type);
+
+    /**
+     * Return whether a problem is supported on a device.
+     */
+    static bool problemSupported(const cl::Device &device, const ScanProblem &problem);
+
+    /**
+     * Return whether a problem is supported by the host backend.
+     */
+    static bool hostSupported(const ScanProblem &problem);
+
+    /**
+     * Scan in host memory.
+     * @see @ref clogs::hostScan and @ref clogs::hostScanSegmented.
+     */
+    static void scanHost(const ScanProblem &problem,
+                         const void *in, void *out, ::size_t elements,
+                         const void *offset, const cl_uchar *headFlags);
 };
 
 } // namespace detail
@@ -40,6 +40,9 @@
 #include <utility>
 #include <set>
 #include <vector>
+#include <atomic>
+#include <thread>
+#include <system_error>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -53,7 +56,8 @@ namespace clogs
 namespace detail
 {
 
-TunePolicy::TunePolicy() : enabled(true), verbosity(TUNE_VERBOSITY_NORMAL), out(&std::cout)
+TunePolicy::TunePolicy()
+    : enabled(true), background(false), fallback(false), verbosity(TUNE_VERBOSITY_NORMAL), out(&std::cout)
 {
 }
 
@@ -102,6 +106,25 @@ void TunePolicy::logEndTest(bool success, double rate) const
         *out << "!."[success] << std::flush;
 }
 
+void TunePolicy::logFailure(const std::string &what) const
+{
+    if (verbosity >= TUNE_VERBOSITY_TERSE)
+        *out << "Tuning failed: " << what << std::endl;
+}
+
+/// Set when the program exits, to abandon background tuning
+static std::atomic<bool> tuningAbandoned(false);
+
+/**
+ * Throws @ref TuneAbandoned if tuning has been abandoned. This is called
+ * before each tuning test.
+ */
+static void checkAbandoned()
+{
+    if (tuningAbandoned)
+        throw TuneAbandoned();
+}
+
 boost::any tuneOne(
     const TunePolicy &policy,
     const cl::Device &device,
@@ -128,6 +151,7 @@ boost::any tuneOne(
         for (std::size_t i = 0; i < retained.size(); i++)
         {
             boost::any &params = retained[i];
+            checkAbandoned();
             policy.logStartTest();
             bool valid = false;
             try
@@ -181,6 +205,101 @@ boost::any tuneOne(
     return boost::any();
 }
 
+std::size_t tuneHostCrossover(
+    const TunePolicy &policy,
+    const cl::Device &device,
+    const std::vector<std::size_t> &problemSizes,
+    std::function<
+        std::pair<double, double>(
+            const cl::Context &,
+            const cl::Device &,
+            std::size_t)> callback)
+{
+    policy.assertEnabled();
+    policy.logStartGroup();
+    std::size_t crossover = 0;
+    for (std::size_t i = 0; i < problemSizes.size(); i++)
+    {
+        checkAbandoned();
+        policy.logStartTest();
+        bool hostFaster = false;
+        try
+        {
+            cl::Context context = contextForDevice(device);
+            std::pair<double, double> r = callback(context, device, problemSizes[i]);
+            // The logged rate is the speedup of the host over the device
+            policy.logEndTest(true, r.first / r.second);
+            hostFaster = r.second < r.first;
+        }
+        catch (InternalError &e)
+        {
+            policy.logEndTest(false, 0.0);
+        }
+        catch (cl::Error &e)
+        {
+            policy.logEndTest(false, 0.0);
+        }
+        if (!hostFaster)
+            break;
+        crossover = problemSizes[i];
+    }
+    policy.logEndGroup();
+    return crossover;
+}
+
+std::vector<std::size_t> hostCrossoverSizes(std::size_t maxElements)
+{
+    std::vector<std::size_t> sizes;
+    for (std::size_t elements = 256; elements <= maxElements; elements *= 4)
+        sizes.push_back(elements);
+    return sizes;
+}
+
+BackgroundTuner::BackgroundTuner() : running(0)
+{
+    // Jobs write to the database, so it must be constructed first to outlive this object
+    getDB();
+}
+
+BackgroundTuner::~BackgroundTuner()
+{
+    tuningAbandoned = true;
+    wait();
+}
+
+BackgroundTuner &BackgroundTuner::get()
+{
+    static BackgroundTuner tuner;
+    return tuner;
+}
+
+bool BackgroundTuner::launch(const std::function<void()> &job)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    try
+    {
+        std::thread([this, job]()
+        {
+            job();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--running == 0)
+                idle.notify_all();
+        }).detach();
+    }
+    catch (std::system_error &e)
+    {
+        return false;
+    }
+    running++;
+    return true;
+}
+
+void BackgroundTuner::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return running == 0; });
+}
+
 CLOGS_LOCAL const TunePolicy &getDetail(const clogs::TunePolicy &tunePolicy)
 {
     assert(tunePolicy.detail_ != NULL);
@@ -219,6 +338,16 @@ void TunePolicy::setEnabled(bool enable)
     detail_->setEnabled(enable);
 }
 
+void TunePolicy::setBackground(bool background)
+{
+    detail_->setBackground(background);
+}
+
+void TunePolicy::setFallback(bool fallback)
+{
+    detail_->setFallback(fallback);
+}
+
 void TunePolicy::setVerbosity(TuneVerbosity verbosity)
 {
     detail_->setVerbosity(verbosity);
@@ -229,4 +358,9 @@ void TunePolicy::setOutput(std::ostream &out)
     detail_->setOutput(out);
 }
 
+void waitForTuning()
+{
+    detail::BackgroundTuner::get().wait();
+}
+
 } // namespace clogs
@@ -32,13 +32,19 @@
 #include <clogs/visibility_push.h>
 #include <string>
 #include <vector>
+#include <set>
 #include <ostream>
 #include <boost/any.hpp>
+#include <boost/noncopyable.hpp>
 #include <functional>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/tune.h>
 #include "cache_types.h"
+#include "cache.h"
 
 namespace cl
 {
@@ -62,18 +68,25 @@ class CLOGS_LOCAL TunePolicy
 {
 private:
     bool enabled;
+    bool background;
+    bool fallback;
     TuneVerbosity verbosity;
     std::ostream *out;
 
 public:
     /**
-     * Constructor. The default state is that tuning is permitted, verbosity level
-     * is normal, and output is sent to @c std::cout.
+     * Constructor. The default state is that tuning is permitted in the
+     * foreground, untuned algorithms cannot be constructed while it is
+     * disabled, verbosity level is normal, and output is sent to @c std::cout.
      */
     TunePolicy();
 
     /// Allow or deny on-the-fly tuning
     void setEnabled(bool enabled) { this->enabled = enabled; }
+    /// Set whether tuning runs in a background thread
+    void setBackground(bool background) { this->background = background; }
+    /// Set whether estimated parameters are used when tuning is disabled
+    void setFallback(bool fallback) { this->fallback = fallback; }
     /// Set how verbose output is
     void setVerbosity(TuneVerbosity verbosity) { this->verbosity = verbosity; }
     /**
@@ -83,6 +96,10 @@ public:
     void setOutput(std::ostream &out) { this->out = &out; }
     /// Returns whether tuning is permitted
     bool isEnabled() const { return enabled; }
+    /// Returns whether tuning is permitted and runs in a background thread
+    bool isBackground() const { return enabled && background; }
+    /// Returns whether tuning is denied and estimated parameters are used instead
+    bool isFallback() const { return !enabled && fallback; }
     /**
      * Checks that tuning is permitted, throwing an exception if not.
      *
@@ -111,6 +128,8 @@ public:
      * @param rate       Rate at which operations occurred (arbitrary scale)
      */
     void logEndTest(bool success, double rate) const;
+    /// Called when tuning in the background fails with an exception
+    void logFailure(const std::string &what) const;
 
     /**
      * @}
@@ -157,6 +176,139 @@ boost::any tuneOne(
             const boost::any &)> callback,
     double ratio = 0.5);
 
+/**
+ * Measure the problem size below which the host backend is faster than the
+ * device. The callback is called for each of @a problemSizes in turn (which
+ * must be increasing), and returns the time taken to run on the device and on
+ * the host, in that order. Both times should include all the overheads seen
+ * by the caller, such as launching kernels and mapping buffers. Measurement
+ * stops at the first problem size for which the device is faster.
+ *
+ * As for @ref tuneOne, the callback may throw @c cl::Error or @ref
+ * InternalError, which also stops the measurement.
+ *
+ * @return The largest problem size for which the host was faster, or 0 if there is none.
+ */
+std::size_t tuneHostCrossover(
+    const TunePolicy &policy,
+    const cl::Device &device,
+    const std::vector<std::size_t> &problemSizes,
+    std::function<
+        std::pair<double, double>(
+            const cl::Context &,
+            const cl::Device &,
+            std::size_t)> callback);
+
+/**
+ * Returns the problem sizes to pass to @ref tuneHostCrossover: powers of 4
+ * from 256 up to at most @a maxElements.
+ */
+std::vector<std::size_t> hostCrossoverSizes(std::size_t maxElements);
+
+/**
+ * Thrown by the tuning functions when background tuning is abandoned at
+ * program exit. This is the expected outcome for unfinished jobs rather than
+ * a failure, so @ref BackgroundTuner does not report it. By then the output
+ * stream of the policy may already have been destroyed.
+ */
+class CLOGS_LOCAL TuneAbandoned : public TuneError
+{
+public:
+    TuneAbandoned() : TuneError("tuning abandoned at exit") {}
+};
+
+/**
+ * Runs autotuning in background threads, for @ref TunePolicy::setBackground.
+ * There is a single instance. When it is destroyed at program exit, running
+ * jobs are abandoned at their next tuning test.
+ */
+class CLOGS_LOCAL BackgroundTuner : public boost::noncopyable
+{
+private:
+    std::mutex mutex;
+    std::condition_variable idle;   ///< Signalled when @ref running drops to zero
+    std::size_t running;            ///< Number of jobs that have not finished
+
+    /**
+     * @name Keys of the problems being tuned, so that each is tuned only once
+     * @{
+     */
+    std::set<ScanParameters::Key> scanKeys;
+    std::set<ReduceParameters::Key> reduceKeys;
+    std::set<RadixsortParameters::Key> radixsortKeys;
+    std::set<CompactParameters::Key> compactKeys;
+    /** @} */
+
+    std::set<ScanParameters::Key> &pendingKeys(const ScanParameters::Key *) { return scanKeys; }
+    std::set<ReduceParameters::Key> &pendingKeys(const ReduceParameters::Key *) { return reduceKeys; }
+    std::set<RadixsortParameters::Key> &pendingKeys(const RadixsortParameters::Key *) { return radixsortKeys; }
+    std::set<CompactParameters::Key> &pendingKeys(const CompactParameters::Key *) { return compactKeys; }
+
+    BackgroundTuner();
+
+    /**
+     * Runs @a job in a new thread. Returns false if the thread could not be
+     * created.
+     */
+    bool launch(const std::function<void()> &job);
+
+public:
+    ~BackgroundTuner();
+
+    /// Returns the singleton instance
+    static BackgroundTuner &get();
+
+    /**
+     * Calls @a tune in a background thread and stores the result in @a table
+     * under @a key, unless that key is already being tuned. Exceptions other
+     * than @ref TuneAbandoned are reported to @a policy and otherwise
+     * ignored, so that tuning is retried the next time the algorithm is
+     * constructed.
+     */
+    template<typename K, typename V>
+    void start(Table<K, V> &table, const K &key, const TunePolicy &policy,
+               const std::function<V()> &tune);
+
+    /// Waits for all the running jobs to finish
+    void wait();
+};
+
+template<typename K, typename V>
+void BackgroundTuner::start(
+    Table<K, V> &table, const K &key, const TunePolicy &policy,
+    const std::function<V()> &tune)
+{
+    std::set<K> &keys = pendingKeys(&key);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!keys.insert(key).second)
+            return;
+    }
+
+    const std::function<void()> job = [this, &table, &keys, key, policy, tune]()
+    {
+        try
+        {
+            table.add(key, tune());
+        }
+        catch (TuneAbandoned &)
+        {
+            // Not a failure, and the output stream may no longer exist
+        }
+        catch (std::exception &e)
+        {
+            policy.logFailure(e.what());
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        keys.erase(key);
+    };
+    if (!launch(job))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        keys.erase(key);
+    }
+}
+
 } // namespace detail
 } // namespace clogs
 
@@ -0,0 +1,350 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Unique and run-length encoding implementation.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <cassert>
+#include <vector>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include <clogs/unique.h>
+#include "unique.h"
+#include "scan.h"
+#include "utils.h"
+#include "tune.h"
+
+namespace clogs
+{
+
+namespace detail
+{
+
+void UniqueProblem::setKeyType(const Type &keyType)
+{
+    if (keyType.getBaseType() == TYPE_VOID)
+        throw std::invalid_argument("keyType must not be void");
+    this->keyType = keyType;
+}
+
+void UniqueProblem::setTunePolicy(const TunePolicy &tunePolicy)
+{
+    this->tunePolicy = tunePolicy;
+}
+
+ScanProblem Unique::makeScanProblem(const UniqueProblem &problem)
+{
+    ScanProblem scanProblem;
+    scanProblem.setType(TYPE_UINT);
+    scanProblem.setTunePolicy(problem.tunePolicy);
+    return scanProblem;
+}
+
+bool Unique::keyTypeSupported(const cl::Device &device, const Type &keyType)
+{
+    return keyType.isStorable(device) && keyType.isComputable(device);
+}
+
+::size_t Unique::checkedKeySize(const cl::Device &device, const UniqueProblem &problem)
+{
+    if (!keyTypeSupported(device, problem.keyType))
+        throw std::invalid_argument("keyType is not valid");
+    return problem.keyType.getSize();
+}
+
+Unique::Unique(const cl::Context &context, const cl::Device &device, const UniqueProblem &problem)
+    : keySize(checkedKeySize(device, problem)),
+      scan(context, device, makeScanProblem(problem))
+{
+    std::map<std::string, int> defines;
+    std::map<std::string, std::string> stringDefines;
+    if (problem.keyType.getBaseType() == TYPE_HALF)
+        defines["ENABLE_KHR_FP16"] = 1;
+    if (problem.keyType.getBaseType() == TYPE_DOUBLE)
+        defines["ENABLE_KHR_FP64"] = 1;
+    stringDefines["KEY_T"] = problem.keyType.getName();
+    if (problem.keyType.getLength() == 1)
+        stringDefines["KEY_DIFFERENT(a, b)"] = "((a) != (b))";
+    else
+        stringDefines["KEY_DIFFERENT(a, b)"] = "any((a) != (b))";
+
+    try
+    {
+        program = build(context, device, "unique.cl", defines, stringDefines);
+        flagsKernel = cl::Kernel(program, "uniqueFlags");
+        scatterKernel = cl::Kernel(program, "uniqueScatter");
+        countsKernel = cl::Kernel(program, "uniqueCounts");
+    }
+    catch (cl::Error &e)
+    {
+        throw InternalError(std::string("Error preparing kernels for unique: ") + e.what());
+    }
+}
+
+void Unique::setEventCallback(
+    void (CL_CALLBACK *callback)(cl_event, void *),
+    void *userData,
+    void (CL_CALLBACK *free)(void *))
+{
+    Algorithm::setEventCallback(callback, userData, free);
+    // The user data is only freed once, by this object
+    scan.setEventCallback(callback, userData, NULL);
+}
+
+void Unique::enqueue(const cl::CommandQueue &commandQueue,
+                     const cl::Buffer &keysBuffer,
+                     const cl::Buffer &uniqueBuffer,
+                     const cl::Buffer &countsBuffer,
+                     const cl::Buffer &numRunsBuffer,
+                     ::size_t numRunsPosition,
+                     ::size_t elements,
+                     const VECTOR_CLASS<cl::Event> *events,
+                     cl::Event *event)
+{
+    /* Validate parameters */
+    if (elements == 0)
+        throw cl::Error(CL_INVALID_GLOBAL_WORK_SIZE, "clogs::Unique::enqueue: elements is zero");
+    if (elements >= 0xFFFFFFFFu)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: too many elements");
+    if (keysBuffer.getInfo<CL_MEM_SIZE>() / keySize < elements)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: range out of keys buffer bounds");
+    if (!(keysBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_READ_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: keys buffer is not readable");
+    if (uniqueBuffer() != NULL)
+    {
+        if (uniqueBuffer.getInfo<CL_MEM_SIZE>() / keySize < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: range out of unique buffer bounds");
+        if (!(uniqueBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: unique buffer is not writable");
+    }
+    if (countsBuffer() != NULL)
+    {
+        if (countsBuffer.getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) < elements)
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: range out of counts buffer bounds");
+        if (!(countsBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+            throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: counts buffer is not writable");
+    }
+    if (numRunsBuffer.getInfo<CL_MEM_SIZE>() / sizeof(cl_uint) <= numRunsPosition)
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: numRuns position out of buffer bounds");
+    if (!(numRunsBuffer.getInfo<CL_MEM_FLAGS>() & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY)))
+        throw cl::Error(CL_INVALID_VALUE, "clogs::Unique::enqueue: numRuns buffer is not writable");
+
+    const cl::Context &context = commandQueue.getInfo<CL_QUEUE_CONTEXT>();
+
+    /* Temporary storage is kept between calls, and only grown when needed.
+     * The starts buffer has one extra slot for the end of the last run and
+     * one for the number of runs.
+     */
+    if (!positions() || positions.getInfo<CL_MEM_SIZE>() < elements * sizeof(cl_uint))
+        positions = cl::Buffer(context, CL_MEM_READ_WRITE, elements * sizeof(cl_uint));
+    const bool wantCounts = countsBuffer() != NULL;
+    if (wantCounts
+        && (!starts() || starts.getInfo<CL_MEM_SIZE>() < (elements + 2) * sizeof(cl_uint)))
+        starts = cl::Buffer(context, CL_MEM_READ_WRITE, (elements + 2) * sizeof(cl_uint));
+
+    flagsKernel.setArg(0, positions);
+    flagsKernel.setArg(1, keysBuffer);
+
+    scatterKernel.setArg(0, uniqueBuffer);
+    scatterKernel.setArg(1, wantCounts ? starts : cl::Buffer());
+    scatterKernel.setArg(2, numRunsBuffer);
+    scatterKernel.setArg(3, (cl_uint) numRunsPosition);
+    scatterKernel.setArg(4, keysBuffer);
+    scatterKernel.setArg(5, positions);
+    scatterKernel.setArg(6, (cl_uint) elements);
+
+    std::vector<cl::Event> flagsEvents(1);
+    std::vector<cl::Event> scanEvents(1);
+    std::vector<cl::Event> scatterEvents(1);
+    commandQueue.enqueueNDRangeKernel(flagsKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(elements),
+                                      cl::NullRange,
+                                      events, &flagsEvents[0]);
+    doEventCallback(flagsEvents[0]);
+    scan.enqueue(commandQueue, positions, positions, elements, NULL,
+                 &flagsEvents, &scanEvents[0]);
+    commandQueue.enqueueNDRangeKernel(scatterKernel,
+                                      cl::NullRange,
+                                      cl::NDRange(elements),
+                                      cl::NullRange,
+                                      &scanEvents, &scatterEvents[0]);
+    doEventCallback(scatterEvents[0]);
+    if (wantCounts)
+    {
+        cl::Event countsEvent;
+        countsKernel.setArg(0, countsBuffer);
+        countsKernel.setArg(1, starts);
+        countsKernel.setArg(2, (cl_uint) elements);
+        commandQueue.enqueueNDRangeKernel(countsKernel,
+                                          cl::NullRange,
+                                          cl::NDRange(elements),
+                                          cl::NullRange,
+                                          &scatterEvents, &countsEvent);
+        doEventCallback(countsEvent);
+        if (event != NULL)
+            *event = countsEvent;
+    }
+    else if (event != NULL)
+        *event = scatterEvents[0];
+}
+
+const UniqueProblem &getDetail(const clogs::UniqueProblem &problem)
+{
+    return *problem.detail_;
+}
+
+} // namespace detail
+
+UniqueProblem::UniqueProblem() : detail_(new detail::UniqueProblem())
+{
+}
+
+UniqueProblem::~UniqueProblem()
+{
+    delete detail_;
+}
+
+UniqueProblem::UniqueProblem(const UniqueProblem &other)
+    : detail_(new detail::UniqueProblem(*other.detail_))
+{
+}
+
+UniqueProblem &UniqueProblem::operator=(const UniqueProblem &other)
+{
+    if (detail_ != other.detail_)
+    {
+        detail::UniqueProblem *tmp = new detail::UniqueProblem(*other.detail_);
+        delete detail_;
+        detail_ = tmp;
+    }
+    return *this;
+}
+
+void UniqueProblem::setKeyType(const Type &keyType)
+{
+    assert(detail_ != NULL);
+    detail_->setKeyType(keyType);
+}
+
+void UniqueProblem::setTunePolicy(const TunePolicy &tunePolicy)
+{
+    assert(detail_ != NULL);
+    detail_->setTunePolicy(detail::getDetail(tunePolicy));
+}
+
+
+Unique::Unique()
+{
+}
+
+detail::Unique *Unique::getDetail() const
+{
+    return static_cast<detail::Unique *>(Algorithm::getDetail());
+}
+
+detail::Unique *Unique::getDetailNonNull() const
+{
+    return static_cast<detail::Unique *>(Algorithm::getDetailNonNull());
+}
+
+void Unique::construct(cl_context context, cl_device_id device, const UniqueProblem &problem,
+                       cl_int &err, const char *&errStr)
+{
+    try
+    {
+        setDetail(new detail::Unique(
+            detail::retainWrap<cl::Context>(context),
+            detail::retainWrap<cl::Device>(device),
+            detail::getDetail(problem)));
+        detail::clearError(err, errStr);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void Unique::moveAssign(Unique &other)
+{
+    delete static_cast<detail::Unique *>(Algorithm::moveAssign(other));
+}
+
+Unique::~Unique()
+{
+    delete getDetail();
+}
+
+void Unique::enqueue(cl_command_queue commandQueue,
+                     cl_mem keysBuffer,
+                     cl_mem uniqueBuffer,
+                     cl_mem countsBuffer,
+                     cl_mem numRunsBuffer,
+                     ::size_t numRunsPosition,
+                     ::size_t elements,
+                     cl_uint numEvents,
+                     const cl_event *events,
+                     cl_event *event,
+                     cl_int &err,
+                     const char *&errStr)
+{
+    try
+    {
+        VECTOR_CLASS<cl::Event> events_ = detail::retainWrap<cl::Event>(numEvents, events);
+        cl::Event event_;
+        getDetailNonNull()->enqueue(
+            detail::retainWrap<cl::CommandQueue>(commandQueue),
+            detail::retainWrap<cl::Buffer>(keysBuffer),
+            detail::retainWrap<cl::Buffer>(uniqueBuffer),
+            detail::retainWrap<cl::Buffer>(countsBuffer),
+            detail::retainWrap<cl::Buffer>(numRunsBuffer),
+            numRunsPosition, elements,
+            events ? &events_ : NULL,
+            event ? &event_ : NULL);
+        detail::clearError(err, errStr);
+        detail::unwrap(event_, event);
+    }
+    catch (cl::Error &e)
+    {
+        detail::setError(err, errStr, e);
+    }
+}
+
+void swap(Unique &a, Unique &b)
+{
+    a.swap(b);
+}
+
+} // namespace clogs
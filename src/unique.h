@@ -0,0 +1,135 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Unique and run-length encoding implementation.
+ */
+
+#ifndef UNIQUE_H
+#define UNIQUE_H
+
+#include "clhpp11.h"
+
+#include <clogs/visibility_push.h>
+#include <cstddef>
+#include <vector>
+#include <clogs/visibility_pop.h>
+
+#include <clogs/core.h>
+#include "utils.h"
+#include "tune.h"
+#include "scan.h"
+
+namespace clogs
+{
+namespace detail
+{
+
+class Unique;
+
+/**
+ * Internal implementation of @ref clogs::UniqueProblem.
+ */
+class CLOGS_LOCAL UniqueProblem
+{
+private:
+    friend class Unique;
+    Type keyType;
+    TunePolicy tunePolicy;
+
+public:
+    void setKeyType(const Type &keyType);
+    void setTunePolicy(const TunePolicy &tunePolicy);
+};
+
+/**
+ * Internal implementation of @ref clogs::Unique.
+ */
+class CLOGS_LOCAL Unique : public Algorithm
+{
+private:
+    ::size_t keySize;                ///< Size of the key type
+    cl::Program program;             ///< Program containing the kernels
+    cl::Kernel flagsKernel;          ///< Marks the first key of each run
+    cl::Kernel scatterKernel;        ///< Writes out the first key and start of each run
+    cl::Kernel countsKernel;         ///< Converts run starts to run lengths
+    Scan scan;                       ///< Converts the marks to output positions
+    cl::Buffer positions;            ///< Run marks, scanned in place to give positions
+    cl::Buffer starts;               ///< Start of each run, plus the number of runs
+
+    /**
+     * Returns the size of the key type, after checking that it is supported
+     * on @a device. This is called from the initializer list, so that an
+     * invalid key type is reported before the scan is constructed (which
+     * may involve tuning).
+     *
+     * @throw std::invalid_argument if the key type is not supported
+     */
+    static ::size_t checkedKeySize(const cl::Device &device, const UniqueProblem &problem);
+
+    /**
+     * Make a scan problem for scanning the run marks.
+     */
+    static ScanProblem makeScanProblem(const UniqueProblem &problem);
+
+public:
+    /**
+     * Constructor.
+     * @see @ref clogs::Unique::Unique(const cl::Context &, const cl::Device &, const UniqueProblem &)
+     */
+    Unique(const cl::Context &context, const cl::Device &device, const UniqueProblem &problem);
+
+    /**
+     * Set a callback to be notified of enqueued commands, including those
+     * of the internal scan.
+     * @see @ref clogs::Scan::setEventCallback
+     */
+    virtual void setEventCallback(
+        void (CL_CALLBACK *callback)(cl_event, void *),
+        void *userData,
+        void (CL_CALLBACK *free)(void *));
+
+    /**
+     * Enqueue a unique or run-length encoding operation on a command queue.
+     * @see @ref clogs::Unique::enqueue.
+     */
+    void enqueue(const cl::CommandQueue &commandQueue,
+                 const cl::Buffer &keysBuffer,
+                 const cl::Buffer &uniqueBuffer,
+                 const cl::Buffer &countsBuffer,
+                 const cl::Buffer &numRunsBuffer,
+                 ::size_t numRunsPosition,
+                 ::size_t elements,
+                 const VECTOR_CLASS<cl::Event> *events = NULL,
+                 cl::Event *event = NULL);
+
+    /**
+     * Return whether a type is supported as a key type on a device.
+     */
+    static bool keyTypeSupported(const cl::Device &device, const Type &keyType);
+};
+
+} // namespace detail
+} // namespace clogs
+
+#endif /* UNIQUE_H */
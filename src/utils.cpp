@@ -36,6 +36,7 @@
 #include <locale>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <clogs/visibility_pop.h>
 
 #include <clogs/core.h>
@@ -124,6 +125,162 @@ unsigned int getWarpSizeSchedule(const cl::Device &device)
     return 1U;
 }
 
+bool workGroupForwardProgress(const cl::Device &device)
+{
+    static const cl_uint vendorNvidia = 0x10DE;
+    static const cl_uint vendorAmd = 0x1002;
+    static const cl_uint vendorIntel = 0x8086;
+
+    const cl_device_type type = device.getInfo<CL_DEVICE_TYPE>();
+    const cl_uint vendor = device.getInfo<CL_DEVICE_VENDOR_ID>();
+    if (type & CL_DEVICE_TYPE_GPU)
+        return vendor == vendorNvidia || vendor == vendorAmd || vendor == vendorIntel;
+    else if (type & CL_DEVICE_TYPE_CPU)
+        return vendor == vendorAmd || vendor == vendorIntel;
+    else
+        return false;
+}
+
+::size_t getDefaultWorkGroupSize(const cl::Device &device, ::size_t maxWorkGroupSize)
+{
+    ::size_t size;
+    if (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU)
+        size = 16;
+    else
+        size = std::max(::size_t(128), ::size_t(4) * getWarpSizeSchedule(device));
+    return roundDownPower2(std::min(size, maxWorkGroupSize));
+}
+
+std::string getSubgroupExtension(const cl::Device &device)
+{
+    if (deviceHasExtension(device, "cl_intel_subgroups"))
+        return "cl_intel_subgroups";
+    if (deviceHasExtension(device, "cl_khr_subgroups")
+        && getSubgroupBuildOptions(device) != "")
+        return "cl_khr_subgroups";
+    return "";
+}
+
+std::string getSubgroupBuildOptions(const cl::Device &device)
+{
+    if (deviceHasExtension(device, "cl_intel_subgroups"))
+        return "";
+    return getLanguageBuildOptions(device);
+}
+
+/* OpenCL 3.0 queries, which are missing from the OpenCL 1.1 headers that
+ * clhpp11.h restricts us to.
+ */
+#ifndef CL_DEVICE_OPENCL_C_ALL_VERSIONS
+# define CL_DEVICE_OPENCL_C_ALL_VERSIONS 0x1066
+#endif
+#ifndef CL_DEVICE_OPENCL_C_FEATURES
+# define CL_DEVICE_OPENCL_C_FEATURES 0x106F
+#endif
+
+namespace
+{
+
+/// Layout of @c cl_name_version from OpenCL 3.0
+struct NameVersion
+{
+    cl_uint version;
+    char name[64];
+};
+
+} // anonymous namespace
+
+/**
+ * Parses a version string of the form "<prefix><major>.<minor> ...", returning
+ * 100 times the major version plus 10 times the minor version, or 0 if the
+ * string does not have that form.
+ */
+static unsigned int parseVersion(const std::string &version, const std::string &prefix)
+{
+    unsigned int major = 0, minor = 0;
+    char dot = 0;
+    std::istringstream in(version.substr(std::min(prefix.size(), version.size())));
+    in.imbue(std::locale::classic());
+    if (version.compare(0, prefix.size(), prefix) != 0
+        || !(in >> major >> dot >> minor) || dot != '.')
+        return 0;
+    return major * 100 + minor * 10;
+}
+
+/**
+ * Retrieves an OpenCL 3.0 device query that returns an array of
+ * @c cl_name_version. An empty array is returned if the query fails.
+ */
+static std::vector<NameVersion> getNameVersions(const cl::Device &device, cl_device_info param)
+{
+    std::vector<NameVersion> out;
+    ::size_t size = 0;
+    if (clGetDeviceInfo(device(), param, 0, NULL, &size) != CL_SUCCESS
+        || size < sizeof(NameVersion))
+        return out;
+    out.resize(size / sizeof(NameVersion));
+    if (clGetDeviceInfo(device(), param, out.size() * sizeof(NameVersion), &out[0], NULL) != CL_SUCCESS)
+        out.clear();
+    return out;
+}
+
+/// Returns whether the OpenCL version of @a device is 3.0 or later
+static bool isOpenCL3(const cl::Device &device)
+{
+    return parseVersion(device.getInfo<CL_DEVICE_VERSION>(), "OpenCL ") >= 300;
+}
+
+unsigned int getLanguageVersion(const cl::Device &device)
+{
+    /* OpenCL 3.0 devices report "OpenCL C 1.2" in CL_DEVICE_OPENCL_C_VERSION
+     * for the sake of old applications, and list the versions they really
+     * support separately. Versions are encoded as major << 22 | minor << 12 |
+     * patch.
+     */
+    if (isOpenCL3(device))
+    {
+        unsigned int best = 0;
+        const std::vector<NameVersion> versions = getNameVersions(device, CL_DEVICE_OPENCL_C_ALL_VERSIONS);
+        for (std::size_t i = 0; i < versions.size(); i++)
+        {
+            const cl_uint v = versions[i].version;
+            best = std::max(best, (v >> 22) * 100 + ((v >> 12) & 0x3ff) * 10);
+        }
+        if (best > 0)
+            return best;
+    }
+    const unsigned int version = parseVersion(
+        device.getInfo<CL_DEVICE_OPENCL_C_VERSION>(), "OpenCL C ");
+    return version > 0 ? version : 100;
+}
+
+bool workGroupFunctionsSupported(const cl::Device &device)
+{
+    const unsigned int version = getLanguageVersion(device);
+    if (version >= 300)
+    {
+        // Optional in OpenCL C 3.0
+        const std::vector<NameVersion> features = getNameVersions(device, CL_DEVICE_OPENCL_C_FEATURES);
+        for (std::size_t i = 0; i < features.size(); i++)
+            if (std::strncmp(features[i].name, "__opencl_c_work_group_collective_functions",
+                             sizeof(features[i].name)) == 0)
+                return true;
+        return false;
+    }
+    return version >= 200;
+}
+
+std::string getLanguageBuildOptions(const cl::Device &device)
+{
+    const unsigned int version = getLanguageVersion(device);
+    if (version >= 300)
+        return "-cl-std=CL3.0";
+    else if (version >= 200)
+        return "-cl-std=CL2.0";
+    else
+        return "";
+}
+
 cl::Context contextForDevice(const cl::Device &device)
 {
     cl_context_properties props[3] =
@@ -209,6 +366,7 @@ cl::Program build(
     KernelParameters::Key key;
     key.device = deviceKey(device);
     key.header = s.str();
+    key.options = options;
     key.checksum = source.checksum;
     KernelParameters::Value value;
     if (getDB().kernel.lookup(key, value))
@@ -32,6 +32,7 @@
 #include "clhpp11.h"
 
 #include <clogs/visibility_push.h>
+#include <cstddef>
 #include <string>
 #include <map>
 #include <vector>
@@ -75,16 +76,17 @@ protected:
 
 public:
     /**
-     * Set a callback to be notified of enqueued commands.
+     * Set a callback to be notified of enqueued commands. Algorithms that
+     * are built on other algorithms override this to forward the callback.
      * @see @ref clogs::Scan::setEventCallback
      */
-    void setEventCallback(
+    virtual void setEventCallback(
         void (CL_CALLBACK *callback)(cl_event, void *),
         void *userData,
         void (CL_CALLBACK *free)(void *));
 
     Algorithm();
-    ~Algorithm();
+    virtual ~Algorithm();
 };
 
 /**
@@ -113,6 +115,63 @@ CLOGS_LOCAL unsigned int getWarpSizeMem(const cl::Device &device);
  */
 CLOGS_LOCAL unsigned int getWarpSizeSchedule(const cl::Device &device);
 
+/**
+ * Returns whether a work-group that has started running on @a device keeps
+ * making progress while other work-groups spin waiting for it. OpenCL does
+ * not promise this and offers no query for it, so this is an allow-list of
+ * the desktop GPU vendors (NVIDIA, AMD and Intel), whose work-groups stay
+ * resident once started, and of CPU devices from AMD and Intel, whose
+ * runtimes give each running work-group an operating system thread. Other
+ * devices (such as mobile GPUs) may time-slice work-groups and are excluded.
+ */
+CLOGS_LOCAL bool workGroupForwardProgress(const cl::Device &device);
+
+/**
+ * Returns a work group size for kernels that have not been tuned, as a power
+ * of two no larger than @a maxWorkGroupSize. GPUs get a few scheduling warps
+ * per group to hide latency. CPU runtimes run the work-items of a group as a
+ * loop that every barrier has to split, so they get small groups.
+ */
+CLOGS_LOCAL ::size_t getDefaultWorkGroupSize(const cl::Device &device, ::size_t maxWorkGroupSize);
+
+/**
+ * Returns the extension that provides sub-group built-ins such as
+ * @c sub_group_reduce_add on @a device (@c cl_intel_subgroups or
+ * @c cl_khr_subgroups), or an empty string if there is none.
+ */
+CLOGS_LOCAL std::string getSubgroupExtension(const cl::Device &device);
+
+/**
+ * Returns the build options needed for the extension returned by
+ * @ref getSubgroupExtension. The built-ins of @c cl_khr_subgroups only
+ * exist in OpenCL C 2.0 and later.
+ */
+CLOGS_LOCAL std::string getSubgroupBuildOptions(const cl::Device &device);
+
+/**
+ * Returns the newest OpenCL C version supported by @a device, as 100 times
+ * the major version plus 10 times the minor version (for example, 120 for
+ * OpenCL C 1.2). On OpenCL 3.0 devices this comes from
+ * @c CL_DEVICE_OPENCL_C_ALL_VERSIONS, since @c CL_DEVICE_OPENCL_C_VERSION
+ * may report an older version.
+ */
+CLOGS_LOCAL unsigned int getLanguageVersion(const cl::Device &device);
+
+/**
+ * Returns whether the OpenCL C work-group collective functions (such as
+ * @c work_group_reduce_add) are available on @a device. They are part of
+ * OpenCL C 2.0, and an optional feature in OpenCL C 3.0.
+ */
+CLOGS_LOCAL bool workGroupFunctionsSupported(const cl::Device &device);
+
+/**
+ * Returns the build options that select the newest OpenCL C version
+ * supported by @a device, if it is 2.0 or later. Programs are otherwise
+ * compiled as OpenCL C 1.x, which lacks features such as the work-group
+ * collective functions.
+ */
+CLOGS_LOCAL std::string getLanguageBuildOptions(const cl::Device &device);
+
 /**
  * Create a context that contains only @a device.
  */
@@ -136,6 +195,7 @@ CLOGS_LOCAL void enableUnitTests();
 /**
  * Create a program. If a valid binary is found in the cache it is used,
  * otherwise the program is built from source and the cache is updated.
+ * The cache is keyed by the build @a options as well as the defines.
  */
 CLOGS_LOCAL cl::Program build(
     const cl::Context &context,
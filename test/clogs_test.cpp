@@ -161,10 +161,34 @@ int main(int argc, const char ** argv)
     {
         po::variables_map vm = processOptions(argc, argv);
 
+        bool haveDevice = false;
+        if (!vm.count("list"))
+        {
+            try
+            {
+                haveDevice = findDevice(vm, g_device);
+            }
+            catch (cl::Error &)
+            {
+                // Typically means that there are no OpenCL platforms at all
+            }
+            if (haveDevice)
+                cout << "Using device " << g_device.getInfo<CL_DEVICE_NAME>() << "\n";
+            else
+                cerr << "No suitable OpenCL device found: only running host tests\n";
+        }
+
+        /* The tests in the "host" registry do not use OpenCL, so they can
+         * run even without a device.
+         */
         CppUnit::TestSuite *rootSuite = new CppUnit::TestSuite("All tests");
-        CppUnit::TestFactoryRegistry::getRegistry().addTestToSuite(rootSuite);
-        if (vm.count("benchmark"))
-            CppUnit::TestFactoryRegistry::getRegistry("benchmark").addTestToSuite(rootSuite);
+        CppUnit::TestFactoryRegistry::getRegistry("host").addTestToSuite(rootSuite);
+        if (haveDevice || vm.count("list"))
+        {
+            CppUnit::TestFactoryRegistry::getRegistry().addTestToSuite(rootSuite);
+            if (vm.count("benchmark"))
+                CppUnit::TestFactoryRegistry::getRegistry("benchmark").addTestToSuite(rootSuite);
+        }
         if (vm.count("list"))
         {
             listTests(rootSuite, "");
@@ -174,16 +198,8 @@ int main(int argc, const char ** argv)
         if (vm.count("test"))
             path = vm["test"].as<string>();
 
-        if (!findDevice(vm, g_device))
-        {
-            cerr << "No suitable OpenCL device found\n";
-            return 1;
-        }
-        else
-        {
-            cout << "Using device " << g_device.getInfo<CL_DEVICE_NAME>() << "\n";
-        }
-        g_context = makeContext(g_device);
+        if (haveDevice)
+            g_context = makeContext(g_device);
 
         CppUnit::BriefTestProgressListener listener;
         CppUnit::TextTestRunner runner;
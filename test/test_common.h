@@ -32,6 +32,8 @@
 #include <stdexcept>
 #include <utility>
 #include <memory>
+#include <limits>
+#include <algorithm>
 #include <clogs/core.h>
 #include <clogs/platform.h>
 #include "clogs_test.h"
@@ -120,6 +122,44 @@ void TestCommon<T>::testUninitialized()
     obj.setEventCallback(eventCallback, NULL);
 }
 
+/**
+ * Host implementation of the built-in operators on integral scalars, for
+ * computing model answers.
+ */
+template<typename T>
+T applyOperator(OperatorType op, const T &a, const T &b)
+{
+    switch (op)
+    {
+    case OPERATOR_SUM: return a + b;
+    case OPERATOR_MIN: return std::min(a, b);
+    case OPERATOR_MAX: return std::max(a, b);
+    case OPERATOR_AND: return a & b;
+    case OPERATOR_OR:  return a | b;
+    case OPERATOR_XOR: return a ^ b;
+    }
+    throw std::invalid_argument("unknown operator");
+}
+
+/**
+ * The identity element for @ref applyOperator.
+ */
+template<typename T>
+T operatorIdentity(OperatorType op)
+{
+    switch (op)
+    {
+    case OPERATOR_SUM:
+    case OPERATOR_OR:
+    case OPERATOR_XOR:
+        return T(0);
+    case OPERATOR_MIN: return std::numeric_limits<T>::max();
+    case OPERATOR_MAX: return std::numeric_limits<T>::min();
+    case OPERATOR_AND: return T(~T(0));
+    }
+    throw std::invalid_argument("unknown operator");
+}
+
 } // namespace Test
 } // namespace clogs
 
@@ -0,0 +1,272 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Test code for stream compaction.
+ */
+
+#include "../src/clhpp11.h"
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <cstddef>
+#include <random>
+#include <clogs/compact.h>
+#include <clogs/platform.h>
+#include "clogs_test.h"
+#include "test_common.h"
+#include "../src/compact.h"
+
+/// How the elements to select are specified in a test
+enum SelectMode
+{
+    SELECT_ELEMENTS,     ///< Non-zero elements are selected
+    SELECT_STENCIL,      ///< Non-zero stencil values are selected
+    SELECT_PREDICATE     ///< A predicate on the elements is used
+};
+
+class TestCompact : public clogs::Test::TestCommon<clogs::Compact>
+{
+    CPPUNIT_TEST_SUB_SUITE(TestCompact, clogs::Test::TestCommon<clogs::Compact>);
+    CPPUNIT_TEST_SUITE_ADD_CUSTOM_TESTS(addCustomTests);
+    CPPUNIT_TEST(testEventCallback);
+    CPPUNIT_TEST_EXCEPTION(testZero, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testMissingStencil, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testUnwriteableCount, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testOutputOverflow, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testVectorNoPredicate, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testMultilinePredicate, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testUninitializedProblem, std::invalid_argument);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    virtual clogs::Compact *factory();
+
+private:
+    /// Add tests dynamically
+    static void addCustomTests(TestSuiteBuilderContextType &context);
+
+    /// Test normal operation of @ref clogs::Compact
+    template<typename Tag>
+    void testNormal(size_t elements, SelectMode mode, bool indices);
+
+    /// Test that the event callback is called the appropriate number of times
+    void testEventCallback();
+
+    void testZero();               ///< Test error handling with zero elements
+    void testMissingStencil();     ///< Test error handling when the stencil buffer is missing
+    void testUnwriteableCount();   ///< Test error handling with an unwriteable count buffer
+    void testOutputOverflow();     ///< Test error handling when output buffer is too small
+    void testVectorNoPredicate();  ///< Test error handling for vector flags without a predicate
+    void testMultilinePredicate(); ///< Test error handling for a predicate with a newline
+    void testUninitializedProblem(); ///< Test error handling when problem is uninitialized
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TestCompact);
+
+clogs::Compact *TestCompact::factory()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    return new clogs::Compact(context, device, problem);
+}
+
+void TestCompact::addCustomTests(TestSuiteBuilderContextType &context)
+{
+    const std::size_t sizes[] = {1, 17, 0x80, 0xffff, 0x10000, 0x210000, 0x210123};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        std::ostringstream name;
+        name << sizes[i];
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_UINT> >, name.str(), sizes[i], SELECT_ELEMENTS, false);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_UCHAR> >, name.str(), sizes[i], SELECT_ELEMENTS, true);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_LONG> >, name.str() + "+S", sizes[i], SELECT_STENCIL, true);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_SHORT> >, name.str() + "+P", sizes[i], SELECT_PREDICATE, false);
+
+        typedef clogs::Test::TypeTag<clogs::TYPE_INT, 3> int3_tag;
+        typedef clogs::Test::TypeTag<clogs::TYPE_UCHAR, 8> uchar8_tag;
+        CLOGS_TEST_BIND_NAME(testNormal<int3_tag>, name.str() + "+S", sizes[i], SELECT_STENCIL, true);
+        CLOGS_TEST_BIND_NAME(testNormal<uchar8_tag>, name.str() + "+P", sizes[i], SELECT_PREDICATE, true);
+    }
+}
+
+template<typename Tag>
+void TestCompact::testNormal(size_t elements, SelectMode mode, bool indices)
+{
+    typedef typename Tag::type T;
+
+    clogs::Type type = Tag::makeType();
+    clogs::CompactProblem problem;
+    problem.setType(type);
+    if (mode == SELECT_STENCIL)
+        problem.setStencilType(clogs::TYPE_UCHAR);
+    else if (mode == SELECT_PREDICATE)
+        problem.setPredicate(Tag::length == 1 ? "x > 50" : "x.s0 > 50");
+    clogs::Compact compact(context, device, problem);
+
+    std::mt19937 engine;
+    clogs::Test::Array<Tag> inputHost(engine, elements, 0, 100);
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UCHAR> > stencilHost(engine, elements, 0, 1);
+    cl::Buffer input = inputHost.upload(context, CL_MEM_READ_ONLY);
+    cl::Buffer stencil;
+    if (mode == SELECT_STENCIL)
+        stencil = stencilHost.upload(context, CL_MEM_READ_ONLY);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, elements * sizeof(T));
+    cl::Buffer outputIndices;
+    if (indices)
+        outputIndices = cl::Buffer(context, CL_MEM_WRITE_ONLY, elements * sizeof(cl_uint));
+    cl::Buffer count(context, CL_MEM_WRITE_ONLY, 3 * sizeof(cl_uint));
+
+    compact.enqueue(queue, input, stencil, output, outputIndices, count, 2, elements);
+
+    /* Compute model answer on host */
+    clogs::Test::Array<Tag> expected;
+    std::vector<cl_uint> expectedIndices;
+    for (size_t i = 0; i < elements; i++)
+    {
+        bool select;
+        if (mode == SELECT_ELEMENTS)
+        {
+            select = false;
+            for (unsigned int j = 0; j < Tag::length; j++)
+                if (Tag::access(inputHost[i], j) != 0)
+                    select = true;
+        }
+        else if (mode == SELECT_STENCIL)
+            select = stencilHost[i] != 0;
+        else
+            select = Tag::access(inputHost[i], 0) > 50;
+        if (select)
+        {
+            expected.push_back(inputHost[i]);
+            expectedIndices.push_back(i);
+        }
+    }
+
+    cl_uint countHost;
+    queue.enqueueReadBuffer(count, CL_TRUE, 2 * sizeof(cl_uint), sizeof(cl_uint), &countHost);
+    CPPUNIT_ASSERT_EQUAL(cl_uint(expected.size()), countHost);
+    if (countHost > 0)
+    {
+        clogs::Test::Array<Tag> outputHost(countHost);
+        queue.enqueueReadBuffer(output, CL_TRUE, 0, countHost * sizeof(T), &outputHost[0]);
+        expected.checkEqual(outputHost, CPPUNIT_SOURCELINE());
+        if (indices)
+        {
+            std::vector<cl_uint> indicesHost(countHost);
+            queue.enqueueReadBuffer(outputIndices, CL_TRUE, 0, countHost * sizeof(cl_uint), &indicesHost[0]);
+            CLOGS_ASSERT_VECTORS_EQUAL(expectedIndices, indicesHost);
+        }
+    }
+}
+
+void TestCompact::testEventCallback()
+{
+    int events = 0;
+    {
+        clogs::CompactProblem problem;
+        problem.setType(clogs::TYPE_UINT);
+        clogs::Compact compact(context, device, problem);
+        cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+        cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+        cl::Buffer count(context, CL_MEM_READ_WRITE, 4);
+        compact.setEventCallback(clogs::Test::eventCallback, &events, clogs::Test::eventCallbackFree);
+        compact.enqueue(queue, buffer, out, cl::Buffer(), count, 0, 4);
+        queue.finish();
+        CPPUNIT_ASSERT(events > 0);
+    }
+    // Check that the free function was called in destructor
+    CPPUNIT_ASSERT_EQUAL(-1, events);
+}
+
+void TestCompact::testZero()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Compact compact(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer count(context, CL_MEM_READ_WRITE, 4);
+    compact.enqueue(queue, buffer, out, cl::Buffer(), count, 0, 0);
+    queue.finish();
+}
+
+void TestCompact::testMissingStencil()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setStencilType(clogs::TYPE_UCHAR);
+    clogs::Compact compact(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer count(context, CL_MEM_READ_WRITE, 4);
+    compact.enqueue(queue, buffer, out, cl::Buffer(), count, 0, 4);
+    queue.finish();
+}
+
+void TestCompact::testUnwriteableCount()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Compact compact(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer count(context, CL_MEM_READ_ONLY, 4);
+    compact.enqueue(queue, buffer, out, cl::Buffer(), count, 0, 4);
+    queue.finish();
+}
+
+void TestCompact::testOutputOverflow()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Compact compact(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 12);
+    cl::Buffer count(context, CL_MEM_READ_WRITE, 4);
+    compact.enqueue(queue, buffer, out, cl::Buffer(), count, 0, 4);
+    queue.finish();
+}
+
+void TestCompact::testVectorNoPredicate()
+{
+    clogs::CompactProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setStencilType(clogs::Type(clogs::TYPE_UINT, 2));
+    clogs::Compact compact(context, device, problem);
+}
+
+void TestCompact::testMultilinePredicate()
+{
+    clogs::CompactProblem problem;
+    problem.setPredicate("x > 0\n");
+}
+
+void TestCompact::testUninitializedProblem()
+{
+    clogs::CompactProblem problem;
+    clogs::Compact compact(context, device, problem);
+}
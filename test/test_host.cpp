@@ -0,0 +1,420 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Test code for the host backend.
+ */
+
+#include "../src/clhpp11.h"
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <clogs/radixsort.h>
+#include <clogs/scan.h>
+#include <clogs/reduce.h>
+#include "clogs_test.h"
+
+using namespace std;
+
+/**
+ * Tests the host implementations directly. These do not need an OpenCL
+ * device, so they are registered separately and always run.
+ */
+class TestHost : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestHost);
+    CPPUNIT_TEST_SUITE_ADD_CUSTOM_TESTS(addCustomTests);
+    CPPUNIT_TEST(testScanSegmented);
+    CPPUNIT_TEST(testReduceNaN);
+    CPPUNIT_TEST_EXCEPTION(testRadixsortUninitialized, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testRadixsortMaxBits, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testScanTransform, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testScanVector, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testScanSegmentedFlags, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testReduceStatistics, std::invalid_argument);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    static void addCustomTests(TestSuiteBuilderContextType &context);
+
+public:
+    /**
+     * Test sorting @a elements @c cl_uint keys with @c cl_ushort values, using
+     * only the low @a bits bits of the keys (0 for all).
+     */
+    void testRadixsort(size_t elements, unsigned int bits);
+
+    /**
+     * Test an exclusive or inclusive scan of @c cl_int values, with or
+     * without an offset.
+     */
+    void testScan(size_t elements, bool inclusive, bool offset);
+
+    /// Test a reduction of @c cl_int values with a built-in operator
+    void testReduce(size_t elements, clogs::OperatorType op);
+
+    void testScanSegmented();            ///< Test a segmented inclusive scan
+    void testReduceNaN();                ///< Test that minimum and maximum ignore NaNs
+    void testRadixsortUninitialized();   ///< Test sorting without a key type
+    void testRadixsortMaxBits();         ///< Test error handling when maxBits is too large
+    void testScanTransform();            ///< Test that transforms are rejected
+    void testScanVector();               ///< Test that vector types are rejected
+    void testScanSegmentedFlags();       ///< Test a segmented scan without head flags
+    void testReduceStatistics();         ///< Test that statistics are rejected
+};
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(TestHost, "host");
+
+void TestHost::addCustomTests(TestSuiteBuilderContextType &context)
+{
+    // Sizes cover the empty case, a single thread and several threads
+    const size_t sizes[] = {0, 1, 1000, 1000000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        std::ostringstream name;
+        name << sizes[i];
+        CLOGS_TEST_BIND_NAME(testRadixsort, name.str(), sizes[i], 0);
+        CLOGS_TEST_BIND_NAME(testRadixsort, name.str() + "+11", sizes[i], 11);
+        CLOGS_TEST_BIND_NAME(testScan, name.str(), sizes[i], false, false);
+        CLOGS_TEST_BIND_NAME(testScan, name.str() + "+I+O", sizes[i], true, true);
+        if (sizes[i] > 0)
+        {
+            CLOGS_TEST_BIND_NAME(testReduce, name.str() + "+sum", sizes[i], clogs::OPERATOR_SUM);
+            CLOGS_TEST_BIND_NAME(testReduce, name.str() + "+max", sizes[i], clogs::OPERATOR_MAX);
+        }
+    }
+}
+
+void TestHost::testRadixsort(size_t elements, unsigned int bits)
+{
+    clogs::RadixsortProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    problem.setValueType(clogs::TYPE_USHORT);
+
+    mt19937 engine;
+    const cl_uint maxKey = bits == 0 ? std::numeric_limits<cl_uint>::max() : (cl_uint(1) << bits) - 1;
+    uniform_int_distribution<cl_uint> keyDist(0, maxKey);
+    vector<cl_uint> keys(elements);
+    vector<cl_ushort> values(elements);
+    vector<pair<cl_uint, cl_ushort> > expected(elements);
+    for (size_t i = 0; i < elements; i++)
+    {
+        keys[i] = keyDist(engine);
+        values[i] = cl_ushort(i);
+        expected[i] = make_pair(keys[i], values[i]);
+    }
+    stable_sort(expected.begin(), expected.end(),
+                [](const pair<cl_uint, cl_ushort> &a, const pair<cl_uint, cl_ushort> &b)
+                { return a.first < b.first; });
+
+    clogs::hostRadixsort(problem, keys.data(), values.data(), elements, bits);
+    for (size_t i = 0; i < elements; i++)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected[i].first, keys[i]);
+        CPPUNIT_ASSERT_EQUAL(expected[i].second, values[i]);
+    }
+}
+
+void TestHost::testScan(size_t elements, bool inclusive, bool offset)
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setInclusive(inclusive);
+
+    mt19937 engine;
+    uniform_int_distribution<cl_int> dist(-1000, 1000);
+    vector<cl_int> in(elements), out(elements), expected(elements);
+    const cl_int offsetValue = 123;
+    cl_int sum = offset ? offsetValue : 0;
+    for (size_t i = 0; i < elements; i++)
+    {
+        in[i] = dist(engine);
+        if (inclusive)
+            sum += in[i];
+        expected[i] = sum;
+        if (!inclusive)
+            sum += in[i];
+    }
+
+    clogs::hostScan(problem, in.data(), out.data(), elements, offset ? &offsetValue : NULL);
+    CLOGS_ASSERT_VECTORS_EQUAL(expected, out);
+    // In-place
+    clogs::hostScan(problem, in.data(), in.data(), elements, offset ? &offsetValue : NULL);
+    CLOGS_ASSERT_VECTORS_EQUAL(expected, in);
+}
+
+void TestHost::testReduce(size_t elements, clogs::OperatorType op)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setOperator(op);
+
+    mt19937 engine;
+    uniform_int_distribution<cl_int> dist(-1000, 1000);
+    vector<cl_int> in(elements);
+    for (size_t i = 0; i < elements; i++)
+        in[i] = dist(engine);
+    cl_int expected;
+    if (op == clogs::OPERATOR_MAX)
+        expected = *max_element(in.begin(), in.end());
+    else
+    {
+        expected = 0;
+        for (size_t i = 0; i < elements; i++)
+            expected += in[i];
+    }
+
+    cl_int out;
+    clogs::hostReduce(problem, in.data(), &out, elements);
+    CPPUNIT_ASSERT_EQUAL(expected, out);
+}
+
+void TestHost::testScanSegmented()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInclusive(true);
+    problem.setSegmented(true);
+
+    const size_t elements = 1000000;
+    mt19937 engine;
+    uniform_int_distribution<cl_uint> dist(0, 100);
+    vector<cl_uint> in(elements), out(elements), expected(elements);
+    vector<cl_uchar> flags(elements);
+    cl_uint sum = 0;
+    for (size_t i = 0; i < elements; i++)
+    {
+        in[i] = dist(engine);
+        flags[i] = dist(engine) == 0;
+        if (flags[i])
+            sum = 0;
+        sum += in[i];
+        expected[i] = sum;
+    }
+
+    clogs::hostScanSegmented(problem, in.data(), out.data(), elements, flags.data());
+    CLOGS_ASSERT_VECTORS_EQUAL(expected, out);
+}
+
+void TestHost::testReduceNaN()
+{
+    const cl_float nan = numeric_limits<cl_float>::quiet_NaN();
+    const cl_float in[4] = {nan, 3.0f, nan, 1.0f};
+    cl_float out;
+
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_FLOAT);
+    problem.setOperator(clogs::OPERATOR_MIN);
+    clogs::hostReduce(problem, in, &out, 4);
+    CPPUNIT_ASSERT_EQUAL(1.0f, out);
+
+    problem.setOperator(clogs::OPERATOR_MAX);
+    clogs::hostReduce(problem, in, &out, 4);
+    CPPUNIT_ASSERT_EQUAL(3.0f, out);
+}
+
+void TestHost::testRadixsortUninitialized()
+{
+    clogs::RadixsortProblem problem;
+    cl_uint keys[1] = {0};
+    clogs::hostRadixsort(problem, keys, NULL, 1);
+}
+
+void TestHost::testRadixsortMaxBits()
+{
+    clogs::RadixsortProblem problem;
+    problem.setKeyType(clogs::TYPE_UCHAR);
+    cl_uchar keys[1] = {0};
+    clogs::hostRadixsort(problem, keys, NULL, 1, 9);
+}
+
+void TestHost::testScanTransform()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setTransform("x * 2");
+    cl_int data[1] = {0};
+    clogs::hostScan(problem, data, data, 1);
+}
+
+void TestHost::testScanVector()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::Type(clogs::TYPE_INT, 2));
+    cl_int2 data[1] = {};
+    clogs::hostScan(problem, data, data, 1);
+}
+
+void TestHost::testScanSegmentedFlags()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setSegmented(true);
+    cl_int data[1] = {0};
+    clogs::hostScan(problem, data, data, 1);
+}
+
+void TestHost::testReduceStatistics()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setStatistics(clogs::REDUCE_STATISTIC_SUM | clogs::REDUCE_STATISTIC_MAX);
+    cl_int in[1] = {0};
+    cl_int out[2];
+    clogs::hostReduce(problem, in, out, 1);
+}
+
+/*******************************************************/
+
+/**
+ * Tests that the algorithms dispatch to the host backend from their
+ * @c enqueue functions, and that events are still honoured.
+ */
+class TestBackend : public clogs::Test::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TestBackend);
+    CPPUNIT_TEST_SUITE_ADD_CUSTOM_TESTS(addCustomTests);
+    CPPUNIT_TEST_EXCEPTION(testHostUnsupported, std::invalid_argument);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    static void addCustomTests(TestSuiteBuilderContextType &context);
+
+public:
+    /// Test a radix sort of @c cl_uint keys with @a backend
+    void testRadixsort(clogs::Backend backend, size_t elements);
+
+    /// Test an inclusive scan of @c cl_uint values with @a backend, waiting for a later user event
+    void testScan(clogs::Backend backend, size_t elements);
+
+    /// Test a minimum reduction of @c cl_int values with @a backend, to a buffer
+    void testReduce(clogs::Backend backend, size_t elements);
+
+    /// Test that BACKEND_HOST rejects a problem the host cannot do
+    void testHostUnsupported();
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TestBackend);
+
+void TestBackend::addCustomTests(TestSuiteBuilderContextType &context)
+{
+    CLOGS_TEST_BIND(testRadixsort, clogs::BACKEND_HOST, 1000);
+    CLOGS_TEST_BIND(testRadixsort, clogs::BACKEND_AUTO, 100);
+    CLOGS_TEST_BIND(testRadixsort, clogs::BACKEND_AUTO, 1000000);
+    CLOGS_TEST_BIND(testScan, clogs::BACKEND_HOST, 1000);
+    CLOGS_TEST_BIND(testScan, clogs::BACKEND_AUTO, 100);
+    CLOGS_TEST_BIND(testReduce, clogs::BACKEND_HOST, 1000);
+    CLOGS_TEST_BIND(testReduce, clogs::BACKEND_AUTO, 100);
+}
+
+void TestBackend::testRadixsort(clogs::Backend backend, size_t elements)
+{
+    clogs::RadixsortProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    problem.setBackend(backend);
+    clogs::Radixsort sort(context, device, problem);
+
+    mt19937 engine;
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UINT> > keys(engine, elements);
+    cl::Buffer buffer = keys.upload(context, CL_MEM_READ_WRITE);
+    sort.enqueue(queue, buffer, cl::Buffer(), elements);
+    sort.enqueue(queue, buffer, cl::Buffer(), elements);   // already sorted
+
+    std::sort(keys.begin(), keys.end());
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UINT> > result(queue, buffer, elements);
+    keys.checkEqual(result, CPPUNIT_SOURCELINE());
+}
+
+void TestBackend::testScan(clogs::Backend backend, size_t elements)
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInclusive(true);
+    problem.setBackend(backend);
+    clogs::Scan scan(context, device, problem);
+
+    mt19937 engine;
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UINT> > in(engine, elements, 0, 100);
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UINT> > expected(elements);
+    cl_uint sum = 0;
+    for (size_t i = 0; i < elements; i++)
+    {
+        sum += in[i];
+        expected[i] = sum;
+    }
+    cl::Buffer inBuffer(context, CL_MEM_READ_WRITE, elements * sizeof(cl_uint));
+    cl::Buffer outBuffer(context, CL_MEM_READ_WRITE, elements * sizeof(cl_uint));
+
+    /* The upload waits for a user event that is only set after the scan has
+     * been enqueued, so the scan must neither block in enqueue nor read the
+     * buffer before then.
+     */
+    cl::UserEvent start(context);
+    vector<cl::Event> waitStart(1, start);
+    cl::Event uploadEvent;
+    queue.enqueueWriteBuffer(inBuffer, CL_FALSE, 0, elements * sizeof(cl_uint), &in[0],
+                             &waitStart, &uploadEvent);
+    queue.flush();
+
+    vector<cl::Event> waitUpload(1, uploadEvent);
+    cl::Event scanEvent;
+    scan.enqueue(queue, inBuffer, outBuffer, elements, NULL, &waitUpload, &scanEvent);
+    CPPUNIT_ASSERT(scanEvent() != NULL);
+    start.setStatus(CL_COMPLETE);
+    scanEvent.wait();
+
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_UINT> > result(queue, outBuffer, elements);
+    expected.checkEqual(result, CPPUNIT_SOURCELINE());
+}
+
+void TestBackend::testReduce(clogs::Backend backend, size_t elements)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setOperator(clogs::OPERATOR_MIN);
+    problem.setBackend(backend);
+    clogs::Reduce reduce(context, device, problem);
+
+    mt19937 engine;
+    clogs::Test::Array<clogs::Test::TypeTag<clogs::TYPE_INT> > in(engine, elements, -1000000, 1000000);
+    cl::Buffer inBuffer = in.upload(context, CL_MEM_READ_ONLY);
+    cl::Buffer outBuffer(context, CL_MEM_READ_WRITE, 2 * sizeof(cl_int));
+    reduce.enqueue(queue, inBuffer, outBuffer, 0, elements, 1);
+
+    cl_int result;
+    queue.enqueueReadBuffer(outBuffer, CL_TRUE, sizeof(cl_int), sizeof(cl_int), &result);
+    CPPUNIT_ASSERT_EQUAL(*min_element(in.begin(), in.end()), result);
+}
+
+void TestBackend::testHostUnsupported()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setCustomOperator("a * b", "1");
+    problem.setBackend(clogs::BACKEND_HOST);
+    clogs::Reduce reduce(context, device, problem);
+}
@@ -74,6 +74,7 @@ class TestRadixsort : public clogs::Test::TestCommon<clogs::Radixsort>
     CPPUNIT_TEST(testTmpKeys);
     CPPUNIT_TEST(testTmpValues);
     CPPUNIT_TEST(testTmpSmall);
+    CPPUNIT_TEST(testDefaultParameters);
     CPPUNIT_TEST(testEventCallback);
 
     CPPUNIT_TEST_SUITE_END();
@@ -141,6 +142,9 @@ public:
     /// Tests using temporary buffers that are too small
     void testTmpSmall();
 
+    /// Tests sorting with the parameters used for untuned devices
+    void testDefaultParameters();
+
     /// Test that the event callback is called at least once
     void testEventCallback();
 
@@ -633,6 +637,45 @@ void TestRadixsort::testTmpSmall()
     testSort<clogs::Test::TypeTag<clogs::TYPE_UINT>, clogs::Test::TypeTag<clogs::TYPE_FLOAT, 4> >(128, 0, 127, 127);
 }
 
+void TestRadixsort::testDefaultParameters()
+{
+    typedef clogs::Test::TypeTag<clogs::TYPE_UINT> KeyTag;
+    typedef clogs::Test::TypeTag<clogs::TYPE_UINT> ValueTag;
+    const size_t size = 100000;
+
+    clogs::detail::RadixsortProblem problem;
+    problem.setKeyType(KeyTag::makeType());
+    problem.setValueType(ValueTag::makeType());
+    clogs::detail::Radixsort sort(context, device, problem,
+                                  clogs::detail::Radixsort::defaultParameters(device, problem));
+    mt19937 engine;
+
+    clogs::Test::Array<KeyTag> hostKeys(engine, size);
+    clogs::Test::Array<ValueTag> hostValues(engine, size);
+    vector<cl_uint> hostOrder(size);
+    for (size_t i = 0; i < size; i++)
+        hostOrder[i] = i;
+
+    cl::Buffer devKeys = hostKeys.upload(context, CL_MEM_READ_WRITE);
+    cl::Buffer devValues = hostValues.upload(context, CL_MEM_READ_WRITE);
+
+    stable_sort(hostOrder.begin(), hostOrder.end(), SortCompare<cl_uint>(hostKeys));
+    clogs::Test::Array<KeyTag> sortedKeys(size);
+    clogs::Test::Array<ValueTag> sortedValues(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        sortedKeys[i] = hostKeys[hostOrder[i]];
+        sortedValues[i] = hostValues[hostOrder[i]];
+    }
+
+    sort.enqueue(queue, devKeys, devValues, size);
+    clogs::Test::Array<KeyTag> resultKeys(queue, devKeys, size);
+    clogs::Test::Array<ValueTag> resultValues(queue, devValues, size);
+
+    sortedKeys.checkEqual(resultKeys, CPPUNIT_SOURCELINE());
+    sortedValues.checkEqual(resultValues, CPPUNIT_SOURCELINE());
+}
+
 void TestRadixsort::testEventCallback()
 {
     int events = 0;
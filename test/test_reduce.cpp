@@ -35,8 +35,12 @@
 #include <stdexcept>
 #include <vector>
 #include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <random>
 #include <sstream>
+#include <string>
 #include <clogs/reduce.h>
 #include <clogs/platform.h>
 #include "clogs_test.h"
@@ -56,6 +60,22 @@ class TestReduce : public clogs::Test::TestCommon<clogs::Reduce>
     CPPUNIT_TEST_EXCEPTION(testInputOverflow, clogs::Error);
     CPPUNIT_TEST_EXCEPTION(testOutputOverflow, clogs::Error);
     CPPUNIT_TEST_EXCEPTION(testUninitializedProblem, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testBitwiseFloat, std::invalid_argument);
+    CPPUNIT_TEST(testTransformComponent);
+    CPPUNIT_TEST_EXCEPTION(testTransformNewline, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testInputTypeLength, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testBinaryUnary, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testUnaryBinary, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testStatisticsUnknown, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testStatisticsOperator, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testStatisticsOverflow, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testIndexVector, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testIndexMissing, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testIndexUnexpected, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testSegmentedBinary, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testSegmentedOverflow, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testColumnsStride, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testReproducibleStatistics, std::invalid_argument);
     CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -69,6 +89,78 @@ private:
     template<typename Tag>
     void testNormal(size_t start, size_t elements, bool toHost);
 
+    /**
+     * Test reductions with operators other than addition. If
+     * @a customIdentity is non-empty, the operator is passed as an equivalent
+     * user-defined operator with that identity.
+     */
+    template<typename Tag>
+    void testOperator(size_t elements, clogs::OperatorType op, const std::string &customIdentity);
+
+    /**
+     * Test a reduction of @c cl_uchar inputs into @c cl_uint, using either
+     * a plain widening conversion or a transform that counts non-zero
+     * elements.
+     */
+    void testTransform(size_t elements, bool count);
+
+    /**
+     * Test a reduction of two inputs. If @a transform is empty, the dot
+     * product of @c cl_uchar vectors is computed as a @c cl_uint. Otherwise,
+     * @a transform is given the squared difference of @c cl_int inputs.
+     */
+    void testBinary(size_t first, size_t elements, const std::string &transform, bool toHost);
+
+    /**
+     * Test computing several statistics of @c cl_int values in one pass.
+     *
+     * @param elements    Number of elements to reduce
+     * @param statistics  Bitwise or of @ref clogs::ReduceStatistic flags
+     * @param toHost      Whether to read the results back to the host
+     */
+    void testStatistics(size_t elements, unsigned int statistics, bool toHost);
+
+    /**
+     * Test an argmin or argmax reduction of @c cl_int values. The values are
+     * drawn from a small range so that ties occur.
+     *
+     * @param first       Index of the first element to reduce
+     * @param elements    Number of elements to reduce
+     * @param index       Whether to find the minimum or maximum
+     * @param toHost      Whether to read the results back to the host
+     */
+    void testIndex(size_t first, size_t elements, clogs::ReduceIndex index, bool toHost);
+
+    /**
+     * Test a segmented reduction of @c cl_int values.
+     *
+     * @param first       Index of the first element of the range
+     * @param elements    Number of elements in the range
+     * @param maxSegment  Maximum segment length (segments may be empty)
+     * @param statistics  Bitwise or of @ref clogs::ReduceStatistic flags, or 0 for a sum
+     */
+    void testSegmented(size_t first, size_t elements, size_t maxSegment, unsigned int statistics);
+
+    /**
+     * Test reducing the columns of a matrix of @c cl_int values.
+     *
+     * @param first       Index of the first element of the first row
+     * @param rows        Number of rows
+     * @param columns     Number of columns
+     * @param rowStride   Distance between the starts of consecutive rows
+     */
+    void testColumns(size_t first, size_t rows, size_t columns, size_t rowStride);
+
+    /**
+     * Test a reproducible sum of @c cl_float values, which must match a
+     * pairwise sum on the host exactly.
+     *
+     * @param first       Index of the first element to reduce
+     * @param elements    Number of elements to reduce
+     * @param toHost      Whether to read the result back to the host
+     */
+    void testReproducible(size_t first, size_t elements, bool toHost);
+
     /// Test that the event callback is called the appropriate number of times
     void testEventCallback();
 
@@ -80,6 +172,22 @@ private:
     void testInputOverflow();      ///< Test error handling when input buffer is too small
     void testOutputOverflow();     ///< Test error handling when output buffer is too small
     void testUninitializedProblem(); ///< Test error handling when problem is uninitialized
+    void testBitwiseFloat();       ///< Test error handling for a bitwise operator on floats
+    void testTransformComponent(); ///< Test a transform that extracts one component of a vector
+    void testTransformNewline();   ///< Test error handling for a transform containing a newline
+    void testInputTypeLength();    ///< Test error handling when the input type has a different length
+    void testBinaryUnary();        ///< Test error handling for a binary reduction with one input
+    void testUnaryBinary();        ///< Test error handling for a unary reduction with two inputs
+    void testStatisticsUnknown();  ///< Test error handling for an unknown statistic flag
+    void testStatisticsOperator(); ///< Test error handling for statistics with an operator
+    void testStatisticsOverflow(); ///< Test error handling when the statistics overrun the output
+    void testIndexVector();        ///< Test error handling for an index with a vector type
+    void testIndexMissing();       ///< Test error handling for an index reduction without an index output
+    void testIndexUnexpected();    ///< Test error handling for an index output without an index reduction
+    void testSegmentedBinary();    ///< Test error handling for a segmented reduction of two inputs
+    void testSegmentedOverflow();  ///< Test error handling when the segment results overrun the output
+    void testColumnsStride();      ///< Test error handling when the row stride is less than the columns
+    void testReproducibleStatistics(); ///< Test error handling for a reproducible reduction with statistics
 };
 CPPUNIT_TEST_SUITE_REGISTRATION(TestReduce);
 
@@ -125,6 +233,51 @@ void TestReduce::addCustomTests(TestSuiteBuilderContextType &context)
             CLOGS_TEST_BIND_NAME(testNormal<int3_tag>, name.str(), firsts[i], sizes[i], toHost);
             CLOGS_TEST_BIND_NAME(testNormal<ulong2_tag>, name.str(), firsts[i], sizes[i], toHost);
         }
+
+        std::ostringstream name;
+        name << sizes[i];
+        typedef clogs::Test::TypeTag<clogs::TYPE_INT> int_tag;
+        typedef clogs::Test::TypeTag<clogs::TYPE_UINT> uint_tag;
+        typedef clogs::Test::TypeTag<clogs::TYPE_UCHAR> uchar_tag;
+        typedef clogs::Test::TypeTag<clogs::TYPE_SHORT, 4> short4_tag;
+        CLOGS_TEST_BIND_NAME(testOperator<int_tag>, name.str() + "+min", sizes[i], clogs::OPERATOR_MIN, "");
+        CLOGS_TEST_BIND_NAME(testOperator<short4_tag>, name.str() + "+max", sizes[i], clogs::OPERATOR_MAX, "");
+        CLOGS_TEST_BIND_NAME(testOperator<uint_tag>, name.str() + "+and", sizes[i], clogs::OPERATOR_AND, "");
+        CLOGS_TEST_BIND_NAME(testOperator<uint_tag>, name.str() + "+or", sizes[i], clogs::OPERATOR_OR, "");
+        CLOGS_TEST_BIND_NAME(testOperator<uchar_tag>, name.str() + "+xor", sizes[i], clogs::OPERATOR_XOR, "");
+        CLOGS_TEST_BIND_NAME(testOperator<int_tag>, name.str() + "+custom", sizes[i], clogs::OPERATOR_MIN, "INT_MAX");
+        CLOGS_TEST_BIND_NAME(testTransform, name.str() + "+widen", sizes[i], false);
+        CLOGS_TEST_BIND_NAME(testTransform, name.str() + "+count", sizes[i], true);
+        CLOGS_TEST_BIND_NAME(testBinary, name.str() + "+dot", firsts[i], sizes[i], "", false);
+        CLOGS_TEST_BIND_NAME(testBinary, name.str() + "+dot+H", firsts[i], sizes[i], "", true);
+        CLOGS_TEST_BIND_NAME(testBinary, name.str() + "+distance", firsts[i], sizes[i], "(x - y) * (x - y)", false);
+        const unsigned int all = clogs::REDUCE_STATISTIC_SUM | clogs::REDUCE_STATISTIC_MIN
+            | clogs::REDUCE_STATISTIC_MAX | clogs::REDUCE_STATISTIC_SUM_SQUARES;
+        CLOGS_TEST_BIND_NAME(testStatistics, name.str() + "+all", sizes[i], all, false);
+        CLOGS_TEST_BIND_NAME(testStatistics, name.str() + "+all+H", sizes[i], all, true);
+        CLOGS_TEST_BIND_NAME(testStatistics, name.str() + "+minmax", sizes[i],
+                             clogs::REDUCE_STATISTIC_MIN | clogs::REDUCE_STATISTIC_MAX, false);
+        CLOGS_TEST_BIND_NAME(testStatistics, name.str() + "+moments+H", sizes[i],
+                             clogs::REDUCE_STATISTIC_SUM | clogs::REDUCE_STATISTIC_SUM_SQUARES, true);
+        CLOGS_TEST_BIND_NAME(testIndex, name.str() + "+argmin", firsts[i], sizes[i], clogs::REDUCE_INDEX_ARGMIN, false);
+        CLOGS_TEST_BIND_NAME(testIndex, name.str() + "+argmax+H", firsts[i], sizes[i], clogs::REDUCE_INDEX_ARGMAX, true);
+        CLOGS_TEST_BIND_NAME(testSegmented, name.str() + "+seg3", firsts[i], sizes[i], 3, 0);
+        CLOGS_TEST_BIND_NAME(testSegmented, name.str() + "+seg1000", firsts[i], sizes[i], 1000, 0);
+        CLOGS_TEST_BIND_NAME(testSegmented, name.str() + "+seg100000", firsts[i], sizes[i], 100000, 0);
+        CLOGS_TEST_BIND_NAME(testSegmented, name.str() + "+seg1000+minmax", firsts[i], sizes[i], 1000,
+                             clogs::REDUCE_STATISTIC_MIN | clogs::REDUCE_STATISTIC_MAX);
+        CLOGS_TEST_BIND_NAME(testReproducible, name.str() + "+reproducible", firsts[i], sizes[i], false);
+        CLOGS_TEST_BIND_NAME(testReproducible, name.str() + "+reproducible+H", firsts[i], sizes[i], true);
+    }
+
+    const std::size_t rows[] =    {1, 1,    17, 1000000, 1000, 3, 5000};
+    const std::size_t columns[] = {1, 5000, 1,  64,      3,    1000, 100};
+    const std::size_t strides[] = {1, 5001, 4,  64,      3,    1024, 128};
+    for (std::size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++)
+    {
+        std::ostringstream name;
+        name << rows[i] << "x" << columns[i] << "/" << strides[i];
+        CLOGS_TEST_BIND_NAME(testColumns, name.str(), 3, rows[i], columns[i], strides[i]);
     }
 }
 
@@ -166,6 +319,338 @@ void TestReduce::testNormal(size_t start, size_t elements, bool toHost)
     CPPUNIT_ASSERT(Tag::equal(ref, outputHost));
 }
 
+template<typename Tag>
+void TestReduce::testOperator(size_t elements, clogs::OperatorType op, const std::string &customIdentity)
+{
+    typedef typename Tag::type T;
+    typedef typename Tag::scalarType S;
+
+    clogs::ReduceProblem problem;
+    problem.setType(Tag::makeType());
+    if (customIdentity.empty())
+        problem.setOperator(op);
+    else
+    {
+        const char * const expressions[] = {"a + b", "min(a, b)", "max(a, b)", "a & b", "a | b", "a ^ b"};
+        problem.setCustomOperator(expressions[op], customIdentity);
+    }
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    clogs::Test::Array<Tag> inputHost(engine, elements);
+    cl::Buffer input = inputHost.upload(context, CL_MEM_READ_ONLY);
+
+    T outputHost;
+    reduce.enqueue(queue, true, input, &outputHost, 0, elements);
+
+    T ref;
+    for (unsigned int j = 0; j < Tag::length; j++)
+    {
+        S accum = clogs::Test::operatorIdentity<S>(op);
+        for (size_t i = 0; i < elements; i++)
+            accum = clogs::Test::applyOperator(op, accum, Tag::access(inputHost[i], j));
+        Tag::access(ref, j) = accum;
+    }
+    CPPUNIT_ASSERT(Tag::equal(ref, outputHost));
+}
+
+void TestReduce::testTransform(size_t elements, bool count)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInputType(clogs::TYPE_UCHAR);
+    if (count)
+        problem.setTransform("x != 0 ? 1 : 0");
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<unsigned int> dist(0, 255);
+    std::vector<cl_uchar> inputHost(elements);
+    cl_uint ref = 0;
+    for (size_t i = 0; i < elements; i++)
+    {
+        inputHost[i] = dist(engine) & 0x13;
+        ref += count ? (inputHost[i] != 0) : inputHost[i];
+    }
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, elements, &inputHost[0]);
+
+    cl_uint outputHost;
+    reduce.enqueue(queue, true, input, &outputHost, 0, elements);
+    CPPUNIT_ASSERT_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testBinary(size_t first, size_t elements, const std::string &transform, bool toHost)
+{
+    clogs::ReduceProblem problem;
+    problem.setBinary(true);
+    if (transform.empty())
+    {
+        problem.setType(clogs::TYPE_UINT);
+        problem.setInputType(clogs::TYPE_UCHAR);
+    }
+    else
+    {
+        problem.setType(clogs::TYPE_INT);
+        problem.setTransform(transform);
+    }
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<int> dist(0, 255);
+    const size_t size = first + elements;
+    std::vector<cl_uchar> aHost(size), bHost(size);
+    std::vector<cl_int> cHost(size), dHost(size);
+    cl_uint ref = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        aHost[i] = dist(engine);
+        bHost[i] = dist(engine);
+        cHost[i] = aHost[i] - 128;
+        dHost[i] = bHost[i] - 128;
+        if (i >= first)
+        {
+            if (transform.empty())
+                ref += cl_uint(aHost[i]) * bHost[i];
+            else
+                ref += cl_uint((cHost[i] - dHost[i]) * (cHost[i] - dHost[i]));
+        }
+    }
+    cl::Buffer a, b;
+    if (transform.empty())
+    {
+        a = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, &aHost[0]);
+        b = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, &bHost[0]);
+    }
+    else
+    {
+        a = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size * sizeof(cl_int), &cHost[0]);
+        b = cl::Buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size * sizeof(cl_int), &dHost[0]);
+    }
+
+    cl_uint outputHost;
+    if (toHost)
+        reduce.enqueueBinary(queue, true, a, b, &outputHost, first, elements);
+    else
+    {
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, 2 * sizeof(cl_uint));
+        reduce.enqueueBinary(queue, a, b, output, first, elements, 1);
+        queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_uint), sizeof(cl_uint), &outputHost);
+    }
+    CPPUNIT_ASSERT_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testStatistics(size_t elements, unsigned int statistics, bool toHost)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setStatistics(statistics);
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<cl_int> dist(-1000, 1000);
+    std::vector<cl_int> inputHost(elements);
+    // Unsigned arithmetic gives well-defined wrapping on overflow
+    cl_uint sum = 0, sumSquares = 0;
+    cl_int minimum = std::numeric_limits<cl_int>::max();
+    cl_int maximum = std::numeric_limits<cl_int>::min();
+    for (size_t i = 0; i < elements; i++)
+    {
+        const cl_int x = dist(engine);
+        inputHost[i] = x;
+        sum += cl_uint(x);
+        sumSquares += cl_uint(x) * cl_uint(x);
+        minimum = std::min(minimum, x);
+        maximum = std::max(maximum, x);
+    }
+    std::vector<cl_int> ref;
+    if (statistics & clogs::REDUCE_STATISTIC_SUM)
+        ref.push_back(cl_int(sum));
+    if (statistics & clogs::REDUCE_STATISTIC_MIN)
+        ref.push_back(minimum);
+    if (statistics & clogs::REDUCE_STATISTIC_MAX)
+        ref.push_back(maximum);
+    if (statistics & clogs::REDUCE_STATISTIC_SUM_SQUARES)
+        ref.push_back(cl_int(sumSquares));
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     elements * sizeof(cl_int), &inputHost[0]);
+
+    std::vector<cl_int> outputHost(ref.size());
+    if (toHost)
+        reduce.enqueue(queue, true, input, &outputHost[0], 0, elements);
+    else
+    {
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, (ref.size() + 1) * sizeof(cl_int));
+        reduce.enqueue(queue, input, output, 0, elements, 1);
+        queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_int), ref.size() * sizeof(cl_int), &outputHost[0]);
+    }
+    CLOGS_ASSERT_VECTORS_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testIndex(size_t first, size_t elements, clogs::ReduceIndex index, bool toHost)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setIndex(index);
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<cl_int> dist(-20, 20);
+    std::vector<cl_int> inputHost(first + elements);
+    for (size_t i = 0; i < first + elements; i++)
+        inputHost[i] = dist(engine);
+    // Strict comparisons find the first occurrence of the extreme value
+    cl_uint refIndex = first;
+    for (size_t i = first; i < first + elements; i++)
+    {
+        if (index == clogs::REDUCE_INDEX_ARGMIN ? inputHost[i] < inputHost[refIndex] : inputHost[i] > inputHost[refIndex])
+            refIndex = i;
+    }
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     inputHost.size() * sizeof(cl_int), &inputHost[0]);
+
+    cl_int outputHost;
+    cl_uint indexHost;
+    if (toHost)
+        reduce.enqueueWithIndex(queue, true, input, &outputHost, &indexHost, first, elements);
+    else
+    {
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, 2 * sizeof(cl_int));
+        cl::Buffer indexOutput(context, CL_MEM_WRITE_ONLY, 3 * sizeof(cl_uint));
+        reduce.enqueueWithIndex(queue, input, output, indexOutput, first, elements, 1, 2);
+        queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_int), sizeof(cl_int), &outputHost);
+        queue.enqueueReadBuffer(indexOutput, CL_TRUE, 2 * sizeof(cl_uint), sizeof(cl_uint), &indexHost);
+    }
+    CPPUNIT_ASSERT_EQUAL(inputHost[refIndex], outputHost);
+    CPPUNIT_ASSERT_EQUAL(refIndex, indexHost);
+}
+
+void TestReduce::testSegmented(size_t first, size_t elements, size_t maxSegment, unsigned int statistics)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setStatistics(statistics);
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<cl_int> dist(-1000, 1000);
+    std::uniform_int_distribution<size_t> segmentDist(0, maxSegment);
+    std::vector<cl_int> inputHost(first + elements);
+    for (size_t i = 0; i < inputHost.size(); i++)
+        inputHost[i] = dist(engine);
+    std::vector<cl_uint> offsets;
+    for (size_t start = 0; start < elements; start += segmentDist(engine))
+        offsets.push_back(start);
+    // Empty segments at the end of the range
+    offsets.push_back(elements);
+    offsets.push_back(elements);
+
+    const size_t outputs = statistics == 0 ? 1 : 2;
+    std::vector<cl_int> ref;
+    for (size_t s = 0; s < offsets.size(); s++)
+    {
+        const size_t end = s + 1 < offsets.size() ? offsets[s + 1] : elements;
+        cl_uint sum = 0;
+        cl_int minimum = std::numeric_limits<cl_int>::max();
+        cl_int maximum = std::numeric_limits<cl_int>::min();
+        for (size_t i = offsets[s]; i < end; i++)
+        {
+            const cl_int x = inputHost[first + i];
+            sum += cl_uint(x);
+            minimum = std::min(minimum, x);
+            maximum = std::max(maximum, x);
+        }
+        if (statistics == 0)
+            ref.push_back(cl_int(sum));
+        else
+        {
+            ref.push_back(minimum);
+            ref.push_back(maximum);
+        }
+    }
+
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     inputHost.size() * sizeof(cl_int), &inputHost[0]);
+    cl::Buffer segmentOffsets(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                              offsets.size() * sizeof(cl_uint), &offsets[0]);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, (ref.size() + 1) * sizeof(cl_int));
+    reduce.enqueueSegmented(queue, input, output, first, elements, 1, segmentOffsets, offsets.size());
+
+    std::vector<cl_int> outputHost(offsets.size() * outputs);
+    queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_int), outputHost.size() * sizeof(cl_int), &outputHost[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testColumns(size_t first, size_t rows, size_t columns, size_t rowStride)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    clogs::Reduce reduce(context, device, problem);
+
+    std::mt19937 engine;
+    std::uniform_int_distribution<cl_int> dist(-1000, 1000);
+    std::vector<cl_int> inputHost(first + (rows - 1) * rowStride + columns);
+    for (size_t i = 0; i < inputHost.size(); i++)
+        inputHost[i] = dist(engine);
+    std::vector<cl_int> ref(columns);
+    for (size_t c = 0; c < columns; c++)
+    {
+        cl_uint sum = 0;
+        for (size_t r = 0; r < rows; r++)
+            sum += cl_uint(inputHost[first + r * rowStride + c]);
+        ref[c] = cl_int(sum);
+    }
+
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     inputHost.size() * sizeof(cl_int), &inputHost[0]);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, (columns + 1) * sizeof(cl_int));
+    reduce.enqueueColumns(queue, input, output, first, rows, columns, rowStride, 1);
+
+    std::vector<cl_int> outputHost(columns);
+    queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_int), columns * sizeof(cl_int), &outputHost[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testReproducible(size_t first, size_t elements, bool toHost)
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_FLOAT);
+    problem.setReproducible(true);
+    clogs::Reduce reduce(context, device, problem);
+
+    // Wide range of magnitudes, so that the order of addition matters
+    std::mt19937 engine;
+    std::uniform_real_distribution<cl_float> dist(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> exponentDist(-20, 20);
+    std::vector<cl_float> inputHost(first + elements);
+    for (size_t i = 0; i < inputHost.size(); i++)
+        inputHost[i] = std::ldexp(dist(engine), exponentDist(engine));
+
+    // Pairwise sum, padded with zeros to a power of two
+    size_t padded = 1;
+    while (padded < elements)
+        padded *= 2;
+    std::vector<cl_float> tree(padded, 0.0f);
+    std::copy(inputHost.begin() + first, inputHost.end(), tree.begin());
+    for (size_t scale = 1; scale < padded; scale *= 2)
+        for (size_t i = 0; i < padded; i += 2 * scale)
+            tree[i] = tree[i] + tree[i + scale];
+    const cl_float ref = tree[0] + 0.0f;
+
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     inputHost.size() * sizeof(cl_float), &inputHost[0]);
+    cl_float outputHost;
+    if (toHost)
+        reduce.enqueue(queue, true, input, &outputHost, first, elements);
+    else
+    {
+        cl::Buffer output(context, CL_MEM_WRITE_ONLY, 2 * sizeof(cl_float));
+        reduce.enqueue(queue, input, output, first, elements, 1);
+        queue.enqueueReadBuffer(output, CL_TRUE, sizeof(cl_float), sizeof(cl_float), &outputHost);
+    }
+    // Compare representations, since the result must be exact
+    CPPUNIT_ASSERT_EQUAL(0, std::memcmp(&ref, &outputHost, sizeof(cl_float)));
+}
+
 void TestReduce::testEventCallback()
 {
     int events = 0;
@@ -271,3 +756,179 @@ void TestReduce::testUninitializedProblem()
     clogs::ReduceProblem problem;
     clogs::Reduce reduce(context, device, problem);
 }
+
+void TestReduce::testBitwiseFloat()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_FLOAT);
+    problem.setOperator(clogs::OPERATOR_XOR);
+    clogs::Reduce reduce(context, device, problem);
+}
+
+void TestReduce::testTransformComponent()
+{
+    const size_t elements = 12345;
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setInputType(clogs::Type(clogs::TYPE_INT, 2));
+    problem.setTransform("x.s1");
+    clogs::Reduce reduce(context, device, problem);
+
+    std::vector<cl_int> inputHost(2 * elements);
+    cl_int ref = 0;
+    for (size_t i = 0; i < elements; i++)
+    {
+        inputHost[2 * i] = 1000;
+        inputHost[2 * i + 1] = cl_int(i % 7) - 3;
+        ref += inputHost[2 * i + 1];
+    }
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     inputHost.size() * sizeof(cl_int), &inputHost[0]);
+
+    cl_int outputHost;
+    reduce.enqueue(queue, true, input, &outputHost, 0, elements);
+    CPPUNIT_ASSERT_EQUAL(ref, outputHost);
+}
+
+void TestReduce::testBinaryUnary()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setBinary(true);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 4);
+    reduce.enqueue(queue, buffer, out, 0, 4, 0);
+    queue.finish();
+}
+
+void TestReduce::testUnaryBinary()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 4);
+    reduce.enqueueBinary(queue, buffer, buffer, out, 0, 4, 0);
+    queue.finish();
+}
+
+void TestReduce::testStatisticsUnknown()
+{
+    clogs::ReduceProblem problem;
+    problem.setStatistics(16);
+}
+
+void TestReduce::testStatisticsOperator()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setStatistics(clogs::REDUCE_STATISTIC_SUM);
+    problem.setOperator(clogs::OPERATOR_MAX);
+    clogs::Reduce reduce(context, device, problem);
+}
+
+void TestReduce::testStatisticsOverflow()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setStatistics(clogs::REDUCE_STATISTIC_MIN | clogs::REDUCE_STATISTIC_MAX);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 8);
+    reduce.enqueue(queue, buffer, out, 0, 4, 1);
+    queue.finish();
+}
+
+void TestReduce::testIndexVector()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::Type(clogs::TYPE_INT, 2));
+    problem.setIndex(clogs::REDUCE_INDEX_ARGMAX);
+    clogs::Reduce reduce(context, device, problem);
+}
+
+void TestReduce::testIndexMissing()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setIndex(clogs::REDUCE_INDEX_ARGMIN);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 4);
+    reduce.enqueue(queue, buffer, out, 0, 4, 0);
+    queue.finish();
+}
+
+void TestReduce::testIndexUnexpected()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 4);
+    cl::Buffer index(context, CL_MEM_READ_WRITE, 4);
+    reduce.enqueueWithIndex(queue, buffer, out, index, 0, 4, 0, 0);
+    queue.finish();
+}
+
+void TestReduce::testSegmentedBinary()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setBinary(true);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 8);
+    cl_uint offsetsHost[2] = {0, 2};
+    cl::Buffer offsets(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(offsetsHost), offsetsHost);
+    reduce.enqueueSegmented(queue, buffer, out, 0, 4, 0, offsets, 2);
+    queue.finish();
+}
+
+void TestReduce::testSegmentedOverflow()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 8);
+    cl_uint offsetsHost[2] = {0, 2};
+    cl::Buffer offsets(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(offsetsHost), offsetsHost);
+    reduce.enqueueSegmented(queue, buffer, out, 0, 4, 1, offsets, 2);
+    queue.finish();
+}
+
+void TestReduce::testColumnsStride()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    clogs::Reduce reduce(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 64);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    reduce.enqueueColumns(queue, buffer, out, 0, 2, 4, 3, 0);
+    queue.finish();
+}
+
+void TestReduce::testReproducibleStatistics()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_FLOAT);
+    problem.setReproducible(true);
+    problem.setStatistics(clogs::REDUCE_STATISTIC_SUM_SQUARES);
+    clogs::Reduce reduce(context, device, problem);
+}
+
+void TestReduce::testTransformNewline()
+{
+    clogs::ReduceProblem problem;
+    problem.setTransform("x *\n x");
+}
+
+void TestReduce::testInputTypeLength()
+{
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInputType(clogs::Type(clogs::TYPE_UCHAR, 2));
+    clogs::Reduce reduce(context, device, problem);
+}
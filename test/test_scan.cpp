@@ -37,7 +37,8 @@
 #include <vector>
 #include <cstddef>
 #include <random>
-#include <sstream>
+#include <limits>
+#include <string>
 #include <clogs/scan.h>
 #include <clogs/platform.h>
 #include "clogs_test.h"
@@ -66,9 +67,16 @@ class TestScan : public clogs::Test::TestCommon<clogs::Scan>
     CPPUNIT_TEST_EXCEPTION(testBadBuffer, clogs::Error);
     CPPUNIT_TEST_EXCEPTION(testZero, clogs::Error);
     CPPUNIT_TEST_EXCEPTION(testVoid, std::invalid_argument);
-    CPPUNIT_TEST_EXCEPTION(testFloat, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testAccumulationIntegral, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testMultilineOperator, std::invalid_argument);
     CPPUNIT_TEST_EXCEPTION(testOffsetWriteOnly, clogs::Error);
     CPPUNIT_TEST_EXCEPTION(testOffsetTooSmall, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testSegmentedNoFlags, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testNotSegmented, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testBatchedStride, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testBatchedSegmented, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testInputTypeLength, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testTransformNewline, std::invalid_argument);
     CPPUNIT_TEST_SUITE_END();
 
 protected:
@@ -82,6 +90,58 @@ public:
     template<typename T>
     void testSimple(const clogs::Type &type, size_t size, OffsetType useOffset);
 
+    /// Test inclusive scans with @ref clogs::Scan
+    template<typename T>
+    void testInclusive(const clogs::Type &type, size_t size, OffsetType useOffset);
+
+    /**
+     * Test scans with operators other than addition. If @a customIdentity
+     * is non-empty, the operator is passed as an equivalent user-defined
+     * operator with that identity.
+     */
+    template<typename T>
+    void testOperator(const clogs::Type &type, size_t size, clogs::OperatorType op,
+                      const std::string &customIdentity, OffsetType useOffset);
+
+    /**
+     * Test scans of floating-point values. The values are small integers, so
+     * that the results are exact unless they exceed the precision of @a T.
+     */
+    template<typename T>
+    void testFloat(const clogs::Type &type, size_t size, clogs::ScanAccumulation accumulation,
+                   OffsetType useOffset);
+
+    /**
+     * Test segmented scans, with random segment lengths up to @a maxSegment.
+     * If @a useOffsets is true, the segments are passed as offsets rather
+     * than head flags.
+     */
+    template<typename T>
+    void testSegmented(const clogs::Type &type, size_t size, size_t maxSegment,
+                       bool useOffsets, bool inclusive);
+
+    /**
+     * Test batched scans. If @a useOffset is true, the same offset is applied
+     * to every row.
+     */
+    template<typename T>
+    void testBatched(const clogs::Type &type, size_t rows, size_t rowLength, size_t rowStride,
+                     bool useOffset, bool inclusive);
+
+    /**
+     * Test scans where the input has type @a TIn and the output has type
+     * @a T. The input values are chosen so that the sums overflow @a TIn.
+     */
+    template<typename TIn, typename T>
+    void testWidening(const clogs::Type &inType, const clogs::Type &type, size_t size,
+                      bool segmented);
+
+    /**
+     * Test scans with a transform. The input is @c cl_uchar, and the number
+     * of preceding elements that are at least 128 is computed.
+     */
+    void testTransform(size_t size);
+
     /// Test operation of @ref clogs::Scan on vectors
     template<typename T>
     void testVector(const clogs::Type &type, size_t size, OffsetType useOffset);
@@ -102,9 +162,16 @@ public:
     void testBadBuffer();          ///< Test error handling when the buffer is invalid
     void testZero();               ///< Test error handling when elements is zero
     void testVoid();               ///< Test error handling when passing a void type
-    void testFloat();              ///< Test error handling when passing a non-integral type
+    void testAccumulationIntegral(); ///< Test error handling for non-native accumulation of an integral type
+    void testMultilineOperator();  ///< Test error handling for a custom operator with a newline
     void testOffsetWriteOnly();    ///< Test error handling when offset buffer not readable
     void testOffsetTooSmall();     ///< Test error handling when offset index is too large
+    void testSegmentedNoFlags();   ///< Test error handling when a segmented scan is given no flags
+    void testNotSegmented();       ///< Test error handling when flags are given to an unsegmented scan
+    void testBatchedStride();      ///< Test error handling when the row stride is less than the row length
+    void testBatchedSegmented();   ///< Test error handling when batching a segmented scan
+    void testInputTypeLength();    ///< Test error handling when the input type has a different length
+    void testTransformNewline();   ///< Test error handling for a transform containing a newline
     void testUninitialized();      ///< Test error handling when an uninitialized object is used
 };
 CPPUNIT_TEST_SUITE_REGISTRATION(TestScan);
@@ -135,7 +202,47 @@ void TestScan::addCustomTests(TestSuiteBuilderContextType &context)
             CLOGS_TEST_BIND_NAME(testSimple<cl_short>, name.str(), clogs::TYPE_SHORT, sizes[i], useOffset);
             CLOGS_TEST_BIND_NAME(testSimple<cl_int>, name.str(), clogs::TYPE_INT, sizes[i], useOffset);
             CLOGS_TEST_BIND_NAME(testSimple<cl_long>, name.str(), clogs::TYPE_LONG, sizes[i], useOffset);
+            CLOGS_TEST_BIND_NAME(testInclusive<cl_uint>, name.str(), clogs::TYPE_UINT, sizes[i], useOffset);
+            CLOGS_TEST_BIND_NAME(testInclusive<cl_long>, name.str(), clogs::TYPE_LONG, sizes[i], useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_int>, name.str() + "+min", clogs::TYPE_INT, sizes[i], clogs::OPERATOR_MIN, "", useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_ushort>, name.str() + "+max", clogs::TYPE_USHORT, sizes[i], clogs::OPERATOR_MAX, "", useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_uint>, name.str() + "+and", clogs::TYPE_UINT, sizes[i], clogs::OPERATOR_AND, "", useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_ulong>, name.str() + "+or", clogs::TYPE_ULONG, sizes[i], clogs::OPERATOR_OR, "", useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_uchar>, name.str() + "+xor", clogs::TYPE_UCHAR, sizes[i], clogs::OPERATOR_XOR, "", useOffset);
+            CLOGS_TEST_BIND_NAME(testOperator<cl_long>, name.str() + "+custom", clogs::TYPE_LONG, sizes[i], clogs::OPERATOR_MAX, "LONG_MIN", useOffset);
+            // Native float sums become inexact beyond 2^24
+            if (sizes[i] <= 0x10000)
+                CLOGS_TEST_BIND_NAME(testFloat<cl_float>, name.str(), clogs::TYPE_FLOAT, sizes[i], clogs::SCAN_ACCUMULATE_NATIVE, useOffset);
+            CLOGS_TEST_BIND_NAME(testFloat<cl_float>, name.str() + "+compensated", clogs::TYPE_FLOAT, sizes[i], clogs::SCAN_ACCUMULATE_COMPENSATED, useOffset);
+            CLOGS_TEST_BIND_NAME(testFloat<cl_float>, name.str() + "+wide", clogs::TYPE_FLOAT, sizes[i], clogs::SCAN_ACCUMULATE_WIDE, useOffset);
+            CLOGS_TEST_BIND_NAME(testFloat<cl_double>, name.str(), clogs::TYPE_DOUBLE, sizes[i], clogs::SCAN_ACCUMULATE_NATIVE, useOffset);
         }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        ostringstream name;
+        name << sizes[i];
+        CLOGS_TEST_BIND_NAME(testSegmented<cl_uint>, name.str() + "+short", clogs::TYPE_UINT, sizes[i], 20, false, false);
+        CLOGS_TEST_BIND_NAME(testSegmented<cl_uint>, name.str() + "+long", clogs::TYPE_UINT, sizes[i], 100000, false, false);
+        CLOGS_TEST_BIND_NAME(testSegmented<cl_int>, name.str() + "+offsets", clogs::TYPE_INT, sizes[i], 1000, true, false);
+        CLOGS_TEST_BIND_NAME(testSegmented<cl_long>, name.str() + "+inclusive", clogs::TYPE_LONG, sizes[i], 1000, false, true);
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        ostringstream name;
+        name << sizes[i];
+        CLOGS_TEST_BIND_NAME((testWidening<cl_uchar, cl_uint>), name.str() + "+uchar", clogs::TYPE_UCHAR, clogs::TYPE_UINT, sizes[i], false);
+        CLOGS_TEST_BIND_NAME((testWidening<cl_ushort, cl_ulong>), name.str() + "+ushort", clogs::TYPE_USHORT, clogs::TYPE_ULONG, sizes[i], false);
+        CLOGS_TEST_BIND_NAME((testWidening<cl_uchar, cl_uint>), name.str() + "+segmented", clogs::TYPE_UCHAR, clogs::TYPE_UINT, sizes[i], true);
+        CLOGS_TEST_BIND_NAME(testTransform, name.str(), sizes[i]);
+    }
+
+    CLOGS_TEST_BIND_NAME(testBatched<cl_uint>, "1x100000", clogs::TYPE_UINT, 1, 100000, 100000, false, false);
+    CLOGS_TEST_BIND_NAME(testBatched<cl_uint>, "3x12345+H", clogs::TYPE_UINT, 3, 12345, 12400, true, false);
+    CLOGS_TEST_BIND_NAME(testBatched<cl_int>, "1000x17", clogs::TYPE_INT, 1000, 17, 20, false, false);
+    CLOGS_TEST_BIND_NAME(testBatched<cl_long>, "10000x1+H", clogs::TYPE_LONG, 10000, 1, 1, true, false);
+    CLOGS_TEST_BIND_NAME(testBatched<cl_ulong>, "64x5000+inclusive", clogs::TYPE_ULONG, 64, 5000, 5000, false, true);
 }
 
 template<typename T>
@@ -184,6 +291,351 @@ void TestScan::testSimple(const clogs::Type &type, size_t size, OffsetType useOf
     CLOGS_ASSERT_VECTORS_EQUAL(hValues, result);
 }
 
+template<typename T>
+void TestScan::testInclusive(const clogs::Type &type, size_t size, OffsetType useOffset)
+{
+    mt19937 engine;
+    cl_ulong limit = (type.getBaseSize() == 8) ? 0x1234567890LL : 100;
+    uniform_int_distribution<T> dist(5, T(limit));
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    problem.setInclusive(true);
+    clogs::Scan scan(context, device, problem);
+
+    vector<T> hValues;
+    hValues.reserve(size + 1);
+
+    /* Populate host with random data */
+    for (size_t i = 0; i < size; i++)
+        hValues.push_back(dist(engine));
+    hValues.push_back(T(0xDEADBEEF)); // sentinel for check for overrun
+
+    T hOffset[2] = {T(0), T(useOffset != OFFSET_NONE ? dist(engine) : 0)}; // first element is just padding to test indexing
+
+    cl::Buffer dValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, (size + 1) * sizeof(T), &hValues[0]);
+    cl::Buffer dOffset(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * 2, &hOffset[0]);
+
+    /* Compute model answer on host */
+    T sum = hOffset[1];
+    for (size_t i = 0; i < size; i++)
+    {
+        sum += hValues[i];
+        hValues[i] = sum;
+    }
+
+    /* Compute on device */
+    if (useOffset == OFFSET_BUFFER)
+        scan.enqueue(queue, dValues, size, dOffset, 1);
+    else if (useOffset == OFFSET_HOST)
+        scan.enqueue(queue, dValues, size, &hOffset[1]);
+    else
+        scan.enqueue(queue, dValues, size, NULL);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dValues, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hValues, result);
+}
+
+template<typename T>
+void TestScan::testOperator(const clogs::Type &type, size_t size, clogs::OperatorType op,
+                            const std::string &customIdentity, OffsetType useOffset)
+{
+    mt19937 engine;
+    uniform_int_distribution<T> dist(numeric_limits<T>::min(), numeric_limits<T>::max());
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    if (customIdentity.empty())
+        problem.setOperator(op);
+    else
+    {
+        const char * const expressions[] = {"a + b", "min(a, b)", "max(a, b)", "a & b", "a | b", "a ^ b"};
+        problem.setCustomOperator(expressions[op], customIdentity);
+    }
+    clogs::Scan scan(context, device, problem);
+
+    vector<T> hValues;
+    hValues.reserve(size + 1);
+
+    /* Populate host with random data */
+    for (size_t i = 0; i < size; i++)
+        hValues.push_back(dist(engine));
+    hValues.push_back(T(0xDEADBEEF)); // sentinel for check for overrun
+
+    T hOffset[2] = {T(0), useOffset != OFFSET_NONE ? dist(engine) : clogs::Test::operatorIdentity<T>(op)};
+
+    cl::Buffer dValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, (size + 1) * sizeof(T), &hValues[0]);
+    cl::Buffer dOffset(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * 2, &hOffset[0]);
+
+    /* Compute model answer on host */
+    T sum = hOffset[1];
+    for (size_t i = 0; i < size; i++)
+    {
+        T cur = hValues[i];
+        hValues[i] = sum;
+        sum = clogs::Test::applyOperator(op, sum, cur);
+    }
+
+    /* Compute on device */
+    if (useOffset == OFFSET_BUFFER)
+        scan.enqueue(queue, dValues, size, dOffset, 1);
+    else if (useOffset == OFFSET_HOST)
+        scan.enqueue(queue, dValues, size, &hOffset[1]);
+    else
+        scan.enqueue(queue, dValues, size, NULL);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dValues, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hValues, result);
+}
+
+template<typename T>
+void TestScan::testFloat(const clogs::Type &type, size_t size, clogs::ScanAccumulation accumulation,
+                         OffsetType useOffset)
+{
+    if (!type.isComputable(device) || !type.isStorable(device))
+        return;
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    problem.setAccumulation(accumulation);
+    if (accumulation == clogs::SCAN_ACCUMULATE_WIDE
+        && !clogs::Type(clogs::TYPE_DOUBLE).isComputable(device))
+        return; // wide accumulation of floats requires double support
+
+    mt19937 engine;
+    uniform_int_distribution<int> dist(0, 100);
+    clogs::Scan scan(context, device, problem);
+
+    vector<T> hValues;
+    hValues.reserve(size + 1);
+
+    /* Populate host with random data */
+    for (size_t i = 0; i < size; i++)
+        hValues.push_back(T(dist(engine)));
+    hValues.push_back(T(-1.5)); // sentinel for check for overrun
+
+    T hOffset[2] = {T(0), T(useOffset != OFFSET_NONE ? dist(engine) : 0)};
+
+    cl::Buffer dValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, (size + 1) * sizeof(T), &hValues[0]);
+    cl::Buffer dOffset(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * 2, &hOffset[0]);
+
+    /* Compute model answer on host. The partial sums are integers below
+     * 2^53, so they are exact in double precision.
+     */
+    vector<double> expected;
+    expected.reserve(size);
+    double sum = hOffset[1];
+    for (size_t i = 0; i < size; i++)
+    {
+        expected.push_back(sum);
+        sum += hValues[i];
+    }
+
+    /* Compute on device */
+    if (useOffset == OFFSET_BUFFER)
+        scan.enqueue(queue, dValues, size, dOffset, 1);
+    else if (useOffset == OFFSET_HOST)
+        scan.enqueue(queue, dValues, size, &hOffset[1]);
+    else
+        scan.enqueue(queue, dValues, size, NULL);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dValues, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    for (size_t i = 0; i < size; i++)
+    {
+        const double tolerance = expected[i] * numeric_limits<T>::epsilon() * 32;
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected[i], double(result[i]), tolerance);
+    }
+    CPPUNIT_ASSERT_EQUAL(T(-1.5), result[size]);
+}
+
+template<typename T>
+void TestScan::testSegmented(const clogs::Type &type, size_t size, size_t maxSegment,
+                             bool useOffsets, bool inclusive)
+{
+    mt19937 engine;
+    uniform_int_distribution<T> dist(5, 100);
+    uniform_int_distribution<size_t> segmentDist(1, maxSegment);
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    problem.setSegmented(true);
+    problem.setInclusive(inclusive);
+    clogs::Scan scan(context, device, problem);
+
+    vector<T> hValues;
+    vector<cl_uchar> hFlags(size, 0);
+    vector<cl_uint> hOffsets;
+    hValues.reserve(size + 1);
+
+    /* Populate host with random data and segments */
+    for (size_t i = 0; i < size; i++)
+        hValues.push_back(dist(engine));
+    hValues.push_back(T(0xDEADBEEF)); // sentinel for check for overrun
+    for (size_t start = 0; start < size; start += segmentDist(engine))
+    {
+        hFlags[start] = 1;
+        hOffsets.push_back(start);
+    }
+
+    cl::Buffer dValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, (size + 1) * sizeof(T), &hValues[0]);
+    cl::Buffer dFlags(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, &hFlags[0]);
+    cl::Buffer dOffsets(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, hOffsets.size() * sizeof(cl_uint), &hOffsets[0]);
+
+    /* Compute model answer on host */
+    T sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        T cur = hValues[i];
+        if (hFlags[i])
+            sum = 0;
+        if (inclusive)
+            sum += cur;
+        hValues[i] = sum;
+        if (!inclusive)
+            sum += cur;
+    }
+
+    /* Compute on device */
+    if (useOffsets)
+        scan.enqueueSegmentedOffsets(queue, dValues, dValues, size, dOffsets, hOffsets.size());
+    else
+        scan.enqueueSegmented(queue, dValues, dValues, size, dFlags);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dValues, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hValues, result);
+}
+
+template<typename T>
+void TestScan::testBatched(const clogs::Type &type, size_t rows, size_t rowLength, size_t rowStride,
+                           bool useOffset, bool inclusive)
+{
+    mt19937 engine;
+    uniform_int_distribution<T> dist(5, 100);
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    problem.setInclusive(inclusive);
+    clogs::Scan scan(context, device, problem);
+
+    const size_t size = (rows - 1) * rowStride + rowLength;
+    vector<T> hValues;
+    hValues.reserve(size + 1);
+
+    /* Populate host with random data */
+    for (size_t i = 0; i < size; i++)
+        hValues.push_back(dist(engine));
+    hValues.push_back(T(0xDEADBEEF)); // sentinel for check for overrun
+    const T offset = useOffset ? dist(engine) : T(0);
+
+    cl::Buffer dValues(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, (size + 1) * sizeof(T), &hValues[0]);
+
+    /* Compute model answer on host. Elements between rows are unchanged. */
+    for (size_t r = 0; r < rows; r++)
+    {
+        T sum = offset;
+        for (size_t i = r * rowStride; i < r * rowStride + rowLength; i++)
+        {
+            T cur = hValues[i];
+            if (inclusive)
+                sum += cur;
+            hValues[i] = sum;
+            if (!inclusive)
+                sum += cur;
+        }
+    }
+
+    /* Compute on device */
+    scan.enqueueBatched(queue, dValues, dValues, rows, rowLength, rowStride,
+                        useOffset ? &offset : NULL);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dValues, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hValues, result);
+}
+
+template<typename TIn, typename T>
+void TestScan::testWidening(const clogs::Type &inType, const clogs::Type &type, size_t size,
+                            bool segmented)
+{
+    mt19937 engine;
+    const unsigned int limit = numeric_limits<TIn>::max();
+    uniform_int_distribution<unsigned int> dist(limit - 100, limit);
+    clogs::ScanProblem problem;
+    problem.setType(type);
+    problem.setInputType(inType);
+    problem.setSegmented(segmented);
+    clogs::Scan scan(context, device, problem);
+
+    vector<TIn> hIn;
+    vector<T> hOut;
+    vector<cl_uchar> hFlags(size, 0);
+    hIn.reserve(size);
+    hOut.reserve(size + 1);
+
+    /* Populate host with random data, and segments of up to 1000 elements */
+    for (size_t i = 0; i < size; i++)
+        hIn.push_back(TIn(dist(engine)));
+    for (size_t i = 0; i < size; i += 1000)
+        hFlags[i] = 1;
+
+    cl::Buffer dIn(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size * sizeof(TIn), &hIn[0]);
+    cl::Buffer dFlags(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, &hFlags[0]);
+    cl::Buffer dOut(context, CL_MEM_READ_WRITE, (size + 1) * sizeof(T));
+    const T sentinel = T(0xDEADBEEF); // check for overrun
+    queue.enqueueWriteBuffer(dOut, CL_TRUE, size * sizeof(T), sizeof(T), &sentinel);
+
+    /* Compute model answer on host */
+    T sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (segmented && hFlags[i])
+            sum = 0;
+        hOut.push_back(sum);
+        sum += hIn[i];
+    }
+    hOut.push_back(sentinel);
+
+    /* Compute on device */
+    if (segmented)
+        scan.enqueueSegmented(queue, dIn, dOut, size, dFlags);
+    else
+        scan.enqueue(queue, dIn, dOut, size);
+
+    vector<T> result(size + 1);
+    queue.enqueueReadBuffer(dOut, CL_TRUE, 0, (size + 1) * sizeof(T), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hOut, result);
+}
+
+void TestScan::testTransform(size_t size)
+{
+    mt19937 engine;
+    uniform_int_distribution<unsigned int> dist(0, 255);
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInputType(clogs::TYPE_UCHAR);
+    problem.setTransform("x >= 128 ? 1 : 0");
+    clogs::Scan scan(context, device, problem);
+
+    vector<cl_uchar> hIn;
+    vector<cl_uint> hOut;
+    hIn.reserve(size);
+    hOut.reserve(size);
+    cl_uint sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        hIn.push_back(dist(engine));
+        hOut.push_back(sum);
+        sum += hIn[i] >= 128;
+    }
+
+    cl::Buffer dIn(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, size, &hIn[0]);
+    cl::Buffer dOut(context, CL_MEM_WRITE_ONLY, size * sizeof(cl_uint));
+    scan.enqueue(queue, dIn, dOut, size);
+
+    vector<cl_uint> result(size);
+    queue.enqueueReadBuffer(dOut, CL_TRUE, 0, size * sizeof(cl_uint), &result[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(hOut, result);
+}
+
 template<typename T>
 void TestScan::testVector(const clogs::Type &type, size_t size, OffsetType useOffset)
 {
@@ -310,9 +762,18 @@ void TestScan::testVoid()
     clogs::Scan scan(context, device, clogs::TYPE_VOID);
 }
 
-void TestScan::testFloat()
+void TestScan::testAccumulationIntegral()
 {
-    clogs::Scan scan(context, device, clogs::TYPE_FLOAT);
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_INT);
+    problem.setAccumulation(clogs::SCAN_ACCUMULATE_COMPENSATED);
+    clogs::Scan scan(context, device, problem);
+}
+
+void TestScan::testMultilineOperator()
+{
+    clogs::ScanProblem problem;
+    problem.setCustomOperator("a +\nb", "0");
 }
 
 void TestScan::testOffsetWriteOnly()
@@ -333,6 +794,59 @@ void TestScan::testOffsetTooSmall()
     queue.finish();
 }
 
+void TestScan::testSegmentedNoFlags()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setSegmented(true);
+    clogs::Scan scan(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    scan.enqueue(queue, buffer, 4);
+    queue.finish();
+}
+
+void TestScan::testNotSegmented()
+{
+    clogs::Scan scan(context, device, clogs::TYPE_UINT);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer flags(context, CL_MEM_READ_ONLY, 4);
+    scan.enqueueSegmented(queue, buffer, buffer, 4, flags);
+    queue.finish();
+}
+
+void TestScan::testInputTypeLength()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setInputType(clogs::Type(clogs::TYPE_UCHAR, 2));
+    clogs::Scan scan(context, device, problem);
+}
+
+void TestScan::testTransformNewline()
+{
+    clogs::ScanProblem problem;
+    problem.setTransform("x\n");
+}
+
+void TestScan::testBatchedStride()
+{
+    clogs::Scan scan(context, device, clogs::TYPE_UINT);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 64);
+    scan.enqueueBatched(queue, buffer, buffer, 2, 4, 3);
+    queue.finish();
+}
+
+void TestScan::testBatchedSegmented()
+{
+    clogs::ScanProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setSegmented(true);
+    clogs::Scan scan(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 64);
+    scan.enqueueBatched(queue, buffer, buffer, 2, 4, 4);
+    queue.finish();
+}
+
 /*******************************************************/
 
 #include "../tools/timer.h"
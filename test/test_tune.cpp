@@ -33,7 +33,10 @@
 #include <utility>
 #include <vector>
 #include <clogs/tune.h>
+#include <clogs/reduce.h>
 #include "../src/tune.h"
+#include "../src/cache.h"
+#include "../src/sqlite3.h"
 #include "test_common.h"
 
 /// Test that @ref clogs::TunePolicy works
@@ -41,9 +44,12 @@ class TestTunePolicy : public clogs::Test::TestFixture
 {
     CPPUNIT_TEST_SUITE(TestTunePolicy);
     CPPUNIT_TEST_EXCEPTION(testDisable, clogs::CacheError);
+    CPPUNIT_TEST(testFallback);
     CPPUNIT_TEST(testVerbositySilent);
     CPPUNIT_TEST(testVerbosityTerse);
     CPPUNIT_TEST(testVerbosityNormal);
+    CPPUNIT_TEST(testBackground);
+    CPPUNIT_TEST(testBackgroundFailure);
     CPPUNIT_TEST_SUITE_END();
 
 private:
@@ -54,10 +60,26 @@ private:
         const boost::any &param);
     std::string getOutput(const clogs::TunePolicy &tunePolicy);
 
+    typedef clogs::detail::Table<
+        clogs::detail::ReduceParameters::Key,
+        clogs::detail::ReduceParameters::Value> Table;
+
+    /**
+     * Runs @a tune with @ref clogs::detail::BackgroundTuner and waits for it,
+     * storing the result in an in-memory table. Returns whether a result was
+     * stored, and the output reported to the policy in @a output.
+     */
+    bool runBackground(
+        const std::function<clogs::detail::ReduceParameters::Value()> &tune,
+        clogs::detail::ReduceParameters::Value &value, std::string &output);
+
     void testDisable();
+    void testFallback();            ///< Test that untuned algorithms work with tuning disabled
     void testVerbositySilent();
     void testVerbosityTerse();
     void testVerbosityNormal();
+    void testBackground();          ///< Test that background tuning stores its result
+    void testBackgroundFailure();   ///< Test that background tuning reports exceptions
 };
 CPPUNIT_TEST_SUITE_REGISTRATION(TestTunePolicy);
 
@@ -104,6 +126,37 @@ void TestTunePolicy::testDisable()
     getOutput(policy);
 }
 
+void TestTunePolicy::testFallback()
+{
+    clogs::TunePolicy policy;
+    std::ostringstream out;
+    policy.setEnabled(false);
+    policy.setFallback(true);
+    policy.setOutput(out);
+
+    // A custom operator that is unlikely to have been tuned already
+    clogs::ReduceProblem problem;
+    problem.setType(clogs::TYPE_UINT);
+    problem.setCustomOperator("a + b + 0", "0");
+    problem.setTunePolicy(policy);
+    clogs::Reduce reduce(context, device, problem);
+
+    const std::size_t elements = 100000;
+    std::vector<cl_uint> values(elements);
+    cl_uint expected = 0;
+    for (std::size_t i = 0; i < elements; i++)
+    {
+        values[i] = i % 1000;
+        expected += values[i];
+    }
+    cl::Buffer input(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                     elements * sizeof(cl_uint), &values[0]);
+    cl_uint actual = 0;
+    reduce.enqueue(queue, true, input, &actual, 0, elements);
+    CPPUNIT_ASSERT_EQUAL(expected, actual);
+    CPPUNIT_ASSERT_EQUAL(std::string(""), out.str());
+}
+
 void TestTunePolicy::testVerbositySilent()
 {
     clogs::TunePolicy policy;
@@ -131,3 +184,53 @@ void TestTunePolicy::testVerbosityNormal()
         std::string("Tuning test on ") + deviceName + '\n'
         + ".!.\n.\n", out);
 }
+
+bool TestTunePolicy::runBackground(
+    const std::function<clogs::detail::ReduceParameters::Value()> &tune,
+    clogs::detail::ReduceParameters::Value &value, std::string &output)
+{
+    sqlite3 *con = NULL;
+    int status = sqlite3_open_v2(
+        ":memory:", &con, SQLITE_OPEN_FULLMUTEX | SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    clogs::detail::sqlite3_ptr db(con);
+    CPPUNIT_ASSERT_EQUAL(SQLITE_OK, status);
+    Table table(con, "background");
+
+    clogs::detail::ReduceParameters::Key key = clogs::detail::ReduceParameters::Key();
+    key.device = clogs::detail::deviceKey(device);
+
+    std::ostringstream out;
+    clogs::TunePolicy policy;
+    policy.setOutput(out);
+    clogs::detail::BackgroundTuner::get().start(table, key, clogs::detail::getDetail(policy), tune);
+    clogs::waitForTuning();
+
+    output = out.str();
+    return table.lookup(key, value);
+}
+
+void TestTunePolicy::testBackground()
+{
+    clogs::detail::ReduceParameters::Value expected = clogs::detail::ReduceParameters::Value();
+    expected.reduceWorkGroupSize = 64;
+    expected.reduceBlocks = 17;
+
+    clogs::detail::ReduceParameters::Value actual;
+    std::string output;
+    bool found = runBackground([expected]() { return expected; }, actual, output);
+    CPPUNIT_ASSERT(found);
+    CPPUNIT_ASSERT_EQUAL(expected.reduceWorkGroupSize, actual.reduceWorkGroupSize);
+    CPPUNIT_ASSERT_EQUAL(expected.reduceBlocks, actual.reduceBlocks);
+    CPPUNIT_ASSERT_EQUAL(std::string(""), output);
+}
+
+void TestTunePolicy::testBackgroundFailure()
+{
+    clogs::detail::ReduceParameters::Value actual;
+    std::string output;
+    bool found = runBackground(
+        []() -> clogs::detail::ReduceParameters::Value { throw clogs::TuneError("no suitable kernel found"); },
+        actual, output);
+    CPPUNIT_ASSERT(!found);
+    CPPUNIT_ASSERT_EQUAL(std::string("Tuning failed: no suitable kernel found\n"), output);
+}
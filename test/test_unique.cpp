@@ -0,0 +1,280 @@
+/* Copyright (c) 2018 Bruce Merry
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file
+ *
+ * Test code for unique and run-length encoding.
+ */
+
+#include "../src/clhpp11.h"
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <cstddef>
+#include <random>
+#include <clogs/scan.h>
+#include <clogs/unique.h>
+#include <clogs/platform.h>
+#include "clogs_test.h"
+#include "test_common.h"
+
+class TestUnique : public clogs::Test::TestCommon<clogs::Unique>
+{
+    CPPUNIT_TEST_SUB_SUITE(TestUnique, clogs::Test::TestCommon<clogs::Unique>);
+    CPPUNIT_TEST_SUITE_ADD_CUSTOM_TESTS(addCustomTests);
+    CPPUNIT_TEST(testRunLengthEncode);
+    CPPUNIT_TEST(testEventCallback);
+    CPPUNIT_TEST_EXCEPTION(testZero, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testUnwriteableNumRuns, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testCountsOverflow, clogs::Error);
+    CPPUNIT_TEST_EXCEPTION(testVoidKey, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testUninitializedProblem, std::invalid_argument);
+    CPPUNIT_TEST_EXCEPTION(testUninitializedProblemUntuned, std::invalid_argument);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    virtual clogs::Unique *factory();
+
+private:
+    /// Add tests dynamically
+    static void addCustomTests(TestSuiteBuilderContextType &context);
+
+    /**
+     * Test normal operation of @ref clogs::Unique. The keys are drawn at
+     * random from [0, @a maxKey], so small values give many runs of equal
+     * keys and zero gives a single run.
+     */
+    template<typename Tag>
+    void testNormal(size_t elements, int maxKey, bool counts);
+
+    /// Test run-length encoding of a fixed input, with the counts output
+    void testRunLengthEncode();
+
+    /// Test that the event callback is called the appropriate number of times
+    void testEventCallback();
+
+    void testZero();                  ///< Test error handling with zero elements
+    void testUnwriteableNumRuns();    ///< Test error handling with an unwriteable numRuns buffer
+    void testCountsOverflow();        ///< Test error handling when the counts buffer is too small
+    void testVoidKey();               ///< Test error handling for a void key type
+    void testUninitializedProblem();  ///< Test error handling when problem is uninitialized
+    void testUninitializedProblemUntuned(); ///< Test that the key type is checked before tuning
+};
+CPPUNIT_TEST_SUITE_REGISTRATION(TestUnique);
+
+clogs::Unique *TestUnique::factory()
+{
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    return new clogs::Unique(context, device, problem);
+}
+
+void TestUnique::addCustomTests(TestSuiteBuilderContextType &context)
+{
+    const std::size_t sizes[] = {1, 17, 0x80, 0xffff, 0x10000, 0x210000, 0x210123};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        std::ostringstream name;
+        name << sizes[i];
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_UINT> >, name.str(), sizes[i], 2, true);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_UINT> >, name.str() + "+single", sizes[i], 0, true);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_UCHAR> >, name.str(), sizes[i], 1, false);
+        CLOGS_TEST_BIND_NAME(testNormal<clogs::Test::TypeTag<clogs::TYPE_ULONG> >, name.str(), sizes[i], 3, true);
+
+        typedef clogs::Test::TypeTag<clogs::TYPE_INT, 2> int2_tag;
+        CLOGS_TEST_BIND_NAME(testNormal<int2_tag>, name.str(), sizes[i], 1, true);
+    }
+}
+
+template<typename Tag>
+void TestUnique::testNormal(size_t elements, int maxKey, bool counts)
+{
+    typedef typename Tag::type T;
+
+    clogs::UniqueProblem problem;
+    problem.setKeyType(Tag::makeType());
+    clogs::Unique unique(context, device, problem);
+
+    std::mt19937 engine;
+    clogs::Test::Array<Tag> keysHost(engine, elements, 0, maxKey);
+    cl::Buffer keys = keysHost.upload(context, CL_MEM_READ_ONLY);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, elements * sizeof(T));
+    cl::Buffer outputCounts;
+    if (counts)
+        outputCounts = cl::Buffer(context, CL_MEM_WRITE_ONLY, elements * sizeof(cl_uint));
+    cl::Buffer numRuns(context, CL_MEM_WRITE_ONLY, 3 * sizeof(cl_uint));
+
+    unique.enqueue(queue, keys, output, outputCounts, numRuns, 1, elements);
+
+    /* Compute model answer on host */
+    clogs::Test::Array<Tag> expected;
+    std::vector<cl_uint> expectedCounts;
+    for (size_t i = 0; i < elements; i++)
+    {
+        if (i == 0 || !Tag::equal(keysHost[i], keysHost[i - 1]))
+        {
+            expected.push_back(keysHost[i]);
+            expectedCounts.push_back(0);
+        }
+        expectedCounts.back()++;
+    }
+
+    cl_uint numRunsHost;
+    queue.enqueueReadBuffer(numRuns, CL_TRUE, sizeof(cl_uint), sizeof(cl_uint), &numRunsHost);
+    CPPUNIT_ASSERT_EQUAL(cl_uint(expected.size()), numRunsHost);
+    clogs::Test::Array<Tag> outputHost(numRunsHost);
+    queue.enqueueReadBuffer(output, CL_TRUE, 0, numRunsHost * sizeof(T), &outputHost[0]);
+    expected.checkEqual(outputHost, CPPUNIT_SOURCELINE());
+    if (counts)
+    {
+        std::vector<cl_uint> countsHost(numRunsHost);
+        queue.enqueueReadBuffer(outputCounts, CL_TRUE, 0, numRunsHost * sizeof(cl_uint), &countsHost[0]);
+        CLOGS_ASSERT_VECTORS_EQUAL(expectedCounts, countsHost);
+    }
+}
+
+void TestUnique::testRunLengthEncode()
+{
+    const cl_uint keysHost[] = {5, 5, 5, 2, 2, 7, 5, 5};
+    const cl_uint expectedKeys[] = {5, 2, 7, 5};
+    const cl_uint expectedCounts[] = {3, 2, 1, 2};
+    const size_t elements = sizeof(keysHost) / sizeof(keysHost[0]);
+    const size_t runs = sizeof(expectedKeys) / sizeof(expectedKeys[0]);
+
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    clogs::Unique unique(context, device, problem);
+
+    cl::Buffer keys(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(keysHost), (void *) keysHost);
+    cl::Buffer output(context, CL_MEM_WRITE_ONLY, elements * sizeof(cl_uint));
+    cl::Buffer counts(context, CL_MEM_WRITE_ONLY, elements * sizeof(cl_uint));
+    cl::Buffer numRuns(context, CL_MEM_WRITE_ONLY, sizeof(cl_uint));
+    unique.enqueue(queue, keys, output, counts, numRuns, 0, elements);
+
+    cl_uint numRunsHost;
+    queue.enqueueReadBuffer(numRuns, CL_TRUE, 0, sizeof(cl_uint), &numRunsHost);
+    CPPUNIT_ASSERT_EQUAL(cl_uint(runs), numRunsHost);
+    std::vector<cl_uint> outputHost(runs);
+    std::vector<cl_uint> countsHost(runs);
+    queue.enqueueReadBuffer(output, CL_TRUE, 0, runs * sizeof(cl_uint), &outputHost[0]);
+    queue.enqueueReadBuffer(counts, CL_TRUE, 0, runs * sizeof(cl_uint), &countsHost[0]);
+    CLOGS_ASSERT_VECTORS_EQUAL(std::vector<cl_uint>(expectedKeys, expectedKeys + runs), outputHost);
+    CLOGS_ASSERT_VECTORS_EQUAL(std::vector<cl_uint>(expectedCounts, expectedCounts + runs), countsHost);
+}
+
+void TestUnique::testEventCallback()
+{
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+
+    // Count the commands of the internal scan, which depend on the tuning
+    int scanEvents = 0;
+    {
+        clogs::Scan scan(context, device, clogs::TYPE_UINT);
+        cl::Buffer positions(context, CL_MEM_READ_WRITE, 16);
+        scan.setEventCallback(clogs::Test::eventCallback, &scanEvents);
+        scan.enqueue(queue, positions, 4);
+        queue.finish();
+    }
+
+    int events = 0;
+    {
+        clogs::UniqueProblem problem;
+        problem.setKeyType(clogs::TYPE_UINT);
+        clogs::Unique unique(context, device, problem);
+        cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+        cl::Buffer counts(context, CL_MEM_READ_WRITE, 16);
+        cl::Buffer numRuns(context, CL_MEM_READ_WRITE, 4);
+        unique.setEventCallback(clogs::Test::eventCallback, &events, clogs::Test::eventCallbackFree);
+        unique.enqueue(queue, buffer, out, numRuns, 0, 4);
+        queue.finish();
+        // Flags and scatter kernels, plus the scan
+        CPPUNIT_ASSERT_EQUAL(2 + scanEvents, events);
+        unique.enqueue(queue, buffer, out, counts, numRuns, 0, 4);
+        queue.finish();
+        // The counts kernel as well
+        CPPUNIT_ASSERT_EQUAL(2 * (2 + scanEvents) + 1, events);
+    }
+    // Check that the free function was called in destructor
+    CPPUNIT_ASSERT_EQUAL(-1, events);
+}
+
+void TestUnique::testZero()
+{
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    clogs::Unique unique(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer numRuns(context, CL_MEM_READ_WRITE, 4);
+    unique.enqueue(queue, buffer, out, numRuns, 0, 0);
+    queue.finish();
+}
+
+void TestUnique::testUnwriteableNumRuns()
+{
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    clogs::Unique unique(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer numRuns(context, CL_MEM_READ_ONLY, 4);
+    unique.enqueue(queue, buffer, out, numRuns, 0, 4);
+    queue.finish();
+}
+
+void TestUnique::testCountsOverflow()
+{
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_UINT);
+    clogs::Unique unique(context, device, problem);
+    cl::Buffer buffer(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer out(context, CL_MEM_READ_WRITE, 16);
+    cl::Buffer counts(context, CL_MEM_READ_WRITE, 12);
+    cl::Buffer numRuns(context, CL_MEM_READ_WRITE, 4);
+    unique.enqueue(queue, buffer, out, counts, numRuns, 0, 4);
+    queue.finish();
+}
+
+void TestUnique::testVoidKey()
+{
+    clogs::UniqueProblem problem;
+    problem.setKeyType(clogs::TYPE_VOID);
+}
+
+void TestUnique::testUninitializedProblem()
+{
+    clogs::UniqueProblem problem;
+    clogs::Unique unique(context, device, problem);
+}
+
+void TestUnique::testUninitializedProblemUntuned()
+{
+    // The key type must be rejected before the scan looks for its tuning
+    clogs::TunePolicy policy;
+    policy.setEnabled(false);
+    clogs::UniqueProblem problem;
+    problem.setTunePolicy(policy);
+    clogs::Unique unique(context, device, problem);
+}